@@ -0,0 +1,772 @@
+/*
+ * ===--- eccpem_bench.c ----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * Benchmark of the key generation, write and read paths. Every operation is run
+ * on every curve at 1..N threads, and throughput, latency percentiles and the
+ * number of OpenSSL heap allocations per operation are emitted as JSON so
+ * results can be tracked over time.
+ *
+ * With --bulk-keys, bulk output of that many key pairs per curve is compared
+ * too: one pair of PEM files per key (CreateECCKeysPemFilesBatch) against two
+ * PEM bundles (CreateECCKeysPemBundles).
+ *
+ * With --load-files, a directory of that many public key files per curve is
+ * loaded with EccPemKeyDirectoryLoadPublicKeys at 1..N threads.
+ *
+ * With --sign-digests, that many digests per curve are signed with
+ * EccPemSignBatch and verified with EccPemVerifyBatch at 1..N threads.
+ *
+ * With --provider or --propq, the operations that take a curve handle (key
+ * generation with a curve, the key pool, reader contexts and PEM bundles) use a
+ * handle of EccPemGetCurveFromProvider, while the operations that take a curve
+ * name keep the default provider, so both show up side by side.
+ *
+ * Built with ECCPEM_INSTRUMENTATION, the stage counters of the whole run are
+ * emitted as well.
+ *
+ * Usage:
+ *   eccpem_bench [--iterations N] [--max-threads N] [--curves a,b,...]
+ *                [--bulk-keys N] [--load-files N] [--sign-digests N] [--dir DIR]
+ *                [--provider NAME] [--propq QUERY] [--output FILE]
+ */
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <openssl/crypto.h>
+#include <openssl/opensslv.h>
+#include <openssl/provider.h>
+
+#include "eccpem.h"
+#include "eccpem_internal.h"
+
+#define BENCH_MAX_CURVES 16
+
+/* Longest curve name and longest file name appended to --dir, e.g.
+ * "/load_<curve>/key_<index>.pem". Longer directories are rejected at startup,
+ * so every file path of the benchmark fits into PATH_MAX. */
+#define BENCH_MAX_CURVE_NAME_LEN 64
+#define BENCH_MAX_SUFFIX_LEN (BENCH_MAX_CURVE_NAME_LEN + 64)
+#define BENCH_MAX_KEY_SIZE ECCPEM_MAX_PUBLIC_KEY_SIZE
+
+/* Number of heap allocations made by OpenSSL, counted through
+ * CRYPTO_set_mem_functions. */
+static atomic_size_t g_num_allocations;
+
+static void* CountingMalloc(size_t size, const char* file, int line) {
+  (void)file;
+  (void)line;
+  atomic_fetch_add_explicit(&g_num_allocations, 1, memory_order_relaxed);
+  return malloc(size);
+}
+
+static void* CountingRealloc(void* ptr, size_t size, const char* file, int line) {
+  (void)file;
+  (void)line;
+  atomic_fetch_add_explicit(&g_num_allocations, 1, memory_order_relaxed);
+  return realloc(ptr, size);
+}
+
+static void CountingFree(void* ptr, const char* file, int line) {
+  (void)file;
+  (void)line;
+  free(ptr);
+}
+
+static const char* kDefaultCurves[] = {"prime256v1", "secp256k1", "secp384r1", "secp521r1"};
+
+/* Settings of a benchmark run. */
+typedef struct {
+  size_t iterations;
+  unsigned int max_threads;
+  const char* curves[BENCH_MAX_CURVES];
+  size_t num_curves;
+  size_t bulk_keys;
+  size_t load_files;
+  size_t sign_digests;
+  char dir[PATH_MAX];
+  const char* provider;
+  const char* propq;
+  OSSL_LIB_CTX* libctx;
+  const char* output_file;
+} BenchConfig;
+
+/* State of one benchmark thread. */
+typedef struct {
+  const char* curve;
+  const EccPemCurve* curve_handle;
+  EccPemKeyPool* key_pool;
+  EccPemReader* reader;
+  unsigned int private_key_size;
+  unsigned int compressed_key_size;
+  char pubkey_file[PATH_MAX];
+  char privkey_file[PATH_MAX];
+  double* latencies;
+  size_t num_failed;
+} BenchThread;
+
+/*
+ * Operation under test. run performs one operation and returns 1 on success.
+ * The operations run in table order for every curve and thread count, so read
+ * operations find the files written by CreateECCKeysPemFiles.
+ */
+typedef struct {
+  const char* name;
+  int (*run)(BenchThread* thread);
+} BenchOperation;
+
+/* Job shared by the workers of one measurement. */
+typedef struct {
+  const BenchOperation* operation;
+  BenchThread* threads;
+  size_t iterations;
+} BenchJob;
+
+
+
+static int RunCreateKeys(BenchThread* thread) {
+  return CreateECCKeysPemFiles(thread->curve, thread->pubkey_file, thread->privkey_file);
+}
+
+static int RunCreateKeysWithCurve(BenchThread* thread) {
+  return CreateECCKeysPemFilesWithCurve(thread->curve_handle, thread->pubkey_file,
+                                        thread->privkey_file);
+}
+
+static int RunTakePooledKeys(BenchThread* thread) {
+  return EccPemKeyPoolTakePemFiles(thread->key_pool, thread->pubkey_file, thread->privkey_file);
+}
+
+static int RunReadPrivateKey(BenchThread* thread) {
+  uint8_t private_key[BENCH_MAX_KEY_SIZE];
+  return ReadPrivateKeyPemFile(thread->privkey_file, private_key, thread->private_key_size);
+}
+
+static int RunReadPublicKey(BenchThread* thread) {
+  uint8_t public_key[BENCH_MAX_KEY_SIZE];
+  return ReadPublicKeyPemFile(thread->pubkey_file, public_key, thread->compressed_key_size);
+}
+
+static int RunReaderReadPrivateKey(BenchThread* thread) {
+  uint8_t private_key[BENCH_MAX_KEY_SIZE];
+  return EccPemReaderReadPrivateKeyFile(thread->reader, thread->privkey_file, private_key,
+                                        thread->private_key_size);
+}
+
+static int RunReaderReadPublicKey(BenchThread* thread) {
+  uint8_t public_key[BENCH_MAX_KEY_SIZE];
+  return EccPemReaderReadPublicKeyFile(thread->reader, thread->pubkey_file, public_key,
+                                       thread->compressed_key_size);
+}
+
+static const BenchOperation kOperations[] = {
+    {"CreateECCKeysPemFiles", RunCreateKeys},
+    {"CreateECCKeysPemFilesWithCurve", RunCreateKeysWithCurve},
+    {"EccPemKeyPoolTakePemFiles", RunTakePooledKeys},
+    {"ReadPrivateKeyPemFile", RunReadPrivateKey},
+    {"ReadPublicKeyPemFile", RunReadPublicKey},
+    {"EccPemReaderReadPrivateKeyFile", RunReaderReadPrivateKey},
+    {"EccPemReaderReadPublicKeyFile", RunReaderReadPublicKey},
+};
+
+
+
+static void BenchWorker(void* arg, unsigned int worker_index) {
+  BenchJob* job = (BenchJob*)arg;
+  BenchThread* thread = &job->threads[worker_index];
+  for (size_t i = 0; i < job->iterations; ++i) {
+    const double start = EccPemNowSeconds();
+    if (!job->operation->run(thread)) {
+      ++thread->num_failed;
+    }
+    thread->latencies[i] = EccPemNowSeconds() - start;
+  }
+}
+
+static int CompareDoubles(const void* a, const void* b) {
+  const double x = *(const double*)a;
+  const double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Function returns the given percentile of sorted values, in microseconds.
+ */
+static double PercentileMicros(const double sorted[], const size_t num_values,
+                               const double percentile) {
+  const size_t index = (size_t)(percentile * (double)(num_values - 1) + 0.5);
+  return sorted[index] * 1e6;
+}
+
+
+
+/*
+ * Function measures one operation on one curve at a thread count and prints the
+ * result as a JSON object.
+ *
+ * Returns:
+ * - 1 if the measurement was run.
+ * - 0 if memory allocation failed.
+ */
+static int MeasureOperation(const BenchConfig* config, const BenchOperation* operation,
+                            BenchThread threads[], const unsigned int num_threads,
+                            FILE* out, const int first_result) {
+  double* latencies = calloc(num_threads * config->iterations, sizeof(double));
+  if (latencies == NULL) {
+    fprintf(stderr, "Allocating latency samples failed.\n");
+    return 0;
+  }
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    threads[t].latencies = latencies + t * config->iterations;
+    threads[t].num_failed = 0;
+  }
+
+  BenchJob job = {operation, threads, config->iterations};
+  const size_t start_allocations = atomic_load(&g_num_allocations);
+  const double start = EccPemNowSeconds();
+  const unsigned int num_workers = EccPemRunWorkers(num_threads, BenchWorker, &job);
+  const double elapsed = EccPemNowSeconds() - start;
+  const size_t num_allocations = atomic_load(&g_num_allocations) - start_allocations;
+
+  size_t num_failed = 0;
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    num_failed += threads[t].num_failed;
+  }
+
+  /* Only workers that ran produced samples */
+  const size_t num_ops = num_workers * config->iterations;
+  qsort(latencies, num_ops, sizeof(double), CompareDoubles);
+  fprintf(out,
+          "%s\n    {\"operation\": \"%s\", \"curve\": \"%s\", \"threads\": %u, "
+          "\"ops\": %zu, \"failed\": %zu, \"seconds\": %.6f, \"keys_per_second\": %.1f, "
+          "\"p50_us\": %.1f, \"p99_us\": %.1f, \"allocs_per_op\": %.1f}",
+          first_result ? "" : ",", operation->name, threads[0].curve, num_workers, num_ops,
+          num_failed, elapsed, elapsed > 0.0 ? (double)(num_ops - num_failed) / elapsed : 0.0,
+          PercentileMicros(latencies, num_ops, 0.50),
+          PercentileMicros(latencies, num_ops, 0.99),
+          (double)num_allocations / (double)num_ops);
+  fflush(out);
+
+  free(latencies);
+  return 1;
+}
+
+
+
+/*
+ * Function formats a file path of the benchmark into a PATH_MAX buffer.
+ *
+ * Returns:
+ * - 1 if the path fits.
+ * - 0 if it would be truncated.
+ */
+static int FormatPath(char path[], const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+static int FormatPath(char path[], const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  const int len = vsnprintf(path, PATH_MAX, format, args);
+  va_end(args);
+  if (len < 0 || len >= PATH_MAX) {
+    fprintf(stderr, "Benchmark file path is too long.\n");
+    return 0;
+  }
+  return 1;
+}
+
+
+
+/*
+ * Function returns the curve handle of the operations that take one, bound to the
+ * provider under test if one was selected.
+ */
+static const EccPemCurve* GetBenchCurve(const BenchConfig* config, const char* curve) {
+  return EccPemGetCurveFromProvider(curve, config->libctx, config->propq);
+}
+
+
+
+/*
+ * Function runs every operation on a curve at 1, 2, 4, ... max_threads threads.
+ */
+static int BenchCurve(const BenchConfig* config, const char* curve, FILE* out,
+                      int* first_result) {
+  const EccPemCurve* curve_handle = GetBenchCurve(config, curve);
+  if (curve_handle == NULL) {
+    return 0;
+  }
+
+  /* Sized so one measurement drains it below the watermark, which shows stalls */
+  EccPemKeyPool* key_pool = EccPemKeyPoolCreate(curve_handle, config->iterations,
+                                                config->iterations / 2);
+  BenchThread* threads = calloc(config->max_threads, sizeof(BenchThread));
+  if (key_pool == NULL || threads == NULL) {
+    fprintf(stderr, "Allocating benchmark threads failed.\n");
+    EccPemKeyPoolFree(key_pool);
+    free(threads);
+    return 0;
+  }
+
+  int ret_value = 1;
+  for (unsigned int t = 0; t < config->max_threads; ++t) {
+    threads[t].curve = curve;
+    threads[t].curve_handle = curve_handle;
+    threads[t].key_pool = key_pool;
+    /* A reader per thread, as a service would create one per worker */
+    threads[t].reader = EccPemReaderCreate(curve_handle);
+    ret_value = ret_value && threads[t].reader != NULL;
+    threads[t].private_key_size = EccPemCurveGetPrivateKeySize(curve_handle);
+    threads[t].compressed_key_size = EccPemCurveGetCompressedKeySize(curve_handle);
+    ret_value = ret_value &&
+                FormatPath(threads[t].pubkey_file, "%s/%s_%u_pub.pem", config->dir, curve, t) &&
+                FormatPath(threads[t].privkey_file, "%s/%s_%u_priv.pem", config->dir, curve, t);
+  }
+
+  unsigned int num_threads = 1;
+  for (;;) {
+    for (size_t op = 0; op < sizeof(kOperations) / sizeof(kOperations[0]) && ret_value; ++op) {
+      ret_value = MeasureOperation(config, &kOperations[op], threads, num_threads, out,
+                                   *first_result);
+      *first_result = 0;
+    }
+    if (!ret_value || num_threads == config->max_threads) {
+      break;
+    }
+    num_threads = num_threads * 2 < config->max_threads ? num_threads * 2 : config->max_threads;
+  }
+
+  for (unsigned int t = 0; t < config->max_threads; ++t) {
+    unlink(threads[t].pubkey_file);
+    unlink(threads[t].privkey_file);
+    EccPemReaderFree(threads[t].reader);
+  }
+  EccPemKeyPoolFree(key_pool);
+  free(threads);
+  return ret_value;
+}
+
+
+
+/*
+ * Function writes bulk_keys key pairs of a curve once to one pair of PEM files
+ * per key and once to two PEM bundles, and prints both timings as JSON objects.
+ *
+ * Returns:
+ * - 1 if both runs wrote every key pair.
+ * - 0 otherwise.
+ */
+static int BenchBulkOutput(const BenchConfig* config, const char* curve, FILE* out,
+                           int* first_result) {
+  const EccPemCurve* curve_handle = GetBenchCurve(config, curve);
+  char** names = calloc(2 * config->bulk_keys, sizeof(char*));
+  if (curve_handle == NULL || names == NULL) {
+    free(names);
+    return 0;
+  }
+
+  int ret_value = 1;
+  for (size_t i = 0; i < config->bulk_keys && ret_value; ++i) {
+    names[i] = malloc(PATH_MAX);
+    names[config->bulk_keys + i] = malloc(PATH_MAX);
+    if (names[i] == NULL || names[config->bulk_keys + i] == NULL) {
+      fprintf(stderr, "Allocating file names failed.\n");
+      ret_value = 0;
+      break;
+    }
+    ret_value = FormatPath(names[i], "%s/bulk_%zu_pub.pem", config->dir, i) &&
+                FormatPath(names[config->bulk_keys + i], "%s/bulk_%zu_priv.pem", config->dir, i);
+  }
+
+  char pub_bundle[PATH_MAX];
+  char priv_bundle[PATH_MAX];
+  ret_value = ret_value && FormatPath(pub_bundle, "%s/bulk_pubkeys.pem", config->dir) &&
+              FormatPath(priv_bundle, "%s/bulk_privkeys.pem", config->dir);
+
+  for (int run = 0; run < 2 && ret_value; ++run) {
+    const size_t start_allocations = atomic_load(&g_num_allocations);
+    const double start = EccPemNowSeconds();
+    const size_t num_created =
+        run == 0 ? CreateECCKeysPemFilesBatch(curve, config->bulk_keys,
+                                              (const char* const*)names,
+                                              (const char* const*)names + config->bulk_keys,
+                                              NULL)
+                 : CreateECCKeysPemBundles(curve_handle, config->bulk_keys, pub_bundle,
+                                           priv_bundle);
+    const double elapsed = EccPemNowSeconds() - start;
+    const size_t num_allocations = atomic_load(&g_num_allocations) - start_allocations;
+    fprintf(out,
+            "%s\n    {\"operation\": \"%s\", \"curve\": \"%s\", \"keys\": %zu, "
+            "\"failed\": %zu, \"seconds\": %.6f, \"keys_per_second\": %.1f, "
+            "\"allocs_per_key\": %.1f}",
+            *first_result ? "" : ",",
+            run == 0 ? "CreateECCKeysPemFilesBatch" : "CreateECCKeysPemBundles", curve,
+            config->bulk_keys, config->bulk_keys - num_created, elapsed,
+            elapsed > 0.0 ? (double)num_created / elapsed : 0.0,
+            (double)num_allocations / (double)config->bulk_keys);
+    fflush(out);
+    *first_result = 0;
+    ret_value = num_created == config->bulk_keys;
+  }
+
+  for (size_t i = 0; i < 2 * config->bulk_keys; ++i) {
+    if (names[i] != NULL) {
+      unlink(names[i]);
+      free(names[i]);
+    }
+  }
+  free(names);
+  unlink(pub_bundle);
+  unlink(priv_bundle);
+  return ret_value;
+}
+
+
+
+/*
+ * Function fills a directory with load_files copies of one public key of a curve
+ * and loads it at 1..max_threads threads, printing every load as a JSON object.
+ * The scan is timed separately from the load.
+ *
+ * Returns:
+ * - 1 if every load read every file.
+ * - 0 otherwise.
+ */
+static int BenchDirectoryLoad(const BenchConfig* config, const char* curve, FILE* out,
+                              int* first_result) {
+  const EccPemCurve* curve_handle = EccPemGetCurve(curve);
+  if (curve_handle == NULL) {
+    return 0;
+  }
+  const unsigned int compressed_key_size = EccPemCurveGetCompressedKeySize(curve_handle);
+
+  char pubkey_pem[ECCPEM_MAX_KEY_PEM_SIZE];
+  char privkey_pem[ECCPEM_MAX_KEY_PEM_SIZE];
+  size_t pubkey_pem_len = 0;
+  size_t privkey_pem_len = 0;
+  char load_dir[PATH_MAX];
+  if (!FormatPath(load_dir, "%s/load_%s", config->dir, curve)) {
+    return 0;
+  }
+  if (!CreateECCKeysPemBuffers(curve, pubkey_pem, sizeof(pubkey_pem), &pubkey_pem_len,
+                               privkey_pem, sizeof(privkey_pem), &privkey_pem_len) ||
+      mkdir(load_dir, 0700) != 0) {
+    fprintf(stderr, "Creating the load directory failed.\n");
+    return 0;
+  }
+
+  int ret_value = 1;
+  char file[PATH_MAX];
+  size_t num_written = 0;
+  for (; num_written < config->load_files && ret_value; ++num_written) {
+    ret_value = FormatPath(file, "%s/key_%zu.pem", load_dir, num_written) &&
+                EccPemWriteFile(file, pubkey_pem, pubkey_pem_len);
+  }
+
+  uint8_t* public_keys = malloc(config->load_files * compressed_key_size);
+  ret_value = ret_value && public_keys != NULL;
+  unsigned int num_threads = 1;
+  while (ret_value) {
+    const double start = EccPemNowSeconds();
+    EccPemKeyDirectory* key_dir = EccPemKeyDirectoryScan(load_dir);
+    const double scan_seconds = EccPemNowSeconds() - start;
+    EccPemLoadStats stats;
+    EccPemKeyDirectoryLoadPublicKeys(key_dir, public_keys, compressed_key_size, NULL,
+                                     num_threads, &stats);
+    EccPemKeyDirectoryClose(key_dir);
+    fprintf(out,
+            "%s\n    {\"operation\": \"EccPemKeyDirectoryLoadPublicKeys\", \"curve\": \"%s\", "
+            "\"threads\": %u, \"files\": %zu, \"failed\": %zu, \"scan_seconds\": %.6f, "
+            "\"seconds\": %.6f, \"files_per_second\": %.1f}",
+            *first_result ? "" : ",", curve, stats.num_threads, config->load_files,
+            config->load_files - stats.num_loaded, scan_seconds, stats.elapsed_seconds,
+            stats.files_per_second);
+    fflush(out);
+    *first_result = 0;
+    ret_value = stats.num_loaded == config->load_files;
+    if (num_threads == config->max_threads) {
+      break;
+    }
+    num_threads = num_threads * 2 < config->max_threads ? num_threads * 2 : config->max_threads;
+  }
+
+  for (size_t i = 0; i < num_written; ++i) {
+    if (FormatPath(file, "%s/key_%zu.pem", load_dir, i)) {
+      unlink(file);
+    }
+  }
+  rmdir(load_dir);
+  free(public_keys);
+  return ret_value;
+}
+
+
+
+/*
+ * Function signs sign_digests random digests with a key pair of a curve and
+ * verifies the signatures, at 1..max_threads threads, printing every batch as a
+ * JSON object.
+ *
+ * Returns:
+ * - 1 if every batch signed and verified every digest.
+ * - 0 otherwise.
+ */
+static int BenchSignVerify(const BenchConfig* config, const char* curve, FILE* out,
+                           int* first_result) {
+  char pubkey_file[PATH_MAX];
+  char privkey_file[PATH_MAX];
+  EccPemKey* private_key = NULL;
+  EccPemKey* public_key = NULL;
+  if (FormatPath(pubkey_file, "%s/sign_%s_pub.pem", config->dir, curve) &&
+      FormatPath(privkey_file, "%s/sign_%s_priv.pem", config->dir, curve) &&
+      CreateECCKeysPemFiles(curve, pubkey_file, privkey_file)) {
+    private_key = EccPemKeyLoadPrivateKeyFile(privkey_file);
+    public_key = EccPemKeyLoadPublicKeyFile(pubkey_file);
+  }
+  unlink(pubkey_file);
+  unlink(privkey_file);
+
+  const size_t signature_size = EccPemKeyGetMaxSignatureSize(private_key);
+  uint8_t* digests = malloc(config->sign_digests * 32);
+  uint8_t* signatures = malloc(config->sign_digests * signature_size);
+  size_t* signature_lens = malloc(config->sign_digests * sizeof(size_t));
+  int ret_value = private_key != NULL && public_key != NULL && digests != NULL &&
+                  signatures != NULL && signature_lens != NULL;
+  if (!ret_value) {
+    fprintf(stderr, "Setting up the signing benchmark failed.\n");
+  }
+  for (size_t i = 0; ret_value && i < config->sign_digests * 32; ++i) {
+    digests[i] = (uint8_t)(i * 131 + 7);
+  }
+
+  unsigned int num_threads = 1;
+  while (ret_value) {
+    double start = EccPemNowSeconds();
+    const size_t num_signed = EccPemSignBatch(private_key, digests, 32, config->sign_digests,
+                                              signatures, signature_size, signature_lens,
+                                              num_threads);
+    const double sign_seconds = EccPemNowSeconds() - start;
+    start = EccPemNowSeconds();
+    const size_t num_valid = EccPemVerifyBatch(public_key, digests, 32, config->sign_digests,
+                                               signatures, signature_size, signature_lens, NULL,
+                                               num_threads);
+    const double verify_seconds = EccPemNowSeconds() - start;
+    fprintf(out,
+            "%s\n    {\"operation\": \"EccPemSignBatch/EccPemVerifyBatch\", \"curve\": \"%s\", "
+            "\"threads\": %u, \"digests\": %zu, \"failed\": %zu, "
+            "\"signs_per_second\": %.1f, \"verifies_per_second\": %.1f}",
+            *first_result ? "" : ",", curve, num_threads, config->sign_digests,
+            config->sign_digests - num_valid,
+            sign_seconds > 0 ? (double)num_signed / sign_seconds : 0.0,
+            verify_seconds > 0 ? (double)num_valid / verify_seconds : 0.0);
+    fflush(out);
+    *first_result = 0;
+    ret_value = num_signed == config->sign_digests && num_valid == config->sign_digests;
+    if (num_threads == config->max_threads) {
+      break;
+    }
+    num_threads = num_threads * 2 < config->max_threads ? num_threads * 2 : config->max_threads;
+  }
+
+  EccPemKeyFree(private_key);
+  EccPemKeyFree(public_key);
+  free(digests);
+  free(signatures);
+  free(signature_lens);
+  return ret_value;
+}
+
+
+
+static void PrintUsage(const char* program) {
+  fprintf(stderr,
+          "Usage: %s [--iterations N] [--max-threads N] [--curves a,b,...] "
+          "[--bulk-keys N] [--load-files N] [--sign-digests N] [--dir DIR] [--provider NAME]\n"
+          "       [--propq QUERY] [--output FILE]\n"
+          "  --iterations   Operations per thread and measurement (default 200).\n"
+          "  --max-threads  Largest thread count (default: number of online CPUs).\n"
+          "  --curves       Comma separated curve names (default: prime256v1,\n"
+          "                 secp256k1,secp384r1,secp521r1).\n"
+          "  --bulk-keys    Key pairs per curve for the bulk output comparison\n"
+          "                 (default 0, disabled). E.g. 100000.\n"
+          "  --load-files   Public key files per curve for the directory load\n"
+          "                 (default 0, disabled). E.g. 200000.\n"
+          "  --sign-digests Digests per curve for the ECDSA sign and verify\n"
+          "                 batches (default 0, disabled). E.g. 100000.\n"
+          "  --dir          Directory for the key files (default: a new directory\n"
+          "                 in /tmp).\n"
+          "  --provider     OpenSSL provider to load into a new library context for\n"
+          "                 the curve handle operations, beside the default one.\n"
+          "  --propq        Property query of the curve handle operations, e.g.\n"
+          "                 provider=qatprovider.\n"
+          "  --output       JSON output file (default: standard output).\n",
+          program);
+}
+
+/*
+ * Function parses the command line into a benchmark configuration.
+ *
+ * Returns:
+ * - 1 on success.
+ * - 0 if an argument is invalid.
+ */
+static int ParseArguments(const int argc, char* argv[], BenchConfig* config,
+                          char* curve_list) {
+  for (int i = 1; i < argc; ++i) {
+    const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (value == NULL) {
+      return 0;
+    }
+    if (strcmp(argv[i], "--iterations") == 0) {
+      config->iterations = strtoul(value, NULL, 10);
+    } else if (strcmp(argv[i], "--max-threads") == 0) {
+      config->max_threads = (unsigned int)strtoul(value, NULL, 10);
+    } else if (strcmp(argv[i], "--curves") == 0) {
+      strncpy(curve_list, value, PATH_MAX - 1);
+      config->num_curves = 0;
+      for (char* curve = strtok(curve_list, ","); curve != NULL && config->num_curves < BENCH_MAX_CURVES;
+           curve = strtok(NULL, ",")) {
+        if (strlen(curve) > BENCH_MAX_CURVE_NAME_LEN) {
+          fprintf(stderr, "Curve name %s is too long.\n", curve);
+          return 0;
+        }
+        config->curves[config->num_curves++] = curve;
+      }
+    } else if (strcmp(argv[i], "--bulk-keys") == 0) {
+      config->bulk_keys = strtoul(value, NULL, 10);
+    } else if (strcmp(argv[i], "--load-files") == 0) {
+      config->load_files = strtoul(value, NULL, 10);
+    } else if (strcmp(argv[i], "--sign-digests") == 0) {
+      config->sign_digests = strtoul(value, NULL, 10);
+    } else if (strcmp(argv[i], "--dir") == 0) {
+      /* Room for the longest file name the benchmark appends */
+      if (strlen(value) >= PATH_MAX - BENCH_MAX_SUFFIX_LEN) {
+        fprintf(stderr, "Benchmark directory %s is too long.\n", value);
+        return 0;
+      }
+      memcpy(config->dir, value, strlen(value) + 1);
+    } else if (strcmp(argv[i], "--provider") == 0) {
+      config->provider = value;
+    } else if (strcmp(argv[i], "--propq") == 0) {
+      config->propq = value;
+    } else if (strcmp(argv[i], "--output") == 0) {
+      config->output_file = value;
+    } else {
+      return 0;
+    }
+    ++i;
+  }
+  return config->iterations > 0 && config->num_curves > 0;
+}
+
+
+
+int main(int argc, char* argv[]) {
+  /* Must run before OpenSSL allocates anything */
+  CRYPTO_set_mem_functions(CountingMalloc, CountingRealloc, CountingFree);
+
+  BenchConfig config;
+  memset(&config, 0, sizeof(config));
+  config.iterations = 200;
+  for (size_t i = 0; i < sizeof(kDefaultCurves) / sizeof(kDefaultCurves[0]); ++i) {
+    config.curves[config.num_curves++] = kDefaultCurves[i];
+  }
+
+  static char curve_list[PATH_MAX];
+  if (!ParseArguments(argc, argv, &config, curve_list)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  config.max_threads = EccPemResolveThreadCount(config.max_threads);
+
+  /* Default provider as well, for whatever the provider under test lacks */
+  if (config.provider != NULL) {
+    config.libctx = OSSL_LIB_CTX_new();
+    if (config.libctx == NULL || OSSL_PROVIDER_load(config.libctx, config.provider) == NULL ||
+        OSSL_PROVIDER_load(config.libctx, "default") == NULL) {
+      fprintf(stderr, "Loading provider %s failed.\n", config.provider);
+      return 1;
+    }
+  }
+
+  int remove_dir = 0;
+  if (config.dir[0] == '\0') {
+    snprintf(config.dir, PATH_MAX, "/tmp/eccpem_bench_XXXXXX");
+    if (mkdtemp(config.dir) == NULL) {
+      fprintf(stderr, "Creating benchmark directory failed.\n");
+      return 1;
+    }
+    remove_dir = 1;
+  }
+
+  FILE* out = stdout;
+  if (config.output_file != NULL) {
+    out = fopen(config.output_file, "w");
+    if (out == NULL) {
+      fprintf(stderr, "Failed to open output file %s\n", config.output_file);
+      return 1;
+    }
+  }
+
+  fprintf(out, "{\n  \"library\": \"eccpem\",\n  \"openssl\": \"%s\",\n"
+          "  \"provider\": \"%s\",\n  \"propq\": \"%s\",\n"
+          "  \"iterations\": %zu,\n  \"max_threads\": %u,\n  \"results\": [",
+          OPENSSL_VERSION_TEXT, config.provider != NULL ? config.provider : "default",
+          config.propq != NULL ? config.propq : "", config.iterations, config.max_threads);
+
+  int ret_value = 1;
+  int first_result = 1;
+  for (size_t c = 0; c < config.num_curves && ret_value; ++c) {
+    ret_value = BenchCurve(&config, config.curves[c], out, &first_result);
+  }
+  fprintf(out, "\n  ],\n  \"bulk\": [");
+
+  first_result = 1;
+  for (size_t c = 0; c < config.num_curves && ret_value && config.bulk_keys > 0; ++c) {
+    ret_value = BenchBulkOutput(&config, config.curves[c], out, &first_result);
+  }
+  fprintf(out, "\n  ],\n  \"load\": [");
+
+  first_result = 1;
+  for (size_t c = 0; c < config.num_curves && ret_value && config.load_files > 0; ++c) {
+    ret_value = BenchDirectoryLoad(&config, config.curves[c], out, &first_result);
+  }
+  fprintf(out, "\n  ],\n  \"sign\": [");
+
+  first_result = 1;
+  for (size_t c = 0; c < config.num_curves && ret_value && config.sign_digests > 0; ++c) {
+    ret_value = BenchSignVerify(&config, config.curves[c], out, &first_result);
+  }
+  fprintf(out, "\n  ],\n  \"stages\": [");
+
+  /* Only filled in by builds with ECCPEM_INSTRUMENTATION */
+  EccPemCounters counters;
+  if (EccPemGetCounters(&counters)) {
+    for (int i = 0; i < ECCPEM_NUM_STAGES; ++i) {
+      const EccPemStageCounters* stage = &counters.stages[i];
+      fprintf(out, "%s\n    {\"stage\": \"%s\", \"count\": %llu, \"nanoseconds\": %llu, "
+              "\"ns_per_call\": %.1f}",
+              i == 0 ? "" : ",", EccPemStageName((EccPemStage)i),
+              (unsigned long long)stage->count, (unsigned long long)stage->nanoseconds,
+              stage->count > 0 ? (double)stage->nanoseconds / (double)stage->count : 0.0);
+    }
+  }
+  fprintf(out, "\n  ]\n}\n");
+
+  if (out != stdout) {
+    fclose(out);
+  }
+  if (remove_dir) {
+    rmdir(config.dir);
+  }
+  return ret_value ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+#include <eccpem/eccpem.h>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Function queues the generation of an ECC key pair and returns a future that
+// becomes ready once both PEM files are written.
+//
+// Arguments:
+// - curve: Handle of the elliptic curve, see EccPemGetCurve.
+// - pubkey_file: PEM file where the public key is going to be stored.
+// - privkey_file: PEM file where the private key is going to be stored.
+//
+// Returns:
+// - Future holding true if the key pair was generated and written, false otherwise.
+std::future<bool> GenerateAsync(const EccPemCurve* curve, const std::string& pubkey_file,
+                                const std::string& privkey_file);
+
+
+int main() {
+
+  const EccPemCurve* curve = EccPemGetCurve("secp256k1");
+  if (curve == nullptr) {
+    return 1;
+  }
+
+  std::vector<std::future<bool>> results;
+  for (int i = 0; i < 8; ++i) {
+    results.push_back(GenerateAsync(curve, "pub_key_" + std::to_string(i) + ".pem",
+                                    "priv_key_" + std::to_string(i) + ".pem"));
+  }
+
+  // The calling thread is free while the keys are generated in the background.
+  int num_created = 0;
+  for (std::future<bool>& result : results) {
+    num_created += result.get() ? 1 : 0;
+  }
+  std::cout << num_created << " of " << results.size() << " ECC key pairs were generated.\n";
+
+  EccPemAsyncShutdown();
+
+  return 0;
+}
+
+
+
+// Function queues the generation of an ECC key pair and returns a future that
+// becomes ready once both PEM files are written.
+//
+// Arguments:
+// - curve: Handle of the elliptic curve, see EccPemGetCurve.
+// - pubkey_file: PEM file where the public key is going to be stored.
+// - privkey_file: PEM file where the private key is going to be stored.
+//
+// Returns:
+// - Future holding true if the key pair was generated and written, false otherwise.
+std::future<bool> GenerateAsync(const EccPemCurve* curve, const std::string& pubkey_file,
+                                const std::string& privkey_file) {
+  // The promise lives until the completion callback, which runs exactly once.
+  std::promise<bool>* promise = new std::promise<bool>();
+  std::future<bool> future = promise->get_future();
+
+  const auto on_complete = [](int result, void* user_data) {
+    std::promise<bool>* done = static_cast<std::promise<bool>*>(user_data);
+    done->set_value(result == 1);
+    delete done;
+  };
+
+  if (EccPemGenerateAsync(curve, pubkey_file.c_str(), privkey_file.c_str(),
+                          on_complete, promise) != 1) {
+    // Rejected requests never invoke the callback.
+    promise->set_value(false);
+    delete promise;
+  }
+  return future;
+}
@@ -1,4 +1,4 @@
-#include <eccpem/eccpem.h>
+#include <eccpem/eccpem.hpp>
 #include <iostream>
 #include <string>
 
@@ -7,10 +7,9 @@ int main() {
   const std::string pubkey_file = "pub_key.pem";
   const std::string privkey_file = "priv_key.pem";
 
-  const std::string ec_type = "secp256k1";
-
-  const int error_code = CreateECCKeysPemFiles(ec_type.c_str(), pubkey_file.c_str(), privkey_file.c_str());
-  if (error_code == 1) {
+  const bool created = eccpem::CreateKeyPemFiles<eccpem::Curve::kSecp256k1>(pubkey_file.c_str(),
+                                                                            privkey_file.c_str());
+  if (created) {
     std::cout << "Generation of ECC key pairs was successful.\n";
   } else {
     std::cout << "Generation of ECC key pairs failed.\n";
@@ -1,4 +1,4 @@
-#include <eccpem/eccpem.h>
+#include <eccpem/eccpem.hpp>
 #include <iostream>
 #include <string>
 #include <stdint.h>
@@ -18,20 +18,16 @@ int main() {
 
   const std::string privkey_file = "priv_key.pem";
 
-  const unsigned int size = 32;
-  uint8_t* private_key = new uint8_t[size];
-
-  const int error_code = ReadPrivateKeyPemFile(privkey_file.c_str(), private_key, size);
-  if (error_code == 1) {
+  // The key size follows from the curve at compile time
+  const auto private_key = eccpem::ReadPrivateKey<eccpem::Curve::kPrime256v1>(privkey_file.c_str());
+  if (private_key) {
     std::cout << "Reading private key from PEM file was successful.\n";
-    const std::string hex_privkey = ArrayToHexString(private_key, size);
+    const std::string hex_privkey = ArrayToHexString(private_key->data(), private_key->size());
     std::cout << "Private key in hex format: " << hex_privkey << "\n";
   } else {
     std::cerr << "Reading private key from PEM file failed.\n";
   }
 
-  delete []private_key;
-
   return 0;
 }
 
@@ -1,4 +1,4 @@
-#include <eccpem/eccpem.h>
+#include <eccpem/eccpem.hpp>
 #include <iostream>
 #include <string>
 #include <stdint.h>
@@ -18,20 +18,16 @@ int main() {
 
   const std::string pub_file = "pub_key.pem";
 
-  const unsigned int compressed_size = 33;
-  uint8_t* pub_key = new uint8_t[compressed_size];
-
-  const int error_code = ReadPublicKeyPemFile(pub_file.c_str(), pub_key, compressed_size);
-  if (error_code == 1) {
+  // The key size follows from the curve at compile time
+  const auto pub_key = eccpem::ReadPublicKey<eccpem::Curve::kPrime256v1>(pub_file.c_str());
+  if (pub_key) {
     std::cout << "Reading public key from PEM file was successful.\n";
-    const std::string hex_pubkey = ArrayToHexString(pub_key, compressed_size);
+    const std::string hex_pubkey = ArrayToHexString(pub_key->data(), pub_key->size());
     std::cout << "Compressed public key in hex format: " << hex_pubkey << "\n";
   } else {
     std::cerr << "Reading public key from PEM file failed.\n";
   }
 
-  delete []pub_key;
-
   return 0;
 }
 
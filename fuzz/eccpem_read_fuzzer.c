@@ -0,0 +1,64 @@
+/*
+ * ===--- eccpem_read_fuzzer.c ----------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * libFuzzer target of the read paths that take untrusted PEM data from memory:
+ * the structural pre-scan, the buffer readers with and without a reader context,
+ * and PEM bundles read in place. Every input goes through all of them, so a
+ * corpus grown by the fuzzer also drives the read path perf regression run,
+ * which links this file without libFuzzer, see eccpem_read_perf.c.
+ *
+ * Build with -DECCPEM_BUILD_FUZZERS=ON (Clang only) and run e.g.
+ *   ./eccpem_read_fuzzer -max_len=1048576 corpus_dir ../fuzz/corpus
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "eccpem.h"
+#include "utils.h"
+
+/* prime256v1 key sizes, the curve of the seed corpus */
+#define FUZZ_PRIVATE_KEY_SIZE 32
+#define FUZZ_COMPRESSED_KEY_SIZE 33
+#define FUZZ_BUNDLE_BATCH 16
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  /* Set up once and kept for the whole run, like a long running reader */
+  static EccPemReader* reader = NULL;
+  if (reader == NULL) {
+    reader = EccPemReaderCreate(EccPemGetCurve("prime256v1"));
+    if (reader == NULL) {
+      return 0;
+    }
+  }
+
+  const char* pem = (const char*)data;
+  uint8_t private_key[FUZZ_PRIVATE_KEY_SIZE];
+  uint8_t public_key[FUZZ_COMPRESSED_KEY_SIZE];
+
+  HasPemKeyBlock(pem, size, 0);
+  HasPemKeyBlock(pem, size, 1);
+  ReadPrivateKeyPemBuffer(pem, size, private_key, FUZZ_PRIVATE_KEY_SIZE);
+  ReadPublicKeyPemBuffer(pem, size, public_key, FUZZ_COMPRESSED_KEY_SIZE);
+  EccPemReaderReadPrivateKeyBuffer(reader, pem, size, private_key, FUZZ_PRIVATE_KEY_SIZE);
+  EccPemReaderReadPublicKeyBuffer(reader, pem, size, public_key, FUZZ_COMPRESSED_KEY_SIZE);
+
+  EccPemBundle* bundle = EccPemBundleOpenBuffer(pem, size);
+  if (bundle != NULL) {
+    uint8_t public_keys[FUZZ_BUNDLE_BATCH * FUZZ_COMPRESSED_KEY_SIZE];
+    while (EccPemBundleNext(bundle, public_keys, FUZZ_COMPRESSED_KEY_SIZE,
+                            FUZZ_BUNDLE_BATCH) > 0) {
+    }
+    EccPemBundleClose(bundle);
+  }
+  return 0;
+}
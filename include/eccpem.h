@@ -5,8 +5,22 @@
 extern "C" {
 #endif
 
+#include "eccpem_curve.h"
 #include "eccpem_write.h"
 #include "eccpem_read.h"
+#include "eccpem_reader.h"
+#include "eccpem_sign.h"
+#include "eccpem_parallel.h"
+#include "eccpem_async.h"
+#include "eccpem_pool.h"
+#include "eccpem_cache.h"
+#include "eccpem_bundle.h"
+#include "eccpem_loader.h"
+#include "eccpem_instrument.h"
+#include "eccpem_store.h"
+#include "eccpem_secure.h"
+#include "eccpem_watch.h"
+#include "eccpem_error.h"
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,475 @@
+/*
+ * ===--- eccpem.hpp --------------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides a header-only C++17 layer over the C API. The curve is a
+ * template argument, so key sizes are compile-time constants: keys are returned
+ * by value in std::array objects of exactly the right size, and the curve handle
+ * is resolved by NID once per curve instead of by name on every call. Nothing
+ * here allocates on the heap, except the key handles of PrivateKey and
+ * PublicKey, which keep a parsed key so it is never parsed again. The Read*
+ * functions go through such a handle as well, so they check the curve of the key.
+ */
+
+#ifndef ECCPEM_HPP_
+#define ECCPEM_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <openssl/obj_mac.h>
+
+#include "eccpem.h"
+
+namespace eccpem {
+
+/* Elliptic curves supported by the C++ layer. */
+enum class Curve {
+  kPrime256v1,
+  kSecp256k1,
+  kSecp384r1,
+  kSecp521r1
+};
+
+/*
+ * Compile-time properties of a curve.
+ *
+ * Fields:
+ * - kNid: OpenSSL NID of the curve.
+ * - kName: Short OpenSSL name of the curve.
+ * - kPrivateKeySize: Size of a private scalar in bytes.
+ * - kCompressedKeySize: Size of a compressed public point in bytes.
+ */
+template <Curve C>
+struct CurveTraits;
+
+template <>
+struct CurveTraits<Curve::kPrime256v1> {
+  static constexpr int kNid = NID_X9_62_prime256v1;
+  static constexpr const char* kName = "prime256v1";
+  static constexpr std::size_t kPrivateKeySize = 32;
+  static constexpr std::size_t kCompressedKeySize = 33;
+};
+
+template <>
+struct CurveTraits<Curve::kSecp256k1> {
+  static constexpr int kNid = NID_secp256k1;
+  static constexpr const char* kName = "secp256k1";
+  static constexpr std::size_t kPrivateKeySize = 32;
+  static constexpr std::size_t kCompressedKeySize = 33;
+};
+
+template <>
+struct CurveTraits<Curve::kSecp384r1> {
+  static constexpr int kNid = NID_secp384r1;
+  static constexpr const char* kName = "secp384r1";
+  static constexpr std::size_t kPrivateKeySize = 48;
+  static constexpr std::size_t kCompressedKeySize = 49;
+};
+
+template <>
+struct CurveTraits<Curve::kSecp521r1> {
+  static constexpr int kNid = NID_secp521r1;
+  static constexpr const char* kName = "secp521r1";
+  static constexpr std::size_t kPrivateKeySize = 66;
+  static constexpr std::size_t kCompressedKeySize = 67;
+};
+
+/* Private scalar of a key on curve C. */
+template <Curve C>
+using PrivateKeyBytes = std::array<uint8_t, CurveTraits<C>::kPrivateKeySize>;
+
+/* Compressed public point of a key on curve C. */
+template <Curve C>
+using CompressedPublicKey = std::array<uint8_t, CurveTraits<C>::kCompressedKeySize>;
+
+
+
+/*
+ * Function returns the handle of curve C. It is looked up by NID on the first
+ * call and cached for the rest of the process.
+ *
+ * Returns:
+ * - Handle of the curve.
+ * - nullptr if OpenSSL does not support the curve.
+ */
+template <Curve C>
+const EccPemCurve* CurveHandle() {
+  static const EccPemCurve* const handle = EccPemGetCurveByNid(CurveTraits<C>::kNid);
+  return handle;
+}
+
+
+
+/*
+ * Function generates a key pair on curve C and writes it to PEM files, like
+ * CreateECCKeysPemFiles.
+ *
+ * Returns:
+ * - true if both files were written.
+ * - false otherwise.
+ */
+template <Curve C>
+bool CreateKeyPemFiles(const char* pubkey_file, const char* privkey_file) {
+  const EccPemCurve* curve = CurveHandle<C>();
+  return curve != nullptr &&
+         CreateECCKeysPemFilesWithCurve(curve, pubkey_file, privkey_file) == 1;
+}
+
+
+
+template <Curve C>
+class PrivateKey;
+
+template <Curve C>
+class PublicKey;
+
+/*
+ * Function copies the private scalar out of a key handle of curve C.
+ *
+ * Returns:
+ * - The private scalar.
+ * - std::nullopt if there is no key.
+ */
+template <Curve C>
+std::optional<PrivateKeyBytes<C>> CopyScalar(const std::optional<PrivateKey<C>>& key) {
+  if (!key) {
+    return std::nullopt;
+  }
+  PrivateKeyBytes<C> private_key;
+  const auto scalar = key->Scalar();
+  std::copy(scalar.begin(), scalar.end(), private_key.begin());
+  return private_key;
+}
+
+
+
+/*
+ * Function copies the compressed public point out of a key handle of curve C.
+ *
+ * Returns:
+ * - The compressed public point.
+ * - std::nullopt if there is no key.
+ */
+template <Curve C>
+std::optional<CompressedPublicKey<C>> CopyPublicPoint(const std::optional<PublicKey<C>>& key) {
+  if (!key) {
+    return std::nullopt;
+  }
+  CompressedPublicKey<C> public_key;
+  const auto point = key->PublicPoint();
+  std::copy(point.begin(), point.end(), public_key.begin());
+  return public_key;
+}
+
+
+
+/*
+ * Function reads the private key of curve C from a PEM file, like
+ * ReadPrivateKeyPemFile. The key goes through a key handle, which checks its
+ * curve.
+ *
+ * Returns:
+ * - The private scalar.
+ * - std::nullopt if the file cannot be read or the key is on another curve.
+ */
+template <Curve C>
+std::optional<PrivateKeyBytes<C>> ReadPrivateKey(const char* privkey_file) {
+  return CopyScalar<C>(PrivateKey<C>::FromFile(privkey_file));
+}
+
+
+
+/*
+ * Function reads the private key of curve C from PEM data, like
+ * ReadPrivateKeyPemBuffer. The key goes through a key handle, which checks its
+ * curve.
+ *
+ * Returns:
+ * - The private scalar.
+ * - std::nullopt if the data cannot be parsed or the key is on another curve.
+ */
+template <Curve C>
+std::optional<PrivateKeyBytes<C>> ReadPrivateKeyFromPem(std::string_view privkey_pem) {
+  return CopyScalar<C>(PrivateKey<C>::FromPem(privkey_pem));
+}
+
+
+
+/*
+ * Function reads the compressed public key of curve C from a PEM file, like
+ * ReadPublicKeyPemFile. The key goes through a key handle, which checks its
+ * curve.
+ *
+ * Returns:
+ * - The compressed public point.
+ * - std::nullopt if the file cannot be read or the key is on another curve.
+ */
+template <Curve C>
+std::optional<CompressedPublicKey<C>> ReadPublicKey(const char* pubkey_file) {
+  return CopyPublicPoint<C>(PublicKey<C>::FromFile(pubkey_file));
+}
+
+
+
+/*
+ * Function reads the compressed public key of curve C from PEM data, like
+ * ReadPublicKeyPemBuffer. The key goes through a key handle, which checks its
+ * curve.
+ *
+ * Returns:
+ * - The compressed public point.
+ * - std::nullopt if the data cannot be parsed or the key is on another curve.
+ */
+template <Curve C>
+std::optional<CompressedPublicKey<C>> ReadPublicKeyFromPem(std::string_view pubkey_pem) {
+  return CopyPublicPoint<C>(PublicKey<C>::FromPem(pubkey_pem));
+}
+
+
+
+/*
+ * Reader context of curve C, see EccPemReader. It owns its reader and can be
+ * moved but not copied. Like the reader, it must not be used by multiple
+ * threads at the same time.
+ */
+template <Curve C>
+class Reader {
+ public:
+  /*
+   * Function creates a reader.
+   *
+   * Returns:
+   * - The reader.
+   * - std::nullopt if setting it up failed.
+   */
+  static std::optional<Reader> Create() {
+    const EccPemCurve* curve = CurveHandle<C>();
+    EccPemReader* reader = curve != nullptr ? EccPemReaderCreate(curve) : nullptr;
+    if (reader == nullptr) {
+      return std::nullopt;
+    }
+    return Reader(reader);
+  }
+
+  Reader(Reader&& other) noexcept : reader_(std::exchange(other.reader_, nullptr)) {}
+
+  Reader& operator=(Reader&& other) noexcept {
+    if (this != &other) {
+      EccPemReaderFree(reader_);
+      reader_ = std::exchange(other.reader_, nullptr);
+    }
+    return *this;
+  }
+
+  Reader(const Reader&) = delete;
+  Reader& operator=(const Reader&) = delete;
+
+  ~Reader() { EccPemReaderFree(reader_); }
+
+  std::optional<PrivateKeyBytes<C>> ReadPrivateKey(const char* privkey_file) {
+    PrivateKeyBytes<C> private_key;
+    if (EccPemReaderReadPrivateKeyFile(reader_, privkey_file, private_key.data(),
+                                       static_cast<unsigned int>(private_key.size())) != 1) {
+      return std::nullopt;
+    }
+    return private_key;
+  }
+
+  std::optional<PrivateKeyBytes<C>> ReadPrivateKeyFromPem(std::string_view privkey_pem) {
+    PrivateKeyBytes<C> private_key;
+    if (EccPemReaderReadPrivateKeyBuffer(reader_, privkey_pem.data(), privkey_pem.size(),
+                                         private_key.data(),
+                                         static_cast<unsigned int>(private_key.size())) != 1) {
+      return std::nullopt;
+    }
+    return private_key;
+  }
+
+  std::optional<CompressedPublicKey<C>> ReadPublicKey(const char* pubkey_file) {
+    CompressedPublicKey<C> public_key;
+    if (EccPemReaderReadPublicKeyFile(reader_, pubkey_file, public_key.data(),
+                                      static_cast<unsigned int>(public_key.size())) != 1) {
+      return std::nullopt;
+    }
+    return public_key;
+  }
+
+  std::optional<CompressedPublicKey<C>> ReadPublicKeyFromPem(std::string_view pubkey_pem) {
+    CompressedPublicKey<C> public_key;
+    if (EccPemReaderReadPublicKeyBuffer(reader_, pubkey_pem.data(), pubkey_pem.size(),
+                                        public_key.data(),
+                                        static_cast<unsigned int>(public_key.size())) != 1) {
+      return std::nullopt;
+    }
+    return public_key;
+  }
+
+ private:
+  explicit Reader(EccPemReader* reader) : reader_(reader) {}
+
+  EccPemReader* reader_;
+};
+
+
+
+
+/*
+ * Read-only view of N contiguous bytes, like std::span<const uint8_t, N> of
+ * C++20. It does not own the bytes.
+ */
+template <std::size_t N>
+class ByteSpan {
+ public:
+  explicit ByteSpan(const uint8_t* data) : data_(data) {}
+
+  const uint8_t* data() const { return data_; }
+  static constexpr std::size_t size() { return N; }
+  const uint8_t* begin() const { return data_; }
+  const uint8_t* end() const { return data_ + N; }
+  uint8_t operator[](const std::size_t i) const { return data_[i]; }
+
+ private:
+  const uint8_t* data_;
+};
+
+/* Views of the private scalar and the compressed public point of curve C. */
+template <Curve C>
+using PrivateKeySpan = ByteSpan<CurveTraits<C>::kPrivateKeySize>;
+
+template <Curve C>
+using PublicKeySpan = ByteSpan<CurveTraits<C>::kCompressedKeySize>;
+
+
+
+/*
+ * Owner of a key handle, see EccPemKey. It is the move-only base of PrivateKey
+ * and PublicKey.
+ */
+class KeyHandle {
+ public:
+  KeyHandle(KeyHandle&& other) noexcept : key_(std::exchange(other.key_, nullptr)) {}
+
+  KeyHandle& operator=(KeyHandle&& other) noexcept {
+    if (this != &other) {
+      EccPemKeyFree(key_);
+      key_ = std::exchange(other.key_, nullptr);
+    }
+    return *this;
+  }
+
+  KeyHandle(const KeyHandle&) = delete;
+  KeyHandle& operator=(const KeyHandle&) = delete;
+
+  ~KeyHandle() { EccPemKeyFree(key_); }
+
+  /* Key handle for the C API, e.g. EccPemSignBatch. It stays owned by this. */
+  const EccPemKey* get() const { return key_; }
+
+  /* EVP_PKEY structure of the key. It must not be freed or modified. */
+  EVP_PKEY* evp_pkey() const { return EccPemKeyGetEvpPkey(key_); }
+
+ protected:
+  explicit KeyHandle(EccPemKey* key) : key_(key) {}
+
+  /*
+   * Function takes a key handle the C API created, if it is on curve C.
+   *
+   * Returns:
+   * - The owner of the handle.
+   * - std::nullopt if key is NULL or on another curve, in which case it is freed.
+   */
+  template <typename Key, Curve C>
+  static std::optional<Key> Adopt(EccPemKey* key) {
+    if (key == nullptr || EccPemKeyCheckCurve(key, CurveHandle<C>()) != 1) {
+      EccPemKeyFree(key);
+      return std::nullopt;
+    }
+    return Key(key);
+  }
+
+  EccPemKey* key_;
+};
+
+
+
+/*
+ * Private key of curve C. The key is parsed or generated once; its scalar and
+ * public point are then views into the key handle, so passing the key on costs
+ * no copy and no parse.
+ */
+template <Curve C>
+class PrivateKey : public KeyHandle {
+ public:
+  static std::optional<PrivateKey> FromFile(const char* privkey_file) {
+    return Adopt<PrivateKey, C>(EccPemKeyLoadPrivateKeyFile(privkey_file));
+  }
+
+  static std::optional<PrivateKey> FromPem(std::string_view privkey_pem) {
+    return Adopt<PrivateKey, C>(
+        EccPemKeyLoadPrivateKeyBuffer(privkey_pem.data(), privkey_pem.size()));
+  }
+
+  static std::optional<PrivateKey> Generate() {
+    const EccPemCurve* curve = CurveHandle<C>();
+    return Adopt<PrivateKey, C>(curve != nullptr ? EccPemKeyGenerate(curve) : nullptr);
+  }
+
+  /* Private scalar, valid as long as the key. */
+  PrivateKeySpan<C> Scalar() const {
+    return PrivateKeySpan<C>(EccPemKeyGetPrivateKey(key_, nullptr));
+  }
+
+  /* Compressed public point, valid as long as the key. */
+  PublicKeySpan<C> PublicPoint() const {
+    return PublicKeySpan<C>(EccPemKeyGetPublicKey(key_, nullptr));
+  }
+
+  /* Function writes the key pair to PEM files, see EccPemKeyWritePemFiles. */
+  bool WritePemFiles(const char* pubkey_file, const char* privkey_file) const {
+    return EccPemKeyWritePemFiles(key_, pubkey_file, privkey_file) == 1;
+  }
+
+ private:
+  friend class KeyHandle;
+  explicit PrivateKey(EccPemKey* key) : KeyHandle(key) {}
+};
+
+
+
+/*
+ * Public key of curve C, like PrivateKey without the scalar.
+ */
+template <Curve C>
+class PublicKey : public KeyHandle {
+ public:
+  static std::optional<PublicKey> FromFile(const char* pubkey_file) {
+    return Adopt<PublicKey, C>(EccPemKeyLoadPublicKeyFile(pubkey_file));
+  }
+
+  static std::optional<PublicKey> FromPem(std::string_view pubkey_pem) {
+    return Adopt<PublicKey, C>(
+        EccPemKeyLoadPublicKeyBuffer(pubkey_pem.data(), pubkey_pem.size()));
+  }
+
+  /* Compressed public point, valid as long as the key. */
+  PublicKeySpan<C> PublicPoint() const {
+    return PublicKeySpan<C>(EccPemKeyGetPublicKey(key_, nullptr));
+  }
+
+ private:
+  friend class KeyHandle;
+  explicit PublicKey(EccPemKey* key) : KeyHandle(key) {}
+};
+
+}  // namespace eccpem
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * ===--- eccpem_async.h ----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides asynchronous generation of Elliptic Curve Cryptography (ECC) key
+ * pairs. Requests are queued to a pool of background threads and a callback is
+ * invoked when the key pair has been written, so the submitting thread never
+ * waits for key generation or file I/O.
+ */
+
+#ifndef ECCPEM_ASYNC_H_
+#define ECCPEM_ASYNC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "eccpem_curve.h"
+
+/*
+ * Completion callback of an asynchronous request. It is invoked exactly once per
+ * accepted request, on one of the pool's threads.
+ *
+ * Arguments:
+ * - result: 1 if the key pair was generated and written to both PEM files,
+ *           0 otherwise.
+ * - user_data: Pointer given when the request was submitted.
+ */
+typedef void (*EccPemAsyncCallback)(int result, void* user_data);
+
+
+
+/*
+ * Function starts the background pool. Calling it is optional: the first
+ * submitted request starts a pool with one thread per online CPU.
+ *
+ * Arguments:
+ * - num_threads: Number of background threads. 0 uses one thread per online CPU.
+ *
+ * Returns:
+ * - 1 if the pool was started.
+ * - 0 if the pool is already running or no thread could be created.
+ */
+int EccPemAsyncInit(const unsigned int num_threads);
+
+
+
+/*
+ * Function stops the background pool. Requests that are already queued are
+ * still completed and their callbacks invoked before it returns. Afterwards new
+ * requests start a new pool. It must not be called from a completion callback.
+ */
+void EccPemAsyncShutdown(void);
+
+
+
+/*
+ * Function queues the generation of an ECC key pair on a cached curve and returns
+ * without waiting for it. A background thread generates the key pair, writes it
+ * to the PEM files like CreateECCKeysPemFilesWithCurve does, and then invokes the
+ * callback. Pending requests are taken from the queue in batches, so one keygen
+ * context is reused and every file is written with a single write call.
+ *
+ * Arguments:
+ * - curve: Handle of the elliptic curve, see EccPemGetCurve.
+ * - pubkey_file: PEM formatted file (extension is .pem) where the public key will
+ *                be stored. The name is copied.
+ * - privkey_file: PEM formatted file (extension is .pem) where the private key will
+ *                 be stored. The name is copied.
+ * - callback: Function invoked on completion. It can be NULL.
+ * - user_data: Pointer passed to the callback.
+ *
+ * Returns:
+ * - 1 if the request was queued. Its callback will be invoked.
+ * - 0 if the arguments are invalid or the pool cannot be started. The callback
+ *   is not invoked.
+ */
+int EccPemGenerateAsync(const EccPemCurve* curve,
+                        const char* pubkey_file,
+                        const char* privkey_file,
+                        EccPemAsyncCallback callback,
+                        void* user_data);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
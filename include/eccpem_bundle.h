@@ -0,0 +1,181 @@
+/*
+ * ===--- eccpem_bundle.h ---------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides functionality to write Elliptic Curve Cryptography (ECC) key
+ * pairs to PEM bundles and to read public keys from them. PEM bundles are PEM
+ * formatted files holding many concatenated key blocks.
+ */
+
+#ifndef ECCPEM_BUNDLE_H_
+#define ECCPEM_BUNDLE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "eccpem_curve.h"
+
+/*
+ * Open PEM bundle. The bundle is read front to back in a single pass with a
+ * constant amount of memory, no matter how many blocks it holds. A bundle must
+ * only be used by one thread at a time.
+ */
+typedef struct EccPemBundle EccPemBundle;
+
+/*
+ * Statistics of a PEM bundle read so far.
+ *
+ * Fields:
+ * - num_keys: Number of public keys returned by EccPemBundleNext.
+ * - num_skipped: Number of public key blocks that could not be decoded and were
+ *                skipped.
+ */
+typedef struct {
+  size_t num_keys;
+  size_t num_skipped;
+} EccPemBundleStats;
+
+
+
+/*
+ * Function generates ECC key pairs on a cached curve and appends the public keys
+ * to one PEM bundle and the private keys, in the same order, to another. Keys are
+ * encoded into reusable in-memory arenas and written in chunks, so each chunk of
+ * key pairs costs one write call per bundle instead of an open, write and close
+ * per file. Existing bundle files are overwritten.
+ *
+ * Arguments:
+ * - curve: Handle of the elliptic curve, see EccPemGetCurve.
+ * - num_keys: Number of key pairs to generate.
+ * - pubkey_bundle_file: PEM formatted file (extension is .pem) where the public
+ *                       keys will be stored.
+ * - privkey_bundle_file: PEM formatted file (extension is .pem) where the private
+ *                        keys will be stored.
+ *
+ * Returns:
+ * - Number of key pairs written to both bundles. It is less than num_keys if key
+ *   generation or writing failed, in which case the bundles hold the key pairs
+ *   written before the failure.
+ */
+size_t CreateECCKeysPemBundles(const EccPemCurve* curve,
+                               const size_t num_keys,
+                               const char* pubkey_bundle_file,
+                               const char* privkey_bundle_file);
+
+
+
+/*
+ * Function opens a PEM bundle for reading.
+ *
+ * Arguments:
+ * - bundle_file: PEM formatted file (extension is .pem) holding any number of
+ *                concatenated public key blocks.
+ *
+ * Returns:
+ * - Pointer to the open bundle, which must be closed with EccPemBundleClose.
+ * - NULL if the file is not a .pem file or cannot be opened.
+ */
+EccPemBundle* EccPemBundleOpen(const char* bundle_file);
+
+
+
+/*
+ * Function opens a PEM bundle for reading through a read-only memory mapping of the
+ * whole file. Block boundaries are scanned for in the mapping and every block is
+ * decoded from it in place, without copying the file through stdio buffers. The
+ * bundle is read with EccPemBundleNext like one opened with EccPemBundleOpen.
+ *
+ * Arguments:
+ * - bundle_file: PEM formatted file (extension is .pem) holding any number of
+ *                concatenated public key blocks.
+ * - sequential_hint: If not 0, the kernel is advised (madvise MADV_SEQUENTIAL) that
+ *                    the bundle will be read front to back, so it reads ahead
+ *                    aggressively.
+ *
+ * Returns:
+ * - Pointer to the open bundle, which must be closed with EccPemBundleClose.
+ * - NULL if the file is not a .pem file, or cannot be opened or mapped.
+ */
+EccPemBundle* EccPemBundleOpenMapped(const char* bundle_file, const int sequential_hint);
+
+
+
+/*
+ * Function opens a PEM bundle that is already in memory, e.g. received over the
+ * network. Blocks are scanned for and decoded in the buffer in place, as with
+ * EccPemBundleOpenMapped, and read with EccPemBundleNext.
+ *
+ * Arguments:
+ * - bundle_pem: Buffer holding any number of concatenated public key blocks. It
+ *               does not need to be null-terminated, and it must stay valid and
+ *               unchanged until the bundle is closed.
+ * - bundle_pem_len: Length of the buffer in bytes.
+ *
+ * Returns:
+ * - Pointer to the open bundle, which must be closed with EccPemBundleClose. The
+ *   buffer stays owned by the caller.
+ * - NULL if bundle_pem is NULL or memory allocation failed.
+ */
+EccPemBundle* EccPemBundleOpenBuffer(const char* bundle_pem, const size_t bundle_pem_len);
+
+
+
+/*
+ * Function reads the next public keys of a PEM bundle and stores them as
+ * compressed binary data, one after another, in a given array. Blocks that are not
+ * public keys are ignored, and public key blocks that cannot be decoded are
+ * skipped and counted in the bundle statistics.
+ *
+ * Arguments:
+ * - bundle: Open bundle.
+ * - public_keys: An array of at least max_keys * compressed_key_size bytes where
+ *                the compressed public keys will be stored.
+ * - compressed_key_size: Size of one compressed public key. Basically compressed
+ *                        public key size is 33 byte.
+ * - max_keys: Maximum number of keys to read.
+ *
+ * Returns:
+ * - Number of public keys stored in the array. 0 means the end of the bundle was
+ *   reached (or the arguments are invalid).
+ */
+size_t EccPemBundleNext(EccPemBundle* bundle,
+                        uint8_t public_keys[],
+                        const unsigned int compressed_key_size,
+                        const size_t max_keys);
+
+
+
+/*
+ * Function returns the statistics of a PEM bundle read so far.
+ *
+ * Arguments:
+ * - bundle: Open bundle.
+ * - stats: Where the statistics will be stored.
+ */
+void EccPemBundleGetStats(const EccPemBundle* bundle, EccPemBundleStats* stats);
+
+
+
+/*
+ * Function closes a PEM bundle.
+ *
+ * Arguments:
+ * - bundle: Bundle to close. NULL is ignored.
+ */
+void EccPemBundleClose(EccPemBundle* bundle);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * ===--- eccpem_cache.h ----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides an optional thread-safe cache of keys read from PEM formatted
+ * files. Repeated reads of an unchanged file are served from memory.
+ */
+
+#ifndef ECCPEM_CACHE_H_
+#define ECCPEM_CACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Least recently used cache of decoded keys. Entries are keyed by file path and
+ * are invalidated when the device, inode, modification time or size of the
+ * file changes. All functions taking a cache are safe to call from multiple
+ * threads at the same time.
+ */
+typedef struct EccPemKeyCache EccPemKeyCache;
+
+/*
+ * Statistics of a key cache.
+ *
+ * Fields:
+ * - hits: Number of reads served from the cache.
+ * - misses: Number of reads that had to parse the PEM file.
+ * - invalidations: Number of entries dropped because their file changed.
+ * - evictions: Number of entries dropped to make room for new ones.
+ * - num_entries: Number of entries currently in the cache.
+ */
+typedef struct {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t invalidations;
+  uint64_t evictions;
+  size_t num_entries;
+} EccPemKeyCacheStats;
+
+
+
+/*
+ * Function creates a new key cache.
+ *
+ * Arguments:
+ * - capacity: Maximum number of keys held by the cache. Must be greater than 0.
+ *
+ * Returns:
+ * - Pointer to the new cache, which must be freed with EccPemKeyCacheFree.
+ * - NULL if capacity is 0 or memory allocation failed.
+ */
+EccPemKeyCache* EccPemKeyCacheCreate(const size_t capacity);
+
+
+
+/*
+ * Function frees a key cache. Cached private keys are cleansed before their
+ * memory is released.
+ *
+ * Arguments:
+ * - cache: Cache to free. NULL is ignored.
+ */
+void EccPemKeyCacheFree(EccPemKeyCache* cache);
+
+
+
+/*
+ * Function drops all entries of a key cache. Statistics are not reset.
+ *
+ * Arguments:
+ * - cache: Cache to clear.
+ */
+void EccPemKeyCacheClear(EccPemKeyCache* cache);
+
+
+
+/*
+ * Function behaves like ReadPrivateKeyPemFile, but serves the private key from the
+ * cache if the file has not changed since it was last read.
+ *
+ * Arguments:
+ * - cache: Cache to use.
+ * - privkey_file: PEM formatted file (extension is .pem) from which the private key
+ *                 will be read.
+ * - private_key: An array where the private key will be stored.
+ * - key_size: Size of array.
+ *
+ * Returns:
+ * - 1 if the private key was stored in the array.
+ * - 0 if the cache is NULL or ReadPrivateKeyPemFile fails.
+ */
+int EccPemKeyCacheReadPrivateKey(EccPemKeyCache* cache,
+                                 const char* privkey_file,
+                                 uint8_t private_key[],
+                                 const unsigned int key_size);
+
+
+
+/*
+ * Function behaves like ReadPublicKeyPemFile, but serves the compressed public key
+ * from the cache if the file has not changed since it was last read.
+ *
+ * Arguments:
+ * - cache: Cache to use.
+ * - pubkey_file: PEM formatted file (extension is .pem) from which the public key
+ *                will be read.
+ * - public_key: An array where the compressed public key will be stored.
+ * - compressed_key_size: Size of array.
+ *
+ * Returns:
+ * - 1 if the compressed public key was stored in the array.
+ * - 0 if the cache is NULL or ReadPublicKeyPemFile fails.
+ */
+int EccPemKeyCacheReadPublicKey(EccPemKeyCache* cache,
+                                const char* pubkey_file,
+                                uint8_t public_key[],
+                                const unsigned int compressed_key_size);
+
+
+
+/*
+ * Function returns the statistics of a key cache.
+ *
+ * Arguments:
+ * - cache: Cache to query.
+ * - stats: Where the statistics will be stored.
+ */
+void EccPemKeyCacheGetStats(EccPemKeyCache* cache, EccPemKeyCacheStats* stats);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * ===--- eccpem_curve.h ----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides cached elliptic curve handles. A curve is resolved once from
+ * its name to its NID, its EC_GROUP and a key generation template; afterwards key generation takes the handle, so no
+ * curve name is parsed and no curve parameters are built per call. A handle can
+ * also be bound to an OpenSSL library context and property query, so the keys of
+ * the curve are generated and read by a chosen provider, e.g. a hardware one.
+ */
+
+#ifndef ECCPEM_CURVE_H_
+#define ECCPEM_CURVE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <openssl/types.h>
+
+/* Maximum number of distinct curves the process wide curve table holds. */
+#define ECCPEM_MAX_CACHED_CURVES 32
+
+/*
+ * Resolved elliptic curve. Handles are owned by the library, stay valid until the
+ * process exits, and can be used by any number of threads at the same time.
+ */
+typedef struct EccPemCurve EccPemCurve;
+
+
+
+/*
+ * Function returns the cached handle of a curve, resolving and caching it on
+ * first use. Later calls with the curve's name, or any of its other OpenSSL
+ * names, return the same handle.
+ *
+ * Arguments:
+ * - ec_type: Curve name as listed by the command: openssl ecparam -list_curves
+ *
+ * Returns:
+ * - Handle of the curve.
+ * - NULL if the name is unknown, setting up the curve failed, or the curve
+ *   table is full.
+ */
+const EccPemCurve* EccPemGetCurve(const char* ec_type);
+
+
+
+/*
+ * Function returns the cached handle of a curve given by its OpenSSL NID,
+ * resolving and caching it on first use.
+ *
+ * Returns:
+ * - Handle of the curve.
+ * - NULL if the NID is not a named curve, setting up the curve failed, or the
+ *   curve table is full.
+ */
+const EccPemCurve* EccPemGetCurveByNid(const int curve_nid);
+
+
+
+/*
+ * Function resolves and caches a set of curves up front, typically at service
+ * start-up, so the first key operation on each curve does not pay for it.
+ *
+ * Arguments:
+ * - ec_types: Array of num_curves curve names.
+ * - num_curves: Number of curve names.
+ *
+ * Returns:
+ * - 1 if every curve was resolved.
+ * - 0 if any name is unknown or setting up a curve failed.
+ */
+int EccPemInitCurves(const char* const ec_types[], const size_t num_curves);
+
+
+
+/*
+ * Function returns the cached handle of a curve whose keys are generated and read
+ * with the implementations a library context provides. Key generation with the
+ * handle and reader contexts created from it (see EccPemReaderCreate) fetch the
+ * EC key management, decoders and signature algorithm from libctx with the
+ * property query propq, e.g. to offload bulk key generation to a hardware
+ * provider. Different libctx or propq values give different handles of the same
+ * curve; libctx NULL and propq NULL give the handle of EccPemGetCurve.
+ *
+ * Arguments:
+ * - ec_type: Curve name as listed by the command: openssl ecparam -list_curves
+ * - libctx: Library context with the providers loaded, NULL for the default one.
+ *           It must not be freed while the handle is in use.
+ * - propq: Property query, e.g. "provider=qatprovider", or NULL. It is copied.
+ *
+ * Returns:
+ * - Handle of the curve.
+ * - NULL if the name is unknown, no provider of libctx matching propq implements
+ *   EC keys of the curve, or the curve table is full.
+ */
+const EccPemCurve* EccPemGetCurveFromProvider(const char* ec_type, OSSL_LIB_CTX* libctx,
+                                              const char* propq);
+
+
+
+/*
+ * Functions return properties of a curve handle: its OpenSSL NID, its short
+ * name, the size of its private keys and the size of its compressed public keys.
+ */
+int EccPemCurveGetNid(const EccPemCurve* curve);
+const char* EccPemCurveGetName(const EccPemCurve* curve);
+unsigned int EccPemCurveGetPrivateKeySize(const EccPemCurve* curve);
+unsigned int EccPemCurveGetCompressedKeySize(const EccPemCurve* curve);
+
+
+
+/*
+ * Functions return the library context and the property query a curve handle
+ * was created with, see EccPemGetCurveFromProvider. NULL stands for the default.
+ */
+OSSL_LIB_CTX* EccPemCurveGetLibraryContext(const EccPemCurve* curve);
+const char* EccPemCurveGetPropertyQuery(const EccPemCurve* curve);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * ===--- eccpem_error.h ----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides the error reporting of the library. Every function that fails
+ * records an error code and a detail message for the calling thread, which can
+ * be queried right after the failing call, like errno. Logging the messages to
+ * stderr is off by default, so rejecting bad input costs no system call and
+ * does not serialize threads.
+ */
+
+#ifndef ECCPEM_ERROR_H_
+#define ECCPEM_ERROR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Error codes.
+ *
+ * - ECCPEM_OK: No error was recorded.
+ * - ECCPEM_ERROR_INVALID_ARGUMENT: An argument is NULL, empty or out of range.
+ * - ECCPEM_ERROR_INVALID_FILE_NAME: A key file name does not have the .pem extension.
+ * - ECCPEM_ERROR_UNKNOWN_CURVE: The elliptic curve name is unknown to OpenSSL.
+ * - ECCPEM_ERROR_OPEN_FAILED: A file or directory cannot be opened or mapped.
+ * - ECCPEM_ERROR_DECODE_FAILED: Data cannot be parsed as a PEM key or key store.
+ * - ECCPEM_ERROR_NOT_EC_KEY: The key is not an EC key on a named curve.
+ * - ECCPEM_ERROR_KEY_SIZE_MISMATCH: A key size does not match the curve of the key.
+ * - ECCPEM_ERROR_KEY_MISMATCH: A public and a private key do not belong together.
+ * - ECCPEM_ERROR_BUFFER_TOO_SMALL: An output buffer is too small.
+ * - ECCPEM_ERROR_KEY_CONVERSION_FAILED: Getting or converting key material failed.
+ * - ECCPEM_ERROR_KEYGEN_FAILED: Setting up or running key generation failed.
+ * - ECCPEM_ERROR_ENCODE_FAILED: Encoding a key as DER or PEM failed.
+ * - ECCPEM_ERROR_WRITE_FAILED: Writing a file failed.
+ * - ECCPEM_ERROR_OUT_OF_MEMORY: Memory allocation failed.
+ * - ECCPEM_ERROR_THREAD_FAILED: Creating a thread failed.
+ * - ECCPEM_ERROR_INVALID_STATE: The call is not allowed in the current state,
+ *                               e.g. a pool that is shutting down.
+ */
+typedef enum {
+  ECCPEM_OK = 0,
+  ECCPEM_ERROR_INVALID_ARGUMENT,
+  ECCPEM_ERROR_INVALID_FILE_NAME,
+  ECCPEM_ERROR_UNKNOWN_CURVE,
+  ECCPEM_ERROR_OPEN_FAILED,
+  ECCPEM_ERROR_DECODE_FAILED,
+  ECCPEM_ERROR_NOT_EC_KEY,
+  ECCPEM_ERROR_KEY_SIZE_MISMATCH,
+  ECCPEM_ERROR_KEY_MISMATCH,
+  ECCPEM_ERROR_BUFFER_TOO_SMALL,
+  ECCPEM_ERROR_KEY_CONVERSION_FAILED,
+  ECCPEM_ERROR_KEYGEN_FAILED,
+  ECCPEM_ERROR_ENCODE_FAILED,
+  ECCPEM_ERROR_WRITE_FAILED,
+  ECCPEM_ERROR_OUT_OF_MEMORY,
+  ECCPEM_ERROR_THREAD_FAILED,
+  ECCPEM_ERROR_INVALID_STATE,
+  ECCPEM_NUM_ERRORS
+} EccPemError;
+
+
+
+/*
+ * Function returns the code of the last error recorded on the calling thread.
+ * Successful calls do not reset it, so it is only meaningful right after a call
+ * failed, or after EccPemClearError.
+ *
+ * Returns:
+ * - Code of the last error.
+ * - ECCPEM_OK if no error was recorded since the thread started or the last
+ *   EccPemClearError call.
+ */
+EccPemError EccPemGetLastError(void);
+
+
+
+/*
+ * Function returns the detail message of the last error recorded on the calling
+ * thread, e.g. "Failed to open public key PEM file". The message is owned by the
+ * library and valid until the next error on the same thread.
+ *
+ * Returns:
+ * - Detail message of the last error.
+ * - Empty string if no error was recorded.
+ */
+const char* EccPemGetLastErrorDetail(void);
+
+
+
+/*
+ * Function resets the last error of the calling thread to ECCPEM_OK.
+ */
+void EccPemClearError(void);
+
+
+
+/*
+ * Function returns a short description of an error code, e.g. "file cannot be
+ * opened".
+ *
+ * Returns:
+ * - Description of the error code.
+ * - "unknown error" if error is out of range.
+ */
+const char* EccPemErrorString(const EccPemError error);
+
+
+
+/*
+ * Function turns logging of error detail messages to stderr on or off, for all
+ * threads. It is off by default.
+ *
+ * Arguments:
+ * - enabled: 1 to log every recorded error, 0 to only record it.
+ */
+void EccPemSetErrorLogging(const int enabled);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
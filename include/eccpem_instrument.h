@@ -0,0 +1,107 @@
+/*
+ * ===--- eccpem_instrument.h -----------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides the optional instrumentation of the library: per stage counters
+ * and cumulative timers of the key read and write paths. Instrumentation is
+ * compiled in with the ECCPEM_INSTRUMENTATION CMake option. Without it the
+ * functions below are still available, but no counting is done and the read and
+ * write paths are exactly the uninstrumented code.
+ */
+
+#ifndef ECCPEM_INSTRUMENT_H_
+#define ECCPEM_INSTRUMENT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * Instrumented stages of the read and write paths.
+ *
+ * - ECCPEM_STAGE_OPEN: Opening and reading a key file.
+ * - ECCPEM_STAGE_PEM_DECODE: Decoding PEM data into a key (base64 and DER).
+ * - ECCPEM_STAGE_EC_CONVERSION: Getting the private scalar of a key, or deriving
+ *                               the public key from it.
+ * - ECCPEM_STAGE_POINT_ENCODE: Encoding the public point of a key.
+ * - ECCPEM_STAGE_KEYGEN: Generating a key pair.
+ * - ECCPEM_STAGE_PEM_ENCODE: Encoding a key pair as PEM data.
+ * - ECCPEM_STAGE_WRITE: Writing PEM data to files.
+ */
+typedef enum {
+  ECCPEM_STAGE_OPEN = 0,
+  ECCPEM_STAGE_PEM_DECODE,
+  ECCPEM_STAGE_EC_CONVERSION,
+  ECCPEM_STAGE_POINT_ENCODE,
+  ECCPEM_STAGE_KEYGEN,
+  ECCPEM_STAGE_PEM_ENCODE,
+  ECCPEM_STAGE_WRITE,
+  ECCPEM_NUM_STAGES
+} EccPemStage;
+
+/*
+ * Counters of one stage.
+ *
+ * Fields:
+ * - count: Number of times the stage ran.
+ * - nanoseconds: Cumulative wall clock time spent in the stage.
+ */
+typedef struct {
+  uint64_t count;
+  uint64_t nanoseconds;
+} EccPemStageCounters;
+
+/* Counters of all stages, summed over all threads. */
+typedef struct {
+  EccPemStageCounters stages[ECCPEM_NUM_STAGES];
+} EccPemCounters;
+
+
+
+/*
+ * Function stores the counters of all stages, summed over all threads that ran
+ * them since the process started or the last EccPemResetCounters call. Threads
+ * that exited are included.
+ *
+ * Arguments:
+ * - counters: Where the counters will be stored.
+ *
+ * Returns:
+ * - 1 if instrumentation is compiled in.
+ * - 0 if it is not, in which case all counters are zero.
+ */
+int EccPemGetCounters(EccPemCounters* counters);
+
+
+
+/*
+ * Function resets the counters returned by EccPemGetCounters to zero. Stages
+ * that are running on other threads at the time are counted either before or
+ * after the reset, never lost.
+ */
+void EccPemResetCounters(void);
+
+
+
+/*
+ * Function returns the name of a stage, e.g. "pem_decode".
+ *
+ * Returns:
+ * - Name of the stage.
+ * - "unknown" if stage is out of range.
+ */
+const char* EccPemStageName(const EccPemStage stage);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * ===--- eccpem_loader.h ---------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides functionality to load every public key PEM file of a directory
+ * at once. The directory is scanned for .pem files first, so the caller can size
+ * the output, and the files are then read on several threads.
+ */
+
+#ifndef ECCPEM_LOADER_H_
+#define ECCPEM_LOADER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Scanned key directory: the sorted list of .pem files found in it. A scanned
+ * directory is read-only, so it can be used by any number of threads.
+ */
+typedef struct EccPemKeyDirectory EccPemKeyDirectory;
+
+/*
+ * Statistics of a directory load.
+ *
+ * Fields:
+ * - num_threads: Number of worker threads that were used.
+ * - num_files: Number of .pem files in the directory.
+ * - num_loaded: Number of public keys that were read.
+ * - elapsed_seconds: Wall clock time of the load.
+ * - files_per_second: Throughput of the load (num_files / elapsed_seconds).
+ */
+typedef struct {
+  unsigned int num_threads;
+  size_t num_files;
+  size_t num_loaded;
+  double elapsed_seconds;
+  double files_per_second;
+} EccPemLoadStats;
+
+
+
+/*
+ * Function lists the regular files with .pem extension in a directory. Other
+ * entries and subdirectories are skipped. Files are sorted by name, so the order
+ * is the same on every scan of an unchanged directory.
+ *
+ * Arguments:
+ * - directory: Path of the directory to scan.
+ *
+ * Returns:
+ * - Pointer to the scanned directory, which must be freed with
+ *   EccPemKeyDirectoryClose.
+ * - NULL if the directory cannot be opened or read, or memory allocation failed.
+ */
+EccPemKeyDirectory* EccPemKeyDirectoryScan(const char* directory);
+
+
+
+/*
+ * Function returns the number of .pem files found by EccPemKeyDirectoryScan.
+ */
+size_t EccPemKeyDirectoryNumFiles(const EccPemKeyDirectory* key_dir);
+
+
+
+/*
+ * Function returns the path (directory and file name) of the index-th .pem file.
+ *
+ * Returns:
+ * - Path of the file, valid until the directory is closed.
+ * - NULL if index is out of range.
+ */
+const char* EccPemKeyDirectoryGetFile(const EccPemKeyDirectory* key_dir, const size_t index);
+
+
+
+/*
+ * Function reads the public key of every .pem file of a scanned directory on
+ * several threads and stores the compressed keys in one contiguous array, the
+ * same binary data ReadPublicKeyPemFile returns.
+ *
+ * Arguments:
+ * - key_dir: Scanned directory.
+ * - public_keys: Output array of EccPemKeyDirectoryNumFiles(key_dir) *
+ *                compressed_key_size bytes. The compressed public key of the i-th
+ *                file is stored at offset i * compressed_key_size.
+ * - compressed_key_size: Size of one compressed public key, see ReadPublicKeyPemFile.
+ * - results: Optional array with an entry per file (can be NULL). Entry i is set
+ *            to 1 if the public key of the i-th file was read, 0 otherwise.
+ * - num_threads: Number of threads to use. 0 uses one thread per online CPU.
+ * - stats: Optional (can be NULL). Filled with the statistics of the load.
+ *
+ * Returns:
+ * - Number of public keys that were read. A file is skipped if it cannot be read,
+ *   is not an EC public key, or compressed_key_size does not match its curve.
+ */
+size_t EccPemKeyDirectoryLoadPublicKeys(const EccPemKeyDirectory* key_dir,
+                                        uint8_t public_keys[],
+                                        const unsigned int compressed_key_size,
+                                        int results[],
+                                        const unsigned int num_threads,
+                                        EccPemLoadStats* stats);
+
+
+
+/*
+ * Function frees a scanned directory.
+ */
+void EccPemKeyDirectoryClose(EccPemKeyDirectory* key_dir);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
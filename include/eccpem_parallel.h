@@ -0,0 +1,78 @@
+/*
+ * ===--- eccpem_parallel.h -------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides functionality to generate large numbers of Elliptic Curve
+ * Cryptography (ECC) key pairs in parallel and write them to PEM formatted files.
+ */
+
+#ifndef ECCPEM_PARALLEL_H_
+#define ECCPEM_PARALLEL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/*
+ * Statistics of a parallel key generation run.
+ *
+ * Fields:
+ * - num_threads: Number of worker threads that were used.
+ * - num_keys: Number of key pairs that were requested.
+ * - num_created: Number of key pairs that were generated and written.
+ * - elapsed_seconds: Wall clock time of the whole run.
+ * - keys_per_second: Throughput of the run (num_created / elapsed_seconds).
+ */
+typedef struct {
+  unsigned int num_threads;
+  size_t num_keys;
+  size_t num_created;
+  double elapsed_seconds;
+  double keys_per_second;
+} EccPemParallelStats;
+
+
+
+/*
+ * Function generates Elliptic Curve Cryptography (ECC) key pairs on the same curve
+ * on several threads and writes every pair to its own PEM formatted files. Every
+ * thread sets up its own key generation context once and then takes chunks of
+ * key pairs from a shared queue until all of them are done.
+ *
+ * Arguments:
+ * - ec_type: Elliptic Curve type. To list the supported curves run:
+ *            $ openssl ecparam -list_curves
+ * - num_keys: Number of key pairs to generate.
+ * - pubkey_files: Array of num_keys PEM formatted files (extension is .pem) where
+ *                 the public keys will be stored.
+ * - privkey_files: Array of num_keys PEM formatted files (extension is .pem) where
+ *                  the private keys will be stored.
+ * - results: Optional array of num_keys entries (can be NULL). Entry i is set to 1
+ *            if the i-th key pair was generated and written, 0 otherwise.
+ * - num_threads: Number of threads to use. 0 uses one thread per online CPU.
+ * - stats: Optional (can be NULL). Filled with the statistics of the run.
+ *
+ * Returns:
+ * - Number of key pairs that were generated and written to PEM files successfully.
+ */
+size_t CreateECCKeysPemFilesParallel(const char* ec_type,
+                                     const size_t num_keys,
+                                     const char* const pubkey_files[],
+                                     const char* const privkey_files[],
+                                     int results[],
+                                     const unsigned int num_threads,
+                                     EccPemParallelStats* stats);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * ===--- eccpem_pool.h -----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides a pool of pre-generated Elliptic Curve Cryptography (ECC) key
+ * pairs. Keys are generated ahead of time by a background thread and handed out
+ * without waiting for key generation, so issuing a fresh key pair only costs
+ * encoding or writing it.
+ */
+
+#ifndef ECCPEM_POOL_H_
+#define ECCPEM_POOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "eccpem_curve.h"
+
+/*
+ * Pool of ready-made key pairs on one curve. All functions taking a pool may be
+ * called from any number of threads at the same time, except EccPemKeyPoolFree.
+ */
+typedef struct EccPemKeyPool EccPemKeyPool;
+
+/*
+ * Statistics of a key pool, used to size it.
+ *
+ * Fields:
+ * - capacity: Maximum number of ready key pairs.
+ * - low_watermark: Depth at or below which the background thread refills the pool.
+ * - depth: Number of ready key pairs at the time of the call.
+ * - min_depth: Lowest depth seen by a take since the pool was created.
+ * - num_taken: Number of key pairs handed out.
+ * - num_stalls: Number of takes that found the pool empty and had to generate
+ *               the key pair on the calling thread.
+ * - num_generated: Number of key pairs generated for the pool, including the
+ *                  initial fill.
+ */
+typedef struct {
+  size_t capacity;
+  size_t low_watermark;
+  size_t depth;
+  size_t min_depth;
+  uint64_t num_taken;
+  uint64_t num_stalls;
+  uint64_t num_generated;
+} EccPemKeyPoolStats;
+
+
+
+/*
+ * Function creates a key pool, fills it and starts its background refill thread.
+ * The pool is full when the function returns.
+ *
+ * Arguments:
+ * - curve: Handle of the elliptic curve, see EccPemGetCurve.
+ * - capacity: Maximum number of ready key pairs. It is rounded up to a power of two.
+ * - low_watermark: The pool is refilled up to its capacity whenever taking a key
+ *                  pair leaves at most low_watermark ready. It must be less than
+ *                  capacity.
+ *
+ * Returns:
+ * - Pointer to the pool, which must be freed with EccPemKeyPoolFree.
+ * - NULL if the arguments are invalid, or generating keys or starting the thread
+ *   failed.
+ */
+EccPemKeyPool* EccPemKeyPoolCreate(const EccPemCurve* curve,
+                                   const size_t capacity,
+                                   const size_t low_watermark);
+
+
+
+/*
+ * Function stops the refill thread and frees the pool with all key pairs still
+ * in it. No other thread may use the pool anymore.
+ */
+void EccPemKeyPoolFree(EccPemKeyPool* pool);
+
+
+
+/*
+ * Function hands out a key pair of the pool and writes it to PEM formatted files,
+ * like CreateECCKeysPemFilesWithCurve does. Every key pair is handed out once.
+ *
+ * Arguments:
+ * - pool: Key pool.
+ * - pubkey_file: PEM formatted file (extension is .pem) where the public key will
+ *                be stored.
+ * - privkey_file: PEM formatted file (extension is .pem) where the private key will
+ *                 be stored.
+ *
+ * Returns:
+ * - 1 if the key pair was written to both PEM files.
+ * - 0 otherwise.
+ */
+int EccPemKeyPoolTakePemFiles(EccPemKeyPool* pool,
+                              const char* pubkey_file,
+                              const char* privkey_file);
+
+
+
+/*
+ * Function hands out a key pair of the pool and writes it in PEM format to memory
+ * buffers, like CreateECCKeysPemBuffers does. Both buffers are null-terminated.
+ *
+ * Arguments:
+ * - pool: Key pool.
+ * - pubkey_pem, pubkey_pem_size: Buffer for the public key PEM data and its size.
+ * - pubkey_pem_len: Where the length of the public key PEM data will be stored.
+ * - privkey_pem, privkey_pem_size: Buffer for the private key PEM data and its size.
+ * - privkey_pem_len: Where the length of the private key PEM data will be stored.
+ *
+ * Returns:
+ * - 1 if the key pair was stored in both buffers.
+ * - 0 otherwise. If a buffer is too small, the required lengths are stored and
+ *   the key pair is discarded.
+ */
+int EccPemKeyPoolTakePemBuffers(EccPemKeyPool* pool,
+                                char pubkey_pem[],
+                                const size_t pubkey_pem_size,
+                                size_t* pubkey_pem_len,
+                                char privkey_pem[],
+                                const size_t privkey_pem_size,
+                                size_t* privkey_pem_len);
+
+
+
+/*
+ * Function returns the statistics of a key pool.
+ *
+ * Arguments:
+ * - pool: Key pool.
+ * - stats: Where the statistics will be stored.
+ */
+void EccPemKeyPoolGetStats(const EccPemKeyPool* pool, EccPemKeyPoolStats* stats);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,9 +17,14 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
 #include <openssl/ec.h>
 
+/* Largest encoded public key of any curve: an uncompressed point on a 571-bit
+ * curve. */
+#define ECCPEM_MAX_PUBLIC_KEY_SIZE 145
+
 /*
  * Function reads private key's PEM file and stores it in a given array as binary data.
  *
@@ -33,7 +38,7 @@ extern "C" {
  * Returns:
  * - 1 if reading PEM file and storing data to array was successful.
  * - 0 if it cannot open the provided PEM file, cannot read the provided PEM file,
- *     fails to convert EVP_PKEY to EC_KEY, or fails to convert bignum to binary.
+ *     fails to get the EC private key, or fails to convert bignum to binary.
  */
 int ReadPrivateKeyPemFile(const char* privkey_file,
                           uint8_t private_key[],
@@ -41,6 +46,30 @@ int ReadPrivateKeyPemFile(const char* privkey_file,
 
 
 
+/*
+ * Function reads a PEM formatted private key from a memory buffer and stores it in a
+ * given array as binary data. The buffer is parsed in memory, no file is involved.
+ *
+ * Arguments:
+ * - privkey_pem: Buffer containing the PEM formatted private key. It does not need
+ *                to be null-terminated.
+ * - privkey_pem_len: Length of the PEM data in bytes.
+ * - private_key: An array where the private key will be stored.
+ * - key_size: Size of array. Run `$ openssl ecparam -list_curves` command to see
+ *            the binary size of the specific cryptographic algorithm.
+ *
+ * Returns:
+ * - 1 if reading PEM data and storing it to array was successful.
+ * - 0 if the buffer cannot be parsed as a PEM private key, fails to convert
+ *     get the EC private key, or fails to convert bignum to binary.
+ */
+int ReadPrivateKeyPemBuffer(const char* privkey_pem,
+                            const size_t privkey_pem_len,
+                            uint8_t private_key[],
+                            const unsigned int key_size);
+
+
+
 /*
  * Function reads public key's PEM file and stores it in a given array as binary data.
  * Note that the array will contain a compressed public key.
@@ -49,12 +78,14 @@ int ReadPrivateKeyPemFile(const char* privkey_file,
  * - pubkey_file: PEM formatted file (extension is .pem) from which the public key
  *                will be read and stored in an array as binary data.
  * - public_key: An array where the compressed public key will be stored.
- * - compressed_key_size: Size of array. Basically compressed public key size is 33 byte.
+ * - compressed_key_size: Size of array. It must be the compressed key size of the
+ *                        key's curve: 33 bytes for 256-bit curves, 49 for secp384r1,
+ *                        67 for secp521r1.
  *
  * Returns:
  * - 1 if reading PEM file and storing data to array was successful.
  * - 0 if it cannot open the provided PEM file, cannot read the provided PEM file,
- *     fails to convert EVP_PKEY to EC_KEY, or fails to read compressed EC public key.
+ *     fails to get the EC public key, or fails to read compressed EC public key.
  */
 int ReadPublicKeyPemFile(const char* pubkey_file,
                          uint8_t public_key[],
@@ -62,6 +93,103 @@ int ReadPublicKeyPemFile(const char* pubkey_file,
 
 
 
+/*
+ * Function reads a PEM formatted public key from a memory buffer and stores it in a
+ * given array as binary data. The buffer is parsed in memory, no file is involved.
+ * Note that the array will contain a compressed public key.
+ *
+ * Arguments:
+ * - pubkey_pem: Buffer containing the PEM formatted public key. It does not need
+ *               to be null-terminated.
+ * - pubkey_pem_len: Length of the PEM data in bytes.
+ * - public_key: An array where the compressed public key will be stored.
+ * - compressed_key_size: Size of array. It must be the compressed key size of the
+ *                        key's curve, see ReadPublicKeyPemFile.
+ *
+ * Returns:
+ * - 1 if reading PEM data and storing it to array was successful.
+ * - 0 if the buffer cannot be parsed as a PEM public key, fails to convert
+ *     get the EC public key, or fails to read compressed EC public key.
+ */
+int ReadPublicKeyPemBuffer(const char* pubkey_pem,
+                           const size_t pubkey_pem_len,
+                           uint8_t public_key[],
+                           const unsigned int compressed_key_size);
+
+
+
+/*
+ * Function reads public key's PEM file of any curve and stores the encoded public
+ * key in the requested form, along with its actual length and the NID of its
+ * curve. If public_key is NULL, only the length and NID are stored, so the caller
+ * can size the buffer first.
+ *
+ * Arguments:
+ * - pubkey_file: PEM formatted file (extension is .pem) containing the public key.
+ * - form: POINT_CONVERSION_COMPRESSED or POINT_CONVERSION_UNCOMPRESSED.
+ * - public_key: Output buffer for the encoded public key, or NULL to query its size.
+ * - public_key_size: Size of output buffer. ECCPEM_MAX_PUBLIC_KEY_SIZE bytes fit any
+ *                    key.
+ * - public_key_len: Where the length of the encoded public key will be stored.
+ * - curve_nid: Where the OpenSSL NID of the key's curve will be stored. It can be NULL.
+ *
+ * Returns:
+ * - 1 if the public key (or, with a NULL buffer, its length) was stored.
+ * - 0 if it cannot open or read the provided PEM file, the arguments are invalid,
+ *     the key is not an EC key, or the buffer is too small.
+ */
+int ReadPublicKeyPemFileEx(const char* pubkey_file,
+                           const point_conversion_form_t form,
+                           uint8_t public_key[],
+                           const size_t public_key_size,
+                           size_t* public_key_len,
+                           int* curve_nid);
+
+
+
+/*
+ * Function is the memory buffer variant of ReadPublicKeyPemFileEx. The buffer of
+ * PEM data (pubkey_pem, pubkey_pem_len) does not need to be null-terminated.
+ */
+int ReadPublicKeyPemBufferEx(const char* pubkey_pem,
+                             const size_t pubkey_pem_len,
+                             const point_conversion_form_t form,
+                             uint8_t public_key[],
+                             const size_t public_key_size,
+                             size_t* public_key_len,
+                             int* curve_nid);
+
+
+
+/*
+ * Function reads private keys' PEM files and derives the compressed public key
+ * of each, the same binary data ReadPublicKeyPemFile returns. One BN_CTX is reused
+ * across the whole batch, and the EC_GROUP of each curve is cached process wide
+ * (see eccpem_curve.h).
+ *
+ * Arguments:
+ * - privkey_files: Array of num_keys private key PEM files (extension is .pem).
+ * - num_keys: Number of private keys.
+ * - public_keys: Output array of num_keys * compressed_key_size bytes. The
+ *                compressed public key of privkey_files[i] is stored at offset
+ *                i * compressed_key_size.
+ * - compressed_key_size: Size of one compressed public key. Basically compressed
+ *                        public key size is 33 byte.
+ * - results: Optional array of num_keys entries. Entry i is set to 1 if the
+ *            public key of privkey_files[i] was derived, 0 otherwise. It can be NULL.
+ *
+ * Returns:
+ * - Number of public keys that were derived. A key is skipped if its file cannot
+ *   be read, it is not an EC key, or compressed_key_size does not match its curve.
+ */
+size_t DerivePublicKeysFromPemFiles(const char* const privkey_files[],
+                                    const size_t num_keys,
+                                    uint8_t public_keys[],
+                                    const unsigned int compressed_key_size,
+                                    int results[]);
+
+
+
 #ifdef __cplusplus
 }
 #endif
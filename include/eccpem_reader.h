@@ -0,0 +1,150 @@
+/*
+ * ===--- eccpem_reader.h ---------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides reader contexts, which read many keys of one curve from PEM
+ * formatted files and buffers. A reader sets up its OpenSSL decoder contexts,
+ * big number context and scratch buffers once, so a read only pays for decoding
+ * the key itself.
+ */
+
+#ifndef ECCPEM_READER_H_
+#define ECCPEM_READER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "eccpem_curve.h"
+
+/*
+ * Reader of the keys of one curve. Keys on other curves are rejected. A reader
+ * is not safe to use from multiple threads at the same time; create one per
+ * thread instead.
+ */
+typedef struct EccPemReader EccPemReader;
+
+
+
+/*
+ * Function creates a new reader.
+ *
+ * Arguments:
+ * - curve: Handle of the curve of the keys that will be read. Keys are decoded
+ *          with the library context and property query of the handle, see
+ *          EccPemGetCurveFromProvider.
+ *
+ * Returns:
+ * - Pointer to the new reader, which must be freed with EccPemReaderFree.
+ * - NULL if curve is NULL or setting up the reader failed.
+ */
+EccPemReader* EccPemReaderCreate(const EccPemCurve* curve);
+
+
+
+/*
+ * Function frees a reader. Its scratch buffers are cleansed first.
+ *
+ * Arguments:
+ * - reader: Reader to free. NULL is ignored.
+ */
+void EccPemReaderFree(EccPemReader* reader);
+
+
+
+/*
+ * Function is ReadPrivateKeyPemFile through a reader.
+ *
+ * Arguments:
+ * - reader: Reader for the curve of the key.
+ * - privkey_file: PEM formatted file (extension is .pem) with the private key.
+ * - private_key: An array where the private key will be stored.
+ * - key_size: Size of array, the private key size of the curve.
+ *
+ * Returns:
+ * - 1 if the private key was read and stored.
+ * - 0 if the file cannot be opened or parsed, the key is not on the curve of
+ *   the reader, or key_size does not fit the key.
+ */
+int EccPemReaderReadPrivateKeyFile(EccPemReader* reader, const char* privkey_file,
+                                   uint8_t private_key[], const unsigned int key_size);
+
+
+
+/*
+ * Function is ReadPrivateKeyPemBuffer through a reader.
+ *
+ * Arguments:
+ * - reader: Reader for the curve of the key.
+ * - privkey_pem: Buffer containing the PEM formatted private key. It does not
+ *                need to be null-terminated.
+ * - privkey_pem_len: Length of the PEM data in bytes.
+ * - private_key: An array where the private key will be stored.
+ * - key_size: Size of array, the private key size of the curve.
+ *
+ * Returns:
+ * - 1 if the private key was read and stored.
+ * - 0 if the buffer cannot be parsed, the key is not on the curve of the
+ *   reader, or key_size does not fit the key.
+ */
+int EccPemReaderReadPrivateKeyBuffer(EccPemReader* reader, const char* privkey_pem,
+                                     const size_t privkey_pem_len, uint8_t private_key[],
+                                     const unsigned int key_size);
+
+
+
+/*
+ * Function is ReadPublicKeyPemFile through a reader.
+ *
+ * Arguments:
+ * - reader: Reader for the curve of the key.
+ * - pubkey_file: PEM formatted file (extension is .pem) with the public key.
+ * - public_key: Output buffer to store the compressed public key binary data.
+ * - compressed_key_size: Size of output buffer, the compressed public key size
+ *                        of the curve.
+ *
+ * Returns:
+ * - 1 if the compressed public key was stored.
+ * - 0 if the file cannot be opened or parsed, the key is not on the curve of
+ *   the reader, or compressed_key_size does not match it.
+ */
+int EccPemReaderReadPublicKeyFile(EccPemReader* reader, const char* pubkey_file,
+                                  uint8_t public_key[], const unsigned int compressed_key_size);
+
+
+
+/*
+ * Function is ReadPublicKeyPemBuffer through a reader.
+ *
+ * Arguments:
+ * - reader: Reader for the curve of the key.
+ * - pubkey_pem: Buffer containing the PEM formatted public key. It does not need
+ *               to be null-terminated.
+ * - pubkey_pem_len: Length of the PEM data in bytes.
+ * - public_key: Output buffer to store the compressed public key binary data.
+ * - compressed_key_size: Size of output buffer, the compressed public key size
+ *                        of the curve.
+ *
+ * Returns:
+ * - 1 if the compressed public key was stored.
+ * - 0 if the buffer cannot be parsed, the key is not on the curve of the
+ *   reader, or compressed_key_size does not match it.
+ */
+int EccPemReaderReadPublicKeyBuffer(EccPemReader* reader, const char* pubkey_pem,
+                                    const size_t pubkey_pem_len, uint8_t public_key[],
+                                    const unsigned int compressed_key_size);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ * ===--- eccpem_secure.h ---------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides secure memory for private key material of bulk operations: an
+ * optional wrapper of OpenSSL's secure heap, which keeps the big numbers of
+ * private keys in locked memory, and secure arenas, which hold the scalars of
+ * many keys contiguously in one locked, guarded mapping that is cleansed in bulk.
+ */
+
+#ifndef ECCPEM_SECURE_H_
+#define ECCPEM_SECURE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "eccpem_curve.h"
+
+/*
+ * Memory region for private key material. Its pages are locked into RAM when
+ * the process may lock them, excluded from core dumps, and surrounded by
+ * inaccessible guard pages, so overruns fault instead of reaching other data.
+ * Keys are stored back to back and the whole arena is cleansed at once. An
+ * arena is not safe to use from multiple threads at the same time.
+ */
+typedef struct EccPemSecureArena EccPemSecureArena;
+
+
+
+/*
+ * Function initializes OpenSSL's secure heap, see CRYPTO_secure_malloc_init.
+ * OpenSSL then allocates the big numbers of private keys, e.g. while generating
+ * or decoding them, from this locked heap instead of the regular one. It must be
+ * called before other threads use OpenSSL.
+ *
+ * Arguments:
+ * - size: Size of the heap in bytes, a power of two. It must be large enough for
+ *         all private keys alive at the same time, since allocations fail once it
+ *         is full; about 100 bytes per key and thread in flight suffice.
+ *
+ * Returns:
+ * - 1 if the secure heap is set up, or already was.
+ * - 0 if it cannot be set up.
+ */
+int EccPemSecureHeapInit(const size_t size);
+
+
+
+/*
+ * Function tears down the secure heap set up by EccPemSecureHeapInit.
+ *
+ * Returns:
+ * - 1 if it was torn down.
+ * - 0 if allocations from it are still in use.
+ */
+int EccPemSecureHeapDone(void);
+
+
+
+/*
+ * Function creates a secure arena.
+ *
+ * Arguments:
+ * - capacity: Number of bytes the arena can hold, e.g. the number of keys times
+ *             the private key size of their curve. It is rounded up to whole
+ *             pages.
+ *
+ * Returns:
+ * - Pointer to the arena, which must be freed with EccPemSecureArenaFree.
+ * - NULL if capacity is 0 or mapping the memory failed.
+ */
+EccPemSecureArena* EccPemSecureArenaCreate(const size_t capacity);
+
+
+
+/*
+ * Function cleanses and frees a secure arena.
+ *
+ * Arguments:
+ * - arena: Arena to free. NULL is ignored.
+ */
+void EccPemSecureArenaFree(EccPemSecureArena* arena);
+
+
+
+/*
+ * Function cleanses the used part of an arena with one pass and makes all of it
+ * available again.
+ */
+void EccPemSecureArenaClear(EccPemSecureArena* arena);
+
+
+
+/*
+ * Functions return whether the pages of an arena are locked into RAM (mlock may
+ * be denied, e.g. by RLIMIT_MEMLOCK, the arena then still works unlocked), its
+ * capacity in bytes, and the number of bytes in use.
+ */
+int EccPemSecureArenaIsLocked(const EccPemSecureArena* arena);
+size_t EccPemSecureArenaGetCapacity(const EccPemSecureArena* arena);
+size_t EccPemSecureArenaGetUsed(const EccPemSecureArena* arena);
+
+
+
+/*
+ * Function takes size bytes from an arena, right behind the previous ones.
+ *
+ * Returns:
+ * - Pointer to the zeroed bytes, valid until the arena is cleared or freed.
+ * - NULL if the arena has fewer than size bytes left.
+ */
+uint8_t* EccPemSecureArenaAlloc(EccPemSecureArena* arena, const size_t size);
+
+
+
+/*
+ * Function reads the private keys of PEM files into an arena. The keys are read
+ * with one reader context, so keys that match the DER template of the curve are
+ * copied from the decoded PEM body directly, without any OpenSSL big numbers.
+ *
+ * Arguments:
+ * - arena: Arena with room for num_files private keys of the curve.
+ * - curve: Handle of the curve of the keys.
+ * - privkey_files: Array of num_files PEM formatted files (.pem extension).
+ * - num_files: Number of files.
+ * - private_keys: Where the start of the keys in the arena will be stored. Key i
+ *                 is at offset i * EccPemCurveGetPrivateKeySize(curve); keys that
+ *                 could not be read are all zeros.
+ * - results: Optional array of num_files entries. Entry i is set to 1 if key i
+ *            was read, 0 otherwise. It can be NULL.
+ *
+ * Returns:
+ * - Number of keys that were read. 0 is also returned if the arguments are
+ *   invalid or the arena is too small, in which case nothing is taken from it.
+ */
+size_t EccPemSecureArenaReadPrivateKeyFiles(EccPemSecureArena* arena, const EccPemCurve* curve,
+                                            const char* const privkey_files[],
+                                            const size_t num_files, uint8_t** private_keys,
+                                            int results[]);
+
+
+
+/*
+ * Function generates key pairs and stores their private keys in an arena. One
+ * key generation context is set up for the whole batch.
+ *
+ * Arguments:
+ * - arena: Arena with room for num_keys private keys of the curve.
+ * - curve: Handle of the curve.
+ * - num_keys: Number of key pairs to generate.
+ * - private_keys: Where the start of the keys in the arena will be stored. Key i
+ *                 is at offset i * EccPemCurveGetPrivateKeySize(curve).
+ * - public_keys: Optional output array of num_keys compressed public keys of
+ *                EccPemCurveGetCompressedKeySize(curve) bytes each. It can be NULL.
+ *
+ * Returns:
+ * - Number of key pairs that were generated. It is less than num_keys only if
+ *   generation failed, the remaining keys are then all zeros.
+ */
+size_t EccPemSecureArenaGenerateKeys(EccPemSecureArena* arena, const EccPemCurve* curve,
+                                     const size_t num_keys, uint8_t** private_keys,
+                                     uint8_t public_keys[]);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
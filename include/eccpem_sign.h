@@ -0,0 +1,252 @@
+/*
+ * ===--- eccpem_sign.h -----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides ECDSA signing and verification with keys loaded from PEM
+ * formatted files or buffers, or generated. A key is loaded once into a handle,
+ * which is then used for any number of batches of digests, optionally on
+ * multiple threads, and gives access to the key's bytes without parsing again.
+ */
+
+#ifndef ECCPEM_SIGN_H_
+#define ECCPEM_SIGN_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <openssl/evp.h>
+
+#include "eccpem_curve.h"
+
+/*
+ * Key loaded from PEM data or generated, ready for signing or verification. A
+ * handle is immutable once created, so it can be used by multiple threads at the
+ * same time.
+ */
+typedef struct EccPemKey EccPemKey;
+
+
+
+/*
+ * Function loads a private key's PEM file into a key handle, which can sign and
+ * verify.
+ *
+ * Arguments:
+ * - privkey_file: PEM formatted file (extension is .pem) with an EC private key.
+ *
+ * Returns:
+ * - Pointer to the key handle, which must be freed with EccPemKeyFree.
+ * - NULL if the file cannot be read or does not hold an EC key on a named curve.
+ */
+EccPemKey* EccPemKeyLoadPrivateKeyFile(const char* privkey_file);
+
+
+
+/*
+ * Function loads a public key's PEM file into a key handle, which can verify.
+ *
+ * Arguments:
+ * - pubkey_file: PEM formatted file (extension is .pem) with an EC public key.
+ *
+ * Returns:
+ * - Pointer to the key handle, which must be freed with EccPemKeyFree.
+ * - NULL if the file cannot be read or does not hold an EC key on a named curve.
+ */
+EccPemKey* EccPemKeyLoadPublicKeyFile(const char* pubkey_file);
+
+
+
+/*
+ * Functions load a private or public key's PEM data from a memory buffer into a
+ * key handle, like EccPemKeyLoadPrivateKeyFile and EccPemKeyLoadPublicKeyFile.
+ *
+ * Arguments:
+ * - privkey_pem, pubkey_pem: Buffer containing the PEM formatted key. It does
+ *                            not need to be null-terminated.
+ * - privkey_pem_len, pubkey_pem_len: Length of the PEM data in bytes.
+ *
+ * Returns:
+ * - Pointer to the key handle, which must be freed with EccPemKeyFree.
+ * - NULL if the data cannot be parsed or does not hold an EC key on a named
+ *   curve.
+ */
+EccPemKey* EccPemKeyLoadPrivateKeyBuffer(const char* privkey_pem, const size_t privkey_pem_len);
+EccPemKey* EccPemKeyLoadPublicKeyBuffer(const char* pubkey_pem, const size_t pubkey_pem_len);
+
+
+
+/*
+ * Function generates a key pair into a private key handle.
+ *
+ * Arguments:
+ * - curve: Handle of the curve, see EccPemGetCurve. A handle of
+ *          EccPemGetCurveFromProvider generates the key with its provider, and
+ *          the key's signatures are made with the same provider.
+ *
+ * Returns:
+ * - Pointer to the key handle, which must be freed with EccPemKeyFree.
+ * - NULL if generating the key pair failed.
+ */
+EccPemKey* EccPemKeyGenerate(const EccPemCurve* curve);
+
+
+
+/*
+ * Function writes the key pair of a private key handle to PEM files, like
+ * CreateECCKeysPemFiles.
+ *
+ * Arguments:
+ * - key: Private key handle.
+ * - pubkey_file: PEM formatted file (extension is .pem) for the public key.
+ * - privkey_file: PEM formatted file (extension is .pem) for the private key.
+ *
+ * Returns:
+ * - 1 if both files were written.
+ * - 0 otherwise.
+ */
+int EccPemKeyWritePemFiles(const EccPemKey* key, const char* pubkey_file,
+                           const char* privkey_file);
+
+
+
+/*
+ * Function frees a key handle.
+ *
+ * Arguments:
+ * - key: Key handle to free. NULL is ignored.
+ */
+void EccPemKeyFree(EccPemKey* key);
+
+
+
+/*
+ * Function returns the curve of a key handle.
+ */
+const EccPemCurve* EccPemKeyGetCurve(const EccPemKey* key);
+
+
+
+/*
+ * Function reports whether a key handle holds a private key, i.e. can sign.
+ */
+int EccPemKeyIsPrivate(const EccPemKey* key);
+
+
+
+/*
+ * Function returns the largest DER encoded ECDSA signature the key can make,
+ * e.g. 72 bytes on prime256v1. It is the slot size signature buffers need.
+ */
+size_t EccPemKeyGetMaxSignatureSize(const EccPemKey* key);
+
+
+
+/*
+ * Functions return the private scalar and the compressed public point of a key
+ * handle. The bytes are stored in the handle, so no copy is made and they stay
+ * valid until the handle is freed.
+ *
+ * Arguments:
+ * - key: Key handle.
+ * - private_key_len, public_key_len: Optional, where the length is stored, e.g.
+ *                                    32 and 33 bytes on prime256v1.
+ *
+ * Returns:
+ * - Pointer to the bytes.
+ * - NULL if key is NULL, or for the scalar if it is a public key handle.
+ */
+const uint8_t* EccPemKeyGetPrivateKey(const EccPemKey* key, size_t* private_key_len);
+const uint8_t* EccPemKeyGetPublicKey(const EccPemKey* key, size_t* public_key_len);
+
+
+
+/*
+ * Function returns the EVP_PKEY structure a key handle owns, for use with other
+ * OpenSSL functions. It must not be freed or modified.
+ */
+EVP_PKEY* EccPemKeyGetEvpPkey(const EccPemKey* key);
+
+
+
+/*
+ * Function checks that a key handle holds a key on the given curve.
+ *
+ * Returns:
+ * - 1 if it does.
+ * - 0 otherwise, or if key is NULL.
+ */
+int EccPemKeyCheckCurve(const EccPemKey* key, const EccPemCurve* curve);
+
+
+
+/*
+ * Function signs a batch of digests with ECDSA. Every worker sets up one
+ * EVP_PKEY_CTX for the whole batch and signs the chunks of digests it takes
+ * from a shared queue.
+ *
+ * Arguments:
+ * - key: Private key handle.
+ * - digests: Array of num_digests digests of digest_len bytes each, stored back
+ *            to back.
+ * - digest_len: Length of one digest, e.g. 32 for SHA-256. At most 64.
+ * - num_digests: Number of digests.
+ * - signatures: Output array of num_digests slots of signature_size bytes. The
+ *               DER encoded signature of digest i is stored at offset
+ *               i * signature_size.
+ * - signature_size: Size of one slot. At least EccPemKeyGetMaxSignatureSize.
+ * - signature_lens: Output array of num_digests lengths. Entry i is the length
+ *                   of signature i, or 0 if signing digest i failed.
+ * - num_threads: Number of signing threads. 0 selects the number of online
+ *                CPUs, 1 signs on the calling thread.
+ *
+ * Returns:
+ * - Number of digests that were signed.
+ */
+size_t EccPemSignBatch(const EccPemKey* key, const uint8_t digests[], const size_t digest_len,
+                       const size_t num_digests, uint8_t signatures[],
+                       const size_t signature_size, size_t signature_lens[],
+                       const unsigned int num_threads);
+
+
+
+/*
+ * Function verifies a batch of ECDSA signatures of digests, like
+ * EccPemSignBatch signs them.
+ *
+ * Arguments:
+ * - key: Public or private key handle.
+ * - digests: Array of num_digests digests of digest_len bytes each, stored back
+ *            to back.
+ * - digest_len: Length of one digest, e.g. 32 for SHA-256. At most 64.
+ * - num_digests: Number of digests.
+ * - signatures: Array of num_digests slots of signature_size bytes. Slot i holds
+ *               the DER encoded signature of digest i.
+ * - signature_size: Size of one slot.
+ * - signature_lens: Array of num_digests lengths of the signatures.
+ * - results: Optional array of num_digests entries. Entry i is set to 1 if
+ *            signature i is valid, 0 otherwise. It can be NULL.
+ * - num_threads: Number of verification threads. 0 selects the number of online
+ *                CPUs, 1 verifies on the calling thread.
+ *
+ * Returns:
+ * - Number of valid signatures.
+ */
+size_t EccPemVerifyBatch(const EccPemKey* key, const uint8_t digests[], const size_t digest_len,
+                         const size_t num_digests, const uint8_t signatures[],
+                         const size_t signature_size, const size_t signature_lens[],
+                         int results[], const unsigned int num_threads);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
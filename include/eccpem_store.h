@@ -0,0 +1,197 @@
+/*
+ * ===--- eccpem_store.h ----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides a compact binary key store, a companion format to PEM files.
+ * A store holds fixed-size key records sorted by key fingerprint plus an index,
+ * so keys are looked up by fingerprint without any parsing. Stores are memory
+ * mapped read-only and can be shared by several processes.
+ */
+
+#ifndef ECCPEM_STORE_H_
+#define ECCPEM_STORE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Size of a key fingerprint (SHA-256 of the compressed public key). */
+#define ECCPEM_FINGERPRINT_SIZE 32
+
+/* Largest compressed public key a record holds (secp521r1). */
+#define ECCPEM_STORE_MAX_PUBLIC_KEY_SIZE 67
+
+/* Largest private key a record holds (secp521r1). */
+#define ECCPEM_STORE_MAX_PRIVATE_KEY_SIZE 66
+
+/*
+ * Fixed-size key record of a store. Records are stored in host byte order.
+ *
+ * Fields:
+ * - fingerprint: SHA-256 of the compressed public key.
+ * - curve_nid: OpenSSL NID of the elliptic curve.
+ * - public_key_len: Length of the compressed public key.
+ * - private_key_len: Length of the private key, 0 if the record has none.
+ * - public_key: Compressed public key.
+ * - private_key: Private key (big-endian scalar padded to the curve size).
+ */
+typedef struct {
+  uint8_t fingerprint[ECCPEM_FINGERPRINT_SIZE];
+  int32_t curve_nid;
+  uint8_t public_key_len;
+  uint8_t private_key_len;
+  uint8_t reserved[2];
+  uint8_t public_key[ECCPEM_STORE_MAX_PUBLIC_KEY_SIZE];
+  uint8_t private_key[ECCPEM_STORE_MAX_PRIVATE_KEY_SIZE];
+  uint8_t padding[3];
+} EccPemStoreRecord;
+
+/*
+ * Open, memory mapped key store. The mapping is read-only, so a store can be
+ * used by any number of threads at the same time.
+ */
+typedef struct EccPemStore EccPemStore;
+
+
+
+/*
+ * Function computes the fingerprint of a public key, the SHA-256 hash of its
+ * compressed form. Stores are indexed by this fingerprint.
+ *
+ * Arguments:
+ * - public_key: Compressed public key.
+ * - public_key_len: Length of the compressed public key.
+ * - fingerprint: An array of ECCPEM_FINGERPRINT_SIZE bytes where the fingerprint
+ *                will be stored.
+ *
+ * Returns:
+ * - 1 if the fingerprint was computed.
+ * - 0 if the arguments are invalid or hashing failed.
+ */
+int EccPemKeyFingerprint(const uint8_t public_key[],
+                         const size_t public_key_len,
+                         uint8_t fingerprint[]);
+
+
+
+/*
+ * Function converts PEM formatted key files into a binary key store. An existing
+ * store file is replaced atomically, so processes that have the old store mapped
+ * keep a consistent view.
+ *
+ * Arguments:
+ * - store_file: Path where the store will be written.
+ * - pubkey_files: Array of num_keys public key PEM files (extension is .pem). It
+ *                 can be NULL, or contain NULL entries, for keys whose private key
+ *                 file is given; the public key is then taken from the private key.
+ * - privkey_files: Array of num_keys private key PEM files (extension is .pem). It
+ *                  can be NULL, or contain NULL entries, for public-only records.
+ * - num_keys: Number of keys.
+ *
+ * Returns:
+ * - 1 if every key was converted and the store was written.
+ * - 0 if a key file cannot be read, a public and private key do not match, a key
+ *     is too large for a record, or writing the store failed. No store is
+ *     written in that case.
+ */
+int EccPemStoreBuild(const char* store_file,
+                     const char* const pubkey_files[],
+                     const char* const privkey_files[],
+                     const size_t num_keys);
+
+
+
+/*
+ * Function opens a binary key store by mapping it read-only.
+ *
+ * Arguments:
+ * - store_file: Path of the store.
+ *
+ * Returns:
+ * - Pointer to the open store, which must be closed with EccPemStoreClose.
+ * - NULL if the file cannot be opened or mapped, or is not a valid store.
+ */
+EccPemStore* EccPemStoreOpen(const char* store_file);
+
+
+
+/*
+ * Function looks up the record of a key by its fingerprint. No parsing is done,
+ * the returned record points into the mapped store.
+ *
+ * Arguments:
+ * - store: Open store.
+ * - fingerprint: ECCPEM_FINGERPRINT_SIZE bytes fingerprint of the key.
+ *
+ * Returns:
+ * - Pointer to the record, valid until the store is closed.
+ * - NULL if the store holds no key with the fingerprint.
+ */
+const EccPemStoreRecord* EccPemStoreLookup(const EccPemStore* store,
+                                           const uint8_t fingerprint[]);
+
+
+
+/*
+ * Function returns the number of records of a store.
+ */
+size_t EccPemStoreNumRecords(const EccPemStore* store);
+
+
+
+/*
+ * Function returns the record at a position of a store. Records are sorted by
+ * fingerprint.
+ *
+ * Returns:
+ * - Pointer to the record, valid until the store is closed.
+ * - NULL if index is out of range.
+ */
+const EccPemStoreRecord* EccPemStoreGetRecord(const EccPemStore* store,
+                                              const size_t index);
+
+
+
+/*
+ * Function converts a store record back into PEM formatted key files.
+ *
+ * Arguments:
+ * - record: Record of a store.
+ * - pubkey_file: PEM formatted file (extension is .pem) where the public key will
+ *                be stored.
+ * - privkey_file: PEM formatted file (extension is .pem) where the private key will
+ *                 be stored. It can be NULL; it must be NULL if the record has no
+ *                 private key.
+ *
+ * Returns:
+ * - 1 if the PEM files were written.
+ * - 0 if the record cannot be converted to a key or writing the files failed.
+ */
+int EccPemStoreRecordToPemFiles(const EccPemStoreRecord* record,
+                                const char* pubkey_file,
+                                const char* privkey_file);
+
+
+
+/*
+ * Function closes a store.
+ *
+ * Arguments:
+ * - store: Store to close. NULL is ignored.
+ */
+void EccPemStoreClose(EccPemStore* store);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * ===--- eccpem_watch.h ----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides watched key directories. The public keys of a directory are
+ * loaded once into an in-memory key table, and inotify then reports the .pem
+ * files that are created, modified or deleted, so only those are read again.
+ * Every update publishes a new immutable snapshot of the table, which readers
+ * pick up without ever waiting for an update.
+ */
+
+#ifndef ECCPEM_WATCH_H_
+#define ECCPEM_WATCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Watcher of one key directory. Updates must be applied by one thread at a time,
+ * while any number of threads acquire snapshots.
+ */
+typedef struct EccPemKeyWatcher EccPemKeyWatcher;
+
+/*
+ * Immutable snapshot of the key table of a watcher, sorted by file name. It is
+ * reference counted and stays valid until it is released, also after newer
+ * snapshots were published or the watcher was freed.
+ */
+typedef struct EccPemKeySnapshot EccPemKeySnapshot;
+
+/*
+ * Statistics of an update.
+ *
+ * Fields:
+ * - num_events: Number of inotify events read.
+ * - num_updated: Number of created or modified files whose key was read again.
+ * - num_removed: Number of files that were deleted or moved away. Their keys are
+ *                dropped from the table.
+ * - num_failed: Number of changed files whose key could not be read. Their keys
+ *               are dropped from the table.
+ * - full_reload: 1 if the kernel's event queue overflowed, so the whole
+ *                directory was loaded again, 0 otherwise.
+ * - generation: Generation of the snapshot in use after the update.
+ * - elapsed_seconds: Wall clock time of the update, without the time spent
+ *                    waiting for events.
+ */
+typedef struct {
+  size_t num_events;
+  size_t num_updated;
+  size_t num_removed;
+  size_t num_failed;
+  int full_reload;
+  uint64_t generation;
+  double elapsed_seconds;
+} EccPemWatchStats;
+
+
+
+/*
+ * Function starts watching a key directory and loads the public key of every
+ * .pem file in it, see EccPemKeyDirectoryLoadPublicKeys. Files whose key cannot
+ * be read are left out of the table.
+ *
+ * Arguments:
+ * - directory: Path of the directory to watch.
+ * - compressed_key_size: Size of one compressed public key, see
+ *                        ReadPublicKeyPemFile. Keys of other sizes are left out.
+ * - num_threads: Number of threads of the initial load. 0 uses one thread per
+ *                online CPU.
+ *
+ * Returns:
+ * - Pointer to the watcher, which must be freed with EccPemKeyWatcherFree.
+ * - NULL if the directory cannot be watched or loaded.
+ */
+EccPemKeyWatcher* EccPemKeyWatcherCreate(const char* directory,
+                                         const unsigned int compressed_key_size,
+                                         const unsigned int num_threads);
+
+
+
+/*
+ * Function stops watching and frees a watcher. Snapshots that were acquired
+ * stay valid until they are released.
+ *
+ * Arguments:
+ * - watcher: Watcher to free. NULL is ignored.
+ */
+void EccPemKeyWatcherFree(EccPemKeyWatcher* watcher);
+
+
+
+/*
+ * Function returns the inotify file descriptor of a watcher. It becomes readable
+ * when changes are pending, so it can be added to an event loop that calls
+ * EccPemKeyWatcherPoll with a timeout of 0.
+ */
+int EccPemKeyWatcherGetFd(const EccPemKeyWatcher* watcher);
+
+
+
+/*
+ * Function waits for changes of the directory and applies them. Only the keys of
+ * files that were created, modified, moved or deleted are read again, through a
+ * key cache, and the new table is published as a snapshot. Parts of the table
+ * without changes are shared with the previous snapshot, so the cost of an
+ * update grows with the number of changed files, not with the size of the table.
+ *
+ * Arguments:
+ * - watcher: Watcher to update.
+ * - timeout_ms: Time to wait for the first change in milliseconds. 0 returns at
+ *               once, -1 waits until a change arrives.
+ * - stats: Optional (can be NULL). Filled with the statistics of the update.
+ *
+ * Returns:
+ * - 1 if pending changes, if any, were applied.
+ * - 0 if reading the events failed or the directory itself was deleted or moved.
+ */
+int EccPemKeyWatcherPoll(EccPemKeyWatcher* watcher, const int timeout_ms,
+                         EccPemWatchStats* stats);
+
+
+
+/*
+ * Function acquires the current snapshot of a watcher. It never waits for an
+ * update in progress.
+ *
+ * Returns:
+ * - Pointer to the snapshot, which must be released with EccPemKeySnapshotRelease.
+ */
+EccPemKeySnapshot* EccPemKeyWatcherAcquireSnapshot(EccPemKeyWatcher* watcher);
+
+
+
+/*
+ * Function releases a snapshot acquired with EccPemKeyWatcherAcquireSnapshot.
+ *
+ * Arguments:
+ * - snapshot: Snapshot to release. NULL is ignored.
+ */
+void EccPemKeySnapshotRelease(EccPemKeySnapshot* snapshot);
+
+
+
+/*
+ * Functions return the number of keys of a snapshot and its generation, which
+ * grows by one with every published update.
+ */
+size_t EccPemKeySnapshotNumKeys(const EccPemKeySnapshot* snapshot);
+uint64_t EccPemKeySnapshotGetGeneration(const EccPemKeySnapshot* snapshot);
+
+
+
+/*
+ * Function looks up the public key of a file.
+ *
+ * Arguments:
+ * - snapshot: Snapshot to search.
+ * - file_name: Name of the file in the watched directory, e.g. "node1.pem".
+ *
+ * Returns:
+ * - Pointer to the compressed public key, valid until the snapshot is released.
+ * - NULL if the snapshot holds no key of that file.
+ */
+const uint8_t* EccPemKeySnapshotFind(const EccPemKeySnapshot* snapshot, const char* file_name);
+
+
+
+/*
+ * Function returns the index-th key of a snapshot in file name order.
+ *
+ * Arguments:
+ * - snapshot: Snapshot to read.
+ * - index: Index of the key, below EccPemKeySnapshotNumKeys.
+ * - file_name: Optional, where the file name will be stored.
+ *
+ * Returns:
+ * - Pointer to the compressed public key. It and the file name are valid until
+ *   the snapshot is released.
+ * - NULL if index is out of range.
+ */
+const uint8_t* EccPemKeySnapshotGetKey(const EccPemKeySnapshot* snapshot, const size_t index,
+                                       const char** file_name);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,8 +17,11 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include <openssl/ec.h>
 
+#include "eccpem_curve.h"
+
 /*
  * Function generates Elliptic Curve Cryptography (ECC) key pairs and writes them to
  * PEM formatted files. If the specified files already exist, they will be overwritten.
@@ -47,24 +50,85 @@ int CreateECCKeysPemFiles(const char* ec_type,
 
 
 /*
- * Function writes ECC key pairs from an EVP_PKEY structure to PEM formatted files.
- * If the specified files already exist, they will be overwritten. Otherwise, new
- * files will be created.
+ * Function is CreateECCKeysPemFiles for a cached curve handle. No curve name is
+ * resolved and no curve parameters are built per call, which makes it the
+ * variant of choice in hot paths.
  *
  * Arguments:
- * - pkey: EVP_PKEY structure containing the ECC public and private key pair
+ * - curve: Handle of the elliptic curve, see EccPemGetCurve.
  * - pubkey_file: PEM formatted file (extension is .pem) where the public key will
- *                be stored
+ *                be stored.
  * - privkey_file: PEM formatted file (extension is .pem) where the private key will
- *                 be stored
+ *                 be stored.
+ *
+ * Returns:
+ * - 1 if generation of key pairs and writing them to PEM files was successful.
+ * - 0 if curve is NULL, a file name is invalid, generating the keys failed, or
+ *     writing keys to PEM format files failed.
+ */
+int CreateECCKeysPemFilesWithCurve(const EccPemCurve* curve,
+                                   const char* pubkey_file,
+                                   const char* privkey_file);
+
+
+
+/*
+ * Function generates a batch of Elliptic Curve Cryptography (ECC) key pairs on the
+ * same curve and writes every pair to its own PEM formatted files. The key
+ * generation context and the curve are set up only once for the whole batch.
+ *
+ * Arguments:
+ * - ec_type: Elliptic Curve type. To list the supported curves run:
+ *            $ openssl ecparam -list_curves
+ * - num_keys: Number of key pairs to generate.
+ * - pubkey_files: Array of num_keys PEM formatted files (extension is .pem) where
+ *                 the public keys will be stored.
+ * - privkey_files: Array of num_keys PEM formatted files (extension is .pem) where
+ *                  the private keys will be stored.
+ * - results: Optional array of num_keys entries (can be NULL). Entry i is set to 1
+ *            if the i-th key pair was generated and written, 0 otherwise.
+ *
+ * Returns:
+ * - Number of key pairs that were generated and written to PEM files successfully.
+ */
+size_t CreateECCKeysPemFilesBatch(const char* ec_type,
+                                  const size_t num_keys,
+                                  const char* const pubkey_files[],
+                                  const char* const privkey_files[],
+                                  int results[]);
+
+
+
+/*
+ * Function generates Elliptic Curve Cryptography (ECC) key pairs and writes them in
+ * PEM format to the given memory buffers instead of files. Both buffers are
+ * null-terminated on success.
+ *
+ * Arguments:
+ * - ec_type: Elliptic Curve type. To list the supported curves run:
+ *            $ openssl ecparam -list_curves
+ * - pubkey_pem: Buffer where the PEM formatted public key will be stored.
+ * - pubkey_pem_size: Size of pubkey_pem buffer.
+ * - pubkey_pem_len: Length of the stored public key PEM data (without the
+ *                   terminating null character).
+ * - privkey_pem: Buffer where the PEM formatted private key will be stored.
+ * - privkey_pem_size: Size of privkey_pem buffer.
+ * - privkey_pem_len: Length of the stored private key PEM data (without the
+ *                    terminating null character).
  *
  * Returns:
- * - 1 if writing both keys to PEM files was successful
- * - 0 if writing either key to its PEM file failed
+ * - 1 if generation of key pairs and writing them to buffers was successful.
+ * - 0 if generating the key pair or encoding it fails, or if a buffer is too
+ *     small. In the latter case the required lengths are stored in
+ *     pubkey_pem_len and privkey_pem_len.
  */
-static int WriteKeysToPEMFiles(EVP_PKEY* pkey,
-                               const char* pubkey_file,
-                               const char* privkey_file);
+int CreateECCKeysPemBuffers(const char* ec_type,
+                            char pubkey_pem[],
+                            const size_t pubkey_pem_size,
+                            size_t* pubkey_pem_len,
+                            char privkey_pem[],
+                            const size_t privkey_pem_size,
+                            size_t* privkey_pem_len);
 
 
 
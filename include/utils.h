@@ -16,6 +16,7 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
 
 
@@ -35,6 +36,44 @@ extern "C" {
 int VerifyPemFileFormat(const char* pem_file);
 
 
+
+/*
+ * Function checks that a file name has a .pem extension, like VerifyPemFileFormat
+ * does, but without reporting an error. It is meant for filtering files, e.g. the
+ * entries of a directory.
+ *
+ * Arguments:
+ * - pem_file: Path or name of the file to check.
+ *
+ * Returns:
+ * - 1 if the file name ends with .pem.
+ * - 0 otherwise, or if pem_file is NULL.
+ */
+int HasPemFileExtension(const char* pem_file);
+
+
+
+/*
+ * Function performs a cheap structural pre-scan of PEM data, e.g. a buffer or a
+ * memory mapped file, before it is decoded. It looks for a complete block whose
+ * BEGIN and END labels match and name a key of the wanted type ("PRIVATE KEY",
+ * "ENCRYPTED PRIVATE KEY" or "EC PRIVATE KEY", or "PUBLIC KEY"), and whose body
+ * is well formed base64 of a plausible length. Nothing is decoded and no error
+ * is reported, so garbage can be rejected long before OpenSSL's PEM decoder
+ * would fail on it.
+ *
+ * Arguments:
+ * - pem: PEM data. It does not need to be null-terminated.
+ * - pem_len: Length of the data in bytes.
+ * - private_key: 1 to look for a private key, 0 for a public key.
+ *
+ * Returns:
+ * - 1 if the data holds a block that can be such a key.
+ * - 0 otherwise, or if pem is NULL. The data then cannot be read as such a key.
+ */
+int HasPemKeyBlock(const char* pem, const size_t pem_len, const int private_key);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,141 @@
+/*
+ * ===--- arena.c -----------------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides the reusable buffers batch writers encode PEM data into, and
+ * the helpers that write such buffers to files without stdio. Arenas hold
+ * private keys, so their memory is wiped whenever it is released or moved.
+ */
+
+#include "eccpem_internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+
+/* Capacity of an arena after its first allocation. */
+#define ECCPEM_ARENA_INITIAL_SIZE (64 * 1024)
+
+void EccPemArenaInit(EccPemArena* arena) {
+  arena->data = NULL;
+  arena->len = 0;
+  arena->capacity = 0;
+}
+
+
+
+void EccPemArenaClear(EccPemArena* arena) {
+  if (arena->data != NULL) {
+    OPENSSL_cleanse(arena->data, arena->len);
+  }
+  arena->len = 0;
+}
+
+
+
+void EccPemArenaFree(EccPemArena* arena) {
+  EccPemArenaClear(arena);
+  free(arena->data);
+  EccPemArenaInit(arena);
+}
+
+
+
+/*
+ * Function makes sure an arena has room for size more bytes. Growing copies the
+ * data into a new block and wipes the old one, unlike realloc.
+ *
+ * Returns:
+ * - 1 if the room is available.
+ * - 0 if memory allocation failed.
+ */
+static int ReserveArena(EccPemArena* arena, const size_t size) {
+  if (arena->capacity - arena->len >= size) {
+    return 1;
+  }
+
+  size_t capacity = arena->capacity > 0 ? arena->capacity : ECCPEM_ARENA_INITIAL_SIZE;
+  while (capacity - arena->len < size) {
+    capacity *= 2;
+  }
+  char* data = malloc(capacity);
+  if (data == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating PEM arena failed.");
+    return 0;
+  }
+  if (arena->data != NULL) {
+    memcpy(data, arena->data, arena->len);
+    OPENSSL_cleanse(arena->data, arena->len);
+    free(arena->data);
+  }
+  arena->data = data;
+  arena->capacity = capacity;
+  return 1;
+}
+
+
+
+int EccPemArenaAppendKeyPair(EccPemArena* pubkey_arena, EccPemArena* privkey_arena,
+                             const EccPemCurve* curve, EVP_PKEY* pkey) {
+  if (!ReserveArena(pubkey_arena, ECCPEM_MAX_KEY_PEM_SIZE) ||
+      !ReserveArena(privkey_arena, ECCPEM_MAX_KEY_PEM_SIZE)) {
+    return 0;
+  }
+
+  size_t pubkey_pem_len = 0;
+  size_t privkey_pem_len = 0;
+  if (!EncodeKeysToPemBuffers(curve, pkey, pubkey_arena->data + pubkey_arena->len,
+                              ECCPEM_MAX_KEY_PEM_SIZE, &pubkey_pem_len,
+                              privkey_arena->data + privkey_arena->len,
+                              ECCPEM_MAX_KEY_PEM_SIZE, &privkey_pem_len)) {
+    /* The arena only wipes its first len bytes, so wipe what a failed encode left
+     * behind them now */
+    OPENSSL_cleanse(privkey_arena->data + privkey_arena->len, ECCPEM_MAX_KEY_PEM_SIZE);
+    return 0;
+  }
+
+  /* The terminating null characters are overwritten by the next key pair */
+  pubkey_arena->len += pubkey_pem_len;
+  privkey_arena->len += privkey_pem_len;
+  return 1;
+}
+
+
+
+int EccPemWriteFully(const int fd, const char* data, const size_t len) {
+  size_t written = 0;
+  while (written < len) {
+    const ssize_t ret = write(fd, data + written, len - written);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      return 0;
+    }
+    written += (size_t)ret;
+  }
+  return 1;
+}
+
+
+
+int EccPemWriteFile(const char* file, const char* data, const size_t len) {
+  ECCPEM_STAGE_BEGIN(write_timer);
+  const int fd = open(file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  int ret_value = 0;
+  if (fd >= 0) {
+    const int written = EccPemWriteFully(fd, data, len);
+    const int closed = close(fd) == 0;
+    ret_value = written && closed;
+  }
+  ECCPEM_STAGE_END(ECCPEM_STAGE_WRITE, write_timer);
+  return ret_value;
+}
@@ -0,0 +1,533 @@
+/*
+ * ===--- base64.c ----------------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides the base64 codec of PEM bodies. A portable table driven kernel
+ * is always available; on x86-64 an AVX2 kernel (the vectorized lookup and
+ * reshuffle scheme of W. Mula and D. Lemire) is selected at run time when the
+ * CPU supports it.
+ */
+
+#include "eccpem_internal.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ECCPEM_HAVE_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+/* Number of base64 characters per line of a PEM body. */
+#define PEM_LINE_LENGTH 64
+
+static const char kEncodeTable[64] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Maps a character to its 6-bit value, or to 0xFF if it is not in the alphabet. */
+static uint8_t kDecodeTable[256];
+static pthread_once_t kDecodeTableOnce = PTHREAD_ONCE_INIT;
+
+static void InitDecodeTable(void) {
+  memset(kDecodeTable, 0xFF, sizeof(kDecodeTable));
+  for (uint8_t i = 0; i < 64; ++i) {
+    kDecodeTable[(unsigned char)kEncodeTable[i]] = i;
+  }
+}
+
+
+
+/*
+ * Function decodes num_chars (a multiple of 4) base64 characters without
+ * padding. Returns 1 on success, 0 if a character is not in the alphabet.
+ */
+static int DecodeScalar(const char* in, const size_t num_chars, uint8_t* out) {
+  uint8_t invalid = 0;
+  for (size_t i = 0; i < num_chars; i += 4) {
+    const uint8_t a = kDecodeTable[(unsigned char)in[i]];
+    const uint8_t b = kDecodeTable[(unsigned char)in[i + 1]];
+    const uint8_t c = kDecodeTable[(unsigned char)in[i + 2]];
+    const uint8_t d = kDecodeTable[(unsigned char)in[i + 3]];
+    invalid |= a | b | c | d;
+    *out++ = (uint8_t)((a << 2) | (b >> 4));
+    *out++ = (uint8_t)((b << 4) | (c >> 2));
+    *out++ = (uint8_t)((c << 6) | d);
+  }
+  /* Valid values are below 64, 0xFF sets the top bits */
+  return (invalid & 0xC0) == 0;
+}
+
+/*
+ * Function checks that num_chars characters are all in the base64 alphabet,
+ * without decoding them.
+ */
+static int ValidateScalar(const char* in, const size_t num_chars) {
+  uint8_t invalid = 0;
+  for (size_t i = 0; i < num_chars; ++i) {
+    invalid |= kDecodeTable[(unsigned char)in[i]];
+  }
+  return (invalid & 0xC0) == 0;
+}
+
+/*
+ * Function encodes num_bytes (a multiple of 3) bytes into base64 characters.
+ */
+static void EncodeScalar(const uint8_t* in, const size_t num_bytes, char* out) {
+  for (size_t i = 0; i < num_bytes; i += 3) {
+    const uint32_t triple = ((uint32_t)in[i] << 16) | ((uint32_t)in[i + 1] << 8) | in[i + 2];
+    *out++ = kEncodeTable[(triple >> 18) & 0x3F];
+    *out++ = kEncodeTable[(triple >> 12) & 0x3F];
+    *out++ = kEncodeTable[(triple >> 6) & 0x3F];
+    *out++ = kEncodeTable[triple & 0x3F];
+  }
+}
+
+
+
+#ifdef ECCPEM_HAVE_AVX2_KERNEL
+/*
+ * Function decodes num_chars (a multiple of 4) base64 characters without
+ * padding, 32 characters at a time. The output buffer must have 8 bytes of
+ * slack behind the decoded data for the 32 byte stores.
+ */
+__attribute__((target("avx2")))
+static int DecodeAvx2(const char* in, size_t num_chars, uint8_t* out) {
+  const __m256i lut_lo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m256i lut_hi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lut_roll = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i mask_2f = _mm256_set1_epi8(0x2F);
+  const __m256i pack_shuffle = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i pack_permute = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+  while (num_chars >= 32) {
+    __m256i str = _mm256_loadu_si256((const __m256i*)in);
+
+    /* Validate: a character is invalid if its low and high nibble classes
+     * intersect */
+    const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+    const __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+    const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    if (!_mm256_testz_si256(lo, hi)) {
+      return 0;
+    }
+
+    /* Translate characters to 6-bit values */
+    const __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+    const __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    str = _mm256_add_epi8(str, roll);
+
+    /* Pack four 6-bit values into three bytes per 32-bit lane */
+    const __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+    __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    packed = _mm256_shuffle_epi8(packed, pack_shuffle);
+    packed = _mm256_permutevar8x32_epi32(packed, pack_permute);
+    _mm256_storeu_si256((__m256i*)out, packed);
+
+    in += 32;
+    out += 24;
+    num_chars -= 32;
+  }
+  return DecodeScalar(in, num_chars, out);
+}
+
+/*
+ * Function checks that num_chars characters are all in the base64 alphabet, 32
+ * characters at a time, with the nibble classes of DecodeAvx2.
+ */
+__attribute__((target("avx2")))
+static int ValidateAvx2(const char* in, size_t num_chars) {
+  const __m256i lut_lo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m256i lut_hi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i mask_2f = _mm256_set1_epi8(0x2F);
+
+  __m256i invalid = _mm256_setzero_si256();
+  while (num_chars >= 32) {
+    const __m256i str = _mm256_loadu_si256((const __m256i*)in);
+    const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+    const __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+    invalid = _mm256_or_si256(invalid, _mm256_and_si256(_mm256_shuffle_epi8(lut_lo, lo_nibbles),
+                                                        _mm256_shuffle_epi8(lut_hi, hi_nibbles)));
+    in += 32;
+    num_chars -= 32;
+  }
+  return _mm256_testz_si256(invalid, invalid) && ValidateScalar(in, num_chars);
+}
+
+/*
+ * Function encodes num_bytes (a multiple of 3) bytes into base64 characters,
+ * 24 bytes at a time.
+ */
+__attribute__((target("avx2")))
+static void EncodeAvx2(const uint8_t* in, size_t num_bytes, char* out) {
+  const __m256i reshuffle = _mm256_set_epi8(
+      10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+      14, 15, 13, 14, 11, 12, 10, 11, 8, 9, 7, 8, 5, 6, 4, 5);
+  const __m256i lut = _mm256_setr_epi8(
+      65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+      65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+
+  while (num_bytes >= 24) {
+    /* The reshuffle expects the 24 input bytes at offset 4 of the register:
+     * bytes 0-11 in the low lane, bytes 12-23 in the high lane. */
+    uint8_t block[32];
+    memcpy(block + 4, in, 24);
+    __m256i src = _mm256_loadu_si256((const __m256i*)block);
+
+    /* Split every three bytes into four 6-bit values */
+    src = _mm256_shuffle_epi8(src, reshuffle);
+    const __m256i t0 = _mm256_and_si256(src, _mm256_set1_epi32(0x0FC0FC00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(src, _mm256_set1_epi32(0x003F03F0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i values = _mm256_or_si256(t1, t3);
+
+    /* Translate 6-bit values to characters */
+    __m256i indices = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+    const __m256i is_lower = _mm256_cmpgt_epi8(values, _mm256_set1_epi8(25));
+    indices = _mm256_sub_epi8(indices, is_lower);
+    const __m256i chars = _mm256_add_epi8(values, _mm256_shuffle_epi8(lut, indices));
+    _mm256_storeu_si256((__m256i*)out, chars);
+
+    in += 24;
+    out += 32;
+    num_bytes -= 24;
+  }
+  EncodeScalar(in, num_bytes, out);
+}
+#endif
+
+
+
+/* Kernels in use, selected once by SelectKernels. */
+static int (*g_decode_kernel)(const char*, size_t, uint8_t*) = DecodeScalar;
+static void (*g_encode_kernel)(const uint8_t*, size_t, char*) = EncodeScalar;
+static int (*g_validate_kernel)(const char*, size_t) = ValidateScalar;
+static EccPemBase64Kernel g_kernel = kEccPemBase64Scalar;
+static pthread_once_t g_select_once = PTHREAD_ONCE_INIT;
+
+static void SelectKernels(void) {
+  pthread_once(&kDecodeTableOnce, InitDecodeTable);
+#ifdef ECCPEM_HAVE_AVX2_KERNEL
+  if (__builtin_cpu_supports("avx2")) {
+    g_decode_kernel = DecodeAvx2;
+    g_encode_kernel = EncodeAvx2;
+    g_validate_kernel = ValidateAvx2;
+    g_kernel = kEccPemBase64Avx2;
+  }
+#endif
+}
+
+
+
+EccPemBase64Kernel EccPemBase64GetKernel(void) {
+  pthread_once(&g_select_once, SelectKernels);
+  return g_kernel;
+}
+
+
+
+int EccPemBase64SetKernel(const EccPemBase64Kernel kernel) {
+  pthread_once(&g_select_once, SelectKernels);
+  if (kernel == kEccPemBase64Scalar) {
+    g_decode_kernel = DecodeScalar;
+    g_encode_kernel = EncodeScalar;
+    g_validate_kernel = ValidateScalar;
+    g_kernel = kernel;
+    return 1;
+  }
+#ifdef ECCPEM_HAVE_AVX2_KERNEL
+  if (kernel == kEccPemBase64Avx2 && __builtin_cpu_supports("avx2")) {
+    g_decode_kernel = DecodeAvx2;
+    g_encode_kernel = EncodeAvx2;
+    g_validate_kernel = ValidateAvx2;
+    g_kernel = kernel;
+    return 1;
+  }
+#endif
+  return 0;
+}
+
+
+
+/*
+ * Function decodes the last quad of a body, which may end with one or two '='
+ * padding characters. Returns the number of bytes stored, or -1 on error.
+ */
+static int DecodeFinalQuad(const char quad[4], uint8_t out[3]) {
+  const int num_padding = quad[3] != '=' ? 0 : (quad[2] != '=' ? 1 : 2);
+  char chars[4] = {quad[0], quad[1], num_padding == 2 ? 'A' : quad[2],
+                   num_padding >= 1 ? 'A' : quad[3]};
+  if (!DecodeScalar(chars, 4, out)) {
+    return -1;
+  }
+  return 3 - num_padding;
+}
+
+int EccPemBase64DecodeBody(const char* body, const size_t body_len,
+                           uint8_t out[], const size_t out_size, size_t* out_len) {
+  pthread_once(&g_select_once, SelectKernels);
+
+  /* The vector kernel stores 32 bytes per 24 decoded, keep it clear of the end */
+  const size_t kStoreSlack = 8;
+  const char* cursor = body;
+  const char* end = body + body_len;
+  char carry[4];
+  size_t num_carry = 0;
+  size_t num_out = 0;
+  int padded = 0;
+
+  while (cursor < end) {
+    const char* newline = memchr(cursor, '\n', (size_t)(end - cursor));
+    const char* line_end = newline != NULL ? newline : end;
+    const char* next_line = newline != NULL ? newline + 1 : end;
+    if (line_end > cursor && line_end[-1] == '\r') {
+      --line_end;
+    }
+    if (line_end == cursor) {
+      cursor = next_line;
+      continue;
+    }
+    if (padded) {
+      /* Nothing may follow the padding */
+      return 0;
+    }
+
+    const char* line = cursor;
+    size_t line_len = (size_t)(line_end - line);
+    cursor = next_line;
+
+    /* Complete a quad that straddles the previous line */
+    while (num_carry > 0 && num_carry < 4 && line_len > 0) {
+      carry[num_carry++] = *line++;
+      --line_len;
+    }
+    if (num_carry == 4) {
+      if (carry[3] == '=') {
+        if (out_size - num_out < 3) {
+          return 0;
+        }
+        const int num_bytes = DecodeFinalQuad(carry, out + num_out);
+        if (num_bytes < 0) {
+          return 0;
+        }
+        num_out += (size_t)num_bytes;
+        padded = 1;
+        if (line_len > 0) {
+          return 0;
+        }
+        num_carry = 0;
+        continue;
+      }
+      if (out_size - num_out < 3 || !DecodeScalar(carry, 4, out + num_out)) {
+        return 0;
+      }
+      num_out += 3;
+      num_carry = 0;
+    }
+
+    /* Hold back a padded final quad and any incomplete quad */
+    size_t num_full = line_len / 4 * 4;
+    if (num_full > 0 && line[num_full - 1] == '=') {
+      num_full -= 4;
+      padded = 1;
+      if (num_full + 4 != line_len) {
+        return 0;
+      }
+    }
+
+    const size_t num_bytes = num_full / 4 * 3;
+    if (out_size - num_out < num_bytes) {
+      return 0;
+    }
+    int ok = 0;
+    if (out_size - num_out >= num_bytes + kStoreSlack) {
+      ok = g_decode_kernel(line, num_full, out + num_out);
+    } else {
+      ok = DecodeScalar(line, num_full, out + num_out);
+    }
+    if (!ok) {
+      return 0;
+    }
+    num_out += num_bytes;
+
+    if (padded) {
+      if (out_size - num_out < 3) {
+        return 0;
+      }
+      const int num_final = DecodeFinalQuad(line + num_full, out + num_out);
+      if (num_final < 0) {
+        return 0;
+      }
+      num_out += (size_t)num_final;
+      continue;
+    }
+
+    for (size_t i = num_full; i < line_len; ++i) {
+      carry[num_carry++] = line[i];
+    }
+  }
+
+  if (num_carry != 0 || num_out == 0) {
+    return 0;
+  }
+  *out_len = num_out;
+  return 1;
+}
+
+
+
+/*
+ * Function counts the base64 characters of a line that the vector kernel did not
+ * accept, allowing the spaces and tabs the OpenSSL decoder skips.
+ *
+ * Returns:
+ * - 1 if the line only holds base64 characters and blanks.
+ * - 0 otherwise.
+ */
+static int CountLenientLine(const char* line, const size_t line_len, size_t* num_chars) {
+  for (size_t i = 0; i < line_len; ++i) {
+    if (kDecodeTable[(unsigned char)line[i]] < 64) {
+      ++*num_chars;
+    } else if (line[i] != ' ' && line[i] != '\t') {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int EccPemBase64CheckBody(const char* body, const size_t body_len, size_t* decoded_len) {
+  pthread_once(&g_select_once, SelectKernels);
+
+  const char* cursor = body;
+  const char* end = body + body_len;
+  size_t num_chars = 0;
+  size_t num_padding = 0;
+
+  while (cursor < end) {
+    const char* newline = memchr(cursor, '\n', (size_t)(end - cursor));
+    const char* line_end = newline != NULL ? newline : end;
+    const char* line = cursor;
+    cursor = newline != NULL ? newline + 1 : end;
+    /* Trailing whitespace is stripped like PEM_read_bio does, also behind padding */
+    while (line_end > line &&
+           (line_end[-1] == '\r' || line_end[-1] == ' ' || line_end[-1] == '\t')) {
+      --line_end;
+    }
+    if (line_end == line) {
+      continue;
+    }
+    if (num_padding > 0) {
+      /* Nothing may follow the padding */
+      return 0;
+    }
+
+    /* Up to two '=' end the last line of the body */
+    while (line_end > line && line_end[-1] == '=' && num_padding < 2) {
+      --line_end;
+      ++num_padding;
+    }
+    const size_t line_len = (size_t)(line_end - line);
+    if (g_validate_kernel(line, line_len)) {
+      num_chars += line_len;
+    } else if (!CountLenientLine(line, line_len, &num_chars)) {
+      return 0;
+    }
+  }
+
+  num_chars += num_padding;
+  if (num_chars == 0 || num_chars % 4 != 0) {
+    return 0;
+  }
+  *decoded_len = num_chars / 4 * 3 - num_padding;
+  return 1;
+}
+
+
+
+size_t EccPemBase64EncodedBodyLength(const size_t data_len) {
+  const size_t num_chars = (data_len + 2) / 3 * 4;
+  return num_chars + (num_chars + PEM_LINE_LENGTH - 1) / PEM_LINE_LENGTH;
+}
+
+int EccPemBase64EncodeBody(const uint8_t data[], const size_t data_len,
+                           char out[], const size_t out_size, size_t* out_len) {
+  pthread_once(&g_select_once, SelectKernels);
+
+  const size_t body_len = EccPemBase64EncodedBodyLength(data_len);
+  if (out_size < body_len) {
+    return 0;
+  }
+
+  /* PEM_LINE_LENGTH characters encode 48 bytes */
+  const size_t line_bytes = PEM_LINE_LENGTH / 4 * 3;
+  size_t num_out = 0;
+  size_t offset = 0;
+  while (offset < data_len) {
+    const size_t chunk = data_len - offset < line_bytes ? data_len - offset : line_bytes;
+    const size_t num_full = chunk / 3 * 3;
+    g_encode_kernel(data + offset, num_full, out + num_out);
+    num_out += num_full / 3 * 4;
+
+    if (chunk > num_full) {
+      uint8_t tail[3] = {0, 0, 0};
+      memcpy(tail, data + offset + num_full, chunk - num_full);
+      EncodeScalar(tail, 3, out + num_out);
+      out[num_out + 3] = '=';
+      if (chunk - num_full == 1) {
+        out[num_out + 2] = '=';
+      }
+      num_out += 4;
+    }
+    out[num_out++] = '\n';
+    offset += chunk;
+  }
+
+  *out_len = num_out;
+  return 1;
+}
+
+
+
+int EccPemEncodeBlock(const char* label, const uint8_t der[], const size_t der_len,
+                      char out[], const size_t out_size, size_t* out_len) {
+  const size_t label_len = strlen(label);
+  const size_t begin_len = sizeof("-----BEGIN -----\n") - 1 + label_len;
+  const size_t end_len = sizeof("-----END -----\n") - 1 + label_len;
+  const size_t total_len = begin_len + EccPemBase64EncodedBodyLength(der_len) + end_len;
+  *out_len = total_len;
+  if (out_size < total_len) {
+    return 0;
+  }
+
+  char* cursor = out;
+  memcpy(cursor, "-----BEGIN ", 11);
+  memcpy(cursor + 11, label, label_len);
+  memcpy(cursor + 11 + label_len, "-----\n", 6);
+  cursor += begin_len;
+
+  size_t body_len = 0;
+  EccPemBase64EncodeBody(der, der_len, cursor, out_size - begin_len, &body_len);
+  cursor += body_len;
+
+  memcpy(cursor, "-----END ", 9);
+  memcpy(cursor + 9, label, label_len);
+  memcpy(cursor + 9 + label_len, "-----\n", 6);
+  return 1;
+}
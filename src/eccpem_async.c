@@ -0,0 +1,307 @@
+/*
+ * ===--- eccpem_async.c ----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides the background pool for asynchronous key generation. Requests
+ * are kept in a FIFO list under a mutex. Every pool thread takes up to a batch
+ * of requests at once, generates and encodes all key pairs of the batch with
+ * one keygen context, writes the files and then invokes the callbacks.
+ */
+
+#include "eccpem_async.h"
+#include "eccpem_internal.h"
+#include "utils.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+
+/* Maximum number of requests a pool thread takes from the queue at once. */
+#define ECCPEM_ASYNC_BATCH_SIZE 16
+
+/* Queued request. The file names are stored right after the structure. */
+typedef struct AsyncJob {
+  const EccPemCurve* curve;
+  const char* pubkey_file;
+  const char* privkey_file;
+  EccPemAsyncCallback callback;
+  void* user_data;
+  struct AsyncJob* next;
+} AsyncJob;
+
+/* PEM encoded key pair of one request of a batch. */
+typedef struct {
+  char pubkey_pem[ECCPEM_MAX_KEY_PEM_SIZE];
+  char privkey_pem[ECCPEM_MAX_KEY_PEM_SIZE];
+  size_t pubkey_pem_len;
+  size_t privkey_pem_len;
+  int result;
+} AsyncKeyPair;
+
+static pthread_mutex_t g_async_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_async_cond = PTHREAD_COND_INITIALIZER;
+static AsyncJob* g_queue_head = NULL;
+static AsyncJob* g_queue_tail = NULL;
+static pthread_t* g_threads = NULL;
+static unsigned int g_num_threads = 0;
+static int g_stopping = 0;
+
+
+
+/*
+ * Function waits for queued requests and takes up to ECCPEM_ASYNC_BATCH_SIZE of
+ * them off the queue.
+ *
+ * Returns:
+ * - Number of requests stored in batch.
+ * - 0 if the pool is stopping and the queue is drained.
+ */
+static size_t TakeJobBatch(AsyncJob* batch[]) {
+  pthread_mutex_lock(&g_async_mutex);
+  while (g_queue_head == NULL && !g_stopping) {
+    pthread_cond_wait(&g_async_cond, &g_async_mutex);
+  }
+
+  size_t num_jobs = 0;
+  while (g_queue_head != NULL && num_jobs < ECCPEM_ASYNC_BATCH_SIZE) {
+    batch[num_jobs++] = g_queue_head;
+    g_queue_head = g_queue_head->next;
+  }
+  if (g_queue_head == NULL) {
+    g_queue_tail = NULL;
+  }
+  pthread_mutex_unlock(&g_async_mutex);
+  return num_jobs;
+}
+
+
+
+/*
+ * Function generates and encodes the key pair of one request. The keygen
+ * context is kept across requests and only recreated when the curve changes.
+ */
+static void GenerateKeyPair(const AsyncJob* job, EVP_PKEY_CTX** ctx,
+                            const EccPemCurve** ctx_curve, AsyncKeyPair* key_pair) {
+  key_pair->result = 0;
+  if (*ctx == NULL || *ctx_curve != job->curve) {
+    EVP_PKEY_CTX_free(*ctx);
+    *ctx = CreateKeygenContext(job->curve);
+    *ctx_curve = *ctx != NULL ? job->curve : NULL;
+    if (*ctx == NULL) {
+      return;
+    }
+  }
+
+  EVP_PKEY* pkey = NULL;
+  if (EccPemKeygen(*ctx, &pkey) <= 0) {
+    EccPemReportError(ECCPEM_ERROR_KEYGEN_FAILED, "Generating EC key pair failed.");
+    return;
+  }
+
+  key_pair->result = EncodeKeysToPemBuffers(job->curve, pkey, key_pair->pubkey_pem,
+                                            sizeof(key_pair->pubkey_pem),
+                                            &key_pair->pubkey_pem_len,
+                                            key_pair->privkey_pem,
+                                            sizeof(key_pair->privkey_pem),
+                                            &key_pair->privkey_pem_len);
+  EVP_PKEY_free(pkey);
+  if (!key_pair->result) {
+    /* A failed encode may leave part of the private key PEM behind */
+    OPENSSL_cleanse(key_pair->privkey_pem, sizeof(key_pair->privkey_pem));
+  }
+}
+
+
+
+/*
+ * Function is the start routine of a pool thread. Per batch it first generates
+ * all key pairs, then writes all files, and finally invokes the callbacks.
+ */
+static void* AsyncWorkerMain(void* arg) {
+  (void)arg;
+  AsyncJob* batch[ECCPEM_ASYNC_BATCH_SIZE];
+  AsyncKeyPair key_pairs[ECCPEM_ASYNC_BATCH_SIZE];
+  EVP_PKEY_CTX* ctx = NULL;
+  const EccPemCurve* ctx_curve = NULL;
+
+  size_t num_jobs = 0;
+  while ((num_jobs = TakeJobBatch(batch)) > 0) {
+    for (size_t i = 0; i < num_jobs; ++i) {
+      GenerateKeyPair(batch[i], &ctx, &ctx_curve, &key_pairs[i]);
+    }
+
+    for (size_t i = 0; i < num_jobs; ++i) {
+      AsyncKeyPair* key_pair = &key_pairs[i];
+      if (!key_pair->result) {
+        continue;
+      }
+      if (!EccPemWriteFile(batch[i]->privkey_file, key_pair->privkey_pem,
+                           key_pair->privkey_pem_len)) {
+        EccPemReportError(ECCPEM_ERROR_WRITE_FAILED, "Unable to write private key file.");
+        key_pair->result = 0;
+      } else if (!EccPemWriteFile(batch[i]->pubkey_file, key_pair->pubkey_pem,
+                                  key_pair->pubkey_pem_len)) {
+        EccPemReportError(ECCPEM_ERROR_WRITE_FAILED, "Unable to write public key file.");
+        key_pair->result = 0;
+      }
+      /* The private key PEM is secret material, wipe it once written */
+      OPENSSL_cleanse(key_pair->privkey_pem, key_pair->privkey_pem_len);
+    }
+
+    for (size_t i = 0; i < num_jobs; ++i) {
+      if (batch[i]->callback != NULL) {
+        batch[i]->callback(key_pairs[i].result, batch[i]->user_data);
+      }
+      free(batch[i]);
+    }
+  }
+
+  EVP_PKEY_CTX_free(ctx);
+  return NULL;
+}
+
+
+
+/*
+ * Function starts the pool threads. The caller holds g_async_mutex.
+ *
+ * Returns:
+ * - 1 if at least one thread was started.
+ * - 0 otherwise.
+ */
+static int StartPoolLocked(const unsigned int num_threads) {
+  const unsigned int num_workers = EccPemResolveThreadCount(num_threads);
+  g_threads = malloc(num_workers * sizeof(pthread_t));
+  if (g_threads == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY,
+                      "Allocating the asynchronous key generation pool failed.");
+    return 0;
+  }
+
+  g_num_threads = 0;
+  for (unsigned int i = 0; i < num_workers; ++i) {
+    if (pthread_create(&g_threads[g_num_threads], NULL, AsyncWorkerMain, NULL) != 0) {
+      EccPemReportErrorf(ECCPEM_ERROR_THREAD_FAILED,
+                         "Creating worker thread failed, continuing with %u threads.",
+                         g_num_threads);
+      break;
+    }
+    ++g_num_threads;
+  }
+
+  if (g_num_threads == 0) {
+    free(g_threads);
+    g_threads = NULL;
+    return 0;
+  }
+  return 1;
+}
+
+
+
+int EccPemAsyncInit(const unsigned int num_threads) {
+  pthread_mutex_lock(&g_async_mutex);
+  if (g_num_threads > 0) {
+    pthread_mutex_unlock(&g_async_mutex);
+    EccPemReportError(ECCPEM_ERROR_INVALID_STATE,
+                      "Asynchronous key generation pool is already running.");
+    return 0;
+  }
+  const int ret_value = StartPoolLocked(num_threads);
+  pthread_mutex_unlock(&g_async_mutex);
+  return ret_value;
+}
+
+
+
+void EccPemAsyncShutdown(void) {
+  pthread_mutex_lock(&g_async_mutex);
+  if (g_num_threads == 0 || g_stopping) {
+    pthread_mutex_unlock(&g_async_mutex);
+    return;
+  }
+  /* Pool threads drain the queue before they see the stop flag */
+  g_stopping = 1;
+  pthread_cond_broadcast(&g_async_cond);
+  pthread_t* threads = g_threads;
+  const unsigned int num_threads = g_num_threads;
+  pthread_mutex_unlock(&g_async_mutex);
+
+  for (unsigned int i = 0; i < num_threads; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+
+  pthread_mutex_lock(&g_async_mutex);
+  free(g_threads);
+  g_threads = NULL;
+  g_num_threads = 0;
+  g_stopping = 0;
+  pthread_mutex_unlock(&g_async_mutex);
+}
+
+
+
+int EccPemGenerateAsync(const EccPemCurve* curve,
+                        const char* pubkey_file,
+                        const char* privkey_file,
+                        EccPemAsyncCallback callback,
+                        void* user_data) {
+  if (curve == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Curve handle cannot be NULL.");
+    return 0;
+  }
+
+  /* Verify both key files have .pem extension */
+  if (!VerifyPemFileFormat(pubkey_file) || !VerifyPemFileFormat(privkey_file)) {
+    return 0;
+  }
+
+  /* One allocation holds the request and copies of both file names */
+  const size_t pubkey_file_size = strlen(pubkey_file) + 1;
+  const size_t privkey_file_size = strlen(privkey_file) + 1;
+  AsyncJob* job = malloc(sizeof(AsyncJob) + pubkey_file_size + privkey_file_size);
+  if (job == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating the asynchronous request failed.");
+    return 0;
+  }
+  char* names = (char*)(job + 1);
+  memcpy(names, pubkey_file, pubkey_file_size);
+  memcpy(names + pubkey_file_size, privkey_file, privkey_file_size);
+  job->curve = curve;
+  job->pubkey_file = names;
+  job->privkey_file = names + pubkey_file_size;
+  job->callback = callback;
+  job->user_data = user_data;
+  job->next = NULL;
+
+  pthread_mutex_lock(&g_async_mutex);
+  if (g_stopping) {
+    pthread_mutex_unlock(&g_async_mutex);
+    free(job);
+    EccPemReportError(ECCPEM_ERROR_INVALID_STATE,
+                      "Asynchronous key generation pool is shutting down.");
+    return 0;
+  }
+  if (g_num_threads == 0 && !StartPoolLocked(0)) {
+    pthread_mutex_unlock(&g_async_mutex);
+    free(job);
+    return 0;
+  }
+
+  if (g_queue_tail != NULL) {
+    g_queue_tail->next = job;
+  } else {
+    g_queue_head = job;
+  }
+  g_queue_tail = job;
+  pthread_cond_signal(&g_async_cond);
+  pthread_mutex_unlock(&g_async_mutex);
+  return 1;
+}
@@ -0,0 +1,489 @@
+/*
+ * ===--- eccpem_bundle.c ---------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides functionality to write Elliptic Curve Cryptography (ECC) key
+ * pairs to PEM bundles in large chunks, and to stream public keys out of PEM
+ * bundles. Blocks are decoded one at a time from a file
+ * BIO, so memory use does not depend on the size of the bundle. Blocks are split
+ * with PEM_read_bio rather than PEM_read_bio_PUBKEY, so the end of the bundle can
+ * be told apart from a corrupted block. Memory mapped bundles are scanned for
+ * block boundaries in place and each body is decoded straight from the mapping,
+ * and so are bundles held in memory.
+ */
+
+#include "eccpem_bundle.h"
+#include "eccpem_internal.h"
+#include "utils.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/bio.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+
+/* Number of key pairs encoded in memory before they are written to the bundles
+ * with one write call each, about 64 KB of PEM data on the common curves. */
+#define ECCPEM_BUNDLE_WRITE_CHUNK 256
+
+/* Largest DER encoded key decoded from a memory mapped bundle. EC keys are far
+ * smaller, anything bigger is skipped. */
+#define ECCPEM_BUNDLE_MAX_DER_SIZE 4096
+
+struct EccPemBundle {
+  /* Streaming bundles read through a file BIO. */
+  BIO* bio;
+  /* Memory mapped and buffer bundles are scanned in place. */
+  const char* map;
+  size_t map_len;
+  size_t map_offset;
+  int owns_map;
+  EVP_ENCODE_CTX* decode_ctx;
+  int at_end;
+  EccPemBundleStats stats;
+};
+
+
+
+/*
+ * Function generates ECC key pairs and writes them to a public and a private key
+ * PEM bundle. Chunks of ECCPEM_BUNDLE_WRITE_CHUNK key pairs are encoded into two
+ * arenas, which are flushed with one write call per bundle.
+ *
+ * Arguments:
+ * - curve: Handle of the elliptic curve.
+ * - num_keys: Number of key pairs to generate.
+ * - pubkey_bundle_file: PEM file (.pem extension) for the public keys.
+ * - privkey_bundle_file: PEM file (.pem extension) for the private keys.
+ *
+ * Returns:
+ * - Number of key pairs written to both bundles.
+ */
+size_t CreateECCKeysPemBundles(const EccPemCurve* curve,
+                               const size_t num_keys,
+                               const char* pubkey_bundle_file,
+                               const char* privkey_bundle_file) {
+  if (curve == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Curve handle cannot be NULL.");
+    return 0;
+  }
+
+  /* Verify both bundle files have .pem extension */
+  if (!VerifyPemFileFormat(pubkey_bundle_file) || !VerifyPemFileFormat(privkey_bundle_file)) {
+    return 0;
+  }
+
+  EVP_PKEY_CTX* ctx = CreateKeygenContext(curve);
+  if (ctx == NULL) {
+    return 0;
+  }
+
+  const int pubkey_fd = open(pubkey_bundle_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  const int privkey_fd = open(privkey_bundle_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                              0666);
+  if (pubkey_fd < 0 || privkey_fd < 0) {
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Unable to open PEM bundle file for writing.");
+  }
+
+  /* The PEM blocks of a chunk are encoded back to back into the arenas */
+  EccPemArena pubkey_arena;
+  EccPemArena privkey_arena;
+  EccPemArenaInit(&pubkey_arena);
+  EccPemArenaInit(&privkey_arena);
+
+  size_t num_written = 0;
+  int failed = pubkey_fd < 0 || privkey_fd < 0;
+  while (!failed && num_written < num_keys) {
+    const size_t chunk_size = num_keys - num_written < ECCPEM_BUNDLE_WRITE_CHUNK
+                                  ? num_keys - num_written
+                                  : ECCPEM_BUNDLE_WRITE_CHUNK;
+    size_t num_encoded = 0;
+    for (; num_encoded < chunk_size; ++num_encoded) {
+      EVP_PKEY* pkey = NULL;
+      if (EccPemKeygen(ctx, &pkey) <= 0) {
+        EccPemReportError(ECCPEM_ERROR_KEYGEN_FAILED, "Generating EC key pair failed.");
+        break;
+      }
+      const int encoded = EccPemArenaAppendKeyPair(&pubkey_arena, &privkey_arena, curve, pkey);
+      EVP_PKEY_free(pkey);
+      if (!encoded) {
+        break;
+      }
+    }
+
+    /* Key pairs encoded before a failure are still written */
+    failed = num_encoded < chunk_size;
+    if (num_encoded > 0) {
+      ECCPEM_STAGE_BEGIN(write_timer);
+      const int written =
+          EccPemWriteFully(privkey_fd, privkey_arena.data, privkey_arena.len) &&
+          EccPemWriteFully(pubkey_fd, pubkey_arena.data, pubkey_arena.len);
+      ECCPEM_STAGE_END(ECCPEM_STAGE_WRITE, write_timer);
+      if (!written) {
+        EccPemReportError(ECCPEM_ERROR_WRITE_FAILED, "Error writing keys to PEM bundle file.");
+        failed = 1;
+      } else {
+        num_written += num_encoded;
+      }
+    }
+    EccPemArenaClear(&pubkey_arena);
+    EccPemArenaClear(&privkey_arena);
+  }
+
+  /* The private key arena is wiped before it is freed */
+  EccPemArenaFree(&pubkey_arena);
+  EccPemArenaFree(&privkey_arena);
+  EVP_PKEY_CTX_free(ctx);
+  /* Data may only reach the disk on close, so a failing close loses every key */
+  const int pubkey_closed = pubkey_fd < 0 || close(pubkey_fd) == 0;
+  const int privkey_closed = privkey_fd < 0 || close(privkey_fd) == 0;
+  if (!pubkey_closed || !privkey_closed) {
+    EccPemReportError(ECCPEM_ERROR_WRITE_FAILED, "Error writing keys to PEM bundle file.");
+    return 0;
+  }
+  return num_written;
+}
+
+
+
+/*
+ * Function opens a PEM bundle for reading.
+ *
+ * Arguments:
+ * - bundle_file: PEM formatted file (.pem extension) holding concatenated public
+ *                key blocks.
+ *
+ * Returns:
+ * - Pointer to the open bundle on success.
+ * - NULL if the file is not a .pem file, cannot be opened, or memory allocation
+ *   failed.
+ */
+EccPemBundle* EccPemBundleOpen(const char* bundle_file) {
+  if (!VerifyPemFileFormat(bundle_file)) {
+    return NULL;
+  }
+
+  EccPemBundle* bundle = calloc(1, sizeof(EccPemBundle));
+  if (bundle == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating PEM bundle failed.");
+    return NULL;
+  }
+
+  bundle->bio = BIO_new_file(bundle_file, "r");
+  if (bundle->bio == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Failed to open PEM bundle file");
+    free(bundle);
+    return NULL;
+  }
+  return bundle;
+}
+
+
+
+/*
+ * Function opens a PEM bundle for reading through a read-only memory mapping of
+ * the whole file.
+ *
+ * Arguments:
+ * - bundle_file: PEM formatted file (.pem extension) holding concatenated public
+ *                key blocks.
+ * - sequential_hint: If not 0, the kernel is advised (MADV_SEQUENTIAL) that the
+ *                    mapping will be read front to back.
+ *
+ * Returns:
+ * - Pointer to the open bundle on success.
+ * - NULL if the file is not a .pem file, cannot be opened or mapped, or memory
+ *   allocation failed.
+ */
+EccPemBundle* EccPemBundleOpenMapped(const char* bundle_file, const int sequential_hint) {
+  if (!VerifyPemFileFormat(bundle_file)) {
+    return NULL;
+  }
+
+  const int fd = open(bundle_file, O_RDONLY);
+  if (fd < 0) {
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Failed to open PEM bundle file");
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Failed to open PEM bundle file");
+    close(fd);
+    return NULL;
+  }
+
+  EccPemBundle* bundle = calloc(1, sizeof(EccPemBundle));
+  if (bundle == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating PEM bundle failed.");
+    close(fd);
+    return NULL;
+  }
+
+  bundle->decode_ctx = EVP_ENCODE_CTX_new();
+  if (bundle->decode_ctx == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating PEM bundle failed.");
+    free(bundle);
+    close(fd);
+    return NULL;
+  }
+
+  /* An empty file cannot be mapped, it is simply a bundle without keys */
+  bundle->map_len = (size_t)st.st_size;
+  if (bundle->map_len == 0) {
+    bundle->at_end = 1;
+    close(fd);
+    return bundle;
+  }
+
+  void* map = mmap(NULL, bundle->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Failed to map PEM bundle file");
+    EVP_ENCODE_CTX_free(bundle->decode_ctx);
+    free(bundle);
+    return NULL;
+  }
+
+  if (sequential_hint) {
+    madvise(map, bundle->map_len, MADV_SEQUENTIAL);
+  }
+  bundle->map = (const char*)map;
+  bundle->owns_map = 1;
+  return bundle;
+}
+
+
+
+/*
+ * Function opens a PEM bundle held in a caller's buffer. The buffer is scanned
+ * and decoded in place like a memory mapped bundle.
+ *
+ * Arguments:
+ * - bundle_pem: Buffer holding concatenated public key blocks.
+ * - bundle_pem_len: Length of the buffer in bytes.
+ *
+ * Returns:
+ * - Pointer to the open bundle on success.
+ * - NULL if bundle_pem is NULL or memory allocation failed.
+ */
+EccPemBundle* EccPemBundleOpenBuffer(const char* bundle_pem, const size_t bundle_pem_len) {
+  if (bundle_pem == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "PEM bundle buffer cannot be NULL.");
+    return NULL;
+  }
+
+  EccPemBundle* bundle = calloc(1, sizeof(EccPemBundle));
+  if (bundle == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating PEM bundle failed.");
+    return NULL;
+  }
+
+  bundle->decode_ctx = EVP_ENCODE_CTX_new();
+  if (bundle->decode_ctx == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating PEM bundle failed.");
+    free(bundle);
+    return NULL;
+  }
+  bundle->map = bundle_pem;
+  bundle->map_len = bundle_pem_len;
+  bundle->at_end = bundle_pem_len == 0;
+  return bundle;
+}
+
+
+
+/*
+ * Function reports whether the last failed PEM read stopped because no further
+ * PEM block exists, and clears the OpenSSL error queue.
+ */
+static int ReachedEndOfBundle(BIO* bio) {
+  const unsigned long error = ERR_peek_last_error();
+  ERR_clear_error();
+  return BIO_eof(bio) || (ERR_GET_LIB(error) == ERR_LIB_PEM &&
+                          ERR_GET_REASON(error) == PEM_R_NO_START_LINE);
+}
+
+
+
+/*
+ * Function decodes the next public key block of a PEM bundle. Blocks of other
+ * types are passed over.
+ *
+ * Returns:
+ * - 1 if a public key was stored in pkey.
+ * - 0 if a public key block could not be decoded.
+ * - -1 at the end of the bundle.
+ */
+static int ReadNextPublicKey(EccPemBundle* bundle, EVP_PKEY** pkey) {
+  for (;;) {
+    char* name = NULL;
+    char* header = NULL;
+    unsigned char* data = NULL;
+    long data_len = 0;
+    if (!PEM_read_bio(bundle->bio, &name, &header, &data, &data_len)) {
+      return ReachedEndOfBundle(bundle->bio) ? -1 : 0;
+    }
+
+    const int is_public_key = strcmp(name, PEM_STRING_PUBLIC) == 0;
+    if (is_public_key) {
+      const unsigned char* der = data;
+      *pkey = d2i_PUBKEY(NULL, &der, data_len);
+    }
+    OPENSSL_free(name);
+    OPENSSL_free(header);
+    OPENSSL_free(data);
+
+    if (is_public_key) {
+      if (*pkey == NULL) {
+        ERR_clear_error();
+        return 0;
+      }
+      return 1;
+    }
+  }
+}
+
+
+
+/*
+ * Function decodes the next public key block of a memory mapped PEM bundle. The
+ * block boundaries are found in the mapping and the base64 body is decoded from
+ * it directly by the vectorized decoder. Blocks of other types are passed over.
+ *
+ * Returns:
+ * - 1 if a public key was stored in pkey.
+ * - 0 if a public key block could not be decoded.
+ * - -1 at the end of the bundle.
+ */
+static int ReadNextMappedPublicKey(EccPemBundle* bundle, EVP_PKEY** pkey) {
+  EccPemBlock block;
+  while (EccPemFindBlock(bundle->map, bundle->map_len, bundle->map_offset, &block)) {
+    bundle->map_offset = block.next;
+    if (!EccPemBlockHasLabel(&block, PEM_STRING_PUBLIC)) {
+      continue;
+    }
+
+    if (!block.complete || block.body_len > ECCPEM_BUNDLE_MAX_DER_SIZE / 3 * 4) {
+      return 0;
+    }
+
+    unsigned char der[ECCPEM_BUNDLE_MAX_DER_SIZE];
+    size_t der_len = 0;
+    if (!EccPemBase64DecodeBody(block.body, block.body_len, der, sizeof(der), &der_len)) {
+      /* Unusual bodies are left to the OpenSSL decoder, malformed ones are not */
+      if (!EccPemBase64CheckBody(block.body, block.body_len, &der_len)) {
+        return 0;
+      }
+      int update_len = 0;
+      int final_len = 0;
+      EVP_DecodeInit(bundle->decode_ctx);
+      if (EVP_DecodeUpdate(bundle->decode_ctx, der, &update_len,
+                           (const unsigned char*)block.body, (int)block.body_len) < 0 ||
+          EVP_DecodeFinal(bundle->decode_ctx, der + update_len, &final_len) < 0) {
+        return 0;
+      }
+      der_len = (size_t)update_len + (size_t)final_len;
+    }
+
+    const unsigned char* der_ptr = der;
+    *pkey = d2i_PUBKEY(NULL, &der_ptr, (long)der_len);
+    if (*pkey == NULL) {
+      ERR_clear_error();
+      return 0;
+    }
+    return 1;
+  }
+  return -1;
+}
+
+
+
+/*
+ * Function reads the next public keys of a PEM bundle and stores them as
+ * compressed binary data in a given array.
+ *
+ * Arguments:
+ * - bundle: Open bundle.
+ * - public_keys: Output array of at least max_keys * compressed_key_size bytes.
+ * - compressed_key_size: Size of one compressed public key.
+ * - max_keys: Maximum number of keys to read.
+ *
+ * Returns:
+ * - Number of public keys stored in the array, 0 at the end of the bundle.
+ */
+size_t EccPemBundleNext(EccPemBundle* bundle,
+                        uint8_t public_keys[],
+                        const unsigned int compressed_key_size,
+                        const size_t max_keys) {
+  if (bundle == NULL || public_keys == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "PEM bundle and public key output buffer cannot be NULL");
+    return 0;
+  }
+
+  if (compressed_key_size == 0) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Invalid compressed key size");
+    return 0;
+  }
+
+  size_t num_keys = 0;
+  while (num_keys < max_keys && !bundle->at_end) {
+    EVP_PKEY* pkey = NULL;
+    const int ret_value = bundle->bio != NULL ? ReadNextPublicKey(bundle, &pkey)
+                                              : ReadNextMappedPublicKey(bundle, &pkey);
+    if (ret_value < 0) {
+      bundle->at_end = 1;
+      continue;
+    }
+    if (ret_value == 0) {
+      ++bundle->stats.num_skipped;
+      continue;
+    }
+
+    uint8_t* public_key = public_keys + num_keys * compressed_key_size;
+    if (ExtractCompressedPublicKey(pkey, public_key, compressed_key_size)) {
+      ++num_keys;
+    } else {
+      ++bundle->stats.num_skipped;
+    }
+    EVP_PKEY_free(pkey);
+  }
+
+  bundle->stats.num_keys += num_keys;
+  return num_keys;
+}
+
+
+
+void EccPemBundleGetStats(const EccPemBundle* bundle, EccPemBundleStats* stats) {
+  if (bundle == NULL || stats == NULL) {
+    return;
+  }
+  *stats = bundle->stats;
+}
+
+
+
+void EccPemBundleClose(EccPemBundle* bundle) {
+  if (bundle == NULL) {
+    return;
+  }
+  BIO_free(bundle->bio);
+  if (bundle->owns_map) {
+    munmap((void*)bundle->map, bundle->map_len);
+  }
+  EVP_ENCODE_CTX_free(bundle->decode_ctx);
+  free(bundle);
+}
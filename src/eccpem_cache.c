@@ -0,0 +1,366 @@
+/*
+ * ===--- eccpem_cache.c ----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides a thread-safe least recently used cache of keys decoded from
+ * PEM formatted files. Entries live in a chained hash table keyed by path and
+ * key kind, and in a doubly linked list ordered by last use.
+ */
+
+#include "eccpem_cache.h"
+#include "eccpem_internal.h"
+#include "eccpem_read.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <openssl/crypto.h>
+
+/* Largest key held by the cache, an uncompressed secp521r1 point. Larger
+ * requests bypass the cache. */
+#define ECCPEM_CACHE_MAX_KEY_SIZE 133
+
+/* Kind of key stored in a cache entry. */
+typedef enum {
+  kCachedPublicKey,
+  kCachedPrivateKey
+} CachedKeyKind;
+
+/* Identity of a file version. A change of any field invalidates the entry. */
+typedef struct {
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  struct timespec mtime;
+} FileVersion;
+
+typedef struct CacheEntry {
+  char* path;
+  uint64_t hash;
+  CachedKeyKind kind;
+  FileVersion version;
+  unsigned int key_size;
+  uint8_t key[ECCPEM_CACHE_MAX_KEY_SIZE];
+  struct CacheEntry* bucket_next;
+  struct CacheEntry* lru_prev;
+  struct CacheEntry* lru_next;
+} CacheEntry;
+
+struct EccPemKeyCache {
+  pthread_mutex_t mutex;
+  size_t capacity;
+  size_t num_buckets;
+  CacheEntry** buckets;
+  /* Most recently used entry is the head, least recently used is the tail. */
+  CacheEntry* lru_head;
+  CacheEntry* lru_tail;
+  EccPemKeyCacheStats stats;
+};
+
+
+
+/*
+ * Function computes the FNV-1a hash of a path and key kind.
+ */
+static uint64_t HashEntryKey(const char* path, const CachedKeyKind kind) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (const unsigned char* p = (const unsigned char*)path; *p != '\0'; ++p) {
+    hash = (hash ^ *p) * 1099511628211ULL;
+  }
+  return (hash ^ (uint64_t)kind) * 1099511628211ULL;
+}
+
+
+
+/*
+ * Function reads the version of a file.
+ *
+ * Returns:
+ * - 1 if the file exists and its version was stored.
+ * - 0 otherwise.
+ */
+static int GetFileVersion(const char* path, FileVersion* version) {
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    return 0;
+  }
+  memset(version, 0, sizeof(*version));
+  version->dev = st.st_dev;
+  version->ino = st.st_ino;
+  version->size = st.st_size;
+  version->mtime = st.st_mtim;
+  return 1;
+}
+
+static int SameFileVersion(const FileVersion* a, const FileVersion* b) {
+  return a->dev == b->dev && a->ino == b->ino && a->size == b->size &&
+         a->mtime.tv_sec == b->mtime.tv_sec && a->mtime.tv_nsec == b->mtime.tv_nsec;
+}
+
+
+
+static void LruUnlink(EccPemKeyCache* cache, CacheEntry* entry) {
+  if (entry->lru_prev != NULL) {
+    entry->lru_prev->lru_next = entry->lru_next;
+  } else {
+    cache->lru_head = entry->lru_next;
+  }
+  if (entry->lru_next != NULL) {
+    entry->lru_next->lru_prev = entry->lru_prev;
+  } else {
+    cache->lru_tail = entry->lru_prev;
+  }
+  entry->lru_prev = NULL;
+  entry->lru_next = NULL;
+}
+
+static void LruPushFront(EccPemKeyCache* cache, CacheEntry* entry) {
+  entry->lru_prev = NULL;
+  entry->lru_next = cache->lru_head;
+  if (cache->lru_head != NULL) {
+    cache->lru_head->lru_prev = entry;
+  } else {
+    cache->lru_tail = entry;
+  }
+  cache->lru_head = entry;
+}
+
+
+
+static CacheEntry* FindEntry(EccPemKeyCache* cache, const char* path,
+                             const uint64_t hash, const CachedKeyKind kind) {
+  CacheEntry* entry = cache->buckets[hash & (cache->num_buckets - 1)];
+  for (; entry != NULL; entry = entry->bucket_next) {
+    if (entry->hash == hash && entry->kind == kind && strcmp(entry->path, path) == 0) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+
+
+/*
+ * Function unlinks an entry from the hash table and the LRU list, cleanses the
+ * key material and frees the entry. The cache mutex must be held.
+ */
+static void RemoveEntry(EccPemKeyCache* cache, CacheEntry* entry) {
+  CacheEntry** link = &cache->buckets[entry->hash & (cache->num_buckets - 1)];
+  while (*link != entry) {
+    link = &(*link)->bucket_next;
+  }
+  *link = entry->bucket_next;
+  LruUnlink(cache, entry);
+
+  OPENSSL_cleanse(entry->key, sizeof(entry->key));
+  free(entry->path);
+  free(entry);
+  --cache->stats.num_entries;
+}
+
+
+
+/*
+ * Function stores a freshly read key in the cache, replacing an existing entry
+ * for the same path and kind, and evicting the least recently used entry if the
+ * cache is full. The cache mutex must be held. Allocation failures are ignored,
+ * the key is then simply not cached.
+ */
+static void StoreEntry(EccPemKeyCache* cache, const char* path, const uint64_t hash,
+                       const CachedKeyKind kind, const FileVersion* version,
+                       const uint8_t key[], const unsigned int key_size) {
+  CacheEntry* entry = FindEntry(cache, path, hash, kind);
+  if (entry != NULL) {
+    LruUnlink(cache, entry);
+  } else {
+    if (cache->stats.num_entries >= cache->capacity) {
+      RemoveEntry(cache, cache->lru_tail);
+      ++cache->stats.evictions;
+    }
+
+    entry = calloc(1, sizeof(CacheEntry));
+    if (entry == NULL) {
+      return;
+    }
+    entry->path = strdup(path);
+    if (entry->path == NULL) {
+      free(entry);
+      return;
+    }
+    entry->hash = hash;
+    entry->kind = kind;
+
+    CacheEntry** bucket = &cache->buckets[hash & (cache->num_buckets - 1)];
+    entry->bucket_next = *bucket;
+    *bucket = entry;
+    ++cache->stats.num_entries;
+  }
+
+  entry->version = *version;
+  entry->key_size = key_size;
+  memcpy(entry->key, key, key_size);
+  LruPushFront(cache, entry);
+}
+
+
+
+/*
+ * Function serves a key read from the cache or, on a miss, reads it through the
+ * given reader function and caches the result.
+ *
+ * Returns:
+ * - 1 if the key was stored in the output array.
+ * - 0 if the underlying reader failed.
+ */
+static int ReadCachedKey(EccPemKeyCache* cache, const char* path, const CachedKeyKind kind,
+                         uint8_t key[], const unsigned int key_size,
+                         int (*read_key)(const char*, uint8_t[], const unsigned int)) {
+  if (path == NULL || key == NULL || key_size == 0 ||
+      key_size > ECCPEM_CACHE_MAX_KEY_SIZE) {
+    /* Let the reader report the error or handle the uncachable size */
+    return read_key(path, key, key_size);
+  }
+
+  FileVersion version;
+  if (!GetFileVersion(path, &version)) {
+    return read_key(path, key, key_size);
+  }
+
+  const uint64_t hash = HashEntryKey(path, kind);
+  pthread_mutex_lock(&cache->mutex);
+  CacheEntry* entry = FindEntry(cache, path, hash, kind);
+  if (entry != NULL) {
+    if (SameFileVersion(&entry->version, &version) && entry->key_size == key_size) {
+      memcpy(key, entry->key, key_size);
+      LruUnlink(cache, entry);
+      LruPushFront(cache, entry);
+      ++cache->stats.hits;
+      pthread_mutex_unlock(&cache->mutex);
+      return 1;
+    }
+    if (!SameFileVersion(&entry->version, &version)) {
+      ++cache->stats.invalidations;
+    }
+    RemoveEntry(cache, entry);
+  }
+  ++cache->stats.misses;
+  pthread_mutex_unlock(&cache->mutex);
+
+  /* Parse outside of the lock so other readers are not held up */
+  if (!read_key(path, key, key_size)) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&cache->mutex);
+  StoreEntry(cache, path, hash, kind, &version, key, key_size);
+  pthread_mutex_unlock(&cache->mutex);
+  return 1;
+}
+
+
+
+/*
+ * Function creates a new key cache holding at most capacity keys.
+ *
+ * Returns:
+ * - Pointer to the new cache on success.
+ * - NULL if capacity is 0 or memory allocation failed.
+ */
+EccPemKeyCache* EccPemKeyCacheCreate(const size_t capacity) {
+  if (capacity == 0) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Key cache capacity must be greater than 0.");
+    return NULL;
+  }
+
+  EccPemKeyCache* cache = calloc(1, sizeof(EccPemKeyCache));
+  if (cache == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating key cache failed.");
+    return NULL;
+  }
+
+  /* Keep the load factor at or below 0.5 */
+  cache->num_buckets = 16;
+  while (cache->num_buckets < 2 * capacity) {
+    cache->num_buckets *= 2;
+  }
+  cache->buckets = calloc(cache->num_buckets, sizeof(CacheEntry*));
+  if (cache->buckets == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating key cache failed.");
+    free(cache);
+    return NULL;
+  }
+
+  cache->capacity = capacity;
+  pthread_mutex_init(&cache->mutex, NULL);
+  return cache;
+}
+
+
+
+void EccPemKeyCacheFree(EccPemKeyCache* cache) {
+  if (cache == NULL) {
+    return;
+  }
+  EccPemKeyCacheClear(cache);
+  pthread_mutex_destroy(&cache->mutex);
+  free(cache->buckets);
+  free(cache);
+}
+
+
+
+void EccPemKeyCacheClear(EccPemKeyCache* cache) {
+  if (cache == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&cache->mutex);
+  while (cache->lru_head != NULL) {
+    RemoveEntry(cache, cache->lru_head);
+  }
+  pthread_mutex_unlock(&cache->mutex);
+}
+
+
+
+int EccPemKeyCacheReadPrivateKey(EccPemKeyCache* cache,
+                                 const char* privkey_file,
+                                 uint8_t private_key[],
+                                 const unsigned int key_size) {
+  if (cache == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Key cache cannot be NULL.");
+    return 0;
+  }
+  return ReadCachedKey(cache, privkey_file, kCachedPrivateKey, private_key, key_size,
+                       ReadPrivateKeyPemFile);
+}
+
+
+
+int EccPemKeyCacheReadPublicKey(EccPemKeyCache* cache,
+                                const char* pubkey_file,
+                                uint8_t public_key[],
+                                const unsigned int compressed_key_size) {
+  if (cache == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Key cache cannot be NULL.");
+    return 0;
+  }
+  return ReadCachedKey(cache, pubkey_file, kCachedPublicKey, public_key,
+                       compressed_key_size, ReadPublicKeyPemFile);
+}
+
+
+
+void EccPemKeyCacheGetStats(EccPemKeyCache* cache, EccPemKeyCacheStats* stats) {
+  if (cache == NULL || stats == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&cache->mutex);
+  *stats = cache->stats;
+  pthread_mutex_unlock(&cache->mutex);
+}
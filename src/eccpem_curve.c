@@ -0,0 +1,549 @@
+/*
+ * ===--- eccpem_curve.c ----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides the process wide table of cached curve handles. Entries are
+ * appended under a mutex and published with a release store of the entry
+ * count; once published an entry never changes, so lookups take no lock. The
+ * DER templates of a curve are built the same way on first use. Handles bound to
+ * a library context or property query live in the same table, beside the handles
+ * of the default library context.
+ */
+
+#include "eccpem_curve.h"
+#include "eccpem_internal.h"
+#include "eccpem_read.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/core_names.h>
+#include <openssl/ec.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/objects.h>
+#include <openssl/x509.h>
+
+/* States of the DER templates of a curve. */
+#define DER_TEMPLATE_NOT_BUILT 0
+#define DER_TEMPLATE_READY 1
+#define DER_TEMPLATE_UNAVAILABLE 2
+
+struct EccPemCurve {
+  int nid;
+  const char* short_name;
+  const char* long_name;
+  /* Library context and property query everything of the curve is fetched with,
+   * NULL for the defaults */
+  OSSL_LIB_CTX* libctx;
+  char* propq;
+  /* Group of the curve, shared read-only. OpenSSL 3 carries precomputed
+   * generator multiples for the built-in named curves already. */
+  EC_GROUP* group;
+  /* Domain parameters key generation contexts are created from. */
+  EVP_PKEY* keygen_template;
+  unsigned int private_key_size;
+  unsigned int compressed_key_size;
+  /* DER templates, built on first use and published with a release store */
+  atomic_int der_template_state;
+  EccPemDerTemplate* der_template;
+};
+
+static EccPemCurve g_curves[ECCPEM_MAX_CACHED_CURVES];
+static atomic_size_t g_num_curves;
+static pthread_mutex_t g_curves_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+static int IsSameProvider(const EccPemCurve* curve, OSSL_LIB_CTX* libctx, const char* propq) {
+  if (curve->libctx != libctx) {
+    return 0;
+  }
+  return curve->propq == NULL ? propq == NULL : propq != NULL && strcmp(curve->propq, propq) == 0;
+}
+
+static const EccPemCurve* FindCurveByNid(const int curve_nid, OSSL_LIB_CTX* libctx,
+                                          const char* propq) {
+  const size_t num_curves = atomic_load_explicit(&g_num_curves, memory_order_acquire);
+  for (size_t i = 0; i < num_curves; ++i) {
+    if (g_curves[i].nid == curve_nid && IsSameProvider(&g_curves[i], libctx, propq)) {
+      return &g_curves[i];
+    }
+  }
+  return NULL;
+}
+
+static const EccPemCurve* FindCurveByName(const char* ec_type, OSSL_LIB_CTX* libctx,
+                                          const char* propq) {
+  const size_t num_curves = atomic_load_explicit(&g_num_curves, memory_order_acquire);
+  for (size_t i = 0; i < num_curves; ++i) {
+    if ((strcmp(g_curves[i].short_name, ec_type) == 0 ||
+         (g_curves[i].long_name != NULL && strcmp(g_curves[i].long_name, ec_type) == 0)) &&
+        IsSameProvider(&g_curves[i], libctx, propq)) {
+      return &g_curves[i];
+    }
+  }
+  return NULL;
+}
+
+
+
+/*
+ * Function creates the domain parameters of a curve, used as template for key
+ * generation contexts, with the EC implementation of a library context.
+ *
+ * Returns:
+ * - Pointer to the EVP_PKEY holding the parameters on success.
+ * - NULL if parameter generation failed.
+ */
+static EVP_PKEY* CreateKeygenTemplate(const int curve_nid, OSSL_LIB_CTX* libctx,
+                                      const char* propq) {
+  EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_from_name(libctx, "EC", propq);
+  if (ctx == NULL) {
+    return NULL;
+  }
+
+  EVP_PKEY* params = NULL;
+  if (EVP_PKEY_paramgen_init(ctx) <= 0 ||
+      EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, curve_nid) <= 0 ||
+      EVP_PKEY_paramgen(ctx, &params) <= 0) {
+    params = NULL;
+  }
+  EVP_PKEY_CTX_free(ctx);
+  return params;
+}
+
+
+
+/*
+ * Function resolves a curve and appends it to the curve table, unless another
+ * thread did so first.
+ *
+ * Returns:
+ * - Handle of the curve.
+ * - NULL if the curve cannot be set up or the table is full.
+ */
+static const EccPemCurve* AddCurve(const int curve_nid, OSSL_LIB_CTX* libctx,
+                                   const char* propq) {
+  pthread_mutex_lock(&g_curves_mutex);
+  const EccPemCurve* curve = FindCurveByNid(curve_nid, libctx, propq);
+  if (curve != NULL) {
+    pthread_mutex_unlock(&g_curves_mutex);
+    return curve;
+  }
+
+  const size_t num_curves = atomic_load_explicit(&g_num_curves, memory_order_relaxed);
+  if (num_curves == ECCPEM_MAX_CACHED_CURVES) {
+    pthread_mutex_unlock(&g_curves_mutex);
+    EccPemReportError(ECCPEM_ERROR_INVALID_STATE, "Curve table is full.");
+    return NULL;
+  }
+
+  EC_GROUP* group = EC_GROUP_new_by_curve_name_ex(libctx, propq, curve_nid);
+  if (group == NULL) {
+    pthread_mutex_unlock(&g_curves_mutex);
+    ERR_clear_error();
+    EccPemReportError(ECCPEM_ERROR_UNKNOWN_CURVE,
+                      "Unknown Elliptic Curve type. "
+                      "Run 'openssl ecparam -list_curves' command to list EC types.");
+    return NULL;
+  }
+  EVP_PKEY* keygen_template = CreateKeygenTemplate(curve_nid, libctx, propq);
+  char* propq_copy = propq != NULL ? OPENSSL_strdup(propq) : NULL;
+  if (keygen_template == NULL || (propq != NULL && propq_copy == NULL)) {
+    pthread_mutex_unlock(&g_curves_mutex);
+    EC_GROUP_free(group);
+    EVP_PKEY_free(keygen_template);
+    OPENSSL_free(propq_copy);
+    ERR_clear_error();
+    EccPemReportError(ECCPEM_ERROR_KEYGEN_FAILED, "Setting EC curve parameters failed.");
+    return NULL;
+  }
+
+  EccPemCurve* entry = &g_curves[num_curves];
+  entry->nid = curve_nid;
+  entry->short_name = OBJ_nid2sn(curve_nid);
+  entry->long_name = OBJ_nid2ln(curve_nid);
+  entry->libctx = libctx;
+  entry->propq = propq_copy;
+  entry->group = group;
+  entry->keygen_template = keygen_template;
+  entry->private_key_size = (unsigned int)(EC_GROUP_get_degree(group) + 7) / 8;
+  entry->compressed_key_size = entry->private_key_size + 1;
+  atomic_init(&entry->der_template_state, DER_TEMPLATE_NOT_BUILT);
+  entry->der_template = NULL;
+
+  /* Publish the entry to lock-free readers */
+  atomic_store_explicit(&g_num_curves, num_curves + 1, memory_order_release);
+  pthread_mutex_unlock(&g_curves_mutex);
+  return entry;
+}
+
+
+
+const EccPemCurve* EccPemGetCurve(const char* ec_type) {
+  return EccPemGetCurveFromProvider(ec_type, NULL, NULL);
+}
+
+
+
+const EccPemCurve* EccPemGetCurveFromProvider(const char* ec_type, OSSL_LIB_CTX* libctx,
+                                              const char* propq) {
+  if (ec_type == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Elliptic Curve type cannot be NULL. "
+                      "Run 'openssl ecparam -list_curves' command to list EC types.");
+    return NULL;
+  }
+
+  const EccPemCurve* curve = FindCurveByName(ec_type, libctx, propq);
+  if (curve != NULL) {
+    return curve;
+  }
+
+  const int curve_nid = OBJ_txt2nid(ec_type);
+  if (curve_nid == NID_undef) {
+    EccPemReportError(ECCPEM_ERROR_UNKNOWN_CURVE,
+                      "Unknown Elliptic Curve type. "
+                      "Run 'openssl ecparam -list_curves' command to list EC types.");
+    return NULL;
+  }
+  curve = FindCurveByNid(curve_nid, libctx, propq);
+  return curve != NULL ? curve : AddCurve(curve_nid, libctx, propq);
+}
+
+
+
+const EccPemCurve* EccPemGetCurveByNid(const int curve_nid) {
+  const EccPemCurve* curve = FindCurveByNid(curve_nid, NULL, NULL);
+  return curve != NULL ? curve : AddCurve(curve_nid, NULL, NULL);
+}
+
+
+
+int EccPemInitCurves(const char* const ec_types[], const size_t num_curves) {
+  if (ec_types == NULL && num_curves > 0) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Curve name array cannot be NULL.");
+    return 0;
+  }
+
+  int ret_value = 1;
+  for (size_t i = 0; i < num_curves; ++i) {
+    if (EccPemGetCurve(ec_types[i]) == NULL) {
+      ret_value = 0;
+    }
+  }
+  return ret_value;
+}
+
+
+
+int EccPemCurveGetNid(const EccPemCurve* curve) {
+  return curve != NULL ? curve->nid : NID_undef;
+}
+
+const char* EccPemCurveGetName(const EccPemCurve* curve) {
+  return curve != NULL ? curve->short_name : NULL;
+}
+
+unsigned int EccPemCurveGetPrivateKeySize(const EccPemCurve* curve) {
+  return curve != NULL ? curve->private_key_size : 0;
+}
+
+unsigned int EccPemCurveGetCompressedKeySize(const EccPemCurve* curve) {
+  return curve != NULL ? curve->compressed_key_size : 0;
+}
+
+OSSL_LIB_CTX* EccPemCurveGetLibraryContext(const EccPemCurve* curve) {
+  return curve != NULL ? curve->libctx : NULL;
+}
+
+const char* EccPemCurveGetPropertyQuery(const EccPemCurve* curve) {
+  return curve != NULL ? curve->propq : NULL;
+}
+
+const EC_GROUP* EccPemCurveGetGroup(const EccPemCurve* curve) {
+  return curve->group;
+}
+
+
+
+/*
+ * Function creates an EVP_PKEY context from the curve's key generation template
+ * and prepares it for key generation. The returned context can be used for any
+ * number of EVP_PKEY_keygen calls and must be freed with EVP_PKEY_CTX_free.
+ *
+ * Returns:
+ * - Pointer to the configured EVP_PKEY_CTX on success.
+ * - NULL if creating the context or initializing key generation failed.
+ */
+EVP_PKEY_CTX* CreateKeygenContext(const EccPemCurve* curve) {
+  EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_from_pkey(curve->libctx, curve->keygen_template,
+                                                 curve->propq);
+  if (ctx == NULL) {
+    EccPemReportError(ECCPEM_ERROR_KEYGEN_FAILED, "Creating EVP_PKEY_CTX failed.");
+    return NULL;
+  }
+
+  if (EVP_PKEY_keygen_init(ctx) <= 0) {
+    EccPemReportError(ECCPEM_ERROR_KEYGEN_FAILED, "Initializing key generation failed.");
+    EVP_PKEY_CTX_free(ctx);
+    return NULL;
+  }
+  return ctx;
+}
+
+
+
+int EccPemKeygen(EVP_PKEY_CTX* ctx, EVP_PKEY** pkey) {
+  ECCPEM_STAGE_BEGIN(keygen_timer);
+  const int ret_value = EVP_PKEY_keygen(ctx, pkey);
+  ECCPEM_STAGE_END(ECCPEM_STAGE_KEYGEN, keygen_timer);
+  return ret_value;
+}
+
+
+
+/*
+ * Function DER encodes a key pair with the OpenSSL encoders, like
+ * EncodeKeysToPemBuffers does.
+ *
+ * Returns:
+ * - 1 if both encodings fit into ECCPEM_MAX_KEY_DER_SIZE bytes.
+ * - 0 otherwise.
+ */
+static int EncodeReferenceKeyDer(EVP_PKEY* pkey, uint8_t pubkey_der[], size_t* pubkey_der_len,
+                                 uint8_t privkey_der[], size_t* privkey_der_len) {
+  uint8_t* der = NULL;
+  int der_len = i2d_PUBKEY(pkey, &der);
+  if (der_len <= 0 || der_len > ECCPEM_MAX_KEY_DER_SIZE) {
+    OPENSSL_free(der);
+    return 0;
+  }
+  memcpy(pubkey_der, der, (size_t)der_len);
+  *pubkey_der_len = (size_t)der_len;
+  OPENSSL_free(der);
+
+  der = NULL;
+  PKCS8_PRIV_KEY_INFO* p8info = EVP_PKEY2PKCS8(pkey);
+  der_len = p8info != NULL ? i2d_PKCS8_PRIV_KEY_INFO(p8info, &der) : -1;
+  PKCS8_PRIV_KEY_INFO_free(p8info);
+  if (der_len <= 0 || der_len > ECCPEM_MAX_KEY_DER_SIZE) {
+    if (der_len > 0) {
+      OPENSSL_clear_free(der, (size_t)der_len);
+    }
+    return 0;
+  }
+  memcpy(privkey_der, der, (size_t)der_len);
+  *privkey_der_len = (size_t)der_len;
+  OPENSSL_clear_free(der, (size_t)der_len);
+  return 1;
+}
+
+
+
+/*
+ * Function reads the private scalar, padded to scalar_len bytes, and the encoded
+ * public point of a key pair.
+ *
+ * Returns:
+ * - 1 on success.
+ * - 0 if the key does not provide them or the scalar does not fit.
+ */
+static int GetKeyComponents(EVP_PKEY* pkey, const size_t scalar_len, uint8_t scalar[],
+                            uint8_t point[], size_t* point_len) {
+  if (!EVP_PKEY_get_octet_string_param(pkey, OSSL_PKEY_PARAM_ENCODED_PUBLIC_KEY, point,
+                                       ECCPEM_MAX_PUBLIC_KEY_SIZE, point_len)) {
+    return 0;
+  }
+
+  BIGNUM* private_key = NULL;
+  if (!EVP_PKEY_get_bn_param(pkey, OSSL_PKEY_PARAM_PRIV_KEY, &private_key)) {
+    return 0;
+  }
+  const int padded = BN_bn2binpad(private_key, scalar, (int)scalar_len) == (int)scalar_len;
+  BN_clear_free(private_key);
+  return padded;
+}
+
+
+
+/*
+ * Function returns the offset of the only occurrence of needle in data.
+ *
+ * Returns:
+ * - Offset of needle.
+ * - data_len if needle does not occur exactly once.
+ */
+static size_t FindUniqueBytes(const uint8_t data[], const size_t data_len,
+                              const uint8_t needle[], const size_t needle_len) {
+  size_t offset = data_len;
+  for (size_t i = 0; i + needle_len <= data_len; ++i) {
+    if (memcmp(data + i, needle, needle_len) == 0) {
+      if (offset != data_len) {
+        return data_len;
+      }
+      offset = i;
+    }
+  }
+  return offset;
+}
+
+
+
+/* Function fills the varying parts of the DER templates with a key pair. */
+static void FillDerTemplate(const EccPemDerTemplate* der_template, const uint8_t scalar[],
+                            const uint8_t point[], uint8_t pubkey_der[], uint8_t privkey_der[]) {
+  memcpy(pubkey_der, der_template->pubkey_der, der_template->pubkey_der_len);
+  memcpy(pubkey_der + der_template->pubkey_point_offset, point, der_template->point_len);
+  memcpy(privkey_der, der_template->privkey_der, der_template->privkey_der_len);
+  memcpy(privkey_der + der_template->privkey_scalar_offset, scalar, der_template->scalar_len);
+  if (der_template->privkey_point_offset < der_template->privkey_der_len) {
+    memcpy(privkey_der + der_template->privkey_point_offset, point, der_template->point_len);
+  }
+}
+
+
+
+/*
+ * Function builds the DER templates of a curve from the encoding of a reference
+ * key pair, and checks them against the encoding of a second key pair, so any
+ * curve whose encodings do not have a fixed layout is left without templates.
+ *
+ * Returns:
+ * - 1 if the templates were built.
+ * - 0 otherwise.
+ */
+static int BuildDerTemplate(const EccPemCurve* curve, EccPemDerTemplate* der_template) {
+  EVP_PKEY_CTX* ctx = CreateKeygenContext(curve);
+  if (ctx == NULL) {
+    return 0;
+  }
+
+  EVP_PKEY* reference_keys[2] = {NULL, NULL};
+  uint8_t scalars[2][ECCPEM_MAX_PUBLIC_KEY_SIZE];
+  uint8_t points[2][ECCPEM_MAX_PUBLIC_KEY_SIZE];
+  size_t point_lens[2] = {0, 0};
+  uint8_t pubkey_der[ECCPEM_MAX_KEY_DER_SIZE];
+  uint8_t privkey_der[ECCPEM_MAX_KEY_DER_SIZE];
+  size_t pubkey_der_len = 0;
+  size_t privkey_der_len = 0;
+
+  der_template->scalar_len = (size_t)(EC_GROUP_order_bits(curve->group) + 7) / 8;
+  int built = der_template->scalar_len <= ECCPEM_MAX_PUBLIC_KEY_SIZE;
+  for (int i = 0; i < 2 && built; ++i) {
+    built = EVP_PKEY_keygen(ctx, &reference_keys[i]) > 0 &&
+            GetKeyComponents(reference_keys[i], der_template->scalar_len, scalars[i],
+                             points[i], &point_lens[i]);
+  }
+  built = built && point_lens[0] == point_lens[1] &&
+          EncodeReferenceKeyDer(reference_keys[0], der_template->pubkey_der,
+                                &der_template->pubkey_der_len, der_template->privkey_der,
+                                &der_template->privkey_der_len);
+
+  if (built) {
+    /* Locate the varying parts in the encoding of the first key pair */
+    der_template->point_len = point_lens[0];
+    der_template->pubkey_point_offset = FindUniqueBytes(der_template->pubkey_der,
+                                                        der_template->pubkey_der_len,
+                                                        points[0], point_lens[0]);
+    der_template->privkey_scalar_offset = FindUniqueBytes(der_template->privkey_der,
+                                                          der_template->privkey_der_len,
+                                                          scalars[0],
+                                                          der_template->scalar_len);
+    der_template->privkey_point_offset = FindUniqueBytes(der_template->privkey_der,
+                                                         der_template->privkey_der_len,
+                                                         points[0], point_lens[0]);
+    built = der_template->pubkey_point_offset < der_template->pubkey_der_len &&
+            der_template->privkey_scalar_offset < der_template->privkey_der_len;
+  }
+
+  if (built) {
+    /* Wipe the reference key pair out of the templates */
+    memset(der_template->pubkey_der + der_template->pubkey_point_offset, 0,
+           der_template->point_len);
+    OPENSSL_cleanse(der_template->privkey_der + der_template->privkey_scalar_offset,
+                    der_template->scalar_len);
+    if (der_template->privkey_point_offset < der_template->privkey_der_len) {
+      memset(der_template->privkey_der + der_template->privkey_point_offset, 0,
+             der_template->point_len);
+    }
+
+    /* The second key pair filled in must match its OpenSSL encoding */
+    uint8_t filled_pubkey_der[ECCPEM_MAX_KEY_DER_SIZE];
+    uint8_t filled_privkey_der[ECCPEM_MAX_KEY_DER_SIZE];
+    FillDerTemplate(der_template, scalars[1], points[1], filled_pubkey_der, filled_privkey_der);
+    built = EncodeReferenceKeyDer(reference_keys[1], pubkey_der, &pubkey_der_len, privkey_der,
+                                  &privkey_der_len) &&
+            pubkey_der_len == der_template->pubkey_der_len &&
+            privkey_der_len == der_template->privkey_der_len &&
+            memcmp(pubkey_der, filled_pubkey_der, pubkey_der_len) == 0 &&
+            memcmp(privkey_der, filled_privkey_der, privkey_der_len) == 0;
+    OPENSSL_cleanse(filled_privkey_der, sizeof(filled_privkey_der));
+  }
+
+  OPENSSL_cleanse(scalars, sizeof(scalars));
+  OPENSSL_cleanse(privkey_der, sizeof(privkey_der));
+  EVP_PKEY_free(reference_keys[0]);
+  EVP_PKEY_free(reference_keys[1]);
+  EVP_PKEY_CTX_free(ctx);
+  ERR_clear_error();
+  return built;
+}
+
+
+
+const EccPemDerTemplate* EccPemCurveGetDerTemplate(const EccPemCurve* curve) {
+  EccPemCurve* entry = (EccPemCurve*)curve;
+  int state = atomic_load_explicit(&entry->der_template_state, memory_order_acquire);
+  if (state == DER_TEMPLATE_NOT_BUILT) {
+    pthread_mutex_lock(&g_curves_mutex);
+    state = atomic_load_explicit(&entry->der_template_state, memory_order_relaxed);
+    if (state == DER_TEMPLATE_NOT_BUILT) {
+      EccPemDerTemplate* der_template = malloc(sizeof(EccPemDerTemplate));
+      if (der_template != NULL && BuildDerTemplate(entry, der_template)) {
+        entry->der_template = der_template;
+        state = DER_TEMPLATE_READY;
+      } else {
+        free(der_template);
+        state = DER_TEMPLATE_UNAVAILABLE;
+      }
+      atomic_store_explicit(&entry->der_template_state, state, memory_order_release);
+    }
+    pthread_mutex_unlock(&g_curves_mutex);
+  }
+  return state == DER_TEMPLATE_READY ? entry->der_template : NULL;
+}
+
+
+
+int EccPemCurveEncodeKeyDer(const EccPemCurve* curve, EVP_PKEY* pkey,
+                            uint8_t pubkey_der[], size_t* pubkey_der_len,
+                            uint8_t privkey_der[], size_t* privkey_der_len) {
+  const EccPemDerTemplate* der_template = EccPemCurveGetDerTemplate(curve);
+  if (der_template == NULL) {
+    return 0;
+  }
+
+  uint8_t scalar[ECCPEM_MAX_PUBLIC_KEY_SIZE];
+  uint8_t point[ECCPEM_MAX_PUBLIC_KEY_SIZE];
+  size_t point_len = 0;
+  if (!GetKeyComponents(pkey, der_template->scalar_len, scalar, point, &point_len) ||
+      point_len != der_template->point_len) {
+    OPENSSL_cleanse(scalar, sizeof(scalar));
+    ERR_clear_error();
+    return 0;
+  }
+
+  FillDerTemplate(der_template, scalar, point, pubkey_der, privkey_der);
+  OPENSSL_cleanse(scalar, sizeof(scalar));
+  *pubkey_der_len = der_template->pubkey_der_len;
+  *privkey_der_len = der_template->privkey_der_len;
+  return 1;
+}
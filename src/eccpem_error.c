@@ -0,0 +1,102 @@
+/*
+ * ===--- eccpem_error.c ----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides the per thread error state. Recording an error stores its code
+ * and a pointer to its constant message in thread-local variables; only the few
+ * messages that carry a value are formatted, into a thread-local buffer. Nothing
+ * is written to stderr unless logging was turned on.
+ */
+
+#include "eccpem_error.h"
+#include "eccpem_internal.h"
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+/* Size of the buffer formatted detail messages are stored in. */
+#define ECCPEM_ERROR_DETAIL_SIZE 160
+
+static const char* kErrorStrings[ECCPEM_NUM_ERRORS] = {
+  "no error",
+  "invalid argument",
+  "key file must have the .pem extension",
+  "unknown elliptic curve",
+  "file cannot be opened",
+  "data cannot be decoded",
+  "key is not an EC key on a named curve",
+  "key size does not match the curve",
+  "public and private keys do not match",
+  "output buffer is too small",
+  "key conversion failed",
+  "key generation failed",
+  "key encoding failed",
+  "writing file failed",
+  "out of memory",
+  "creating thread failed",
+  "operation not allowed in the current state"
+};
+
+static atomic_int g_error_logging = 0;
+static _Thread_local EccPemError t_last_error = ECCPEM_OK;
+static _Thread_local const char* t_last_error_detail = "";
+static _Thread_local char t_detail_buffer[ECCPEM_ERROR_DETAIL_SIZE];
+
+
+
+void EccPemReportError(const EccPemError error, const char* message) {
+  t_last_error = error;
+  t_last_error_detail = message;
+  if (atomic_load_explicit(&g_error_logging, memory_order_relaxed)) {
+    fprintf(stderr, "%s\n", message);
+  }
+}
+
+
+
+void EccPemReportErrorf(const EccPemError error, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  vsnprintf(t_detail_buffer, sizeof(t_detail_buffer), format, args);
+  va_end(args);
+  EccPemReportError(error, t_detail_buffer);
+}
+
+
+
+EccPemError EccPemGetLastError(void) {
+  return t_last_error;
+}
+
+
+
+const char* EccPemGetLastErrorDetail(void) {
+  return t_last_error_detail;
+}
+
+
+
+void EccPemClearError(void) {
+  t_last_error = ECCPEM_OK;
+  t_last_error_detail = "";
+}
+
+
+
+const char* EccPemErrorString(const EccPemError error) {
+  if ((int)error < 0 || error >= ECCPEM_NUM_ERRORS) {
+    return "unknown error";
+  }
+  return kErrorStrings[error];
+}
+
+
+
+void EccPemSetErrorLogging(const int enabled) {
+  atomic_store_explicit(&g_error_logging, enabled != 0, memory_order_relaxed);
+}
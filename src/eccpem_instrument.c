@@ -0,0 +1,205 @@
+/*
+ * ===--- eccpem_instrument.c -----------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides the stage counters of the instrumentation. Every thread counts
+ * into its own block, which only it writes, so recording a stage is two plain
+ * stores and never contends. Blocks are linked into a list that readers sum up
+ * under a mutex, and the block of an exiting thread is folded into a retired
+ * total. A reset records the current totals as the new zero point, so it never
+ * races with the writers.
+ */
+
+#include "eccpem_instrument.h"
+#include "eccpem_internal.h"
+
+#include <string.h>
+
+static const char* kStageNames[ECCPEM_NUM_STAGES] = {
+  "open", "pem_decode", "ec_conversion", "point_encode", "keygen", "pem_encode", "write"
+};
+
+const char* EccPemStageName(const EccPemStage stage) {
+  if ((int)stage < 0 || stage >= ECCPEM_NUM_STAGES) {
+    return "unknown";
+  }
+  return kStageNames[stage];
+}
+
+
+
+#ifdef ECCPEM_INSTRUMENTATION
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Counters of one thread. Only the owning thread writes them. */
+typedef struct ThreadCounters {
+  _Atomic uint64_t count[ECCPEM_NUM_STAGES];
+  _Atomic uint64_t nanoseconds[ECCPEM_NUM_STAGES];
+  struct ThreadCounters* prev;
+  struct ThreadCounters* next;
+} ThreadCounters;
+
+static pthread_mutex_t g_counters_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ThreadCounters* g_thread_counters = NULL;
+static EccPemCounters g_retired_counters;
+static EccPemCounters g_reset_counters;
+static pthread_once_t g_counters_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_counters_key;
+static int g_counters_key_created = 0;
+static _Thread_local ThreadCounters* t_counters = NULL;
+
+
+
+/*
+ * Function is the destructor of the thread's counters. It adds them to the
+ * retired total and frees them when the thread exits.
+ */
+static void RetireThreadCounters(void* arg) {
+  ThreadCounters* counters = (ThreadCounters*)arg;
+  pthread_mutex_lock(&g_counters_mutex);
+  for (int i = 0; i < ECCPEM_NUM_STAGES; ++i) {
+    g_retired_counters.stages[i].count += atomic_load_explicit(&counters->count[i],
+                                                               memory_order_relaxed);
+    g_retired_counters.stages[i].nanoseconds +=
+        atomic_load_explicit(&counters->nanoseconds[i], memory_order_relaxed);
+  }
+  if (counters->prev != NULL) {
+    counters->prev->next = counters->next;
+  } else {
+    g_thread_counters = counters->next;
+  }
+  if (counters->next != NULL) {
+    counters->next->prev = counters->prev;
+  }
+  pthread_mutex_unlock(&g_counters_mutex);
+  t_counters = NULL;
+  free(counters);
+}
+
+
+
+static void CreateCountersKey(void) {
+  g_counters_key_created = pthread_key_create(&g_counters_key, RetireThreadCounters) == 0;
+}
+
+
+
+/*
+ * Function returns the counters of the calling thread, creating and registering
+ * them on first use.
+ *
+ * Returns:
+ * - Pointer to the counters.
+ * - NULL if memory allocation failed, in which case nothing is counted.
+ */
+static ThreadCounters* GetThreadCounters(void) {
+  if (t_counters != NULL) {
+    return t_counters;
+  }
+
+  pthread_once(&g_counters_key_once, CreateCountersKey);
+  ThreadCounters* counters = calloc(1, sizeof(ThreadCounters));
+  if (counters == NULL) {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&g_counters_mutex);
+  counters->next = g_thread_counters;
+  if (g_thread_counters != NULL) {
+    g_thread_counters->prev = counters;
+  }
+  g_thread_counters = counters;
+  pthread_mutex_unlock(&g_counters_mutex);
+
+  /* Without the key the counters stay registered for the rest of the process */
+  if (g_counters_key_created) {
+    pthread_setspecific(g_counters_key, counters);
+  }
+  t_counters = counters;
+  return counters;
+}
+
+
+
+uint64_t EccPemInstrumentNow(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+
+
+void EccPemInstrumentRecord(const EccPemStage stage, const uint64_t nanoseconds) {
+  ThreadCounters* counters = GetThreadCounters();
+  if (counters == NULL) {
+    return;
+  }
+  /* The owning thread is the only writer, so no read-modify-write is needed */
+  atomic_store_explicit(&counters->count[stage],
+                        atomic_load_explicit(&counters->count[stage], memory_order_relaxed) + 1,
+                        memory_order_relaxed);
+  atomic_store_explicit(&counters->nanoseconds[stage],
+                        atomic_load_explicit(&counters->nanoseconds[stage],
+                                             memory_order_relaxed) + nanoseconds,
+                        memory_order_relaxed);
+}
+
+
+
+/*
+ * Function sums the counters of the live threads and the retired total. The
+ * caller holds g_counters_mutex.
+ */
+static void SumCountersLocked(EccPemCounters* counters) {
+  *counters = g_retired_counters;
+  for (const ThreadCounters* thread = g_thread_counters; thread != NULL; thread = thread->next) {
+    for (int i = 0; i < ECCPEM_NUM_STAGES; ++i) {
+      counters->stages[i].count += atomic_load_explicit(&thread->count[i],
+                                                        memory_order_relaxed);
+      counters->stages[i].nanoseconds += atomic_load_explicit(&thread->nanoseconds[i],
+                                                              memory_order_relaxed);
+    }
+  }
+}
+
+
+
+int EccPemGetCounters(EccPemCounters* counters) {
+  pthread_mutex_lock(&g_counters_mutex);
+  SumCountersLocked(counters);
+  for (int i = 0; i < ECCPEM_NUM_STAGES; ++i) {
+    counters->stages[i].count -= g_reset_counters.stages[i].count;
+    counters->stages[i].nanoseconds -= g_reset_counters.stages[i].nanoseconds;
+  }
+  pthread_mutex_unlock(&g_counters_mutex);
+  return 1;
+}
+
+
+
+void EccPemResetCounters(void) {
+  pthread_mutex_lock(&g_counters_mutex);
+  SumCountersLocked(&g_reset_counters);
+  pthread_mutex_unlock(&g_counters_mutex);
+}
+
+#else
+
+int EccPemGetCounters(EccPemCounters* counters) {
+  memset(counters, 0, sizeof(*counters));
+  return 0;
+}
+
+
+
+void EccPemResetCounters(void) {
+}
+
+#endif
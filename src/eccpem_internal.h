@@ -0,0 +1,645 @@
+/*
+ * ===--- eccpem_internal.h -------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File declares helpers shared between the eccpem source files. It is not
+ * installed and is not part of the public API.
+ */
+
+#ifndef ECCPEM_INTERNAL_H_
+#define ECCPEM_INTERNAL_H_
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+
+#include "eccpem_curve.h"
+#include "eccpem_error.h"
+#include "eccpem_instrument.h"
+
+/*
+ * Functions record an error for the calling thread, see eccpem_error.h, and log
+ * its message to stderr if logging is on. The message of EccPemReportError must
+ * be a string constant; EccPemReportErrorf formats it.
+ */
+void EccPemReportError(const EccPemError error, const char* message);
+void EccPemReportErrorf(const EccPemError error, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/*
+ * Stage timers of the instrumentation, see eccpem_instrument.h. A stage is timed
+ * with ECCPEM_STAGE_BEGIN(timer) and ECCPEM_STAGE_END(stage, timer) in the same
+ * block. Without ECCPEM_INSTRUMENTATION both expand to nothing.
+ */
+#ifdef ECCPEM_INSTRUMENTATION
+#define ECCPEM_STAGE_BEGIN(timer) const uint64_t timer = EccPemInstrumentNow()
+#define ECCPEM_STAGE_END(stage, timer) \
+  EccPemInstrumentRecord((stage), EccPemInstrumentNow() - (timer))
+
+/*
+ * Function returns a monotonic timestamp in nanoseconds.
+ */
+uint64_t EccPemInstrumentNow(void);
+
+/*
+ * Function adds one run of a stage taking nanoseconds to the counters of the
+ * calling thread.
+ */
+void EccPemInstrumentRecord(const EccPemStage stage, const uint64_t nanoseconds);
+#else
+#define ECCPEM_STAGE_BEGIN(timer) ((void)0)
+#define ECCPEM_STAGE_END(stage, timer) ((void)0)
+#endif
+
+
+/*
+ * Function creates an EVP_PKEY context from the key generation template of a
+ * cached curve and prepares it for key generation. The returned context can be
+ * used for any number of EVP_PKEY_keygen calls and must be freed with
+ * EVP_PKEY_CTX_free.
+ *
+ * Arguments:
+ * - curve: Handle of the elliptic curve.
+ *
+ * Returns:
+ * - Pointer to the configured EVP_PKEY_CTX on success.
+ * - NULL if creating the context or initializing key generation failed.
+ */
+EVP_PKEY_CTX* CreateKeygenContext(const EccPemCurve* curve);
+
+
+
+/*
+ * Function generates a key pair with a context from CreateKeygenContext. It is
+ * EVP_PKEY_keygen timed as ECCPEM_STAGE_KEYGEN.
+ *
+ * Returns:
+ * - The return value of EVP_PKEY_keygen, positive on success.
+ */
+int EccPemKeygen(EVP_PKEY_CTX* ctx, EVP_PKEY** pkey);
+
+
+
+/* Size of a buffer large enough for the DER encoding of any EC key, public or
+ * private. */
+#define ECCPEM_MAX_KEY_DER_SIZE 512
+
+/*
+ * DER encodings of a key pair of a curve with the varying parts cut out. On a
+ * named curve the SubjectPublicKeyInfo and PKCS#8 encodings of every key pair
+ * differ only in the private scalar and the public point, which have a fixed
+ * length, so a key pair is encoded by copying the templates and filling them in.
+ *
+ * Fields:
+ * - pubkey_der, pubkey_der_len: SubjectPublicKeyInfo template.
+ * - pubkey_point_offset: Offset of the public point in pubkey_der.
+ * - privkey_der, privkey_der_len: PKCS#8 PrivateKeyInfo template.
+ * - privkey_scalar_offset: Offset of the private scalar in privkey_der.
+ * - privkey_point_offset: Offset of the public point in privkey_der, or
+ *                         privkey_der_len if the private key has no public key.
+ * - scalar_len: Length of the private scalar.
+ * - point_len: Length of the uncompressed public point.
+ */
+typedef struct {
+  uint8_t pubkey_der[ECCPEM_MAX_KEY_DER_SIZE];
+  size_t pubkey_der_len;
+  size_t pubkey_point_offset;
+  uint8_t privkey_der[ECCPEM_MAX_KEY_DER_SIZE];
+  size_t privkey_der_len;
+  size_t privkey_scalar_offset;
+  size_t privkey_point_offset;
+  size_t scalar_len;
+  size_t point_len;
+} EccPemDerTemplate;
+
+/*
+ * Function returns the DER templates of a cached curve, building them on first
+ * use.
+ *
+ * Returns:
+ * - Pointer to the templates, owned by the curve handle.
+ * - NULL if the key encodings of the curve do not have a fixed layout.
+ */
+const EccPemDerTemplate* EccPemCurveGetDerTemplate(const EccPemCurve* curve);
+
+/*
+ * Function DER encodes the public key (SubjectPublicKeyInfo) and the private key
+ * (unencrypted PKCS#8) of a key pair on a cached curve, from the curve's
+ * templates, without any heap allocation for the encodings. The output is the
+ * same as i2d_PUBKEY and i2d_PKCS8_PRIV_KEY_INFO produce.
+ *
+ * Arguments:
+ * - curve: Handle of the curve the key pair was generated on.
+ * - pkey: EVP_PKEY structure containing the key pair.
+ * - pubkey_der: Buffer of ECCPEM_MAX_KEY_DER_SIZE bytes for the public key.
+ * - pubkey_der_len: Where the length of the public key DER will be stored.
+ * - privkey_der: Buffer of ECCPEM_MAX_KEY_DER_SIZE bytes for the private key.
+ * - privkey_der_len: Where the length of the private key DER will be stored.
+ *
+ * Returns:
+ * - 1 if both keys were encoded.
+ * - 0 if the curve has no templates or the key does not fit them, in which case
+ *   the caller falls back to the OpenSSL encoders.
+ */
+int EccPemCurveEncodeKeyDer(const EccPemCurve* curve, EVP_PKEY* pkey,
+                            uint8_t pubkey_der[], size_t* pubkey_der_len,
+                            uint8_t privkey_der[], size_t* privkey_der_len);
+
+
+
+/*
+ * Function returns the EC_GROUP of a cached curve. The group is shared and must
+ * not be modified or freed.
+ */
+const EC_GROUP* EccPemCurveGetGroup(const EccPemCurve* curve);
+
+
+
+/*
+ * Function writes ECC key pairs from an EVP_PKEY structure to PEM formatted files.
+ * If the specified files already exist, they will be overwritten. Otherwise, new
+ * files will be created.
+ *
+ * Arguments:
+ * - pkey: EVP_PKEY structure containing the ECC public and private key pair
+ * - pubkey_file: PEM formatted file (extension is .pem) where the public key will
+ *                be stored
+ * - privkey_file: PEM formatted file (extension is .pem) where the private key will
+ *                 be stored
+ *
+ * Returns:
+ * - 1 if writing both keys to PEM files was successful
+ * - 0 if writing either key to its PEM file failed
+ */
+int WriteKeysToPEMFiles(EVP_PKEY* pkey,
+                        const char* pubkey_file,
+                        const char* privkey_file);
+
+
+
+/* Size of a buffer large enough for the PEM encoding of any EC key, public or
+ * private. */
+#define ECCPEM_MAX_KEY_PEM_SIZE 1024
+
+/*
+ * Function encodes the public and private keys of an EVP_PKEY structure in PEM
+ * format into caller provided buffers and null-terminates them. If the curve of
+ * the key is given, the DER encodings are built from its templates, see
+ * EccPemCurveEncodeKeyDer, which avoids the heap allocations of the OpenSSL
+ * encoders.
+ *
+ * Arguments:
+ * - curve: Handle of the curve the key pair was generated on, or NULL.
+ * - pkey: EVP_PKEY structure containing the ECC public and private key pair.
+ * - pubkey_pem, pubkey_pem_size: Buffer for the public key PEM data and its size.
+ * - pubkey_pem_len: Where the length of the public key PEM data will be stored.
+ * - privkey_pem, privkey_pem_size: Buffer for the private key PEM data and its size.
+ * - privkey_pem_len: Where the length of the private key PEM data will be stored.
+ *
+ * Returns:
+ * - 1 if both keys were stored in the buffers.
+ * - 0 if encoding failed or a buffer is too small. In the latter case the
+ *   required lengths are still stored.
+ */
+int EncodeKeysToPemBuffers(const EccPemCurve* curve, EVP_PKEY* pkey,
+                           char pubkey_pem[], const size_t pubkey_pem_size,
+                           size_t* pubkey_pem_len,
+                           char privkey_pem[], const size_t privkey_pem_size,
+                           size_t* privkey_pem_len);
+
+
+
+/*
+ * Growable buffer that the PEM blocks of many key pairs are encoded into, one
+ * after another. Batch writers keep one per thread and clear it between flushes,
+ * so encoding a key pair allocates nothing once the arena has grown.
+ *
+ * Fields:
+ * - data: Start of the buffer.
+ * - len: Number of bytes used.
+ * - capacity: Size of the buffer.
+ */
+typedef struct {
+  char* data;
+  size_t len;
+  size_t capacity;
+} EccPemArena;
+
+/*
+ * Functions initialize an empty arena, wipe and empty it while keeping its
+ * memory, and wipe and free it.
+ */
+void EccPemArenaInit(EccPemArena* arena);
+void EccPemArenaClear(EccPemArena* arena);
+void EccPemArenaFree(EccPemArena* arena);
+
+/*
+ * Function appends the public key PEM block of a key pair to one arena and its
+ * private key PEM block to another, see EncodeKeysToPemBuffers.
+ *
+ * Returns:
+ * - 1 if both blocks were appended.
+ * - 0 if encoding or memory allocation failed.
+ */
+int EccPemArenaAppendKeyPair(EccPemArena* pubkey_arena, EccPemArena* privkey_arena,
+                             const EccPemCurve* curve, EVP_PKEY* pkey);
+
+
+
+/*
+ * Function writes len bytes to a file descriptor, continuing after partial
+ * writes.
+ *
+ * Returns:
+ * - 1 if all bytes were written.
+ * - 0 otherwise.
+ */
+int EccPemWriteFully(const int fd, const char* data, const size_t len);
+
+/*
+ * Function replaces the content of a file with len bytes, written with a single
+ * write call in the common case.
+ *
+ * Returns:
+ * - 1 if the file was written and closed.
+ * - 0 otherwise.
+ */
+int EccPemWriteFile(const char* file, const char* data, const size_t len);
+
+
+
+/*
+ * Function writes a key pair to PEM formatted files through two arenas, which
+ * are cleared first. It is the batch writers' counterpart of
+ * WriteKeysToPEMFiles: one encoding pass and one write call per file, and no
+ * allocation once the arenas have grown.
+ *
+ * Returns:
+ * - 1 if both PEM files were written.
+ * - 0 otherwise.
+ */
+int WriteKeyPairWithArenas(const EccPemCurve* curve, EVP_PKEY* pkey,
+                           const char* pubkey_file, const char* privkey_file,
+                           EccPemArena* pubkey_arena, EccPemArena* privkey_arena);
+
+
+
+/*
+ * Functions open a private or public key's PEM file and parse it into an
+ * EVP_PKEY structure, which must be freed with EVP_PKEY_free. The file name is
+ * not validated.
+ *
+ * Returns:
+ * - Pointer to the EVP_PKEY structure on success.
+ * - NULL if the PEM file cannot be opened or read.
+ */
+EVP_PKEY* LoadPrivateKeyPemFile(const char* privkey_file);
+EVP_PKEY* LoadPublicKeyPemFile(const char* pubkey_file);
+
+
+
+/*
+ * Functions parse a private or public key's PEM data of pem_len bytes, at most
+ * INT_MAX, into an EVP_PKEY structure, which must be freed with EVP_PKEY_free.
+ *
+ * Returns:
+ * - Pointer to the EVP_PKEY structure on success.
+ * - NULL if the PEM data cannot be parsed.
+ */
+EVP_PKEY* LoadPrivateKeyPemBuffer(const char* privkey_pem, const size_t privkey_pem_len);
+EVP_PKEY* LoadPublicKeyPemBuffer(const char* pubkey_pem, const size_t pubkey_pem_len);
+
+
+
+/*
+ * Function extracts the private key of an EVP_PKEY structure and stores it in a
+ * given array as binary data. The EVP_PKEY structure is not freed.
+ *
+ * Arguments:
+ * - pkey: EVP_PKEY structure containing the EC private key.
+ * - private_key: An array where the private key will be stored.
+ * - key_size: Size of array.
+ *
+ * Returns:
+ * - 1 if storing the private key to array was successful.
+ * - 0 otherwise.
+ */
+int ExtractPrivateKey(EVP_PKEY* pkey, uint8_t private_key[],
+                      const unsigned int key_size);
+
+
+
+/*
+ * Function extracts the public key of an EVP_PKEY structure and stores it in a
+ * given array as compressed binary data. The EVP_PKEY structure is not freed.
+ *
+ * Arguments:
+ * - pkey: EVP_PKEY structure containing the EC public key.
+ * - public_key: Output buffer to store the compressed public key binary data.
+ * - compressed_key_size: Size of output buffer.
+ *
+ * Returns:
+ * - 1 if storing the compressed public key to array was successful.
+ * - 0 otherwise.
+ */
+int ExtractCompressedPublicKey(EVP_PKEY* pkey, uint8_t public_key[],
+                               const unsigned int compressed_key_size);
+
+
+
+/*
+ * Function returns the NID of the elliptic curve of an EC key, or NID_undef if
+ * the key is not an EC key on a named curve.
+ */
+int GetEcKeyCurveNid(const EVP_PKEY* pkey);
+
+
+
+/*
+ * Function encodes the public key of an EC key as an octet string in the given
+ * point conversion form. If out is NULL, only the length of the encoding is
+ * computed.
+ *
+ * Arguments:
+ * - pkey: EVP_PKEY structure containing the EC public key.
+ * - form: POINT_CONVERSION_COMPRESSED or POINT_CONVERSION_UNCOMPRESSED.
+ * - out: Output buffer for the encoded point, or NULL.
+ * - out_size: Size of output buffer.
+ * - out_len: Where the length of the encoded point will be stored.
+ *
+ * Returns:
+ * - 1 on success.
+ * - 0 if the key is not an EC key or the buffer is too small.
+ */
+int EncodeEcPublicKey(EVP_PKEY* pkey, const point_conversion_form_t form,
+                      uint8_t out[], const size_t out_size, size_t* out_len);
+
+
+
+/*
+ * Location of one PEM block inside a memory region. All pointers point into the
+ * scanned region, nothing is copied.
+ *
+ * Fields:
+ * - label: Start of the label of the block, e.g. "PUBLIC KEY".
+ * - label_len: Length of the label.
+ * - body: Start of the base64 body (the lines between BEGIN and END).
+ * - body_len: Length of the body, including line breaks.
+ * - complete: 1 if a matching END line was found, 0 if the block is truncated
+ *             or its END label does not match the BEGIN label.
+ * - next: Offset in the region right after the block, where scanning for the
+ *         next block continues.
+ */
+typedef struct {
+  const char* label;
+  size_t label_len;
+  const char* body;
+  size_t body_len;
+  int complete;
+  size_t next;
+} EccPemBlock;
+
+/*
+ * Function finds the next PEM block in a memory region, starting at a given
+ * offset. Like PEM_read_bio, it only takes BEGIN and END markers at the start of
+ * a line.
+ *
+ * Arguments:
+ * - data: Memory region holding PEM formatted data.
+ * - data_len: Length of the region.
+ * - offset: Offset in the region where the search starts.
+ * - block: Where the location of the block will be stored.
+ *
+ * Returns:
+ * - 1 if a BEGIN line was found. The block may still be incomplete, see
+ *   EccPemBlock.complete.
+ * - 0 if there is no further PEM block.
+ */
+int EccPemFindBlock(const char* data, const size_t data_len, const size_t offset,
+                    EccPemBlock* block);
+
+
+
+/*
+ * Function reports whether a block has the given label.
+ */
+int EccPemBlockHasLabel(const EccPemBlock* block, const char* label);
+
+
+
+/*
+ * Function finds the first block of a memory region that can hold a key: it is
+ * complete, has a key label ("PRIVATE KEY", "ENCRYPTED PRIVATE KEY" or
+ * "EC PRIVATE KEY" for private keys, "PUBLIC KEY" for public keys), and its body
+ * passes EccPemBase64CheckBody with a plausible DER length. RFC 1421 headers in
+ * front of the body are skipped. Nothing is decoded.
+ *
+ * Arguments:
+ * - data: Memory region holding PEM formatted data, e.g. a buffer or a memory
+ *         mapped file.
+ * - data_len: Length of the region.
+ * - private_key: 1 to look for a private key block, 0 for a public key block.
+ * - block: Where the location of the block will be stored.
+ *
+ * Returns:
+ * - 1 if such a block was found.
+ * - 0 otherwise; the data then cannot be parsed as such a key.
+ */
+int EccPemFindKeyBlock(const char* data, const size_t data_len, const int private_key,
+                       EccPemBlock* block);
+
+
+
+/*
+ * Base64 kernels. The fastest kernel the CPU supports is selected on first use.
+ */
+typedef enum {
+  kEccPemBase64Scalar,
+  kEccPemBase64Avx2
+} EccPemBase64Kernel;
+
+/*
+ * Function returns the base64 kernel in use.
+ */
+EccPemBase64Kernel EccPemBase64GetKernel(void);
+
+/*
+ * Function overrides the base64 kernel in use, e.g. to compare kernels in tests.
+ * It must not be called while other threads encode or decode.
+ *
+ * Returns:
+ * - 1 if the kernel was selected.
+ * - 0 if the kernel is not supported by this build or CPU.
+ */
+int EccPemBase64SetKernel(const EccPemBase64Kernel kernel);
+
+
+
+/*
+ * Function decodes the base64 body of a PEM block, as found by EccPemFindBlock,
+ * into DER. Line breaks (LF or CRLF) may occur anywhere between characters.
+ * Bodies with RFC 1421 headers or any other character outside the base64
+ * alphabet are rejected, so callers can fall back to the OpenSSL decoder.
+ *
+ * Arguments:
+ * - body: Base64 body of the block.
+ * - body_len: Length of the body.
+ * - out: Output buffer for the DER data.
+ * - out_size: Size of output buffer.
+ * - out_len: Where the length of the DER data will be stored.
+ *
+ * Returns:
+ * - 1 if the body was decoded.
+ * - 0 if the body is empty or malformed, or the buffer is too small.
+ */
+int EccPemBase64DecodeBody(const char* body, const size_t body_len,
+                           uint8_t out[], const size_t out_size, size_t* out_len);
+
+
+
+/*
+ * Function checks the base64 body of a PEM block without decoding it: every line
+ * must hold base64 characters only, '=' padding may only end the body, and the
+ * number of characters must be a multiple of four. Spaces and tabs are skipped
+ * like the OpenSSL decoder does. It is much cheaper than decoding, so malformed
+ * bodies can be rejected before they reach OpenSSL.
+ *
+ * Arguments:
+ * - body: Base64 body of the block, without RFC 1421 headers.
+ * - body_len: Length of the body.
+ * - decoded_len: Where the length of the decoded data will be stored.
+ *
+ * Returns:
+ * - 1 if the body is well formed.
+ * - 0 if it is empty or malformed.
+ */
+int EccPemBase64CheckBody(const char* body, const size_t body_len, size_t* decoded_len);
+
+
+
+/*
+ * Function returns the length of the PEM body encoding data_len bytes: base64
+ * lines of 64 characters, each terminated by a line feed.
+ */
+size_t EccPemBase64EncodedBodyLength(const size_t data_len);
+
+/*
+ * Function encodes data as a PEM body, the same way PEM_write_bio does.
+ *
+ * Returns:
+ * - 1 if the body was stored in out, which is not NUL-terminated.
+ * - 0 if the buffer is too small.
+ */
+int EccPemBase64EncodeBody(const uint8_t data[], const size_t data_len,
+                           char out[], const size_t out_size, size_t* out_len);
+
+
+
+/*
+ * Function writes a complete PEM block (BEGIN line, body and END line) holding
+ * DER data. The block is not NUL-terminated.
+ *
+ * Arguments:
+ * - label: Label of the block, e.g. PEM_STRING_PUBLIC.
+ * - der: DER data.
+ * - der_len: Length of the DER data.
+ * - out: Output buffer.
+ * - out_size: Size of output buffer.
+ * - out_len: Where the length of the block is stored, also if the buffer is too
+ *            small.
+ *
+ * Returns:
+ * - 1 if the block was stored in out.
+ * - 0 if the buffer is too small.
+ */
+int EccPemEncodeBlock(const char* label, const uint8_t der[], const size_t der_len,
+                      char out[], const size_t out_size, size_t* out_len);
+
+
+
+/*
+ * Shared queue of work items. Workers pull contiguous chunks of item indices
+ * from it until the queue is drained, so faster workers simply take more chunks.
+ */
+typedef struct {
+  atomic_size_t next_item;
+  size_t num_items;
+  size_t chunk_size;
+} EccPemWorkQueue;
+
+/*
+ * Function initializes a work queue over the item indices [0, num_items).
+ *
+ * Arguments:
+ * - queue: Work queue to initialize.
+ * - num_items: Number of work items.
+ * - chunk_size: Number of items handed out per chunk. 0 selects a default.
+ */
+void EccPemWorkQueueInit(EccPemWorkQueue* queue, const size_t num_items,
+                         const size_t chunk_size);
+
+
+
+/*
+ * Function takes the next chunk of work items from the queue. It is safe to call
+ * from multiple threads at the same time.
+ *
+ * Arguments:
+ * - queue: Work queue to take the chunk from.
+ * - begin: Where the first item index of the chunk will be stored.
+ * - end: Where the index one past the last item of the chunk will be stored.
+ *
+ * Returns:
+ * - 1 if a non-empty chunk was taken.
+ * - 0 if the queue is drained.
+ */
+int EccPemWorkQueueNext(EccPemWorkQueue* queue, size_t* begin, size_t* end);
+
+
+
+/*
+ * Function runs the worker function on num_threads threads and waits for all of
+ * them to finish. The calling thread acts as one of the workers.
+ *
+ * Arguments:
+ * - num_threads: Number of workers. 0 selects the number of online CPUs.
+ * - worker: Function run by every worker. It receives arg and its own worker
+ *           index in [0, number of workers).
+ * - arg: Argument passed to every worker.
+ *
+ * Returns:
+ * - Number of workers that were run. It is less than num_threads if some
+ *   threads could not be created; remaining work is then done by the others.
+ */
+unsigned int EccPemRunWorkers(const unsigned int num_threads,
+                              void (*worker)(void* arg, unsigned int worker_index),
+                              void* arg);
+
+
+
+/*
+ * Function returns the number of workers EccPemRunWorkers will use for a
+ * requested thread count.
+ *
+ * Arguments:
+ * - num_threads: Requested number of threads. 0 selects the number of online CPUs.
+ *
+ * Returns:
+ * - Number of workers, at least 1.
+ */
+unsigned int EccPemResolveThreadCount(const unsigned int num_threads);
+
+
+
+/*
+ * Function returns a monotonic timestamp in seconds.
+ */
+double EccPemNowSeconds(void);
+
+#endif
@@ -0,0 +1,273 @@
+/*
+ * ===--- eccpem_loader.c ---------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides the directory scan and the parallel load of public key PEM
+ * files. A scan keeps all paths in one buffer with a sorted array of pointers
+ * into it. The load hands out chunks of files to the shared worker runner, and
+ * every worker writes straight into its slots of the caller's arrays.
+ */
+
+#include "eccpem_loader.h"
+#include "eccpem_internal.h"
+#include "eccpem_read.h"
+#include "utils.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* Number of files a load worker takes from the work queue at once. */
+#define ECCPEM_LOAD_CHUNK_SIZE 64
+
+struct EccPemKeyDirectory {
+  char* paths;
+  const char** files;
+  size_t num_files;
+};
+
+/* Shared state of a directory load. */
+typedef struct {
+  const EccPemKeyDirectory* key_dir;
+  uint8_t* public_keys;
+  unsigned int compressed_key_size;
+  int* results;
+  EccPemWorkQueue queue;
+  atomic_size_t num_loaded;
+} LoadJob;
+
+
+
+/*
+ * Function checks whether a directory entry is a regular file, following
+ * symbolic links. The entry type is only looked up if readdir did not report it.
+ */
+static int IsRegularFile(DIR* dir, const struct dirent* entry) {
+  if (entry->d_type == DT_REG) {
+    return 1;
+  }
+  if (entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK) {
+    return 0;
+  }
+  struct stat file_stat;
+  return fstatat(dirfd(dir), entry->d_name, &file_stat, 0) == 0 && S_ISREG(file_stat.st_mode);
+}
+
+
+
+static int ComparePaths(const void* a, const void* b) {
+  return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+
+
+/*
+ * Function appends the path of a directory entry, null-terminated, to the path
+ * buffer of a scan, growing it as needed.
+ *
+ * Returns:
+ * - 1 on success.
+ * - 0 if memory allocation failed.
+ */
+static int AppendPath(char** paths, size_t* paths_len, size_t* paths_capacity,
+                      const char* directory, const char* name) {
+  const size_t path_size = strlen(directory) + 1 + strlen(name) + 1;
+  if (*paths_capacity - *paths_len < path_size) {
+    size_t capacity = *paths_capacity > 0 ? *paths_capacity : 4096;
+    while (capacity - *paths_len < path_size) {
+      capacity *= 2;
+    }
+    char* grown = realloc(*paths, capacity);
+    if (grown == NULL) {
+      return 0;
+    }
+    *paths = grown;
+    *paths_capacity = capacity;
+  }
+  snprintf(*paths + *paths_len, path_size, "%s/%s", directory, name);
+  *paths_len += path_size;
+  return 1;
+}
+
+
+
+EccPemKeyDirectory* EccPemKeyDirectoryScan(const char* directory) {
+  if (directory == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Key directory cannot be NULL.");
+    return NULL;
+  }
+
+  DIR* dir = opendir(directory);
+  if (dir == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Unable to open key directory.");
+    return NULL;
+  }
+
+  EccPemKeyDirectory* key_dir = calloc(1, sizeof(EccPemKeyDirectory));
+  if (key_dir == NULL) {
+    closedir(dir);
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating the key directory failed.");
+    return NULL;
+  }
+
+  /* Paths are collected first, pointers into the buffer are only taken once
+   * it stops moving */
+  size_t paths_len = 0;
+  size_t paths_capacity = 0;
+  int ret_value = 1;
+  const struct dirent* entry = NULL;
+  while ((entry = readdir(dir)) != NULL) {
+    if (!HasPemFileExtension(entry->d_name) || !IsRegularFile(dir, entry)) {
+      continue;
+    }
+    if (!AppendPath(&key_dir->paths, &paths_len, &paths_capacity, directory, entry->d_name)) {
+      ret_value = 0;
+      break;
+    }
+    ++key_dir->num_files;
+  }
+  closedir(dir);
+
+  if (ret_value && key_dir->num_files > 0) {
+    key_dir->files = malloc(key_dir->num_files * sizeof(const char*));
+    ret_value = key_dir->files != NULL;
+  }
+  if (!ret_value) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating the key directory failed.");
+    EccPemKeyDirectoryClose(key_dir);
+    return NULL;
+  }
+
+  const char* path = key_dir->paths;
+  for (size_t i = 0; i < key_dir->num_files; ++i) {
+    key_dir->files[i] = path;
+    path += strlen(path) + 1;
+  }
+  if (key_dir->num_files > 1) {
+    qsort(key_dir->files, key_dir->num_files, sizeof(const char*), ComparePaths);
+  }
+  return key_dir;
+}
+
+
+
+size_t EccPemKeyDirectoryNumFiles(const EccPemKeyDirectory* key_dir) {
+  return key_dir != NULL ? key_dir->num_files : 0;
+}
+
+
+
+const char* EccPemKeyDirectoryGetFile(const EccPemKeyDirectory* key_dir, const size_t index) {
+  if (key_dir == NULL || index >= key_dir->num_files) {
+    return NULL;
+  }
+  return key_dir->files[index];
+}
+
+
+
+/*
+ * Function is the worker of EccPemKeyDirectoryLoadPublicKeys. It reads the files
+ * of the chunks it takes from the job's queue.
+ */
+static void LoadWorker(void* arg, unsigned int worker_index) {
+  (void)worker_index;
+  LoadJob* job = (LoadJob*)arg;
+
+  size_t num_loaded = 0;
+  size_t begin = 0;
+  size_t end = 0;
+  while (EccPemWorkQueueNext(&job->queue, &begin, &end)) {
+    for (size_t i = begin; i < end; ++i) {
+      uint8_t* public_key = job->public_keys + i * job->compressed_key_size;
+      const int result = ReadPublicKeyPemFile(job->key_dir->files[i], public_key,
+                                              job->compressed_key_size);
+      if (job->results != NULL) {
+        job->results[i] = result;
+      }
+      num_loaded += (size_t)result;
+    }
+  }
+  atomic_fetch_add_explicit(&job->num_loaded, num_loaded, memory_order_relaxed);
+}
+
+
+
+size_t EccPemKeyDirectoryLoadPublicKeys(const EccPemKeyDirectory* key_dir,
+                                        uint8_t public_keys[],
+                                        const unsigned int compressed_key_size,
+                                        int results[],
+                                        const unsigned int num_threads,
+                                        EccPemLoadStats* stats) {
+  if (stats != NULL) {
+    memset(stats, 0, sizeof(*stats));
+  }
+
+  if (key_dir == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Key directory cannot be NULL.");
+    return 0;
+  }
+
+  if (stats != NULL) {
+    stats->num_files = key_dir->num_files;
+  }
+  if (results != NULL) {
+    memset(results, 0, key_dir->num_files * sizeof(results[0]));
+  }
+  if (key_dir->num_files == 0) {
+    return 0;
+  }
+
+  if (public_keys == NULL || compressed_key_size == 0) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Public key output array cannot be NULL or empty.");
+    return 0;
+  }
+
+  LoadJob job;
+  job.key_dir = key_dir;
+  job.public_keys = public_keys;
+  job.compressed_key_size = compressed_key_size;
+  job.results = results;
+  EccPemWorkQueueInit(&job.queue, key_dir->num_files, ECCPEM_LOAD_CHUNK_SIZE);
+  atomic_init(&job.num_loaded, 0);
+
+  /* Never start more threads than there are chunks of work */
+  unsigned int num_workers = EccPemResolveThreadCount(num_threads);
+  const size_t num_chunks = (key_dir->num_files + ECCPEM_LOAD_CHUNK_SIZE - 1) /
+                            ECCPEM_LOAD_CHUNK_SIZE;
+  if (num_chunks < num_workers) {
+    num_workers = (unsigned int)num_chunks;
+  }
+
+  const double start_time = EccPemNowSeconds();
+  num_workers = EccPemRunWorkers(num_workers, LoadWorker, &job);
+  const double elapsed_seconds = EccPemNowSeconds() - start_time;
+
+  const size_t num_loaded = atomic_load(&job.num_loaded);
+  if (stats != NULL) {
+    stats->num_threads = num_workers;
+    stats->num_loaded = num_loaded;
+    stats->elapsed_seconds = elapsed_seconds;
+    stats->files_per_second =
+        elapsed_seconds > 0 ? (double)key_dir->num_files / elapsed_seconds : 0;
+  }
+  return num_loaded;
+}
+
+
+
+void EccPemKeyDirectoryClose(EccPemKeyDirectory* key_dir) {
+  if (key_dir == NULL) {
+    return;
+  }
+  free(key_dir->files);
+  free(key_dir->paths);
+  free(key_dir);
+}
@@ -0,0 +1,279 @@
+/*
+ * ===--- eccpem_parallel.c -------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides functionality to generate Elliptic Curve Cryptography key pairs
+ * on a pool of worker threads, together with the small work queue and worker
+ * runner that the other multi-threaded parts of the library are built on.
+ */
+
+#include "eccpem_parallel.h"
+#include "eccpem_internal.h"
+#include "utils.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <openssl/objects.h>
+
+/* Default number of items a worker takes from a work queue at once. */
+#define ECCPEM_DEFAULT_CHUNK_SIZE 16
+
+void EccPemWorkQueueInit(EccPemWorkQueue* queue, const size_t num_items,
+                         const size_t chunk_size) {
+  atomic_init(&queue->next_item, 0);
+  queue->num_items = num_items;
+  queue->chunk_size = chunk_size == 0 ? ECCPEM_DEFAULT_CHUNK_SIZE : chunk_size;
+}
+
+
+
+int EccPemWorkQueueNext(EccPemWorkQueue* queue, size_t* begin, size_t* end) {
+  const size_t first = atomic_fetch_add_explicit(&queue->next_item, queue->chunk_size,
+                                                 memory_order_relaxed);
+  if (first >= queue->num_items) {
+    return 0;
+  }
+  *begin = first;
+  *end = first + queue->chunk_size < queue->num_items ? first + queue->chunk_size
+                                                      : queue->num_items;
+  return 1;
+}
+
+
+
+unsigned int EccPemResolveThreadCount(const unsigned int num_threads) {
+  if (num_threads != 0) {
+    return num_threads;
+  }
+  const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return num_cpus > 0 ? (unsigned int)num_cpus : 1;
+}
+
+
+
+double EccPemNowSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+
+
+/* Start routine argument of a worker thread. */
+typedef struct {
+  void (*worker)(void* arg, unsigned int worker_index);
+  void* arg;
+  unsigned int worker_index;
+} WorkerThreadArg;
+
+static void* WorkerThreadMain(void* thread_arg) {
+  const WorkerThreadArg* worker_arg = (const WorkerThreadArg*)thread_arg;
+  worker_arg->worker(worker_arg->arg, worker_arg->worker_index);
+  return NULL;
+}
+
+
+
+unsigned int EccPemRunWorkers(const unsigned int num_threads,
+                              void (*worker)(void* arg, unsigned int worker_index),
+                              void* arg) {
+  const unsigned int num_workers = EccPemResolveThreadCount(num_threads);
+  if (num_workers == 1) {
+    worker(arg, 0);
+    return 1;
+  }
+
+  pthread_t* threads = malloc((num_workers - 1) * sizeof(pthread_t));
+  WorkerThreadArg* thread_args = malloc(num_workers * sizeof(WorkerThreadArg));
+  if (threads == NULL || thread_args == NULL) {
+    free(threads);
+    free(thread_args);
+    worker(arg, 0);
+    return 1;
+  }
+
+  /* Worker 0 is the calling thread, the others get their own threads */
+  unsigned int num_started = 0;
+  for (unsigned int i = 1; i < num_workers; ++i) {
+    thread_args[i].worker = worker;
+    thread_args[i].arg = arg;
+    thread_args[i].worker_index = i;
+    if (pthread_create(&threads[num_started], NULL, WorkerThreadMain, &thread_args[i]) != 0) {
+      EccPemReportErrorf(ECCPEM_ERROR_THREAD_FAILED,
+                         "Creating worker thread failed, continuing with %u threads.",
+                         num_started + 1);
+      break;
+    }
+    ++num_started;
+  }
+
+  worker(arg, 0);
+  for (unsigned int i = 0; i < num_started; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+
+  free(threads);
+  free(thread_args);
+  return num_started + 1;
+}
+
+
+
+/* Shared state of a parallel key generation run. */
+typedef struct {
+  const EccPemCurve* curve;
+  const char* const* pubkey_files;
+  const char* const* privkey_files;
+  int* results;
+  EccPemWorkQueue queue;
+  atomic_size_t num_created;
+} ParallelKeygenJob;
+
+/*
+ * Function is the worker of CreateECCKeysPemFilesParallel. It sets up its own
+ * key generation context and arenas and generates key pairs for the chunks it
+ * takes from the job's queue.
+ */
+static void ParallelKeygenWorker(void* arg, unsigned int worker_index) {
+  (void)worker_index;
+  ParallelKeygenJob* job = (ParallelKeygenJob*)arg;
+
+  EVP_PKEY_CTX* ctx = CreateKeygenContext(job->curve);
+  if (ctx == NULL) {
+    return;
+  }
+
+  EccPemArena pubkey_arena;
+  EccPemArena privkey_arena;
+  EccPemArenaInit(&pubkey_arena);
+  EccPemArenaInit(&privkey_arena);
+
+  size_t num_created = 0;
+  size_t begin = 0;
+  size_t end = 0;
+  while (EccPemWorkQueueNext(&job->queue, &begin, &end)) {
+    for (size_t i = begin; i < end; ++i) {
+      if (!VerifyPemFileFormat(job->pubkey_files[i]) ||
+          !VerifyPemFileFormat(job->privkey_files[i])) {
+        continue;
+      }
+
+      EVP_PKEY* pkey = NULL;
+      if (EccPemKeygen(ctx, &pkey) <= 0) {
+        EccPemReportError(ECCPEM_ERROR_KEYGEN_FAILED, "Generating EC key pair failed.");
+        continue;
+      }
+
+      if (!WriteKeyPairWithArenas(job->curve, pkey, job->pubkey_files[i],
+                                  job->privkey_files[i], &pubkey_arena, &privkey_arena)) {
+        EccPemReportError(ECCPEM_ERROR_WRITE_FAILED,
+                          "Writing private and public keys in PEM format files failed.");
+        EVP_PKEY_free(pkey);
+        continue;
+      }
+      EVP_PKEY_free(pkey);
+
+      if (job->results != NULL) {
+        job->results[i] = 1;
+      }
+      ++num_created;
+    }
+  }
+
+  atomic_fetch_add_explicit(&job->num_created, num_created, memory_order_relaxed);
+  EccPemArenaFree(&pubkey_arena);
+  EccPemArenaFree(&privkey_arena);
+  EVP_PKEY_CTX_free(ctx);
+}
+
+
+
+/*
+ * Function generates ECC key pairs on several threads and writes every pair to
+ * its own PEM formatted files.
+ *
+ * Arguments:
+ * - ec_type: The type of elliptic curve to use for key generation. Must be a valid
+ *            curve name as listed by the command: openssl ecparam -list_curves
+ * - num_keys: Number of key pairs to generate.
+ * - pubkey_files: Array of num_keys paths (.pem extension) for the public keys.
+ * - privkey_files: Array of num_keys paths (.pem extension) for the private keys.
+ * - results: Optional array of num_keys per key results (may be NULL).
+ * - num_threads: Number of threads to use. 0 uses one thread per online CPU.
+ * - stats: Optional statistics of the run (may be NULL).
+ *
+ * Returns:
+ * - Number of key pairs that were generated and written successfully.
+ */
+size_t CreateECCKeysPemFilesParallel(const char* ec_type,
+                                     const size_t num_keys,
+                                     const char* const pubkey_files[],
+                                     const char* const privkey_files[],
+                                     int results[],
+                                     const unsigned int num_threads,
+                                     EccPemParallelStats* stats) {
+  if (stats != NULL) {
+    memset(stats, 0, sizeof(*stats));
+    stats->num_keys = num_keys;
+  }
+
+  if (results != NULL) {
+    memset(results, 0, num_keys * sizeof(results[0]));
+  }
+
+  /* Sanity checking of arguments. */
+  if (ec_type == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Elliptic Curve type cannot be NULL. "
+                      "Run 'openssl ecparam -list_curves' command to list EC types.");
+    return 0;
+  }
+
+  if (pubkey_files == NULL || privkey_files == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Public and private key file arrays cannot be NULL.");
+    return 0;
+  }
+
+  const EccPemCurve* curve = EccPemGetCurve(ec_type);
+  if (curve == NULL) {
+    return 0;
+  }
+
+  ParallelKeygenJob job;
+  job.curve = curve;
+  job.pubkey_files = pubkey_files;
+  job.privkey_files = privkey_files;
+  job.results = results;
+  EccPemWorkQueueInit(&job.queue, num_keys, 0);
+  atomic_init(&job.num_created, 0);
+
+  /* Never start more threads than there are chunks of work */
+  unsigned int num_workers = EccPemResolveThreadCount(num_threads);
+  const size_t num_chunks = (num_keys + job.queue.chunk_size - 1) / job.queue.chunk_size;
+  if (num_chunks < num_workers) {
+    num_workers = num_chunks > 0 ? (unsigned int)num_chunks : 1;
+  }
+
+  const double start_time = EccPemNowSeconds();
+  num_workers = EccPemRunWorkers(num_workers, ParallelKeygenWorker, &job);
+  const double elapsed_seconds = EccPemNowSeconds() - start_time;
+
+  const size_t num_created = atomic_load(&job.num_created);
+  if (stats != NULL) {
+    stats->num_threads = num_workers;
+    stats->num_created = num_created;
+    stats->elapsed_seconds = elapsed_seconds;
+    stats->keys_per_second = elapsed_seconds > 0 ? (double)num_created / elapsed_seconds : 0;
+  }
+  return num_created;
+}
@@ -0,0 +1,410 @@
+/*
+ * ===--- eccpem_pool.c -----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides the pool of pre-generated key pairs. Ready keys are kept in a
+ * bounded lock-free ring (Vyukov's multi-producer multi-consumer queue: every
+ * cell carries a sequence number telling whether it is ready to be written or
+ * read at a given position), so takes never block each other. A background
+ * thread sleeps on a condition variable and refills the ring up to its capacity
+ * once a take leaves it at or below the low watermark.
+ */
+
+#include "eccpem_pool.h"
+#include "eccpem_internal.h"
+#include "utils.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+
+/* Size of a cache line, used to keep the ring positions on separate lines. */
+#define ECCPEM_CACHE_LINE_SIZE 64
+
+/* Cell of the ring. */
+typedef struct {
+  atomic_size_t sequence;
+  EVP_PKEY* pkey;
+} KeyPoolCell;
+
+struct EccPemKeyPool {
+  _Alignas(ECCPEM_CACHE_LINE_SIZE) atomic_size_t enqueue_pos;
+  _Alignas(ECCPEM_CACHE_LINE_SIZE) atomic_size_t dequeue_pos;
+  _Alignas(ECCPEM_CACHE_LINE_SIZE) atomic_size_t depth;
+  atomic_size_t min_depth;
+  atomic_uint_fast64_t num_taken;
+  atomic_uint_fast64_t num_stalls;
+  atomic_uint_fast64_t num_generated;
+  atomic_int refill_requested;
+
+  KeyPoolCell* cells;
+  size_t mask;
+  size_t low_watermark;
+  const EccPemCurve* curve;
+
+  /* Key generation context, used only by the refill thread once it runs */
+  EVP_PKEY_CTX* ctx;
+  pthread_t refill_thread;
+  int has_refill_thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  atomic_int stopping;
+};
+
+
+
+/*
+ * Function appends a key pair to the ring.
+ *
+ * Returns:
+ * - 1 if the key pair was stored.
+ * - 0 if the ring is full.
+ */
+static int KeyPoolPush(EccPemKeyPool* pool, EVP_PKEY* pkey) {
+  size_t pos = atomic_load_explicit(&pool->enqueue_pos, memory_order_relaxed);
+  KeyPoolCell* cell = NULL;
+  for (;;) {
+    cell = &pool->cells[pos & pool->mask];
+    const size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&pool->enqueue_pos, &pos, pos + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return 0;
+    } else {
+      pos = atomic_load_explicit(&pool->enqueue_pos, memory_order_relaxed);
+    }
+  }
+
+  cell->pkey = pkey;
+  /* Counted before the key pair is published, so the pop that takes it always
+   * decrements after this and depth never wraps below 0 */
+  atomic_fetch_add_explicit(&pool->depth, 1, memory_order_relaxed);
+  atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+  return 1;
+}
+
+
+
+/*
+ * Function removes the oldest key pair from the ring.
+ *
+ * Returns:
+ * - The key pair.
+ * - NULL if the ring is empty.
+ */
+static EVP_PKEY* KeyPoolPop(EccPemKeyPool* pool) {
+  size_t pos = atomic_load_explicit(&pool->dequeue_pos, memory_order_relaxed);
+  KeyPoolCell* cell = NULL;
+  for (;;) {
+    cell = &pool->cells[pos & pool->mask];
+    const size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    const intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&pool->dequeue_pos, &pos, pos + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return NULL;
+    } else {
+      pos = atomic_load_explicit(&pool->dequeue_pos, memory_order_relaxed);
+    }
+  }
+
+  EVP_PKEY* pkey = cell->pkey;
+  cell->pkey = NULL;
+  atomic_store_explicit(&cell->sequence, pos + pool->mask + 1, memory_order_release);
+  atomic_fetch_sub_explicit(&pool->depth, 1, memory_order_relaxed);
+  return pkey;
+}
+
+
+
+/*
+ * Function generates key pairs until the ring holds capacity of them or the pool
+ * is stopping.
+ *
+ * Returns:
+ * - 1 if the ring was filled.
+ * - 0 if generating a key pair failed.
+ */
+static int FillKeyPool(EccPemKeyPool* pool) {
+  while (atomic_load_explicit(&pool->depth, memory_order_relaxed) <= pool->mask &&
+         !atomic_load_explicit(&pool->stopping, memory_order_relaxed)) {
+    EVP_PKEY* pkey = NULL;
+    if (EccPemKeygen(pool->ctx, &pkey) <= 0) {
+      EccPemReportError(ECCPEM_ERROR_KEYGEN_FAILED, "Generating EC key pair failed.");
+      return 0;
+    }
+    if (!KeyPoolPush(pool, pkey)) {
+      EVP_PKEY_free(pkey);
+      return 1;
+    }
+    atomic_fetch_add_explicit(&pool->num_generated, 1, memory_order_relaxed);
+  }
+  return 1;
+}
+
+
+
+/* Start routine of the refill thread. */
+static void* KeyPoolRefillMain(void* arg) {
+  EccPemKeyPool* pool = (EccPemKeyPool*)arg;
+  pthread_mutex_lock(&pool->mutex);
+  for (;;) {
+    while (!atomic_load(&pool->refill_requested) && !atomic_load(&pool->stopping)) {
+      pthread_cond_wait(&pool->cond, &pool->mutex);
+    }
+    if (atomic_load(&pool->stopping)) {
+      break;
+    }
+    atomic_store(&pool->refill_requested, 0);
+    pthread_mutex_unlock(&pool->mutex);
+    FillKeyPool(pool);
+    pthread_mutex_lock(&pool->mutex);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  return NULL;
+}
+
+
+
+/*
+ * Function takes a key pair from the pool, wakes the refill thread if the pool
+ * dropped to its low watermark, and generates the key pair on the calling thread
+ * if the pool is empty.
+ *
+ * Returns:
+ * - The key pair, which must be freed with EVP_PKEY_free.
+ * - NULL if the pool was empty and generating a key pair failed.
+ */
+static EVP_PKEY* TakeKeyPair(EccPemKeyPool* pool) {
+  EVP_PKEY* pkey = KeyPoolPop(pool);
+  const size_t depth = atomic_load_explicit(&pool->depth, memory_order_relaxed);
+  atomic_fetch_add_explicit(&pool->num_taken, 1, memory_order_relaxed);
+
+  size_t min_depth = atomic_load_explicit(&pool->min_depth, memory_order_relaxed);
+  while (depth < min_depth &&
+         !atomic_compare_exchange_weak_explicit(&pool->min_depth, &min_depth, depth,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+  }
+
+  /* Only the first take below the watermark signals, the rest see the flag */
+  if (depth <= pool->low_watermark && !atomic_exchange(&pool->refill_requested, 1)) {
+    pthread_mutex_lock(&pool->mutex);
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+  }
+
+  if (pkey == NULL) {
+    atomic_fetch_add_explicit(&pool->num_stalls, 1, memory_order_relaxed);
+    EVP_PKEY_CTX* ctx = CreateKeygenContext(pool->curve);
+    if (ctx == NULL) {
+      return NULL;
+    }
+    if (EccPemKeygen(ctx, &pkey) <= 0) {
+      EccPemReportError(ECCPEM_ERROR_KEYGEN_FAILED, "Generating EC key pair failed.");
+      pkey = NULL;
+    }
+    EVP_PKEY_CTX_free(ctx);
+  }
+  return pkey;
+}
+
+
+
+EccPemKeyPool* EccPemKeyPoolCreate(const EccPemCurve* curve,
+                                   const size_t capacity,
+                                   const size_t low_watermark) {
+  if (curve == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Curve handle cannot be NULL.");
+    return NULL;
+  }
+
+  if (capacity == 0 || low_watermark >= capacity) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Key pool low watermark must be less than its capacity.");
+    return NULL;
+  }
+
+  size_t num_cells = 1;
+  while (num_cells < capacity) {
+    num_cells <<= 1;
+  }
+
+  /* The size of the structure is a multiple of its cache line alignment */
+  EccPemKeyPool* pool = aligned_alloc(ECCPEM_CACHE_LINE_SIZE, sizeof(EccPemKeyPool));
+  KeyPoolCell* cells = malloc(num_cells * sizeof(KeyPoolCell));
+  if (pool == NULL || cells == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating the key pool failed.");
+    free(pool);
+    free(cells);
+    return NULL;
+  }
+  memset(pool, 0, sizeof(*pool));
+  for (size_t i = 0; i < num_cells; ++i) {
+    atomic_init(&cells[i].sequence, i);
+    cells[i].pkey = NULL;
+  }
+  atomic_init(&pool->enqueue_pos, 0);
+  atomic_init(&pool->dequeue_pos, 0);
+  atomic_init(&pool->depth, 0);
+  atomic_init(&pool->min_depth, num_cells);
+  atomic_init(&pool->num_taken, 0);
+  atomic_init(&pool->num_stalls, 0);
+  atomic_init(&pool->num_generated, 0);
+  atomic_init(&pool->refill_requested, 0);
+  pool->cells = cells;
+  pool->mask = num_cells - 1;
+  pool->low_watermark = low_watermark;
+  pool->curve = curve;
+  pool->has_refill_thread = 0;
+  atomic_init(&pool->stopping, 0);
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->cond, NULL);
+
+  /* Fill the pool before the refill thread takes over the context */
+  pool->ctx = CreateKeygenContext(curve);
+  if (pool->ctx == NULL || !FillKeyPool(pool)) {
+    EccPemKeyPoolFree(pool);
+    return NULL;
+  }
+
+  if (pthread_create(&pool->refill_thread, NULL, KeyPoolRefillMain, pool) != 0) {
+    EccPemReportError(ECCPEM_ERROR_THREAD_FAILED, "Creating key pool refill thread failed.");
+    EccPemKeyPoolFree(pool);
+    return NULL;
+  }
+  pool->has_refill_thread = 1;
+  return pool;
+}
+
+
+
+void EccPemKeyPoolFree(EccPemKeyPool* pool) {
+  if (pool == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->mutex);
+  atomic_store(&pool->stopping, 1);
+  pthread_cond_signal(&pool->cond);
+  pthread_mutex_unlock(&pool->mutex);
+  if (pool->has_refill_thread) {
+    pthread_join(pool->refill_thread, NULL);
+  }
+
+  EVP_PKEY* pkey = NULL;
+  while ((pkey = KeyPoolPop(pool)) != NULL) {
+    EVP_PKEY_free(pkey);
+  }
+  EVP_PKEY_CTX_free(pool->ctx);
+  pthread_mutex_destroy(&pool->mutex);
+  pthread_cond_destroy(&pool->cond);
+  free(pool->cells);
+  free(pool);
+}
+
+
+
+int EccPemKeyPoolTakePemFiles(EccPemKeyPool* pool,
+                              const char* pubkey_file,
+                              const char* privkey_file) {
+  if (pool == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Key pool cannot be NULL.");
+    return 0;
+  }
+
+  /* Verify both key files have .pem extension */
+  if (!VerifyPemFileFormat(pubkey_file) || !VerifyPemFileFormat(privkey_file)) {
+    return 0;
+  }
+
+  EVP_PKEY* pkey = TakeKeyPair(pool);
+  if (pkey == NULL) {
+    return 0;
+  }
+
+  /* A single key pair fits in buffers on the stack, no arena is needed */
+  char pubkey_pem[ECCPEM_MAX_KEY_PEM_SIZE];
+  char privkey_pem[ECCPEM_MAX_KEY_PEM_SIZE];
+  size_t pubkey_pem_len = 0;
+  size_t privkey_pem_len = 0;
+  int ret_value = EncodeKeysToPemBuffers(pool->curve, pkey, pubkey_pem, sizeof(pubkey_pem),
+                                         &pubkey_pem_len, privkey_pem, sizeof(privkey_pem),
+                                         &privkey_pem_len);
+  EVP_PKEY_free(pkey);
+  if (ret_value) {
+    ret_value = EccPemWriteFile(privkey_file, privkey_pem, privkey_pem_len) &&
+                EccPemWriteFile(pubkey_file, pubkey_pem, pubkey_pem_len);
+  }
+  OPENSSL_cleanse(privkey_pem, sizeof(privkey_pem));
+  if (!ret_value) {
+    EccPemReportError(ECCPEM_ERROR_WRITE_FAILED,
+                      "Writing private and public keys in PEM format files failed.");
+  }
+  return ret_value;
+}
+
+
+
+int EccPemKeyPoolTakePemBuffers(EccPemKeyPool* pool,
+                                char pubkey_pem[],
+                                const size_t pubkey_pem_size,
+                                size_t* pubkey_pem_len,
+                                char privkey_pem[],
+                                const size_t privkey_pem_size,
+                                size_t* privkey_pem_len) {
+  if (pool == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Key pool cannot be NULL.");
+    return 0;
+  }
+
+  if (pubkey_pem == NULL || pubkey_pem_len == NULL ||
+      privkey_pem == NULL || privkey_pem_len == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "PEM output buffers and lengths cannot be NULL.");
+    return 0;
+  }
+
+  EVP_PKEY* pkey = TakeKeyPair(pool);
+  if (pkey == NULL) {
+    return 0;
+  }
+
+  const int ret_value = EncodeKeysToPemBuffers(pool->curve, pkey, pubkey_pem,
+                                               pubkey_pem_size, pubkey_pem_len, privkey_pem,
+                                               privkey_pem_size, privkey_pem_len);
+  EVP_PKEY_free(pkey);
+  return ret_value;
+}
+
+
+
+void EccPemKeyPoolGetStats(const EccPemKeyPool* pool, EccPemKeyPoolStats* stats) {
+  if (pool == NULL || stats == NULL) {
+    return;
+  }
+  stats->capacity = pool->mask + 1;
+  stats->low_watermark = pool->low_watermark;
+  stats->depth = atomic_load(&pool->depth);
+  stats->min_depth = atomic_load(&pool->min_depth);
+  stats->num_taken = atomic_load(&pool->num_taken);
+  stats->num_stalls = atomic_load(&pool->num_stalls);
+  stats->num_generated = atomic_load(&pool->num_generated);
+}
@@ -16,14 +16,491 @@
 
 #include <openssl/bio.h>
 #include <openssl/core_names.h>
+#include <openssl/crypto.h>
 #include <openssl/ec.h>
+#include <openssl/err.h>
+#include <openssl/objects.h>
 #include <openssl/param_build.h>
 #include <openssl/pem.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "eccpem_internal.h"
 #include "utils.h"
 
+/* Largest DER encoded key decoded by the fast path. EC keys are far smaller,
+ * anything bigger takes the OpenSSL path. */
+#define PEM_FAST_PATH_MAX_DER_SIZE 4096
+
+/* Largest PEM file read into memory for the fast path. */
+#define PEM_FAST_PATH_MAX_FILE_SIZE 16384
+
+
+/*
+ * Function extracts the private key of an EVP_PKEY structure and stores it in a
+ * given array as binary data. The EVP_PKEY structure is not freed. The scalar is
+ * read straight from the provider key, no legacy EC_KEY copy is made.
+ *
+ * Arguments:
+ * - pkey: EVP_PKEY structure containing the EC private key.
+ * - private_key: An array where the private key will be stored.
+ * - key_size: Size of array.
+ *
+ * Returns:
+ * - 1 if storing the private key to array was successful.
+ * - 0 if it fails to get the private key as bignum, or fails to convert bignum
+ *     to binary.
+ */
+int ExtractPrivateKey(EVP_PKEY* pkey, uint8_t private_key[],
+                      const unsigned int key_size) {
+  /* Get private key as BIGNUM */
+  ECCPEM_STAGE_BEGIN(conversion_timer);
+  BIGNUM* priv_bn = NULL;
+  if (!EVP_PKEY_get_bn_param(pkey, OSSL_PKEY_PARAM_PRIV_KEY, &priv_bn)) {
+    ECCPEM_STAGE_END(ECCPEM_STAGE_EC_CONVERSION, conversion_timer);
+    EccPemReportError(ECCPEM_ERROR_KEY_CONVERSION_FAILED, "Failed to get private key as BIGNUM.");
+    return 0;
+  }
+
+  /* Convert BIGNUM to binary */
+  const int ret_value = BN_bn2binpad(priv_bn, private_key, (int)key_size) >= 0;
+  BN_clear_free(priv_bn);
+  ECCPEM_STAGE_END(ECCPEM_STAGE_EC_CONVERSION, conversion_timer);
+  if (!ret_value) {
+    EccPemReportError(ECCPEM_ERROR_KEY_CONVERSION_FAILED,
+                      "Failed to convert private key to binary format.");
+    return 0;
+  }
+  return 1;
+}
+
+
+
+/*
+ * Function extracts the public key of an EVP_PKEY structure and stores it in a
+ * given array as compressed binary data. The EVP_PKEY structure is not freed.
+ *
+ * Arguments:
+ * - pkey: EVP_PKEY structure containing the EC public key.
+ * - public_key: Output buffer to store the compressed public key binary data.
+ * - compressed_key_size: Size of output buffer.
+ *
+ * Returns:
+ * - 1 if storing the compressed public key to array was successful.
+ * - 0 if it fails to get the public key point, or the compressed public key
+ *     does not have exactly compressed_key_size bytes.
+ */
+int ExtractCompressedPublicKey(EVP_PKEY* pkey, uint8_t public_key[],
+                               const unsigned int compressed_key_size) {
+  ECCPEM_STAGE_BEGIN(encode_timer);
+  size_t len = 0;
+  int ret_value = EncodeEcPublicKey(pkey, POINT_CONVERSION_COMPRESSED, NULL, 0, &len);
+  if (ret_value && len != compressed_key_size) {
+    EccPemReportErrorf(ECCPEM_ERROR_KEY_SIZE_MISMATCH,
+                       "Invalid compressed key size. The curve of the key needs %zu bytes", len);
+    ret_value = 0;
+  } else if (ret_value && !EncodeEcPublicKey(pkey, POINT_CONVERSION_COMPRESSED, public_key,
+                                             compressed_key_size, &len)) {
+    EccPemReportError(ECCPEM_ERROR_KEY_CONVERSION_FAILED,
+                      "Failed to convert public key to compressed form");
+    ret_value = 0;
+  }
+  ECCPEM_STAGE_END(ECCPEM_STAGE_POINT_ENCODE, encode_timer);
+  return ret_value;
+}
+
+
+
+/*
+ * Function returns the NID of the elliptic curve of an EC key.
+ *
+ * Arguments:
+ * - pkey: EVP_PKEY structure containing an EC key.
+ *
+ * Returns:
+ * - NID of the curve.
+ * - NID_undef if the key is not an EC key on a named curve.
+ */
+int GetEcKeyCurveNid(const EVP_PKEY* pkey) {
+  char curve_name[64];
+  if (!EVP_PKEY_get_utf8_string_param(pkey, OSSL_PKEY_PARAM_GROUP_NAME, curve_name,
+                                      sizeof(curve_name), NULL)) {
+    return NID_undef;
+  }
+  return OBJ_txt2nid(curve_name);
+}
+
+
+
+/*
+ * Function returns the point conversion form of an encoded EC point from its
+ * first byte, or 0 if the byte is not a valid prefix.
+ */
+static point_conversion_form_t GetEncodedPointForm(const uint8_t prefix) {
+  switch (prefix) {
+    case 0x02:
+    case 0x03:
+      return POINT_CONVERSION_COMPRESSED;
+    case 0x04:
+      return POINT_CONVERSION_UNCOMPRESSED;
+    case 0x06:
+    case 0x07:
+      return POINT_CONVERSION_HYBRID;
+    default:
+      return (point_conversion_form_t)0;
+  }
+}
+
+static const char* GetPointFormName(const point_conversion_form_t form) {
+  switch (form) {
+    case POINT_CONVERSION_COMPRESSED:
+      return OSSL_PKEY_EC_POINT_CONVERSION_FORMAT_COMPRESSED;
+    case POINT_CONVERSION_HYBRID:
+      return OSSL_PKEY_EC_POINT_CONVERSION_FORMAT_HYBRID;
+    default:
+      return OSSL_PKEY_EC_POINT_CONVERSION_FORMAT_UNCOMPRESSED;
+  }
+}
+
+
+
+/*
+ * Function encodes the public key of an EC key as an octet string in the given
+ * point conversion form. If out is NULL, only the length of the encoding is
+ * computed.
+ *
+ * The encoded point is read from the provider key with
+ * EVP_PKEY_get_octet_string_param, in the form the key currently has. A point
+ * on a prime curve is compressed in place from its X and Y coordinates; any
+ * other conversion switches OSSL_PKEY_PARAM_EC_POINT_CONVERSION_FORMAT of the
+ * key for the duration of the call. No legacy EC_KEY copy is made.
+ *
+ * Arguments:
+ * - pkey: EVP_PKEY structure containing the EC public key.
+ * - form: POINT_CONVERSION_COMPRESSED or POINT_CONVERSION_UNCOMPRESSED.
+ * - out: Output buffer for the encoded point, or NULL.
+ * - out_size: Size of output buffer.
+ * - out_len: Where the length of the encoded point will be stored.
+ *
+ * Returns:
+ * - 1 on success.
+ * - 0 if the key is not an EC key or the buffer is too small.
+ */
+int EncodeEcPublicKey(EVP_PKEY* pkey, const point_conversion_form_t form,
+                      uint8_t out[], const size_t out_size, size_t* out_len) {
+  uint8_t point[ECCPEM_MAX_PUBLIC_KEY_SIZE];
+  size_t point_len = 0;
+  if (!EVP_PKEY_get_octet_string_param(pkey, OSSL_PKEY_PARAM_ENCODED_PUBLIC_KEY, point,
+                                       sizeof(point), &point_len) || point_len < 2) {
+    EccPemReportError(ECCPEM_ERROR_KEY_CONVERSION_FAILED, "Failed to get public key point");
+    return 0;
+  }
+
+  const point_conversion_form_t current_form = GetEncodedPointForm(point[0]);
+  char field_type[32];
+  if (current_form != form && form == POINT_CONVERSION_COMPRESSED &&
+      current_form != POINT_CONVERSION_COMPRESSED && current_form != 0 &&
+      EVP_PKEY_get_utf8_string_param(pkey, OSSL_PKEY_PARAM_EC_FIELD_TYPE, field_type,
+                                     sizeof(field_type), NULL) &&
+      strcmp(field_type, SN_X9_62_prime_field) == 0) {
+    /* On a prime curve the compressed point is the X coordinate prefixed with
+     * the parity of Y */
+    const size_t coordinate_len = (point_len - 1) / 2;
+    point[0] = (uint8_t)(0x02 | (point[point_len - 1] & 1));
+    point_len = 1 + coordinate_len;
+  } else if (current_form != form) {
+    char saved_form[32];
+    if (!EVP_PKEY_get_utf8_string_param(pkey, OSSL_PKEY_PARAM_EC_POINT_CONVERSION_FORMAT,
+                                        saved_form, sizeof(saved_form), NULL) ||
+        !EVP_PKEY_set_utf8_string_param(pkey, OSSL_PKEY_PARAM_EC_POINT_CONVERSION_FORMAT,
+                                        GetPointFormName(form))) {
+      EccPemReportError(ECCPEM_ERROR_ENCODE_FAILED, "Failed to encode public key");
+      return 0;
+    }
+    const int encoded = EVP_PKEY_get_octet_string_param(
+        pkey, OSSL_PKEY_PARAM_ENCODED_PUBLIC_KEY, point, sizeof(point), &point_len);
+    EVP_PKEY_set_utf8_string_param(pkey, OSSL_PKEY_PARAM_EC_POINT_CONVERSION_FORMAT,
+                                   saved_form);
+    if (!encoded) {
+      EccPemReportError(ECCPEM_ERROR_ENCODE_FAILED, "Failed to encode public key");
+      return 0;
+    }
+  }
+
+  *out_len = point_len;
+  if (out != NULL) {
+    if (out_size < point_len) {
+      EccPemReportError(ECCPEM_ERROR_ENCODE_FAILED, "Failed to encode public key");
+      return 0;
+    }
+    memcpy(out, point, point_len);
+  }
+  return 1;
+}
+
+
+
+/*
+ * Function decodes the first PEM block of a memory region into a key without
+ * going through the OpenSSL PEM reader: the block is located in place, its body
+ * is decoded by the vectorized base64 decoder, and the DER is handed to d2i.
+ * Only unencrypted EC keys are taken, anything else (another label, RFC 1421
+ * headers, an unusual encoding) returns NULL and leaves the OpenSSL error queue
+ * untouched, so the caller can fall back to the PEM_read functions.
+ *
+ * Arguments:
+ * - pem: Memory region holding the PEM formatted key.
+ * - pem_len: Length of the region.
+ * - private_key: 1 to decode a private key, 0 to decode a public key.
+ *
+ * Returns:
+ * - Pointer to the EVP_PKEY structure on success.
+ * - NULL if the fast path does not apply.
+ */
+static EVP_PKEY* DecodePemKeyFast(const char* pem, const size_t pem_len,
+                                  const int private_key) {
+  EccPemBlock block;
+  if (!EccPemFindBlock(pem, pem_len, 0, &block) || !block.complete ||
+      block.body_len > PEM_FAST_PATH_MAX_DER_SIZE / 3 * 4) {
+    return NULL;
+  }
+
+  /* Private keys are PKCS#8 or traditional "EC PRIVATE KEY" blocks */
+  const int is_traditional = private_key &&
+                             EccPemBlockHasLabel(&block, PEM_STRING_ECPRIVATEKEY);
+  if (private_key) {
+    if (!is_traditional && !EccPemBlockHasLabel(&block, PEM_STRING_PKCS8INF)) {
+      return NULL;
+    }
+  } else if (!EccPemBlockHasLabel(&block, PEM_STRING_PUBLIC)) {
+    return NULL;
+  }
+
+  uint8_t der[PEM_FAST_PATH_MAX_DER_SIZE];
+  size_t der_len = 0;
+  if (!EccPemBase64DecodeBody(block.body, block.body_len, der, sizeof(der), &der_len)) {
+    return NULL;
+  }
+
+  ERR_set_mark();
+  const unsigned char* der_ptr = der;
+  EVP_PKEY* pkey = NULL;
+  if (!private_key) {
+    pkey = d2i_PUBKEY(NULL, &der_ptr, (long)der_len);
+  } else if (is_traditional) {
+    pkey = d2i_PrivateKey(EVP_PKEY_EC, NULL, &der_ptr, (long)der_len);
+  } else {
+    pkey = d2i_AutoPrivateKey(NULL, &der_ptr, (long)der_len);
+  }
+  ERR_pop_to_mark();
+
+  if (private_key) {
+    OPENSSL_cleanse(der, der_len);
+  }
+  if (pkey != NULL && EVP_PKEY_get_base_id(pkey) != EVP_PKEY_EC) {
+    EVP_PKEY_free(pkey);
+    return NULL;
+  }
+  return pkey;
+}
+
+
+
+/*
+ * Function reads a small PEM file into memory and decodes it with
+ * DecodePemKeyFast. The file position is left at the start of the file.
+ *
+ * Arguments:
+ * - pem_file: Open PEM file.
+ * - private_key: 1 to decode a private key, 0 to decode a public key.
+ *
+ * Returns:
+ * - Pointer to the EVP_PKEY structure on success.
+ * - NULL if the file is too large or the fast path does not apply.
+ */
+static EVP_PKEY* LoadPemKeyFileFast(FILE* pem_file, const int private_key) {
+  char pem[PEM_FAST_PATH_MAX_FILE_SIZE];
+  ECCPEM_STAGE_BEGIN(read_timer);
+  const size_t pem_len = fread(pem, 1, sizeof(pem), pem_file);
+  ECCPEM_STAGE_END(ECCPEM_STAGE_OPEN, read_timer);
+  EVP_PKEY* pkey = NULL;
+  if (pem_len < sizeof(pem)) {
+    ECCPEM_STAGE_BEGIN(decode_timer);
+    pkey = DecodePemKeyFast(pem, pem_len, private_key);
+    ECCPEM_STAGE_END(ECCPEM_STAGE_PEM_DECODE, decode_timer);
+  }
+  if (private_key) {
+    OPENSSL_cleanse(pem, pem_len);
+  }
+  rewind(pem_file);
+  return pkey;
+}
+
+
+
+/*
+ * Function opens a private key's PEM file and parses it into an EVP_PKEY
+ * structure, which must be freed with EVP_PKEY_free.
+ *
+ * Arguments:
+ * - privkey_file: PEM formatted file containing the private key.
+ *
+ * Returns:
+ * - Pointer to the EVP_PKEY structure on success.
+ * - NULL if it cannot open or read the provided PEM file.
+ */
+EVP_PKEY* LoadPrivateKeyPemFile(const char* privkey_file) {
+  /* Open and read the PEM file */
+  ECCPEM_STAGE_BEGIN(open_timer);
+  FILE* pem_file = fopen(privkey_file, "r");
+  ECCPEM_STAGE_END(ECCPEM_STAGE_OPEN, open_timer);
+  if (pem_file == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED,
+                      "Unable to open private key's pem file or it does not exist.");
+    return NULL;
+  }
+
+  EVP_PKEY* pkey = LoadPemKeyFileFast(pem_file, 1);
+  if (pkey == NULL) {
+    /* The OpenSSL reader reads and decodes the file in one pass */
+    ECCPEM_STAGE_BEGIN(decode_timer);
+    pkey = PEM_read_PrivateKey(pem_file, NULL, NULL, NULL);
+    ECCPEM_STAGE_END(ECCPEM_STAGE_PEM_DECODE, decode_timer);
+  }
+  fclose(pem_file);
+
+  if (pkey == NULL) {
+    EccPemReportError(ECCPEM_ERROR_DECODE_FAILED, "Failed to read private key from PEM file.");
+    return NULL;
+  }
+  return pkey;
+}
+
+
+
+/*
+ * Function opens a public key's PEM file and parses it into an EVP_PKEY
+ * structure, which must be freed with EVP_PKEY_free.
+ *
+ * Arguments:
+ * - pubkey_file: PEM formatted file containing the public key.
+ *
+ * Returns:
+ * - Pointer to the EVP_PKEY structure on success.
+ * - NULL if it cannot open or read the provided PEM file.
+ */
+EVP_PKEY* LoadPublicKeyPemFile(const char* pubkey_file) {
+  /* Open and read the PEM file */
+  ECCPEM_STAGE_BEGIN(open_timer);
+  FILE* pem_file = fopen(pubkey_file, "r");
+  ECCPEM_STAGE_END(ECCPEM_STAGE_OPEN, open_timer);
+  if (pem_file == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Failed to open public key PEM file");
+    return NULL;
+  }
+
+  EVP_PKEY* pkey = LoadPemKeyFileFast(pem_file, 0);
+  if (pkey == NULL) {
+    /* The OpenSSL reader reads and decodes the file in one pass */
+    ECCPEM_STAGE_BEGIN(decode_timer);
+    pkey = PEM_read_PUBKEY(pem_file, NULL, NULL, NULL);
+    ECCPEM_STAGE_END(ECCPEM_STAGE_PEM_DECODE, decode_timer);
+  }
+  fclose(pem_file);
+
+  if (pkey == NULL) {
+    EccPemReportError(ECCPEM_ERROR_DECODE_FAILED, "Failed to read public key from PEM file");
+    return NULL;
+  }
+  return pkey;
+}
+
+
+
+/*
+ * Function parses a private key's PEM data into an EVP_PKEY structure, which
+ * must be freed with EVP_PKEY_free. The data is decoded in place, or read
+ * through a read-only memory BIO if it is not a plain private key block.
+ *
+ * Arguments:
+ * - privkey_pem: Buffer containing the PEM formatted private key.
+ * - privkey_pem_len: Length of the PEM data, at most INT_MAX bytes.
+ *
+ * Returns:
+ * - Pointer to the EVP_PKEY structure on success.
+ * - NULL if the PEM data cannot be parsed.
+ */
+EVP_PKEY* LoadPrivateKeyPemBuffer(const char* privkey_pem, const size_t privkey_pem_len) {
+  ECCPEM_STAGE_BEGIN(decode_timer);
+  EVP_PKEY* pkey = DecodePemKeyFast(privkey_pem, privkey_pem_len, 1);
+  ECCPEM_STAGE_END(ECCPEM_STAGE_PEM_DECODE, decode_timer);
+  if (pkey == NULL) {
+    /* Wrap the buffer in a read-only memory BIO and parse it */
+    BIO* bio = BIO_new_mem_buf(privkey_pem, (int)privkey_pem_len);
+    if (bio == NULL) {
+      EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Failed to create memory BIO for private key.");
+      return NULL;
+    }
+
+    ECCPEM_STAGE_BEGIN(bio_decode_timer);
+
+    pkey = PEM_read_bio_PrivateKey(bio, NULL, NULL, NULL);
+
+    ECCPEM_STAGE_END(ECCPEM_STAGE_PEM_DECODE, bio_decode_timer);
+    BIO_free(bio);
+  }
+
+  if (pkey == NULL) {
+    EccPemReportError(ECCPEM_ERROR_DECODE_FAILED, "Failed to read private key from PEM buffer.");
+    return NULL;
+  }
+  return pkey;
+}
+
+
+
+/*
+ * Function parses a public key's PEM data into an EVP_PKEY structure, which
+ * must be freed with EVP_PKEY_free, like LoadPrivateKeyPemBuffer.
+ *
+ * Arguments:
+ * - pubkey_pem: Buffer containing the PEM formatted public key.
+ * - pubkey_pem_len: Length of the PEM data, at most INT_MAX bytes.
+ *
+ * Returns:
+ * - Pointer to the EVP_PKEY structure on success.
+ * - NULL if the PEM data cannot be parsed.
+ */
+EVP_PKEY* LoadPublicKeyPemBuffer(const char* pubkey_pem, const size_t pubkey_pem_len) {
+  ECCPEM_STAGE_BEGIN(decode_timer);
+  EVP_PKEY* pkey = DecodePemKeyFast(pubkey_pem, pubkey_pem_len, 0);
+  ECCPEM_STAGE_END(ECCPEM_STAGE_PEM_DECODE, decode_timer);
+  if (pkey == NULL) {
+    /* Wrap the buffer in a read-only memory BIO and parse it */
+    BIO* bio = BIO_new_mem_buf(pubkey_pem, (int)pubkey_pem_len);
+    if (bio == NULL) {
+      EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Failed to create memory BIO for public key");
+      return NULL;
+    }
+
+    ECCPEM_STAGE_BEGIN(bio_decode_timer);
+
+    pkey = PEM_read_bio_PUBKEY(bio, NULL, NULL, NULL);
+
+    ECCPEM_STAGE_END(ECCPEM_STAGE_PEM_DECODE, bio_decode_timer);
+    BIO_free(bio);
+  }
+
+  if (pkey == NULL) {
+    EccPemReportError(ECCPEM_ERROR_DECODE_FAILED, "Failed to read public key from PEM buffer");
+    return NULL;
+  }
+  return pkey;
+}
+
+
+
 /*
  * Function reads private key's PEM file and stores it in a given array as
  * binary data.
@@ -38,7 +515,7 @@
  * Returns:
  * - 1 if reading PEM file and storing data to array was successful.
  * - 0 if it cannot open the provided PEM file, cannot read the provided PEM
- * file, fails to convert EVP_PKEY to EC_KEY, or fails to convert bignum to
+ * file, fails to get the EC private key, or fails to convert bignum to
  * binary.
  */
 int ReadPrivateKeyPemFile(const char* privkey_file, uint8_t private_key[],
@@ -49,58 +526,74 @@ int ReadPrivateKeyPemFile(const char* privkey_file, uint8_t private_key[],
   }
 
   if (private_key == NULL) {
-    fprintf(stderr, "Private key's array cannot be null.\n");
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Private key's array cannot be null.");
     return 0;
   }
 
   if (key_size == 0) {
-    fprintf(stderr, "Private key's array size cannot be null. Check it using openssl ecparam -list_curves command.\n");
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Private key's array size cannot be null. Check it using openssl ecparam -list_curves command.");
     return 0;
   }
 
-  /* Open and read the PEM file */
-  FILE* pem_file = fopen(privkey_file, "r");
-  if (pem_file == NULL) {
-    fprintf(stderr, "Unable to open private key's pem file or it does not exist.\n");
+  EVP_PKEY* pkey = LoadPrivateKeyPemFile(privkey_file);
+  if (pkey == NULL) {
     return 0;
   }
 
-  EVP_PKEY* pkey = PEM_read_PrivateKey(pem_file, NULL, NULL, NULL);
-  fclose(pem_file);
+  const int ret_value = ExtractPrivateKey(pkey, private_key, key_size);
+  EVP_PKEY_free(pkey);
+  return ret_value;
+}
 
-  if (pkey == NULL) {
-    fprintf(stderr, "Failed to read private key from PEM file.\n");
+
+
+/*
+ * Function reads a PEM formatted private key from a memory buffer and stores it
+ * in a given array as binary data. No file is opened; unencrypted EC keys are
+ * decoded in place, anything else is read through a read-only memory BIO.
+ *
+ * Arguments:
+ * - privkey_pem: Buffer containing the PEM formatted private key. It does not
+ *                need to be null-terminated.
+ * - privkey_pem_len: Length of the PEM data in bytes.
+ * - private_key: An array where the private key will be stored.
+ * - key_size: Size of array. Run `$ openssl ecparam -list_curves` command to
+ * see the binary size of the specific cryptographic algorithm.
+ *
+ * Returns:
+ * - 1 if reading PEM data and storing it to array was successful.
+ * - 0 if the buffer is invalid, cannot be parsed as a PEM private key, fails to
+ * get the EC private key, or fails to convert bignum to binary.
+ */
+int ReadPrivateKeyPemBuffer(const char* privkey_pem, const size_t privkey_pem_len,
+                            uint8_t private_key[], const unsigned int key_size) {
+  /* Validate input parameters */
+  if (privkey_pem == NULL || privkey_pem_len == 0 || privkey_pem_len > INT_MAX) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Private key's PEM buffer cannot be null or empty.");
     return 0;
   }
 
-  /* Convert EVP_PKEY to EC_KEY */
-  EC_KEY* ec_key = EVP_PKEY_get1_EC_KEY(pkey);
-  if (ec_key == NULL) {
-    EVP_PKEY_free(pkey);
-    fprintf(stderr, "Failed to convert EVP_PKEY to EC_KEY.\n");
+  if (private_key == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Private key's array cannot be null.");
     return 0;
   }
 
-  /* Get private key as BIGNUM */
-  const BIGNUM* priv_bn = EC_KEY_get0_private_key(ec_key);
-  if (priv_bn == NULL) {
-    EC_KEY_free(ec_key);
-    EVP_PKEY_free(pkey);
-    fprintf(stderr, "Failed to get private key as BIGNUM.\n");
+  if (key_size == 0) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Private key's array size cannot be null. Check it using openssl ecparam -list_curves command.");
     return 0;
   }
 
-  /* Convert BIGNUM to binary */
-  if (BN_bn2binpad(priv_bn, private_key, key_size) < 0) {
-    EC_KEY_free(ec_key);
-    EVP_PKEY_free(pkey);
-    fprintf(stderr, "Failed to convert private key to binary format.\n");
+  EVP_PKEY* pkey = LoadPrivateKeyPemBuffer(privkey_pem, privkey_pem_len);
+  if (pkey == NULL) {
     return 0;
   }
 
-  EC_KEY_free(ec_key);
+  const int ret_value = ExtractPrivateKey(pkey, private_key, key_size);
   EVP_PKEY_free(pkey);
-  return 1;
+  return ret_value;
 }
 
 
@@ -111,8 +604,9 @@ int ReadPrivateKeyPemFile(const char* privkey_file, uint8_t private_key[],
  * Arguments:
  * - pubkey_file: PEM formatted file (.pem extension) containing the public key
  * - public_key: Output buffer to store the compressed public key binary data
- * - compressed_key_size: Size of output buffer. For ECDSA compressed public
- * keys, this should be 33 bytes.
+ * - compressed_key_size: Size of output buffer. It must be the compressed key
+ * size of the key's curve, e.g. 33 bytes for prime256v1 and secp256k1, 49 bytes
+ * for secp384r1 and 67 bytes for secp521r1.
  *
  * Returns:
  * - 1 on success: Public key was read and stored successfully
@@ -131,67 +625,337 @@ int ReadPublicKeyPemFile(const char* pubkey_file, uint8_t public_key[],
   }
 
   if (public_key == NULL) {
-    fprintf(stderr, "Public key output buffer cannot be NULL\n");
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Public key output buffer cannot be NULL");
     return 0;
   }
 
-  if (compressed_key_size != 33) {
-    fprintf(stderr, "Invalid compressed key size. Expected 33 bytes for ECDSA compressed public key\n");
+  if (compressed_key_size == 0) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Invalid compressed key size. It must match the curve of the key");
     return 0;
   }
 
-  /* Open and read the PEM file */
-  FILE* pem_file = fopen(pubkey_file, "r");
-  if (pem_file == NULL) {
-    fprintf(stderr, "Failed to open public key PEM file\n");
+  EVP_PKEY* pkey = LoadPublicKeyPemFile(pubkey_file);
+  if (pkey == NULL) {
     return 0;
   }
 
-  EVP_PKEY* pkey = PEM_read_PUBKEY(pem_file, NULL, NULL, NULL);
-  fclose(pem_file);
+  const int ret_value = ExtractCompressedPublicKey(pkey, public_key, compressed_key_size);
+  EVP_PKEY_free(pkey);
+  return ret_value;
+}
+
+
+
+/*
+ * Function reads a PEM formatted public key from a memory buffer and stores it
+ * as compressed binary data. No file is opened; the key is decoded in place, or
+ * read through a read-only memory BIO if it is not a plain public key block.
+ *
+ * Arguments:
+ * - pubkey_pem: Buffer containing the PEM formatted public key. It does not need
+ *               to be null-terminated.
+ * - pubkey_pem_len: Length of the PEM data in bytes.
+ * - public_key: Output buffer to store the compressed public key binary data
+ * - compressed_key_size: Size of output buffer. It must be the compressed key
+ * size of the key's curve, e.g. 33 bytes for prime256v1 and secp256k1, 49 bytes
+ * for secp384r1 and 67 bytes for secp521r1.
+ *
+ * Returns:
+ * - 1 on success: Public key was read and stored successfully
+ * - 0 on failure: Returns 0 if any of the following operations fail:
+ *     - Invalid input parameters
+ *     - Parsing the PEM data
+ *     - Converting key formats
+ *     - Compressing the public key
+ */
+int ReadPublicKeyPemBuffer(const char* pubkey_pem, const size_t pubkey_pem_len,
+                           uint8_t public_key[],
+                           const unsigned int compressed_key_size) {
+  /* Validate input parameters */
+  if (pubkey_pem == NULL || pubkey_pem_len == 0 || pubkey_pem_len > INT_MAX) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Public key PEM buffer cannot be NULL or empty");
+    return 0;
+  }
 
+  if (public_key == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Public key output buffer cannot be NULL");
+    return 0;
+  }
+
+  if (compressed_key_size == 0) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Invalid compressed key size. It must match the curve of the key");
+    return 0;
+  }
+
+  EVP_PKEY* pkey = LoadPublicKeyPemBuffer(pubkey_pem, pubkey_pem_len);
   if (pkey == NULL) {
-    fprintf(stderr, "Failed to read public key from PEM file\n");
     return 0;
   }
 
-  /* Convert EVP_PKEY to EC_KEY */
-  EC_KEY* ec_key = EVP_PKEY_get1_EC_KEY(pkey);
-  if (ec_key == NULL) {
-    EVP_PKEY_free(pkey);
-    fprintf(stderr, "Failed to convert EVP_PKEY to EC_KEY\n");
+  const int ret_value = ExtractCompressedPublicKey(pkey, public_key, compressed_key_size);
+  EVP_PKEY_free(pkey);
+  return ret_value;
+}
+
+
+
+/*
+ * Function stores the encoded public key of a key and its curve NID, or only
+ * their sizes if public_key is NULL.
+ *
+ * Returns:
+ * - 1 on success.
+ * - 0 if the form is invalid, the key is not an EC key, or the buffer is too
+ *     small.
+ */
+static int StoreEncodedPublicKey(EVP_PKEY* pkey, const point_conversion_form_t form,
+                                 uint8_t public_key[], const size_t public_key_size,
+                                 size_t* public_key_len, int* curve_nid) {
+  if (form != POINT_CONVERSION_COMPRESSED && form != POINT_CONVERSION_UNCOMPRESSED) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Invalid point conversion form");
     return 0;
   }
 
-  /* Get public key point */
-  const EC_POINT* pub_point = EC_KEY_get0_public_key(ec_key);
-  if (pub_point == NULL) {
-    EC_KEY_free(ec_key);
-    EVP_PKEY_free(pkey);
-    fprintf(stderr, "Failed to get public key point\n");
+  if (!EncodeEcPublicKey(pkey, form, NULL, 0, public_key_len)) {
     return 0;
   }
+  if (curve_nid != NULL) {
+    *curve_nid = GetEcKeyCurveNid(pkey);
+  }
+  if (public_key == NULL) {
+    return 1;
+  }
 
-  /* Get the curve group */
-  const EC_GROUP* group = EC_KEY_get0_group(ec_key);
-  if (group == NULL) {
-    EC_KEY_free(ec_key);
-    EVP_PKEY_free(pkey);
-    fprintf(stderr, "Failed to get curve group\n");
+  if (public_key_size < *public_key_len) {
+    EccPemReportErrorf(ECCPEM_ERROR_BUFFER_TOO_SMALL,
+                       "Public key output buffer is too small, %zu bytes are required",
+                       *public_key_len);
     return 0;
   }
+  return EncodeEcPublicKey(pkey, form, public_key, public_key_size, public_key_len);
+}
 
-  /* Convert point to compressed form */
-  size_t len = EC_POINT_point2oct(group, pub_point, POINT_CONVERSION_COMPRESSED,
-                                 public_key, compressed_key_size, NULL);
-  if (len != compressed_key_size) {
-    EC_KEY_free(ec_key);
-    EVP_PKEY_free(pkey);
-    fprintf(stderr, "Failed to convert public key to compressed form\n");
+
+
+/*
+ * Function reads public key's PEM file of any curve and stores the encoded
+ * public key in the requested form, along with its actual length and the NID of
+ * the curve. If public_key is NULL, only the length and NID are stored, so the
+ * caller can size the buffer.
+ *
+ * Arguments:
+ * - pubkey_file: PEM formatted file (.pem extension) containing the public key.
+ * - form: POINT_CONVERSION_COMPRESSED or POINT_CONVERSION_UNCOMPRESSED.
+ * - public_key: Output buffer for the encoded public key, or NULL.
+ * - public_key_size: Size of output buffer. ECCPEM_MAX_PUBLIC_KEY_SIZE bytes fit
+ *                    any key.
+ * - public_key_len: Where the length of the encoded public key will be stored.
+ * - curve_nid: Where the OpenSSL NID of the key's curve will be stored. It can
+ *              be NULL.
+ *
+ * Returns:
+ * - 1 if the public key (or, with a NULL buffer, its length) was stored.
+ * - 0 if the file cannot be opened or parsed, the arguments are invalid, the key
+ *     is not an EC key, or the buffer is too small.
+ */
+int ReadPublicKeyPemFileEx(const char* pubkey_file,
+                           const point_conversion_form_t form,
+                           uint8_t public_key[],
+                           const size_t public_key_size,
+                           size_t* public_key_len,
+                           int* curve_nid) {
+  /* Validate input parameters */
+  if (!VerifyPemFileFormat(pubkey_file)) {
     return 0;
   }
 
-  EC_KEY_free(ec_key);
+  if (public_key_len == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Public key length output cannot be NULL");
+    return 0;
+  }
+
+  EVP_PKEY* pkey = LoadPublicKeyPemFile(pubkey_file);
+  if (pkey == NULL) {
+    return 0;
+  }
+
+  ECCPEM_STAGE_BEGIN(encode_timer);
+  const int ret_value = StoreEncodedPublicKey(pkey, form, public_key, public_key_size,
+                                              public_key_len, curve_nid);
+  ECCPEM_STAGE_END(ECCPEM_STAGE_POINT_ENCODE, encode_timer);
   EVP_PKEY_free(pkey);
-  return 1;
+  return ret_value;
+}
+
+
+
+/*
+ * Function is the memory buffer variant of ReadPublicKeyPemFileEx. The buffer
+ * does not need to be null-terminated.
+ */
+int ReadPublicKeyPemBufferEx(const char* pubkey_pem,
+                             const size_t pubkey_pem_len,
+                             const point_conversion_form_t form,
+                             uint8_t public_key[],
+                             const size_t public_key_size,
+                             size_t* public_key_len,
+                             int* curve_nid) {
+  /* Validate input parameters */
+  if (pubkey_pem == NULL || pubkey_pem_len == 0 || pubkey_pem_len > INT_MAX) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Public key PEM buffer cannot be NULL or empty");
+    return 0;
+  }
+
+  if (public_key_len == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Public key length output cannot be NULL");
+    return 0;
+  }
+
+  EVP_PKEY* pkey = LoadPublicKeyPemBuffer(pubkey_pem, pubkey_pem_len);
+  if (pkey == NULL) {
+    return 0;
+  }
+
+  ECCPEM_STAGE_BEGIN(encode_timer);
+  const int ret_value = StoreEncodedPublicKey(pkey, form, public_key, public_key_size,
+                                              public_key_len, curve_nid);
+  ECCPEM_STAGE_END(ECCPEM_STAGE_POINT_ENCODE, encode_timer);
+  EVP_PKEY_free(pkey);
+  return ret_value;
+}
+
+
+
+/*
+ * Function derives the compressed public key of one private key by multiplying
+ * the generator of its curve with the private scalar.
+ *
+ * Returns:
+ * - 1 if the compressed public key was stored.
+ * - 0 if the key is not an EC key or the size does not match its curve.
+ */
+static int DeriveCompressedPublicKey(EVP_PKEY* pkey, BN_CTX* bn_ctx,
+                                     uint8_t public_key[],
+                                     const unsigned int compressed_key_size) {
+  const int curve_nid = GetEcKeyCurveNid(pkey);
+  if (curve_nid == NID_undef) {
+    EccPemReportError(ECCPEM_ERROR_NOT_EC_KEY, "Private key is not an EC key on a named curve.");
+    return 0;
+  }
+
+  /* The group is cached with the curve, so it is not built per key */
+  const EccPemCurve* curve = EccPemGetCurveByNid(curve_nid);
+  if (curve == NULL) {
+    return 0;
+  }
+  const EC_GROUP* group = EccPemCurveGetGroup(curve);
+
+  if (compressed_key_size != EccPemCurveGetCompressedKeySize(curve)) {
+    EccPemReportError(ECCPEM_ERROR_KEY_SIZE_MISMATCH,
+                      "Invalid compressed key size for the key's curve.");
+    return 0;
+  }
+
+  BIGNUM* scalar = NULL;
+  if (!EVP_PKEY_get_bn_param(pkey, OSSL_PKEY_PARAM_PRIV_KEY, &scalar)) {
+    EccPemReportError(ECCPEM_ERROR_KEY_CONVERSION_FAILED,
+                      "Failed to convert EVP_PKEY to private key bignum.");
+    return 0;
+  }
+
+  int ret_value = 0;
+  EC_POINT* point = EC_POINT_new(group);
+  if (point != NULL && EC_POINT_mul(group, point, scalar, NULL, NULL, bn_ctx) &&
+      EC_POINT_point2oct(group, point, POINT_CONVERSION_COMPRESSED, public_key,
+                         compressed_key_size, bn_ctx) == compressed_key_size) {
+    ret_value = 1;
+  } else {
+    EccPemReportError(ECCPEM_ERROR_KEY_CONVERSION_FAILED, "Deriving public key failed.");
+  }
+  EC_POINT_free(point);
+  BN_clear_free(scalar);
+  return ret_value;
+}
+
+
+
+/*
+ * Function reads private keys' PEM files and derives their compressed public
+ * keys. A single BN_CTX is shared by the whole batch, and the EC_GROUP of the
+ * cached curve is reused across batches too.
+ *
+ * Arguments:
+ * - privkey_files: Array of num_keys private key PEM files (extension is .pem).
+ * - num_keys: Number of private keys.
+ * - public_keys: Output array of num_keys * compressed_key_size bytes. The
+ *                compressed public key of privkey_files[i] is stored at offset
+ *                i * compressed_key_size.
+ * - compressed_key_size: Size of one compressed public key. Basically compressed
+ *                        public key size is 33 byte.
+ * - results: Optional array of num_keys entries. Entry i is set to 1 if the
+ *            public key of privkey_files[i] was derived, 0 otherwise. It can be NULL.
+ *
+ * Returns:
+ * - Number of public keys that were derived.
+ */
+size_t DerivePublicKeysFromPemFiles(const char* const privkey_files[],
+                                    const size_t num_keys,
+                                    uint8_t public_keys[],
+                                    const unsigned int compressed_key_size,
+                                    int results[]) {
+  if (results != NULL) {
+    memset(results, 0, num_keys * sizeof(results[0]));
+  }
+
+  /* Validate input parameters */
+  if (privkey_files == NULL || public_keys == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Private key file array and public key output buffer cannot be NULL.");
+    return 0;
+  }
+
+  if (compressed_key_size == 0) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Invalid compressed key size");
+    return 0;
+  }
+
+  BN_CTX* bn_ctx = BN_CTX_new();
+  if (bn_ctx == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating BN_CTX failed.");
+    return 0;
+  }
+
+  size_t num_derived = 0;
+  for (size_t i = 0; i < num_keys; ++i) {
+    if (!VerifyPemFileFormat(privkey_files[i])) {
+      continue;
+    }
+
+    EVP_PKEY* pkey = LoadPrivateKeyPemFile(privkey_files[i]);
+    if (pkey == NULL) {
+      continue;
+    }
+
+    uint8_t* public_key = public_keys + i * compressed_key_size;
+    ECCPEM_STAGE_BEGIN(conversion_timer);
+    const int derived = DeriveCompressedPublicKey(pkey, bn_ctx, public_key,
+                                                  compressed_key_size);
+    ECCPEM_STAGE_END(ECCPEM_STAGE_EC_CONVERSION, conversion_timer);
+    EVP_PKEY_free(pkey);
+    if (!derived) {
+      continue;
+    }
+
+    if (results != NULL) {
+      results[i] = 1;
+    }
+    ++num_derived;
+  }
+
+  BN_CTX_free(bn_ctx);
+  return num_derived;
 }
@@ -0,0 +1,492 @@
+/*
+ * ===--- eccpem_reader.c ---------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides reader contexts. Keys are read into the reader's scratch
+ * buffer and their PEM body is decoded in place. A DER that matches the
+ * template of the reader's curve is taken apart directly: the public point is
+ * checked to lie on the curve and compressed with the reader's BN_CTX, and the
+ * private scalar is checked against the group order. Any other DER is handed to
+ * the reader's OSSL_DECODER_CTX, which is set up once instead of on every call.
+ */
+
+#include "eccpem_reader.h"
+#include "eccpem_internal.h"
+#include "eccpem_read.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <openssl/bio.h>
+#include <openssl/bn.h>
+#include <openssl/crypto.h>
+#include <openssl/decoder.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+
+#include "utils.h"
+
+/* Size of the scratch buffer key files are read into. Larger files are read
+ * with the OpenSSL PEM reader. */
+#define READER_PEM_BUFFER_SIZE 16384
+
+/* Size of the scratch buffer PEM bodies are decoded into. */
+#define READER_DER_BUFFER_SIZE 4096
+
+struct EccPemReader {
+  const EccPemCurve* curve;
+  const EC_GROUP* group;
+  const EccPemDerTemplate* der_template;
+  uint8_t order[ECCPEM_MAX_PUBLIC_KEY_SIZE];
+  BN_CTX* bn_ctx;
+  EC_POINT* point;
+  OSSL_DECODER_CTX* pubkey_decoder;
+  OSSL_DECODER_CTX* privkey_decoder;
+  EVP_PKEY* decoded_key;
+  char pem[READER_PEM_BUFFER_SIZE];
+  uint8_t der[READER_DER_BUFFER_SIZE];
+};
+
+
+
+EccPemReader* EccPemReaderCreate(const EccPemCurve* curve) {
+  if (curve == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Curve of the reader cannot be NULL.");
+    return NULL;
+  }
+
+  EccPemReader* reader = calloc(1, sizeof(EccPemReader));
+  if (reader == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating the reader failed.");
+    return NULL;
+  }
+  reader->curve = curve;
+  reader->group = EccPemCurveGetGroup(curve);
+  reader->der_template = EccPemCurveGetDerTemplate(curve);
+  reader->bn_ctx = BN_CTX_new();
+  reader->point = EC_POINT_new(reader->group);
+
+  /* The decoders write every key they decode to reader->decoded_key */
+  OSSL_LIB_CTX* libctx = EccPemCurveGetLibraryContext(curve);
+  const char* propq = EccPemCurveGetPropertyQuery(curve);
+  reader->pubkey_decoder = OSSL_DECODER_CTX_new_for_pkey(&reader->decoded_key, "DER",
+                                                         "SubjectPublicKeyInfo", "EC",
+                                                         EVP_PKEY_PUBLIC_KEY, libctx, propq);
+  reader->privkey_decoder = OSSL_DECODER_CTX_new_for_pkey(&reader->decoded_key, "DER", NULL,
+                                                          "EC", EVP_PKEY_KEYPAIR, libctx, propq);
+  if (reader->bn_ctx == NULL || reader->point == NULL || reader->pubkey_decoder == NULL ||
+      reader->privkey_decoder == NULL ||
+      OSSL_DECODER_CTX_get_num_decoders(reader->pubkey_decoder) == 0 ||
+      OSSL_DECODER_CTX_get_num_decoders(reader->privkey_decoder) == 0) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Setting up the reader failed.");
+    EccPemReaderFree(reader);
+    return NULL;
+  }
+
+  if (reader->der_template != NULL &&
+      BN_bn2binpad(EC_GROUP_get0_order(reader->group), reader->order,
+                   (int)reader->der_template->scalar_len) < 0) {
+    reader->der_template = NULL;
+  }
+  return reader;
+}
+
+
+
+void EccPemReaderFree(EccPemReader* reader) {
+  if (reader == NULL) {
+    return;
+  }
+  OSSL_DECODER_CTX_free(reader->pubkey_decoder);
+  OSSL_DECODER_CTX_free(reader->privkey_decoder);
+  EC_POINT_free(reader->point);
+  BN_CTX_free(reader->bn_ctx);
+  OPENSSL_cleanse(reader, sizeof(EccPemReader));
+  free(reader);
+}
+
+
+
+/*
+ * Function reads a key file into the scratch buffer of the reader.
+ *
+ * Arguments:
+ * - reader: Reader whose buffer the file is read into.
+ * - key_file: File to read.
+ * - pem_len: Where the length of the file will be stored.
+ * - too_large: Set to 1 if the file does not fit the buffer, 0 otherwise.
+ *
+ * Returns:
+ * - 1 if the whole file was read.
+ * - 0 if the file cannot be opened or read, or does not fit the buffer.
+ */
+static int ReadKeyFile(EccPemReader* reader, const char* key_file, size_t* pem_len,
+                       int* too_large) {
+  ECCPEM_STAGE_BEGIN(open_timer);
+  *pem_len = 0;
+  *too_large = 0;
+  const int fd = open(key_file, O_RDONLY | O_CLOEXEC);
+  ssize_t num_read = -1;
+  if (fd >= 0) {
+    do {
+      num_read = read(fd, reader->pem + *pem_len, sizeof(reader->pem) - *pem_len);
+      *pem_len += num_read > 0 ? (size_t)num_read : 0;
+    } while ((num_read > 0 && *pem_len < sizeof(reader->pem)) ||
+             (num_read < 0 && errno == EINTR));
+    close(fd);
+    *too_large = *pem_len == sizeof(reader->pem);
+  }
+  ECCPEM_STAGE_END(ECCPEM_STAGE_OPEN, open_timer);
+  return num_read >= 0 && !*too_large;
+}
+
+
+
+/*
+ * Function compares a DER encoding with a template of the reader's curve,
+ * except for up to two varying parts.
+ *
+ * Returns:
+ * - 1 if the encoding has the layout of the template.
+ * - 0 otherwise.
+ */
+static int MatchesDerTemplate(const uint8_t der[], const size_t der_len,
+                              const uint8_t template_der[], const size_t template_len,
+                              const size_t hole_offsets[2], const size_t hole_len[2]) {
+  if (der_len != template_len) {
+    return 0;
+  }
+  size_t offset = 0;
+  for (int i = 0; i < 2; ++i) {
+    /* Parts at or past the end of the template are absent */
+    if (hole_offsets[i] < offset || hole_offsets[i] >= template_len) {
+      continue;
+    }
+    if (memcmp(der + offset, template_der + offset, hole_offsets[i] - offset) != 0) {
+      return 0;
+    }
+    offset = hole_offsets[i] + hole_len[i];
+  }
+  return offset <= template_len &&
+         memcmp(der + offset, template_der + offset, template_len - offset) == 0;
+}
+
+
+
+/*
+ * Function decodes the body of the first PEM block of a key into the DER scratch
+ * buffer of the reader.
+ *
+ * Returns:
+ * - 1 if the block has the expected label and its body was decoded.
+ * - 0 if the block needs the OpenSSL PEM reader, e.g. it is encrypted.
+ */
+static int DecodePemBody(EccPemReader* reader, const char* pem, const size_t pem_len,
+                         const int private_key, size_t* der_len) {
+  EccPemBlock block;
+  if (!EccPemFindBlock(pem, pem_len, 0, &block) || !block.complete) {
+    return 0;
+  }
+  const int has_key_label = private_key ?
+                            EccPemBlockHasLabel(&block, PEM_STRING_PKCS8INF) ||
+                            EccPemBlockHasLabel(&block, PEM_STRING_ECPRIVATEKEY) :
+                            EccPemBlockHasLabel(&block, PEM_STRING_PUBLIC);
+  if (!has_key_label) {
+    return 0;
+  }
+  return EccPemBase64DecodeBody(block.body, block.body_len, reader->der, sizeof(reader->der),
+                                der_len);
+}
+
+
+
+/*
+ * Function decodes a key the templates do not cover. DER data goes through the
+ * reader's decoder, anything else through the OpenSSL PEM reader if the pre-scan
+ * finds a key block in it.
+ *
+ * Returns:
+ * - Pointer to the EVP_PKEY structure, which must be freed with EVP_PKEY_free.
+ * - NULL if the data cannot be decoded or the key is not on the reader's curve.
+ */
+static EVP_PKEY* DecodeKey(EccPemReader* reader, const char* pem, const size_t pem_len,
+                           const int has_der, const size_t der_len, const int private_key) {
+  EVP_PKEY* pkey = NULL;
+  ECCPEM_STAGE_BEGIN(decode_timer);
+  if (has_der) {
+    const unsigned char* data = reader->der;
+    size_t data_len = der_len;
+    ERR_set_mark();
+    if (OSSL_DECODER_from_data(private_key ? reader->privkey_decoder : reader->pubkey_decoder,
+                               &data, &data_len)) {
+      pkey = reader->decoded_key;
+    }
+    ERR_pop_to_mark();
+    reader->decoded_key = NULL;
+  } else if (pem_len <= INT_MAX && HasPemKeyBlock(pem, pem_len, private_key)) {
+    BIO* bio = BIO_new_mem_buf(pem, (int)pem_len);
+    if (bio != NULL) {
+      OSSL_LIB_CTX* libctx = EccPemCurveGetLibraryContext(reader->curve);
+      const char* propq = EccPemCurveGetPropertyQuery(reader->curve);
+      pkey = private_key ? PEM_read_bio_PrivateKey_ex(bio, NULL, NULL, NULL, libctx, propq)
+                         : PEM_read_bio_PUBKEY_ex(bio, NULL, NULL, NULL, libctx, propq);
+      BIO_free(bio);
+    }
+  }
+  ECCPEM_STAGE_END(ECCPEM_STAGE_PEM_DECODE, decode_timer);
+
+  if (pkey == NULL) {
+    EccPemReportError(ECCPEM_ERROR_DECODE_FAILED, private_key ?
+                      "Failed to read private key from PEM data." :
+                      "Failed to read public key from PEM data.");
+    return NULL;
+  }
+  if (GetEcKeyCurveNid(pkey) != EccPemCurveGetNid(reader->curve)) {
+    EccPemReportError(ECCPEM_ERROR_NOT_EC_KEY, "Key is not on the curve of the reader.");
+    EVP_PKEY_free(pkey);
+    return NULL;
+  }
+  return pkey;
+}
+
+
+
+/*
+ * Function stores the compressed public key of a SubjectPublicKeyInfo that
+ * matches the template of the reader's curve.
+ *
+ * Returns:
+ * - 1 if the point is on the curve and was stored.
+ * - 0 otherwise.
+ */
+static int CompressTemplatePoint(EccPemReader* reader, const size_t der_len,
+                                 uint8_t public_key[], const unsigned int compressed_key_size) {
+  const EccPemDerTemplate* der_template = reader->der_template;
+  const size_t hole_offsets[2] = {der_template->pubkey_point_offset, SIZE_MAX};
+  const size_t hole_len[2] = {der_template->point_len, 0};
+  if (!MatchesDerTemplate(reader->der, der_len, der_template->pubkey_der,
+                          der_template->pubkey_der_len, hole_offsets, hole_len)) {
+    return 0;
+  }
+
+  /* Decoding the point checks that it lies on the curve */
+  ERR_set_mark();
+  const int ret_value =
+      EC_POINT_oct2point(reader->group, reader->point,
+                         reader->der + der_template->pubkey_point_offset,
+                         der_template->point_len, reader->bn_ctx) &&
+      EC_POINT_point2oct(reader->group, reader->point, POINT_CONVERSION_COMPRESSED,
+                         public_key, compressed_key_size,
+                         reader->bn_ctx) == compressed_key_size;
+  ERR_pop_to_mark();
+  return ret_value;
+}
+
+
+
+/*
+ * Function stores the private key of a PKCS#8 PrivateKeyInfo that matches the
+ * template of the reader's curve.
+ *
+ * Returns:
+ * - 1 if the scalar is within the group order, the embedded public point lies on
+ *   the curve, and the scalar was stored.
+ * - 0 otherwise.
+ */
+static int CopyTemplateScalar(EccPemReader* reader, const size_t der_len,
+                              uint8_t private_key[], const unsigned int key_size) {
+  const EccPemDerTemplate* der_template = reader->der_template;
+  const size_t hole_offsets[2] = {der_template->privkey_scalar_offset,
+                                  der_template->privkey_point_offset};
+  const size_t hole_len[2] = {der_template->scalar_len, der_template->point_len};
+  if (key_size < der_template->scalar_len ||
+      !MatchesDerTemplate(reader->der, der_len, der_template->privkey_der,
+                          der_template->privkey_der_len, hole_offsets, hole_len)) {
+    return 0;
+  }
+
+  /* Valid scalars are in [1, order - 1] */
+  const uint8_t* scalar = reader->der + der_template->privkey_scalar_offset;
+  uint8_t nonzero = 0;
+  for (size_t i = 0; i < der_template->scalar_len; ++i) {
+    nonzero |= scalar[i];
+  }
+  if (nonzero == 0 || memcmp(scalar, reader->order, der_template->scalar_len) >= 0) {
+    return 0;
+  }
+
+  /* The OpenSSL decoder rejects keys whose public point is not on the curve */
+  ERR_set_mark();
+  const int point_valid =
+      EC_POINT_oct2point(reader->group, reader->point,
+                         reader->der + der_template->privkey_point_offset,
+                         der_template->point_len, reader->bn_ctx);
+  ERR_pop_to_mark();
+  if (!point_valid) {
+    return 0;
+  }
+
+  const size_t padding = key_size - der_template->scalar_len;
+  memset(private_key, 0, padding);
+  memcpy(private_key + padding, scalar, der_template->scalar_len);
+  return 1;
+}
+
+
+
+/*
+ * Function reads a private key from PEM data held in memory.
+ */
+static int ReadPrivateKeyPem(EccPemReader* reader, const char* pem, const size_t pem_len,
+                             uint8_t private_key[], const unsigned int key_size) {
+  ECCPEM_STAGE_BEGIN(decode_timer);
+  size_t der_len = 0;
+  const int has_der = DecodePemBody(reader, pem, pem_len, 1, &der_len);
+  ECCPEM_STAGE_END(ECCPEM_STAGE_PEM_DECODE, decode_timer);
+
+  int ret_value = 0;
+  ECCPEM_STAGE_BEGIN(conversion_timer);
+  const int copied = has_der && reader->der_template != NULL &&
+                     CopyTemplateScalar(reader, der_len, private_key, key_size);
+  ECCPEM_STAGE_END(ECCPEM_STAGE_EC_CONVERSION, conversion_timer);
+  if (copied) {
+    ret_value = 1;
+  } else {
+    EVP_PKEY* pkey = DecodeKey(reader, pem, pem_len, has_der, der_len, 1);
+    ret_value = pkey != NULL && ExtractPrivateKey(pkey, private_key, key_size);
+    EVP_PKEY_free(pkey);
+  }
+  if (has_der) {
+    OPENSSL_cleanse(reader->der, der_len);
+  }
+  return ret_value;
+}
+
+
+
+/*
+ * Function reads a public key from PEM data held in memory.
+ */
+static int ReadPublicKeyPem(EccPemReader* reader, const char* pem, const size_t pem_len,
+                            uint8_t public_key[], const unsigned int compressed_key_size) {
+  if (compressed_key_size != EccPemCurveGetCompressedKeySize(reader->curve)) {
+    EccPemReportErrorf(ECCPEM_ERROR_KEY_SIZE_MISMATCH,
+                       "Invalid compressed key size. The curve of the reader needs %u bytes",
+                       EccPemCurveGetCompressedKeySize(reader->curve));
+    return 0;
+  }
+
+  ECCPEM_STAGE_BEGIN(decode_timer);
+  size_t der_len = 0;
+  const int has_der = DecodePemBody(reader, pem, pem_len, 0, &der_len);
+  ECCPEM_STAGE_END(ECCPEM_STAGE_PEM_DECODE, decode_timer);
+
+  ECCPEM_STAGE_BEGIN(encode_timer);
+  const int compressed = has_der && reader->der_template != NULL &&
+                         CompressTemplatePoint(reader, der_len, public_key,
+                                               compressed_key_size);
+  ECCPEM_STAGE_END(ECCPEM_STAGE_POINT_ENCODE, encode_timer);
+  if (compressed) {
+    return 1;
+  }
+
+  EVP_PKEY* pkey = DecodeKey(reader, pem, pem_len, has_der, der_len, 0);
+  const int ret_value = pkey != NULL &&
+                        ExtractCompressedPublicKey(pkey, public_key, compressed_key_size);
+  EVP_PKEY_free(pkey);
+  return ret_value;
+}
+
+
+
+int EccPemReaderReadPrivateKeyFile(EccPemReader* reader, const char* privkey_file,
+                                   uint8_t private_key[], const unsigned int key_size) {
+  /* Validate input parameters */
+  if (reader == NULL || private_key == NULL || key_size == 0) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Reader and private key's array cannot be NULL or empty.");
+    return 0;
+  }
+  if (!VerifyPemFileFormat(privkey_file)) {
+    return 0;
+  }
+
+  size_t pem_len = 0;
+  int too_large = 0;
+  if (!ReadKeyFile(reader, privkey_file, &pem_len, &too_large)) {
+    if (too_large) {
+      /* Only the OpenSSL reader streams files of any size */
+      return ReadPrivateKeyPemFile(privkey_file, private_key, key_size);
+    }
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED,
+                      "Unable to open private key's pem file or it does not exist.");
+    return 0;
+  }
+
+  const int ret_value = ReadPrivateKeyPem(reader, reader->pem, pem_len, private_key, key_size);
+  OPENSSL_cleanse(reader->pem, pem_len);
+  return ret_value;
+}
+
+
+
+int EccPemReaderReadPrivateKeyBuffer(EccPemReader* reader, const char* privkey_pem,
+                                     const size_t privkey_pem_len, uint8_t private_key[],
+                                     const unsigned int key_size) {
+  /* Validate input parameters */
+  if (reader == NULL || privkey_pem == NULL || privkey_pem_len == 0 || private_key == NULL ||
+      key_size == 0) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Reader, private key PEM buffer and array cannot be NULL or empty.");
+    return 0;
+  }
+  return ReadPrivateKeyPem(reader, privkey_pem, privkey_pem_len, private_key, key_size);
+}
+
+
+
+int EccPemReaderReadPublicKeyFile(EccPemReader* reader, const char* pubkey_file,
+                                  uint8_t public_key[], const unsigned int compressed_key_size) {
+  /* Validate input parameters */
+  if (reader == NULL || public_key == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Reader and public key output buffer cannot be NULL.");
+    return 0;
+  }
+  if (!VerifyPemFileFormat(pubkey_file)) {
+    return 0;
+  }
+
+  size_t pem_len = 0;
+  int too_large = 0;
+  if (!ReadKeyFile(reader, pubkey_file, &pem_len, &too_large)) {
+    if (too_large) {
+      /* Only the OpenSSL reader streams files of any size */
+      return ReadPublicKeyPemFile(pubkey_file, public_key, compressed_key_size);
+    }
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Failed to open public key PEM file");
+    return 0;
+  }
+  return ReadPublicKeyPem(reader, reader->pem, pem_len, public_key, compressed_key_size);
+}
+
+
+
+int EccPemReaderReadPublicKeyBuffer(EccPemReader* reader, const char* pubkey_pem,
+                                    const size_t pubkey_pem_len, uint8_t public_key[],
+                                    const unsigned int compressed_key_size) {
+  /* Validate input parameters */
+  if (reader == NULL || pubkey_pem == NULL || pubkey_pem_len == 0 || public_key == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Reader, public key PEM buffer and output buffer cannot be NULL or empty.");
+    return 0;
+  }
+  return ReadPublicKeyPem(reader, pubkey_pem, pubkey_pem_len, public_key, compressed_key_size);
+}
@@ -0,0 +1,274 @@
+/*
+ * ===--- eccpem_secure.c ---------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides secure memory for private key material. An arena is one
+ * anonymous mapping: the usable pages are locked and excluded from core dumps,
+ * and one inaccessible guard page sits on either side of them. Keys are packed
+ * into it back to back, so a whole batch is cleansed with one pass instead of one
+ * heap block at a time.
+ */
+
+/* MAP_ANONYMOUS and madvise are not part of C11 */
+#define _DEFAULT_SOURCE
+
+#include "eccpem_secure.h"
+#include "eccpem_internal.h"
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+
+#include "eccpem_reader.h"
+
+struct EccPemSecureArena {
+  uint8_t* mapping;     /* Start of the mapping, a guard page */
+  size_t mapping_len;
+  uint8_t* data;        /* Usable pages behind the first guard page */
+  size_t capacity;
+  size_t used;
+  int locked;
+};
+
+
+
+int EccPemSecureHeapInit(const size_t size) {
+  if (CRYPTO_secure_malloc_initialized()) {
+    return 1;
+  }
+  /* 16 byte blocks at least, a private key's big number is larger anyway */
+  if (CRYPTO_secure_malloc_init(size, 16) == 0) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY,
+                      "Setting up the secure heap failed. Its size must be a power of two.");
+    return 0;
+  }
+  return 1;
+}
+
+
+
+int EccPemSecureHeapDone(void) {
+  return CRYPTO_secure_malloc_done();
+}
+
+
+
+EccPemSecureArena* EccPemSecureArenaCreate(const size_t capacity) {
+  if (capacity == 0) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Capacity of the arena cannot be 0.");
+    return NULL;
+  }
+
+  const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t data_len = (capacity + page_size - 1) / page_size * page_size;
+  const size_t mapping_len = data_len + 2 * page_size;
+  if (data_len < capacity || mapping_len < data_len) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Capacity of the arena is too large.");
+    return NULL;
+  }
+
+  EccPemSecureArena* arena = OPENSSL_zalloc(sizeof(EccPemSecureArena));
+  void* mapping = mmap(NULL, mapping_len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (arena == NULL || mapping == MAP_FAILED) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Mapping the secure arena failed.");
+    if (mapping != MAP_FAILED) {
+      munmap(mapping, mapping_len);
+    }
+    OPENSSL_free(arena);
+    return NULL;
+  }
+  arena->mapping = mapping;
+  arena->mapping_len = mapping_len;
+  arena->data = arena->mapping + page_size;
+  arena->capacity = data_len;
+
+  /* Guard pages fault on overruns in either direction */
+  if (mprotect(arena->mapping, page_size, PROT_NONE) != 0 ||
+      mprotect(arena->data + data_len, page_size, PROT_NONE) != 0) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Setting up the guard pages failed.");
+    EccPemSecureArenaFree(arena);
+    return NULL;
+  }
+#ifdef MADV_DONTDUMP
+  madvise(arena->data, data_len, MADV_DONTDUMP);
+#endif
+  /* Locking is best effort, the memory lock limit of a process may be small */
+  arena->locked = mlock(arena->data, data_len) == 0;
+  return arena;
+}
+
+
+
+void EccPemSecureArenaFree(EccPemSecureArena* arena) {
+  if (arena == NULL) {
+    return;
+  }
+  EccPemSecureArenaClear(arena);
+  if (arena->locked) {
+    munlock(arena->data, arena->capacity);
+  }
+  munmap(arena->mapping, arena->mapping_len);
+  OPENSSL_free(arena);
+}
+
+
+
+void EccPemSecureArenaClear(EccPemSecureArena* arena) {
+  if (arena == NULL) {
+    return;
+  }
+  OPENSSL_cleanse(arena->data, arena->used);
+  arena->used = 0;
+}
+
+
+
+int EccPemSecureArenaIsLocked(const EccPemSecureArena* arena) {
+  return arena != NULL && arena->locked;
+}
+
+
+
+size_t EccPemSecureArenaGetCapacity(const EccPemSecureArena* arena) {
+  return arena != NULL ? arena->capacity : 0;
+}
+
+
+
+size_t EccPemSecureArenaGetUsed(const EccPemSecureArena* arena) {
+  return arena != NULL ? arena->used : 0;
+}
+
+
+
+uint8_t* EccPemSecureArenaAlloc(EccPemSecureArena* arena, const size_t size) {
+  if (arena == NULL || size > arena->capacity - arena->used) {
+    return NULL;
+  }
+  /* Cleared memory is all zeros already */
+  uint8_t* bytes = arena->data + arena->used;
+  arena->used += size;
+  return bytes;
+}
+
+
+
+/*
+ * Function takes the room for num_keys keys of key_size bytes from an arena.
+ *
+ * Returns:
+ * - Pointer to the room.
+ * - NULL if the arguments are invalid or the arena is too small.
+ */
+static uint8_t* AllocKeys(EccPemSecureArena* arena, const EccPemCurve* curve,
+                          const size_t num_keys, const size_t key_size) {
+  if (arena == NULL || curve == NULL || num_keys == 0) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Arena and curve cannot be NULL, and the number of keys cannot be 0.");
+    return NULL;
+  }
+  uint8_t* keys = num_keys <= SIZE_MAX / key_size ?
+                  EccPemSecureArenaAlloc(arena, num_keys * key_size) : NULL;
+  if (keys == NULL) {
+    EccPemReportErrorf(ECCPEM_ERROR_BUFFER_TOO_SMALL,
+                       "Secure arena is too small. It has %zu bytes left",
+                       arena->capacity - arena->used);
+  }
+  return keys;
+}
+
+
+
+size_t EccPemSecureArenaReadPrivateKeyFiles(EccPemSecureArena* arena, const EccPemCurve* curve,
+                                            const char* const privkey_files[],
+                                            const size_t num_files, uint8_t** private_keys,
+                                            int results[]) {
+  if (results != NULL) {
+    memset(results, 0, num_files * sizeof(results[0]));
+  }
+  if (privkey_files == NULL || private_keys == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Private key files and private keys cannot be NULL.");
+    return 0;
+  }
+
+  const size_t key_size = curve != NULL ? EccPemCurveGetPrivateKeySize(curve) : 1;
+  uint8_t* keys = AllocKeys(arena, curve, num_files, key_size);
+  if (keys == NULL) {
+    return 0;
+  }
+  EccPemReader* reader = EccPemReaderCreate(curve);
+  if (reader == NULL) {
+    arena->used -= num_files * key_size;
+    return 0;
+  }
+
+  size_t num_read = 0;
+  for (size_t i = 0; i < num_files; ++i) {
+    uint8_t* key = keys + i * key_size;
+    const int read = EccPemReaderReadPrivateKeyFile(reader, privkey_files[i], key,
+                                                    (unsigned int)key_size);
+    if (!read) {
+      OPENSSL_cleanse(key, key_size);
+    }
+    if (results != NULL) {
+      results[i] = read;
+    }
+    num_read += (size_t)read;
+  }
+  EccPemReaderFree(reader);
+  *private_keys = keys;
+  return num_read;
+}
+
+
+
+size_t EccPemSecureArenaGenerateKeys(EccPemSecureArena* arena, const EccPemCurve* curve,
+                                     const size_t num_keys, uint8_t** private_keys,
+                                     uint8_t public_keys[]) {
+  if (private_keys == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Private keys cannot be NULL.");
+    return 0;
+  }
+
+  const size_t key_size = curve != NULL ? EccPemCurveGetPrivateKeySize(curve) : 1;
+  uint8_t* keys = AllocKeys(arena, curve, num_keys, key_size);
+  if (keys == NULL) {
+    return 0;
+  }
+  EVP_PKEY_CTX* ctx = CreateKeygenContext(curve);
+  if (ctx == NULL) {
+    arena->used -= num_keys * key_size;
+    return 0;
+  }
+  *private_keys = keys;
+
+  const unsigned int compressed_key_size = EccPemCurveGetCompressedKeySize(curve);
+  size_t num_generated = 0;
+  for (; num_generated < num_keys; ++num_generated) {
+    EVP_PKEY* pkey = NULL;
+    uint8_t* key = keys + num_generated * key_size;
+    int generated = EccPemKeygen(ctx, &pkey) > 0;
+    if (!generated) {
+      EccPemReportError(ECCPEM_ERROR_KEYGEN_FAILED, "Generating EC key pair failed.");
+    }
+    generated = generated && ExtractPrivateKey(pkey, key, (unsigned int)key_size) &&
+                (public_keys == NULL ||
+                 ExtractCompressedPublicKey(pkey, public_keys +
+                                            num_generated * compressed_key_size,
+                                            compressed_key_size));
+    EVP_PKEY_free(pkey);
+    if (!generated) {
+      OPENSSL_cleanse(key, key_size);
+      break;
+    }
+  }
+  EVP_PKEY_CTX_free(ctx);
+  return num_generated;
+}
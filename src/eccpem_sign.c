@@ -0,0 +1,444 @@
+/*
+ * ===--- eccpem_sign.c -----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides key handles and batched ECDSA signing and verification. A key
+ * handle owns the EVP_PKEY decoded from its PEM data or generated, along with
+ * the key's bytes, which are extracted once when the handle is created. Workers
+ * share it read-only, each with its own EVP_PKEY_CTX that is initialized once per
+ * batch, so a signature costs one EVP_PKEY_sign or EVP_PKEY_verify call and
+ * nothing else.
+ */
+
+#include "eccpem_sign.h"
+#include "eccpem_internal.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+
+#include "eccpem_read.h"
+#include "utils.h"
+
+/* Number of digests a worker takes from the queue at a time. */
+#define ECCPEM_SIGN_CHUNK_SIZE 32
+
+/* Longest digest accepted, the size of SHA-512. */
+#define ECCPEM_MAX_DIGEST_SIZE 64
+
+struct EccPemKey {
+  EVP_PKEY* pkey;
+  const EccPemCurve* curve;
+  int is_private;
+  size_t max_signature_size;
+  uint8_t private_key[ECCPEM_MAX_PUBLIC_KEY_SIZE];   /* Scalar of private keys */
+  size_t private_key_len;
+  uint8_t public_key[ECCPEM_MAX_PUBLIC_KEY_SIZE];    /* Compressed point */
+  size_t public_key_len;
+};
+
+/* Batch shared by the workers of EccPemSignBatch and EccPemVerifyBatch. */
+typedef struct {
+  const EccPemKey* key;
+  const uint8_t* digests;
+  size_t digest_len;
+  uint8_t* signatures;                  /* Output of signing */
+  const uint8_t* const_signatures;      /* Input of verification */
+  size_t signature_size;
+  size_t* signature_lens;               /* Output of signing */
+  const size_t* const_signature_lens;   /* Input of verification */
+  int* results;
+  EccPemWorkQueue queue;
+  atomic_size_t num_done;
+} SignJob;
+
+
+
+/*
+ * Function wraps a decoded key into a key handle.
+ *
+ * Returns:
+ * - Pointer to the key handle. It takes ownership of pkey.
+ * - NULL if the key is not an EC key on a named curve, in which case pkey is
+ *   freed.
+ */
+static EccPemKey* CreateKey(EVP_PKEY* pkey, const int is_private) {
+  if (pkey == NULL) {
+    return NULL;
+  }
+
+  const int curve_nid = GetEcKeyCurveNid(pkey);
+  const EccPemCurve* curve = curve_nid != NID_undef ? EccPemGetCurveByNid(curve_nid) : NULL;
+  if (curve == NULL) {
+    EccPemReportError(ECCPEM_ERROR_NOT_EC_KEY, "Key is not an EC key on a named curve.");
+    EVP_PKEY_free(pkey);
+    return NULL;
+  }
+
+  EccPemKey* key = malloc(sizeof(EccPemKey));
+  if (key == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating the key handle failed.");
+    EVP_PKEY_free(pkey);
+    return NULL;
+  }
+  key->pkey = pkey;
+  key->curve = curve;
+  key->is_private = is_private;
+  key->max_signature_size = (size_t)EVP_PKEY_get_size(pkey);
+  key->private_key_len = is_private ? EccPemCurveGetPrivateKeySize(curve) : 0;
+  key->public_key_len = EccPemCurveGetCompressedKeySize(curve);
+
+  /* The bytes are extracted once, accessors hand out pointers to them */
+  if ((is_private && !ExtractPrivateKey(pkey, key->private_key,
+                                        (unsigned int)key->private_key_len)) ||
+      !ExtractCompressedPublicKey(pkey, key->public_key, (unsigned int)key->public_key_len)) {
+    EccPemKeyFree(key);
+    return NULL;
+  }
+  return key;
+}
+
+
+
+EccPemKey* EccPemKeyLoadPrivateKeyFile(const char* privkey_file) {
+  if (!VerifyPemFileFormat(privkey_file)) {
+    return NULL;
+  }
+  return CreateKey(LoadPrivateKeyPemFile(privkey_file), 1);
+}
+
+
+
+EccPemKey* EccPemKeyLoadPublicKeyFile(const char* pubkey_file) {
+  if (!VerifyPemFileFormat(pubkey_file)) {
+    return NULL;
+  }
+  return CreateKey(LoadPublicKeyPemFile(pubkey_file), 0);
+}
+
+
+
+EccPemKey* EccPemKeyLoadPrivateKeyBuffer(const char* privkey_pem, const size_t privkey_pem_len) {
+  if (privkey_pem == NULL || privkey_pem_len == 0 || privkey_pem_len > INT_MAX) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Private key's PEM buffer cannot be null or empty.");
+    return NULL;
+  }
+  return CreateKey(LoadPrivateKeyPemBuffer(privkey_pem, privkey_pem_len), 1);
+}
+
+
+
+EccPemKey* EccPemKeyLoadPublicKeyBuffer(const char* pubkey_pem, const size_t pubkey_pem_len) {
+  if (pubkey_pem == NULL || pubkey_pem_len == 0 || pubkey_pem_len > INT_MAX) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Public key PEM buffer cannot be NULL or empty");
+    return NULL;
+  }
+  return CreateKey(LoadPublicKeyPemBuffer(pubkey_pem, pubkey_pem_len), 0);
+}
+
+
+
+EccPemKey* EccPemKeyGenerate(const EccPemCurve* curve) {
+  if (curve == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Curve handle cannot be NULL.");
+    return NULL;
+  }
+
+  EVP_PKEY_CTX* ctx = CreateKeygenContext(curve);
+  if (ctx == NULL) {
+    return NULL;
+  }
+  EVP_PKEY* pkey = NULL;
+  const int generated = EccPemKeygen(ctx, &pkey) > 0;
+  EVP_PKEY_CTX_free(ctx);
+  if (!generated) {
+    EccPemReportError(ECCPEM_ERROR_KEYGEN_FAILED, "Generating EC key pair failed.");
+    return NULL;
+  }
+  EccPemKey* key = CreateKey(pkey, 1);
+  if (key != NULL) {
+    /* Keep the provider of the curve for signing */
+    key->curve = curve;
+  }
+  return key;
+}
+
+
+
+int EccPemKeyWritePemFiles(const EccPemKey* key, const char* pubkey_file,
+                           const char* privkey_file) {
+  if (key == NULL || !key->is_private) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Writing PEM files needs a private key handle.");
+    return 0;
+  }
+  if (!VerifyPemFileFormat(pubkey_file) || !VerifyPemFileFormat(privkey_file)) {
+    return 0;
+  }
+  if (!WriteKeysToPEMFiles(key->pkey, pubkey_file, privkey_file)) {
+    EccPemReportError(ECCPEM_ERROR_WRITE_FAILED,
+                      "Writing private and public keys in PEM format files failed.");
+    return 0;
+  }
+  return 1;
+}
+
+
+
+void EccPemKeyFree(EccPemKey* key) {
+  if (key == NULL) {
+    return;
+  }
+  EVP_PKEY_free(key->pkey);
+  OPENSSL_cleanse(key->private_key, sizeof(key->private_key));
+  free(key);
+}
+
+
+
+const EccPemCurve* EccPemKeyGetCurve(const EccPemKey* key) {
+  return key != NULL ? key->curve : NULL;
+}
+
+
+
+int EccPemKeyIsPrivate(const EccPemKey* key) {
+  return key != NULL && key->is_private;
+}
+
+
+
+size_t EccPemKeyGetMaxSignatureSize(const EccPemKey* key) {
+  return key != NULL ? key->max_signature_size : 0;
+}
+
+
+
+const uint8_t* EccPemKeyGetPrivateKey(const EccPemKey* key, size_t* private_key_len) {
+  const int has_scalar = key != NULL && key->is_private;
+  if (private_key_len != NULL) {
+    *private_key_len = has_scalar ? key->private_key_len : 0;
+  }
+  return has_scalar ? key->private_key : NULL;
+}
+
+
+
+const uint8_t* EccPemKeyGetPublicKey(const EccPemKey* key, size_t* public_key_len) {
+  if (public_key_len != NULL) {
+    *public_key_len = key != NULL ? key->public_key_len : 0;
+  }
+  return key != NULL ? key->public_key : NULL;
+}
+
+
+
+EVP_PKEY* EccPemKeyGetEvpPkey(const EccPemKey* key) {
+  return key != NULL ? key->pkey : NULL;
+}
+
+
+
+int EccPemKeyCheckCurve(const EccPemKey* key, const EccPemCurve* curve) {
+  if (key == NULL || key->curve != curve) {
+    EccPemReportError(ECCPEM_ERROR_NOT_EC_KEY, "Key is not on the expected curve.");
+    return 0;
+  }
+  return 1;
+}
+
+
+
+/*
+ * Function creates the EVP_PKEY_CTX a worker uses for a whole batch.
+ *
+ * Returns:
+ * - Pointer to the context, initialized for signing or verification.
+ * - NULL if creating or initializing it failed.
+ */
+static EVP_PKEY_CTX* CreateWorkerContext(const EccPemKey* key, const int sign) {
+  EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_from_pkey(EccPemCurveGetLibraryContext(key->curve),
+                                                 key->pkey,
+                                                 EccPemCurveGetPropertyQuery(key->curve));
+  if (ctx != NULL && (sign ? EVP_PKEY_sign_init(ctx) : EVP_PKEY_verify_init(ctx)) <= 0) {
+    EVP_PKEY_CTX_free(ctx);
+    ctx = NULL;
+  }
+  return ctx;
+}
+
+
+
+/*
+ * Function is the worker of EccPemSignBatch. Digests of chunks are left unsigned
+ * if the worker's context cannot be created.
+ */
+static void SignWorker(void* arg, unsigned int worker_index) {
+  (void)worker_index;
+  SignJob* job = (SignJob*)arg;
+  EVP_PKEY_CTX* ctx = CreateWorkerContext(job->key, 1);
+
+  size_t num_signed = 0;
+  size_t num_taken = 0;
+  size_t begin = 0;
+  size_t end = 0;
+  while (EccPemWorkQueueNext(&job->queue, &begin, &end)) {
+    num_taken += end - begin;
+    for (size_t i = begin; i < end && ctx != NULL; ++i) {
+      size_t signature_len = job->signature_size;
+      if (EVP_PKEY_sign(ctx, job->signatures + i * job->signature_size, &signature_len,
+                        job->digests + i * job->digest_len, job->digest_len) > 0) {
+        job->signature_lens[i] = signature_len;
+        ++num_signed;
+      }
+    }
+  }
+  if (num_signed < num_taken) {
+    ERR_clear_error();
+  }
+  EVP_PKEY_CTX_free(ctx);
+  atomic_fetch_add_explicit(&job->num_done, num_signed, memory_order_relaxed);
+}
+
+
+
+/*
+ * Function is the worker of EccPemVerifyBatch.
+ */
+static void VerifyWorker(void* arg, unsigned int worker_index) {
+  (void)worker_index;
+  SignJob* job = (SignJob*)arg;
+  EVP_PKEY_CTX* ctx = CreateWorkerContext(job->key, 0);
+
+  size_t num_valid = 0;
+  size_t begin = 0;
+  size_t end = 0;
+  while (EccPemWorkQueueNext(&job->queue, &begin, &end)) {
+    for (size_t i = begin; i < end && ctx != NULL; ++i) {
+      const size_t signature_len = job->const_signature_lens[i];
+      const int valid = signature_len > 0 && signature_len <= job->signature_size &&
+                        EVP_PKEY_verify(ctx, job->const_signatures + i * job->signature_size,
+                                        signature_len, job->digests + i * job->digest_len,
+                                        job->digest_len) == 1;
+      if (job->results != NULL) {
+        job->results[i] = valid;
+      }
+      num_valid += (size_t)valid;
+    }
+  }
+  /* Invalid signatures leave errors behind in OpenSSL's queue */
+  ERR_clear_error();
+  EVP_PKEY_CTX_free(ctx);
+  atomic_fetch_add_explicit(&job->num_done, num_valid, memory_order_relaxed);
+}
+
+
+
+/*
+ * Function runs the workers of a batch on up to num_threads threads.
+ *
+ * Returns:
+ * - Number of digests the workers signed, or signatures they found valid.
+ */
+static size_t RunBatch(SignJob* job, const size_t num_digests, const unsigned int num_threads,
+                       void (*worker)(void* arg, unsigned int worker_index)) {
+  EccPemWorkQueueInit(&job->queue, num_digests, ECCPEM_SIGN_CHUNK_SIZE);
+  atomic_init(&job->num_done, 0);
+
+  /* Never start more threads than there are chunks of work */
+  unsigned int num_workers = EccPemResolveThreadCount(num_threads);
+  const size_t num_chunks = (num_digests + ECCPEM_SIGN_CHUNK_SIZE - 1) / ECCPEM_SIGN_CHUNK_SIZE;
+  if (num_chunks < num_workers) {
+    num_workers = (unsigned int)num_chunks;
+  }
+  EccPemRunWorkers(num_workers, worker, job);
+  return atomic_load(&job->num_done);
+}
+
+
+
+size_t EccPemSignBatch(const EccPemKey* key, const uint8_t digests[], const size_t digest_len,
+                       const size_t num_digests, uint8_t signatures[],
+                       const size_t signature_size, size_t signature_lens[],
+                       const unsigned int num_threads) {
+  if (signature_lens != NULL) {
+    memset(signature_lens, 0, num_digests * sizeof(signature_lens[0]));
+  }
+
+  /* Validate input parameters */
+  if (key == NULL || !key->is_private) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Signing needs a private key handle.");
+    return 0;
+  }
+  if (num_digests == 0) {
+    return 0;
+  }
+  if (digests == NULL || signatures == NULL || signature_lens == NULL || digest_len == 0 ||
+      digest_len > ECCPEM_MAX_DIGEST_SIZE) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Digest, signature and signature length arrays cannot be NULL or empty.");
+    return 0;
+  }
+  if (signature_size < key->max_signature_size) {
+    EccPemReportErrorf(ECCPEM_ERROR_BUFFER_TOO_SMALL,
+                       "Signature slots are too small. The key needs %zu bytes",
+                       key->max_signature_size);
+    return 0;
+  }
+
+  SignJob job;
+  memset(&job, 0, sizeof(job));
+  job.key = key;
+  job.digests = digests;
+  job.digest_len = digest_len;
+  job.signatures = signatures;
+  job.signature_size = signature_size;
+  job.signature_lens = signature_lens;
+  return RunBatch(&job, num_digests, num_threads, SignWorker);
+}
+
+
+
+size_t EccPemVerifyBatch(const EccPemKey* key, const uint8_t digests[], const size_t digest_len,
+                         const size_t num_digests, const uint8_t signatures[],
+                         const size_t signature_size, const size_t signature_lens[],
+                         int results[], const unsigned int num_threads) {
+  if (results != NULL) {
+    memset(results, 0, num_digests * sizeof(results[0]));
+  }
+
+  /* Validate input parameters */
+  if (key == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Key handle cannot be NULL.");
+    return 0;
+  }
+  if (num_digests == 0) {
+    return 0;
+  }
+  if (digests == NULL || signatures == NULL || signature_lens == NULL || digest_len == 0 ||
+      digest_len > ECCPEM_MAX_DIGEST_SIZE) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Digest, signature and signature length arrays cannot be NULL or empty.");
+    return 0;
+  }
+
+  SignJob job;
+  memset(&job, 0, sizeof(job));
+  job.key = key;
+  job.digests = digests;
+  job.digest_len = digest_len;
+  job.const_signatures = signatures;
+  job.signature_size = signature_size;
+  job.const_signature_lens = signature_lens;
+  job.results = results;
+  return RunBatch(&job, num_digests, num_threads, VerifyWorker);
+}
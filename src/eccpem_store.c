@@ -0,0 +1,564 @@
+/*
+ * ===--- eccpem_store.c ----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides the binary key store. A store file is laid out as follows:
+ *
+ *   header     StoreHeader (64 bytes)
+ *   index      uint32_t[2^index_bits + 1], index[b] is the position of the first
+ *              record whose fingerprint starts with the index_bits prefix b
+ *   padding    up to 8 byte alignment
+ *   records    EccPemStoreRecord[num_records], sorted by fingerprint
+ *
+ * Fingerprints are SHA-256 hashes and therefore uniformly distributed, so with
+ * 2^index_bits >= num_records a bucket holds about one record and a lookup is
+ * one index read plus a search over a handful of records.
+ */
+
+#include "eccpem_store.h"
+#include "eccpem_internal.h"
+#include "utils.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/bn.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/objects.h>
+#include <openssl/param_build.h>
+#include <openssl/pem.h>
+
+#define STORE_MAGIC "ECCPEMKS"
+#define STORE_VERSION 1
+/* Upper bound of the index size, 2^24 buckets use 64 MiB. */
+#define STORE_MAX_INDEX_BITS 24
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t num_records;
+  uint32_t index_bits;
+  uint32_t reserved[9];
+} StoreHeader;
+
+_Static_assert(sizeof(StoreHeader) == 64, "Store header must be 64 bytes");
+_Static_assert(sizeof(EccPemStoreRecord) == 176, "Store record must be 176 bytes");
+
+struct EccPemStore {
+  const uint8_t* map;
+  size_t map_len;
+  const StoreHeader* header;
+  const uint32_t* index;
+  const EccPemStoreRecord* records;
+};
+
+
+
+/*
+ * Function returns the offset of the first record in a store with the given
+ * index size.
+ */
+static size_t RecordsOffset(const uint32_t index_bits) {
+  const size_t index_end = sizeof(StoreHeader) +
+                           (((size_t)1 << index_bits) + 1) * sizeof(uint32_t);
+  return (index_end + 7) & ~(size_t)7;
+}
+
+/*
+ * Function returns the index bucket of a fingerprint, its first index_bits bits.
+ */
+static size_t FingerprintBucket(const uint8_t fingerprint[], const uint32_t index_bits) {
+  if (index_bits == 0) {
+    return 0;
+  }
+  const uint32_t prefix = ((uint32_t)fingerprint[0] << 24) | ((uint32_t)fingerprint[1] << 16) |
+                          ((uint32_t)fingerprint[2] << 8) | (uint32_t)fingerprint[3];
+  return prefix >> (32 - index_bits);
+}
+
+static int CompareRecords(const void* a, const void* b) {
+  return memcmp(((const EccPemStoreRecord*)a)->fingerprint,
+                ((const EccPemStoreRecord*)b)->fingerprint, ECCPEM_FINGERPRINT_SIZE);
+}
+
+
+
+int EccPemKeyFingerprint(const uint8_t public_key[],
+                         const size_t public_key_len,
+                         uint8_t fingerprint[]) {
+  if (public_key == NULL || public_key_len == 0 || fingerprint == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Public key and fingerprint buffers cannot be NULL.");
+    return 0;
+  }
+  unsigned int digest_len = 0;
+  if (!EVP_Digest(public_key, public_key_len, fingerprint, &digest_len, EVP_sha256(), NULL)) {
+    EccPemReportError(ECCPEM_ERROR_KEY_CONVERSION_FAILED,
+                      "Computing public key fingerprint failed.");
+    return 0;
+  }
+  return 1;
+}
+
+
+
+/*
+ * Function fills a store record from a key's PEM files.
+ *
+ * Returns:
+ * - 1 on success.
+ * - 0 if a file cannot be read, the keys do not match, or a key does not fit
+ *   into a record.
+ */
+static int FillRecord(const char* pubkey_file, const char* privkey_file,
+                      EccPemStoreRecord* record) {
+  EVP_PKEY* pub_pkey = NULL;
+  EVP_PKEY* priv_pkey = NULL;
+  if (pubkey_file != NULL &&
+      (!VerifyPemFileFormat(pubkey_file) || (pub_pkey = LoadPublicKeyPemFile(pubkey_file)) == NULL)) {
+    return 0;
+  }
+  if (privkey_file != NULL &&
+      (!VerifyPemFileFormat(privkey_file) || (priv_pkey = LoadPrivateKeyPemFile(privkey_file)) == NULL)) {
+    EVP_PKEY_free(pub_pkey);
+    return 0;
+  }
+
+  int ret_value = 0;
+  EVP_PKEY* pkey = pub_pkey != NULL ? pub_pkey : priv_pkey;
+  size_t public_key_len = 0;
+  if (pkey == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Either the public or the private key file must be given.");
+  } else if ((record->curve_nid = GetEcKeyCurveNid(pkey)) == NID_undef) {
+    EccPemReportError(ECCPEM_ERROR_NOT_EC_KEY, "Key is not an EC key on a named curve.");
+  } else if (!EncodeEcPublicKey(pkey, POINT_CONVERSION_COMPRESSED, record->public_key,
+                                sizeof(record->public_key), &public_key_len)) {
+    EccPemReportError(ECCPEM_ERROR_KEY_SIZE_MISMATCH,
+                      "Public key does not fit into a key store record.");
+  } else {
+    record->public_key_len = (uint8_t)public_key_len;
+    ret_value = EccPemKeyFingerprint(record->public_key, public_key_len, record->fingerprint);
+  }
+
+  if (ret_value && priv_pkey != NULL) {
+    uint8_t derived_key[ECCPEM_STORE_MAX_PUBLIC_KEY_SIZE];
+    size_t derived_len = 0;
+    const unsigned int key_size = (unsigned int)(EVP_PKEY_get_bits(priv_pkey) + 7) / 8;
+    if (key_size > sizeof(record->private_key) ||
+        !ExtractPrivateKey(priv_pkey, record->private_key, key_size)) {
+      EccPemReportError(ECCPEM_ERROR_KEY_SIZE_MISMATCH,
+                        "Private key does not fit into a key store record.");
+      ret_value = 0;
+    } else if (!EncodeEcPublicKey(priv_pkey, POINT_CONVERSION_COMPRESSED, derived_key,
+                                  sizeof(derived_key), &derived_len) ||
+               derived_len != public_key_len ||
+               memcmp(derived_key, record->public_key, derived_len) != 0) {
+      EccPemReportError(ECCPEM_ERROR_KEY_MISMATCH,
+                        "Public and private key files do not belong to the same key.");
+      ret_value = 0;
+    } else {
+      record->private_key_len = (uint8_t)key_size;
+    }
+  }
+
+  EVP_PKEY_free(pub_pkey);
+  EVP_PKEY_free(priv_pkey);
+  return ret_value;
+}
+
+
+
+/*
+ * Function writes a store file from sorted, deduplicated records.
+ *
+ * Returns:
+ * - 1 on success.
+ * - 0 if creating or writing the file failed.
+ */
+static int WriteStoreFile(const char* store_file, const EccPemStoreRecord* records,
+                          const size_t num_records) {
+  uint32_t index_bits = 0;
+  while (index_bits < STORE_MAX_INDEX_BITS && ((size_t)1 << index_bits) < num_records) {
+    ++index_bits;
+  }
+
+  const size_t num_buckets = (size_t)1 << index_bits;
+  uint32_t* index = calloc(num_buckets + 1, sizeof(uint32_t));
+  if (index == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating key store index failed.");
+    return 0;
+  }
+  for (size_t i = 0; i < num_records; ++i) {
+    ++index[FingerprintBucket(records[i].fingerprint, index_bits) + 1];
+  }
+  for (size_t b = 0; b < num_buckets; ++b) {
+    index[b + 1] += index[b];
+  }
+
+  StoreHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+  header.version = STORE_VERSION;
+  header.record_size = sizeof(EccPemStoreRecord);
+  header.num_records = num_records;
+  header.index_bits = index_bits;
+
+  /* Write next to the target and rename, so readers never see a partial store */
+  const size_t tmp_file_size = strlen(store_file) + 32;
+  char* tmp_file = malloc(tmp_file_size);
+  if (tmp_file == NULL) {
+    free(index);
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating key store file name failed.");
+    return 0;
+  }
+  snprintf(tmp_file, tmp_file_size, "%s.tmp.%ld", store_file, (long)getpid());
+
+  /* The store holds private scalars, so only the owner may read it */
+  const int fd = open(tmp_file, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  FILE* fp = fd >= 0 ? fdopen(fd, "wb") : NULL;
+  if (fp == NULL) {
+    if (fd >= 0) {
+      close(fd);
+      remove(tmp_file);
+    }
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Unable to open key store file for writing.");
+    free(index);
+    free(tmp_file);
+    return 0;
+  }
+
+  static const uint8_t kZeroPadding[8] = {0};
+  const size_t index_size = (num_buckets + 1) * sizeof(uint32_t);
+  const size_t padding = RecordsOffset(index_bits) - sizeof(header) - index_size;
+  int ret_value = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+                  fwrite(index, index_size, 1, fp) == 1 &&
+                  fwrite(kZeroPadding, 1, padding, fp) == padding &&
+                  fwrite(records, sizeof(EccPemStoreRecord), num_records, fp) == num_records;
+  ret_value = (fclose(fp) == 0) && ret_value;
+
+  if (ret_value && rename(tmp_file, store_file) != 0) {
+    ret_value = 0;
+  }
+  if (!ret_value) {
+    EccPemReportError(ECCPEM_ERROR_WRITE_FAILED, "Writing key store file failed.");
+    remove(tmp_file);
+  }
+
+  free(index);
+  free(tmp_file);
+  return ret_value;
+}
+
+
+
+/*
+ * Function converts PEM formatted key files into a binary key store.
+ *
+ * Arguments:
+ * - store_file: Path where the store will be written.
+ * - pubkey_files: Array of num_keys public key PEM files, or NULL.
+ * - privkey_files: Array of num_keys private key PEM files, or NULL.
+ * - num_keys: Number of keys.
+ *
+ * Returns:
+ * - 1 if every key was converted and the store was written.
+ * - 0 otherwise, no store is written then.
+ */
+int EccPemStoreBuild(const char* store_file,
+                     const char* const pubkey_files[],
+                     const char* const privkey_files[],
+                     const size_t num_keys) {
+  if (store_file == NULL || (pubkey_files == NULL && privkey_files == NULL)) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Key store file and key file arrays cannot be NULL.");
+    return 0;
+  }
+
+  if (num_keys > UINT32_MAX) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Too many keys for a key store.");
+    return 0;
+  }
+
+  EccPemStoreRecord* records = calloc(num_keys > 0 ? num_keys : 1, sizeof(EccPemStoreRecord));
+  if (records == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating key store records failed.");
+    return 0;
+  }
+
+  int ret_value = 1;
+  for (size_t i = 0; i < num_keys && ret_value; ++i) {
+    ret_value = FillRecord(pubkey_files != NULL ? pubkey_files[i] : NULL,
+                           privkey_files != NULL ? privkey_files[i] : NULL, &records[i]);
+  }
+
+  if (ret_value) {
+    qsort(records, num_keys, sizeof(EccPemStoreRecord), CompareRecords);
+
+    /* The same key may be listed twice; keep one record, preferring one with a
+     * private key. */
+    size_t num_records = 0;
+    for (size_t i = 0; i < num_keys; ++i) {
+      if (num_records > 0 && CompareRecords(&records[num_records - 1], &records[i]) == 0) {
+        if (records[num_records - 1].private_key_len == 0) {
+          records[num_records - 1] = records[i];
+        }
+        continue;
+      }
+      records[num_records++] = records[i];
+    }
+    ret_value = WriteStoreFile(store_file, records, num_records);
+  }
+
+  OPENSSL_cleanse(records, num_keys * sizeof(EccPemStoreRecord));
+  free(records);
+  return ret_value;
+}
+
+
+
+/*
+ * Function opens a binary key store by mapping it read-only and validates its
+ * header and index.
+ *
+ * Returns:
+ * - Pointer to the open store on success.
+ * - NULL if the file cannot be opened or mapped, or is not a valid store.
+ */
+EccPemStore* EccPemStoreOpen(const char* store_file) {
+  if (store_file == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Key store file cannot be NULL.");
+    return NULL;
+  }
+
+  const int fd = open(store_file, O_RDONLY);
+  if (fd < 0) {
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED,
+                      "Unable to open key store file or it does not exist.");
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(StoreHeader)) {
+    EccPemReportError(ECCPEM_ERROR_DECODE_FAILED, "Invalid key store file.");
+    close(fd);
+    return NULL;
+  }
+
+  const size_t map_len = (size_t)st.st_size;
+  void* map = mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Failed to map key store file.");
+    return NULL;
+  }
+
+  /* Validate the header and that the index cannot point outside the records */
+  const StoreHeader* header = (const StoreHeader*)map;
+  int valid = memcmp(header->magic, STORE_MAGIC, sizeof(header->magic)) == 0 &&
+              header->version == STORE_VERSION &&
+              header->record_size == sizeof(EccPemStoreRecord) &&
+              header->index_bits <= STORE_MAX_INDEX_BITS &&
+              header->num_records <= UINT32_MAX &&
+              map_len >= RecordsOffset(header->index_bits) &&
+              (map_len - RecordsOffset(header->index_bits)) / sizeof(EccPemStoreRecord) ==
+                  header->num_records &&
+              (map_len - RecordsOffset(header->index_bits)) % sizeof(EccPemStoreRecord) == 0;
+  const uint32_t* index = (const uint32_t*)((const uint8_t*)map + sizeof(StoreHeader));
+  if (valid) {
+    const size_t num_buckets = (size_t)1 << header->index_bits;
+    valid = index[0] == 0 && index[num_buckets] == header->num_records;
+    for (size_t b = 0; b < num_buckets && valid; ++b) {
+      valid = index[b] <= index[b + 1];
+    }
+  }
+
+  EccPemStore* store = valid ? calloc(1, sizeof(EccPemStore)) : NULL;
+  if (store == NULL) {
+    if (valid) {
+      EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating key store failed.");
+    } else {
+      EccPemReportError(ECCPEM_ERROR_DECODE_FAILED, "Invalid key store file.");
+    }
+    munmap(map, map_len);
+    return NULL;
+  }
+
+  store->map = (const uint8_t*)map;
+  store->map_len = map_len;
+  store->header = header;
+  store->index = index;
+  store->records = (const EccPemStoreRecord*)(store->map + RecordsOffset(header->index_bits));
+  return store;
+}
+
+
+
+const EccPemStoreRecord* EccPemStoreLookup(const EccPemStore* store,
+                                           const uint8_t fingerprint[]) {
+  if (store == NULL || fingerprint == NULL) {
+    return NULL;
+  }
+
+  const size_t bucket = FingerprintBucket(fingerprint, store->header->index_bits);
+  size_t low = store->index[bucket];
+  size_t high = store->index[bucket + 1];
+  while (low < high) {
+    const size_t middle = low + (high - low) / 2;
+    const int cmp = memcmp(store->records[middle].fingerprint, fingerprint,
+                           ECCPEM_FINGERPRINT_SIZE);
+    if (cmp == 0) {
+      return &store->records[middle];
+    }
+    if (cmp < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return NULL;
+}
+
+
+
+size_t EccPemStoreNumRecords(const EccPemStore* store) {
+  return store != NULL ? (size_t)store->header->num_records : 0;
+}
+
+
+
+const EccPemStoreRecord* EccPemStoreGetRecord(const EccPemStore* store,
+                                              const size_t index) {
+  if (store == NULL || index >= store->header->num_records) {
+    return NULL;
+  }
+  return &store->records[index];
+}
+
+
+
+/*
+ * Function builds an EVP_PKEY structure from the raw key material of a record.
+ *
+ * Returns:
+ * - Pointer to the EVP_PKEY structure, which must be freed with EVP_PKEY_free.
+ * - NULL if the record does not describe a valid key.
+ */
+static EVP_PKEY* RecordToPkey(const EccPemStoreRecord* record) {
+  const char* curve_name = OBJ_nid2sn(record->curve_nid);
+  if (curve_name == NULL || record->public_key_len == 0 ||
+      record->public_key_len > sizeof(record->public_key) ||
+      record->private_key_len > sizeof(record->private_key)) {
+    return NULL;
+  }
+
+  OSSL_PARAM_BLD* param_bld = OSSL_PARAM_BLD_new();
+  BIGNUM* priv_bn = NULL;
+  OSSL_PARAM* params = NULL;
+  EVP_PKEY_CTX* ctx = NULL;
+  EVP_PKEY* pkey = NULL;
+
+  int ok = param_bld != NULL &&
+           OSSL_PARAM_BLD_push_utf8_string(param_bld, OSSL_PKEY_PARAM_GROUP_NAME, curve_name, 0) &&
+           OSSL_PARAM_BLD_push_octet_string(param_bld, OSSL_PKEY_PARAM_PUB_KEY,
+                                            record->public_key, record->public_key_len);
+  if (ok && record->private_key_len > 0) {
+    priv_bn = BN_secure_new();
+    ok = priv_bn != NULL &&
+         BN_bin2bn(record->private_key, record->private_key_len, priv_bn) != NULL &&
+         OSSL_PARAM_BLD_push_BN(param_bld, OSSL_PKEY_PARAM_PRIV_KEY, priv_bn);
+  }
+  if (ok) {
+    params = OSSL_PARAM_BLD_to_param(param_bld);
+    ctx = EVP_PKEY_CTX_new_from_name(NULL, "EC", NULL);
+    const int selection = record->private_key_len > 0 ? EVP_PKEY_KEYPAIR : EVP_PKEY_PUBLIC_KEY;
+    ok = params != NULL && ctx != NULL && EVP_PKEY_fromdata_init(ctx) > 0 &&
+         EVP_PKEY_fromdata(ctx, &pkey, selection, params) > 0;
+  }
+
+  EVP_PKEY_CTX_free(ctx);
+  OSSL_PARAM_free(params);
+  BN_clear_free(priv_bn);
+  OSSL_PARAM_BLD_free(param_bld);
+  if (!ok) {
+    EVP_PKEY_free(pkey);
+    return NULL;
+  }
+  return pkey;
+}
+
+
+
+/*
+ * Function converts a store record back into PEM formatted key files.
+ *
+ * Returns:
+ * - 1 if the PEM files were written.
+ * - 0 if the record cannot be converted to a key or writing the files failed.
+ */
+int EccPemStoreRecordToPemFiles(const EccPemStoreRecord* record,
+                                const char* pubkey_file,
+                                const char* privkey_file) {
+  if (record == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Key store record cannot be NULL.");
+    return 0;
+  }
+
+  if (!VerifyPemFileFormat(pubkey_file) ||
+      (privkey_file != NULL && !VerifyPemFileFormat(privkey_file))) {
+    return 0;
+  }
+
+  if (privkey_file != NULL && record->private_key_len == 0) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Key store record has no private key.");
+    return 0;
+  }
+
+  EVP_PKEY* pkey = RecordToPkey(record);
+  if (pkey == NULL) {
+    EccPemReportError(ECCPEM_ERROR_KEY_CONVERSION_FAILED,
+                      "Failed to convert key store record to EVP_PKEY.");
+    return 0;
+  }
+
+  int ret_value = 0;
+  if (privkey_file != NULL) {
+    ret_value = WriteKeysToPEMFiles(pkey, pubkey_file, privkey_file);
+  } else {
+    FILE* pubkey_fp = fopen(pubkey_file, "w");
+    if (pubkey_fp == NULL) {
+      EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Unable to open public key file for writing.");
+    } else {
+      ret_value = PEM_write_PUBKEY(pubkey_fp, pkey);
+      ret_value = (fclose(pubkey_fp) == 0) && ret_value;
+      if (!ret_value) {
+        EccPemReportError(ECCPEM_ERROR_WRITE_FAILED,
+                          "Error writing public key data in PEM format.");
+      }
+    }
+  }
+
+  EVP_PKEY_free(pkey);
+  return ret_value;
+}
+
+
+
+void EccPemStoreClose(EccPemStore* store) {
+  if (store == NULL) {
+    return;
+  }
+  munmap((void*)store->map, store->map_len);
+  free(store);
+}
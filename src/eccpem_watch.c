@@ -0,0 +1,819 @@
+/*
+ * ===--- eccpem_watch.c ----------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides watched key directories. The key table is split into immutable,
+ * reference counted chunks of about ECCPEM_WATCH_CHUNK_SIZE keys sorted by file
+ * name, and a snapshot is an array of chunk pointers. An update rebuilds only the
+ * chunks whose name range has changes and shares all other chunks with the
+ * previous snapshot. The new snapshot is published with one atomic exchange;
+ * readers only count themselves in while they take a reference, so the writer
+ * knows when the previous snapshot can no longer be picked up.
+ */
+
+/* sched_yield and strdup are not part of C11 */
+#define _DEFAULT_SOURCE
+
+#include "eccpem_watch.h"
+#include "eccpem_internal.h"
+#include "eccpem_cache.h"
+#include "eccpem_loader.h"
+#include "eccpem_read.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+/* Number of keys of a chunk built from scratch. An updated chunk is split again
+ * once it holds more than twice as many. */
+#define ECCPEM_WATCH_CHUNK_SIZE 256
+
+/* Capacity of the key cache that changed files are read through. */
+#define ECCPEM_WATCH_CACHE_SIZE 4096
+
+/* Events the directory is watched for. IN_CREATE is the only event of a new
+ * symbolic or hard link. A regular file still being written when its IN_CREATE
+ * is handled fails to read, and its later IN_CLOSE_WRITE adds it. */
+#define ECCPEM_WATCH_EVENTS (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | \
+                             IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF)
+
+/* Immutable run of keys sorted by file name. The offsets, keys and names follow
+ * the struct in the same allocation. */
+typedef struct {
+  atomic_size_t refs;
+  size_t num_keys;
+  const uint32_t* name_offsets;
+  const uint8_t* keys;
+  const char* names;
+} KeyChunk;
+
+struct EccPemKeySnapshot {
+  atomic_size_t refs;
+  uint64_t generation;
+  unsigned int key_size;
+  size_t num_keys;
+  size_t num_chunks;
+  KeyChunk** chunks;
+  /* Index of the first key of every chunk */
+  size_t* chunk_starts;
+};
+
+struct EccPemKeyWatcher {
+  char* directory;
+  unsigned int key_size;
+  unsigned int num_threads;
+  int fd;
+  int wd;
+  EccPemKeyCache* cache;
+  _Atomic(EccPemKeySnapshot*) snapshot;
+  /* Number of readers between loading the snapshot pointer and taking a
+   * reference to it */
+  atomic_size_t num_acquiring;
+};
+
+/* Change of one file, collected from the events of a poll. */
+typedef struct {
+  char* name;
+  size_t sequence;
+  int removed;
+  uint8_t key[ECCPEM_MAX_PUBLIC_KEY_SIZE];
+} FileChange;
+
+/* Sorted keys a chunk is built from, pointing into older chunks or changes. */
+typedef struct {
+  const char** names;
+  const uint8_t** keys;
+  size_t num_keys;
+  size_t capacity;
+} KeyList;
+
+/* Growing arrays of the snapshot under construction. */
+typedef struct {
+  KeyChunk** chunks;
+  size_t num_chunks;
+  size_t capacity;
+} ChunkList;
+
+
+
+static const char* ChunkName(const KeyChunk* chunk, const size_t index) {
+  return chunk->names + chunk->name_offsets[index];
+}
+
+
+
+/*
+ * Function builds a chunk from num_keys sorted keys.
+ *
+ * Returns:
+ * - Pointer to the chunk with one reference.
+ * - NULL if memory allocation failed.
+ */
+static KeyChunk* CreateChunk(const char* const names[], const uint8_t* const keys[],
+                             const size_t num_keys, const unsigned int key_size) {
+  size_t names_len = 0;
+  for (size_t i = 0; i < num_keys; ++i) {
+    names_len += strlen(names[i]) + 1;
+  }
+  if (names_len > UINT32_MAX) {
+    return NULL;
+  }
+
+  const size_t offsets_len = (num_keys + 1) * sizeof(uint32_t);
+  KeyChunk* chunk = malloc(sizeof(KeyChunk) + offsets_len + num_keys * key_size + names_len);
+  if (chunk == NULL) {
+    return NULL;
+  }
+  uint32_t* name_offsets = (uint32_t*)(chunk + 1);
+  uint8_t* chunk_keys = (uint8_t*)name_offsets + offsets_len;
+  char* chunk_names = (char*)chunk_keys + num_keys * key_size;
+
+  uint32_t offset = 0;
+  for (size_t i = 0; i < num_keys; ++i) {
+    const size_t len = strlen(names[i]) + 1;
+    name_offsets[i] = offset;
+    memcpy(chunk_names + offset, names[i], len);
+    memcpy(chunk_keys + i * key_size, keys[i], key_size);
+    offset += (uint32_t)len;
+  }
+  name_offsets[num_keys] = offset;
+
+  atomic_init(&chunk->refs, 1);
+  chunk->num_keys = num_keys;
+  chunk->name_offsets = name_offsets;
+  chunk->keys = chunk_keys;
+  chunk->names = chunk_names;
+  return chunk;
+}
+
+
+
+static void ReleaseChunk(KeyChunk* chunk) {
+  if (atomic_fetch_sub_explicit(&chunk->refs, 1, memory_order_acq_rel) == 1) {
+    free(chunk);
+  }
+}
+
+
+
+static void FreeChunkList(ChunkList* list) {
+  for (size_t i = 0; i < list->num_chunks; ++i) {
+    ReleaseChunk(list->chunks[i]);
+  }
+  free(list->chunks);
+}
+
+
+
+static int AppendChunk(ChunkList* list, KeyChunk* chunk) {
+  if (list->num_chunks == list->capacity) {
+    const size_t capacity = list->capacity > 0 ? 2 * list->capacity : 16;
+    KeyChunk** chunks = realloc(list->chunks, capacity * sizeof(KeyChunk*));
+    if (chunks == NULL) {
+      return 0;
+    }
+    list->chunks = chunks;
+    list->capacity = capacity;
+  }
+  list->chunks[list->num_chunks++] = chunk;
+  return 1;
+}
+
+
+
+/*
+ * Function splits sorted keys into chunks of ECCPEM_WATCH_CHUNK_SIZE keys, or
+ * one chunk if they fit into two, and appends them to a chunk list.
+ */
+static int AppendKeys(ChunkList* list, const KeyList* keys, const unsigned int key_size) {
+  size_t chunk_size = keys->num_keys;
+  if (chunk_size > 2 * ECCPEM_WATCH_CHUNK_SIZE) {
+    chunk_size = ECCPEM_WATCH_CHUNK_SIZE;
+  }
+  for (size_t begin = 0; begin < keys->num_keys; begin += chunk_size) {
+    const size_t end = keys->num_keys - begin > chunk_size ? begin + chunk_size : keys->num_keys;
+    KeyChunk* chunk = CreateChunk(keys->names + begin, keys->keys + begin, end - begin, key_size);
+    if (chunk == NULL) {
+      return 0;
+    }
+    if (!AppendChunk(list, chunk)) {
+      ReleaseChunk(chunk);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+
+
+static int PushKey(KeyList* list, const char* name, const uint8_t* key) {
+  if (list->num_keys == list->capacity) {
+    const size_t capacity = list->capacity > 0 ? 2 * list->capacity : 4 * ECCPEM_WATCH_CHUNK_SIZE;
+    const char** names = realloc(list->names, capacity * sizeof(const char*));
+    if (names != NULL) {
+      list->names = names;
+    }
+    const uint8_t** keys = realloc(list->keys, capacity * sizeof(const uint8_t*));
+    if (keys != NULL) {
+      list->keys = keys;
+    }
+    if (names == NULL || keys == NULL) {
+      return 0;
+    }
+    list->capacity = capacity;
+  }
+  list->names[list->num_keys] = name;
+  list->keys[list->num_keys] = key;
+  ++list->num_keys;
+  return 1;
+}
+
+
+
+/*
+ * Function creates a snapshot that takes over the chunks of a list.
+ *
+ * Returns:
+ * - Pointer to the snapshot with one reference.
+ * - NULL if memory allocation failed, the chunks are then released.
+ */
+static EccPemKeySnapshot* CreateSnapshot(ChunkList* list, const unsigned int key_size,
+                                         const uint64_t generation) {
+  EccPemKeySnapshot* snapshot = calloc(1, sizeof(EccPemKeySnapshot));
+  size_t* chunk_starts = malloc((list->num_chunks + 1) * sizeof(size_t));
+  if (snapshot == NULL || chunk_starts == NULL) {
+    free(snapshot);
+    free(chunk_starts);
+    FreeChunkList(list);
+    return NULL;
+  }
+
+  size_t num_keys = 0;
+  for (size_t i = 0; i < list->num_chunks; ++i) {
+    chunk_starts[i] = num_keys;
+    num_keys += list->chunks[i]->num_keys;
+  }
+  chunk_starts[list->num_chunks] = num_keys;
+
+  atomic_init(&snapshot->refs, 1);
+  snapshot->generation = generation;
+  snapshot->key_size = key_size;
+  snapshot->num_keys = num_keys;
+  snapshot->num_chunks = list->num_chunks;
+  snapshot->chunks = list->chunks;
+  snapshot->chunk_starts = chunk_starts;
+  return snapshot;
+}
+
+
+
+/*
+ * Function loads the whole directory of a watcher into a new snapshot.
+ *
+ * Returns:
+ * - Pointer to the snapshot.
+ * - NULL if the directory cannot be scanned or memory allocation failed.
+ */
+static EccPemKeySnapshot* LoadSnapshot(const EccPemKeyWatcher* watcher,
+                                       const uint64_t generation) {
+  EccPemKeyDirectory* key_dir = EccPemKeyDirectoryScan(watcher->directory);
+  if (key_dir == NULL) {
+    return NULL;
+  }
+
+  const size_t num_files = EccPemKeyDirectoryNumFiles(key_dir);
+  uint8_t* public_keys = malloc(num_files * watcher->key_size + 1);
+  int* results = malloc(num_files * sizeof(int) + 1);
+  KeyList keys = {0};
+  ChunkList chunks = {0};
+  int ret_value = public_keys != NULL && results != NULL;
+  if (ret_value && num_files > 0) {
+    EccPemKeyDirectoryLoadPublicKeys(key_dir, public_keys, watcher->key_size, results,
+                                     watcher->num_threads, NULL);
+  }
+  for (size_t i = 0; ret_value && i < num_files; ++i) {
+    if (results[i]) {
+      const char* path = EccPemKeyDirectoryGetFile(key_dir, i);
+      const char* name = strrchr(path, '/');
+      ret_value = PushKey(&keys, name != NULL ? name + 1 : path,
+                          public_keys + i * watcher->key_size);
+    }
+  }
+  /* Names are copied into the chunks, so the scan can be closed afterwards */
+  ret_value = ret_value && AppendKeys(&chunks, &keys, watcher->key_size);
+
+  free(keys.names);
+  free(keys.keys);
+  free(results);
+  free(public_keys);
+  EccPemKeyDirectoryClose(key_dir);
+  if (!ret_value) {
+    FreeChunkList(&chunks);
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating the key snapshot failed.");
+    return NULL;
+  }
+  EccPemKeySnapshot* snapshot = CreateSnapshot(&chunks, watcher->key_size, generation);
+  if (snapshot == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating the key snapshot failed.");
+  }
+  return snapshot;
+}
+
+
+
+/*
+ * Function replaces the snapshot of a watcher and releases the previous one once
+ * no reader can pick it up anymore.
+ */
+static void PublishSnapshot(EccPemKeyWatcher* watcher, EccPemKeySnapshot* snapshot) {
+  EccPemKeySnapshot* previous = atomic_exchange(&watcher->snapshot, snapshot);
+  /* A reader that loaded the previous pointer is counted until it holds a
+   * reference, which takes a few instructions */
+  while (atomic_load(&watcher->num_acquiring) != 0) {
+    sched_yield();
+  }
+  EccPemKeySnapshotRelease(previous);
+}
+
+
+
+EccPemKeyWatcher* EccPemKeyWatcherCreate(const char* directory,
+                                         const unsigned int compressed_key_size,
+                                         const unsigned int num_threads) {
+  if (directory == NULL || compressed_key_size == 0 ||
+      compressed_key_size > ECCPEM_MAX_PUBLIC_KEY_SIZE) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Key directory cannot be NULL and the key size must be valid.");
+    return NULL;
+  }
+
+  EccPemKeyWatcher* watcher = calloc(1, sizeof(EccPemKeyWatcher));
+  if (watcher == NULL || (watcher->directory = strdup(directory)) == NULL ||
+      (watcher->cache = EccPemKeyCacheCreate(ECCPEM_WATCH_CACHE_SIZE)) == NULL) {
+    EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating the key watcher failed.");
+    if (watcher != NULL) {
+      free(watcher->directory);
+    }
+    free(watcher);
+    return NULL;
+  }
+  watcher->key_size = compressed_key_size;
+  watcher->num_threads = num_threads;
+  atomic_init(&watcher->snapshot, NULL);
+  atomic_init(&watcher->num_acquiring, 0);
+
+  /* Watch before loading, so files changed during the load show up as events */
+  watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  watcher->wd = watcher->fd >= 0 ?
+                inotify_add_watch(watcher->fd, directory, ECCPEM_WATCH_EVENTS) : -1;
+  if (watcher->wd < 0) {
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Unable to watch key directory.");
+    EccPemKeyWatcherFree(watcher);
+    return NULL;
+  }
+
+  EccPemKeySnapshot* snapshot = LoadSnapshot(watcher, 1);
+  if (snapshot == NULL) {
+    EccPemKeyWatcherFree(watcher);
+    return NULL;
+  }
+  atomic_store(&watcher->snapshot, snapshot);
+  return watcher;
+}
+
+
+
+void EccPemKeyWatcherFree(EccPemKeyWatcher* watcher) {
+  if (watcher == NULL) {
+    return;
+  }
+  if (watcher->fd >= 0) {
+    close(watcher->fd);
+  }
+  EccPemKeySnapshotRelease(atomic_load(&watcher->snapshot));
+  EccPemKeyCacheFree(watcher->cache);
+  free(watcher->directory);
+  free(watcher);
+}
+
+
+
+int EccPemKeyWatcherGetFd(const EccPemKeyWatcher* watcher) {
+  return watcher != NULL ? watcher->fd : -1;
+}
+
+
+
+/*
+ * Function orders changes by name and, for one name, by arrival.
+ */
+static int CompareChanges(const void* lhs, const void* rhs) {
+  const FileChange* a = (const FileChange*)lhs;
+  const FileChange* b = (const FileChange*)rhs;
+  const int order = strcmp(a->name, b->name);
+  if (order != 0) {
+    return order;
+  }
+  return a->sequence < b->sequence ? -1 : a->sequence > b->sequence;
+}
+
+
+
+static void FreeChanges(FileChange* changes, const size_t num_changes) {
+  for (size_t i = 0; i < num_changes; ++i) {
+    free(changes[i].name);
+  }
+  free(changes);
+}
+
+
+
+/* Changes read from the inotify descriptor. */
+typedef struct {
+  FileChange* changes;
+  size_t num_changes;
+  size_t capacity;
+  size_t num_events;
+  int overflow;
+  int directory_gone;
+} EventBatch;
+
+
+
+static int AppendChange(EventBatch* batch, const char* name, const int removed) {
+  if (batch->num_changes == batch->capacity) {
+    const size_t capacity = batch->capacity > 0 ? 2 * batch->capacity : 64;
+    FileChange* changes = realloc(batch->changes, capacity * sizeof(FileChange));
+    if (changes == NULL) {
+      return 0;
+    }
+    batch->changes = changes;
+    batch->capacity = capacity;
+  }
+  FileChange* change = &batch->changes[batch->num_changes];
+  change->name = strdup(name);
+  if (change->name == NULL) {
+    return 0;
+  }
+  change->sequence = batch->num_changes++;
+  change->removed = removed;
+  return 1;
+}
+
+
+
+/*
+ * Function reads all pending events of a watcher into a batch.
+ *
+ * Returns:
+ * - 1 if the events were read.
+ * - 0 if reading failed or memory allocation failed.
+ */
+static int ReadEvents(const EccPemKeyWatcher* watcher, EventBatch* batch) {
+  char buffer[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)]
+      __attribute__((aligned(__alignof__(struct inotify_event))));
+  for (;;) {
+    const ssize_t len = read(watcher->fd, buffer, sizeof(buffer));
+    if (len < 0 && errno == EINTR) {
+      continue;
+    }
+    if (len < 0 && errno == EAGAIN) {
+      return 1;
+    }
+    if (len <= 0) {
+      EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Reading key directory events failed.");
+      return 0;
+    }
+
+    for (const char* p = buffer; p < buffer + len;) {
+      const struct inotify_event* event = (const struct inotify_event*)p;
+      p += sizeof(struct inotify_event) + event->len;
+      ++batch->num_events;
+      if (event->mask & IN_Q_OVERFLOW) {
+        batch->overflow = 1;
+      }
+      if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+        batch->directory_gone = 1;
+      }
+      if (event->len == 0 || (event->mask & IN_ISDIR) || !HasPemFileExtension(event->name)) {
+        continue;
+      }
+      if (!AppendChange(batch, event->name, (event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0)) {
+        EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating key directory events failed.");
+        return 0;
+      }
+    }
+  }
+}
+
+
+
+/*
+ * Function keeps the last change of every name and reads the keys of the files
+ * that were created or modified through the cache of a watcher. Files whose key
+ * cannot be read turn into removals.
+ *
+ * Returns:
+ * - Number of changes left, sorted by name.
+ */
+static size_t PrepareChanges(EccPemKeyWatcher* watcher, FileChange* changes,
+                             const size_t num_changes, EccPemWatchStats* stats) {
+  qsort(changes, num_changes, sizeof(FileChange), CompareChanges);
+  size_t num_kept = 0;
+  for (size_t i = 0; i < num_changes; ++i) {
+    if (i + 1 < num_changes && strcmp(changes[i].name, changes[i + 1].name) == 0) {
+      free(changes[i].name);
+      continue;
+    }
+    changes[num_kept++] = changes[i];
+  }
+
+  const size_t directory_len = strlen(watcher->directory);
+  for (size_t i = 0; i < num_kept; ++i) {
+    FileChange* change = &changes[i];
+    if (change->removed) {
+      ++stats->num_removed;
+      continue;
+    }
+    const size_t name_len = strlen(change->name);
+    char* path = malloc(directory_len + name_len + 2);
+    int read = 0;
+    if (path != NULL) {
+      memcpy(path, watcher->directory, directory_len);
+      path[directory_len] = '/';
+      memcpy(path + directory_len + 1, change->name, name_len + 1);
+      read = EccPemKeyCacheReadPublicKey(watcher->cache, path, change->key, watcher->key_size);
+      free(path);
+    }
+    if (read) {
+      ++stats->num_updated;
+    } else {
+      change->removed = 1;
+      ++stats->num_failed;
+    }
+  }
+  return num_kept;
+}
+
+
+
+/*
+ * Function merges the keys of a chunk with the sorted changes of its name range.
+ */
+static int MergeChunk(KeyList* keys, const KeyChunk* chunk, const FileChange* changes,
+                      const size_t num_changes, const unsigned int key_size) {
+  size_t i = 0;
+  size_t j = 0;
+  while (i < chunk->num_keys || j < num_changes) {
+    const int order = i == chunk->num_keys ? 1 :
+                      j == num_changes ? -1 : strcmp(ChunkName(chunk, i), changes[j].name);
+    if (order < 0) {
+      if (!PushKey(keys, ChunkName(chunk, i), chunk->keys + i * key_size)) {
+        return 0;
+      }
+      ++i;
+      continue;
+    }
+    if (!changes[j].removed && !PushKey(keys, changes[j].name, changes[j].key)) {
+      return 0;
+    }
+    /* A change replaces the key of the same name */
+    i += order == 0;
+    ++j;
+  }
+  return 1;
+}
+
+
+
+/*
+ * Function builds the snapshot that follows a snapshot with sorted changes. Chunks
+ * without changes are shared.
+ *
+ * Returns:
+ * - Pointer to the new snapshot.
+ * - NULL if memory allocation failed.
+ */
+static EccPemKeySnapshot* UpdateSnapshot(const EccPemKeySnapshot* snapshot,
+                                         const FileChange* changes, const size_t num_changes) {
+  static const KeyChunk kEmptyChunk = {0};
+  const unsigned int key_size = snapshot->key_size;
+  const size_t num_chunks = snapshot->num_chunks;
+  KeyList keys = {0};
+  ChunkList chunks = {0};
+  int ret_value = 1;
+
+  size_t j = 0;
+  for (size_t c = 0; ret_value && c < (num_chunks > 0 ? num_chunks : 1); ++c) {
+    const KeyChunk* chunk = num_chunks > 0 ? snapshot->chunks[c] : &kEmptyChunk;
+    /* A chunk takes the names below the first name of the next one, the first
+     * chunk also those before its own first name */
+    size_t end = j;
+    if (c + 1 < num_chunks) {
+      const char* next_name = ChunkName(snapshot->chunks[c + 1], 0);
+      while (end < num_changes && strcmp(changes[end].name, next_name) < 0) {
+        ++end;
+      }
+    } else {
+      end = num_changes;
+    }
+
+    if (end == j) {
+      atomic_fetch_add_explicit(&snapshot->chunks[c]->refs, 1, memory_order_relaxed);
+      ret_value = AppendChunk(&chunks, snapshot->chunks[c]);
+      if (!ret_value) {
+        ReleaseChunk(snapshot->chunks[c]);
+      }
+      continue;
+    }
+    keys.num_keys = 0;
+    ret_value = MergeChunk(&keys, chunk, changes + j, end - j, key_size) &&
+                AppendKeys(&chunks, &keys, key_size);
+    j = end;
+  }
+
+  free(keys.names);
+  free(keys.keys);
+  if (!ret_value) {
+    FreeChunkList(&chunks);
+    return NULL;
+  }
+  return CreateSnapshot(&chunks, key_size, snapshot->generation + 1);
+}
+
+
+
+int EccPemKeyWatcherPoll(EccPemKeyWatcher* watcher, const int timeout_ms,
+                         EccPemWatchStats* stats) {
+  EccPemWatchStats local_stats;
+  if (stats == NULL) {
+    stats = &local_stats;
+  }
+  memset(stats, 0, sizeof(*stats));
+  if (watcher == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Key watcher cannot be NULL.");
+    return 0;
+  }
+
+  EccPemKeySnapshot* snapshot = atomic_load(&watcher->snapshot);
+  stats->generation = snapshot->generation;
+  struct pollfd poll_fd = {watcher->fd, POLLIN, 0};
+  const int num_ready = poll(&poll_fd, 1, timeout_ms);
+  if (num_ready < 0 && errno != EINTR) {
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Waiting for key directory events failed.");
+    return 0;
+  }
+  if (num_ready <= 0) {
+    return 1;
+  }
+
+  const double start_time = EccPemNowSeconds();
+  EventBatch batch = {0};
+  int ret_value = ReadEvents(watcher, &batch);
+  stats->num_events = batch.num_events;
+  if (ret_value && batch.directory_gone) {
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Key directory was deleted or moved.");
+    ret_value = 0;
+  }
+
+  EccPemKeySnapshot* next = NULL;
+  if (ret_value && batch.overflow) {
+    /* Events were lost, only a new load tells what changed */
+    stats->full_reload = 1;
+    EccPemKeyCacheClear(watcher->cache);
+    next = LoadSnapshot(watcher, snapshot->generation + 1);
+    ret_value = next != NULL;
+  } else if (ret_value && batch.num_changes > 0) {
+    const size_t num_changes = PrepareChanges(watcher, batch.changes, batch.num_changes, stats);
+    batch.num_changes = num_changes;
+    next = UpdateSnapshot(snapshot, batch.changes, num_changes);
+    if (next == NULL) {
+      EccPemReportError(ECCPEM_ERROR_OUT_OF_MEMORY, "Allocating the key snapshot failed.");
+      ret_value = 0;
+    }
+  }
+  FreeChanges(batch.changes, batch.num_changes);
+
+  if (next != NULL) {
+    PublishSnapshot(watcher, next);
+    stats->generation = next->generation;
+  }
+  stats->elapsed_seconds = EccPemNowSeconds() - start_time;
+  return ret_value;
+}
+
+
+
+EccPemKeySnapshot* EccPemKeyWatcherAcquireSnapshot(EccPemKeyWatcher* watcher) {
+  if (watcher == NULL) {
+    return NULL;
+  }
+  atomic_fetch_add(&watcher->num_acquiring, 1);
+  EccPemKeySnapshot* snapshot = atomic_load(&watcher->snapshot);
+  atomic_fetch_add_explicit(&snapshot->refs, 1, memory_order_relaxed);
+  atomic_fetch_sub(&watcher->num_acquiring, 1);
+  return snapshot;
+}
+
+
+
+void EccPemKeySnapshotRelease(EccPemKeySnapshot* snapshot) {
+  if (snapshot == NULL ||
+      atomic_fetch_sub_explicit(&snapshot->refs, 1, memory_order_acq_rel) != 1) {
+    return;
+  }
+  for (size_t i = 0; i < snapshot->num_chunks; ++i) {
+    ReleaseChunk(snapshot->chunks[i]);
+  }
+  free(snapshot->chunks);
+  free(snapshot->chunk_starts);
+  free(snapshot);
+}
+
+
+
+size_t EccPemKeySnapshotNumKeys(const EccPemKeySnapshot* snapshot) {
+  return snapshot != NULL ? snapshot->num_keys : 0;
+}
+
+
+
+uint64_t EccPemKeySnapshotGetGeneration(const EccPemKeySnapshot* snapshot) {
+  return snapshot != NULL ? snapshot->generation : 0;
+}
+
+
+
+const uint8_t* EccPemKeySnapshotFind(const EccPemKeySnapshot* snapshot, const char* file_name) {
+  if (snapshot == NULL || file_name == NULL || snapshot->num_chunks == 0) {
+    return NULL;
+  }
+
+  /* Last chunk whose first name is not above the file name */
+  size_t low = 0;
+  size_t high = snapshot->num_chunks;
+  while (high - low > 1) {
+    const size_t mid = low + (high - low) / 2;
+    if (strcmp(ChunkName(snapshot->chunks[mid], 0), file_name) <= 0) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+
+  const KeyChunk* chunk = snapshot->chunks[low];
+  low = 0;
+  high = chunk->num_keys;
+  while (low < high) {
+    const size_t mid = low + (high - low) / 2;
+    const int order = strcmp(ChunkName(chunk, mid), file_name);
+    if (order == 0) {
+      return chunk->keys + mid * snapshot->key_size;
+    }
+    if (order < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return NULL;
+}
+
+
+
+const uint8_t* EccPemKeySnapshotGetKey(const EccPemKeySnapshot* snapshot, const size_t index,
+                                       const char** file_name) {
+  if (snapshot == NULL || index >= snapshot->num_keys) {
+    return NULL;
+  }
+
+  /* Last chunk that starts at or before the index */
+  size_t low = 0;
+  size_t high = snapshot->num_chunks;
+  while (high - low > 1) {
+    const size_t mid = low + (high - low) / 2;
+    if (snapshot->chunk_starts[mid] <= index) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+
+  const KeyChunk* chunk = snapshot->chunks[low];
+  const size_t chunk_index = index - snapshot->chunk_starts[low];
+  if (file_name != NULL) {
+    *file_name = ChunkName(chunk, chunk_index);
+  }
+  return chunk->keys + chunk_index * snapshot->key_size;
+}
@@ -11,6 +11,7 @@
  */
 
 #include "eccpem_write.h"
+#include "eccpem_internal.h"
 #include "utils.h"
 
 #include <stdio.h>
@@ -18,6 +19,7 @@
 #include <openssl/ec.h>
 #include <openssl/bio.h>
 #include <openssl/pem.h>
+#include <openssl/x509.h>
 
 /*
  * Function generates an Elliptic Curve Cryptography (ECC) key pair and writes the
@@ -45,48 +47,72 @@ int CreateECCKeysPemFiles(const char* ec_type,
                           const char* privkey_file) {
   /* Sanity checking of arguments. */
   if (ec_type == NULL) {
-    fprintf(stderr, "Elliptic Curve type cannot be NULL. "
-            "Run 'openssl ecparam -list_curves' command to list EC types.");
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Elliptic Curve type cannot be NULL. "
+                      "Run 'openssl ecparam -list_curves' command to list EC types.");
     return 0;
   }
 
-  /* Verify both key files have .pem extension */
-  if (!VerifyPemFileFormat(pubkey_file) || !VerifyPemFileFormat(privkey_file)) {
+  /* The file names are verified by CreateECCKeysPemFilesWithCurve */
+  const EccPemCurve* curve = EccPemGetCurve(ec_type);
+  if (curve == NULL) {
     return 0;
   }
+  return CreateECCKeysPemFilesWithCurve(curve, pubkey_file, privkey_file);
+}
 
-  /* Create a new EVP_PKEY context for key generation */
-  EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
-  if (ctx == NULL) {
-    fprintf(stderr, "Creating EVP_PKEY_CTX failed.\n");
+
+
+/*
+ * Function generates an Elliptic Curve Cryptography (ECC) key pair on a cached
+ * curve and writes the public and private keys to separate PEM formatted files.
+ * It is CreateECCKeysPemFiles without resolving a curve name.
+ *
+ * Arguments:
+ * - curve: Handle of the elliptic curve, see EccPemGetCurve.
+ * - pubkey_file: Path to the PEM file (.pem extension) where the public key will
+ *                be written
+ * - privkey_file: Path to the PEM file (.pem extension) where the private key will
+ *                 be written
+ *
+ * Returns:
+ * - 1 on success: Key pair was generated and written to files successfully
+ * - 0 on failure: Returns 0 if any of the following operations fail:
+ *     - Creating the key generation context
+ *     - Generating the EC key pair
+ *     - Writing either the public or private key to their respective PEM files
+ */
+int CreateECCKeysPemFilesWithCurve(const EccPemCurve* curve,
+                                   const char* pubkey_file,
+                                   const char* privkey_file) {
+  if (curve == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT, "Curve handle cannot be NULL.");
     return 0;
   }
 
-  /* Initialize key generation */
-  if (EVP_PKEY_keygen_init(ctx) <= 0) {
-    fprintf(stderr, "Initializing key generation failed.\n");
-    EVP_PKEY_CTX_free(ctx);
+  /* Verify both key files have .pem extension */
+  if (!VerifyPemFileFormat(pubkey_file) || !VerifyPemFileFormat(privkey_file)) {
     return 0;
   }
 
-  /* Set the EC curve by name */
-  if (EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, OBJ_txt2nid(ec_type)) <= 0) {
-    fprintf(stderr, "Setting EC curve parameters failed.\n");
-    EVP_PKEY_CTX_free(ctx);
+  /* Create a new EVP_PKEY context for key generation from the curve's template */
+  EVP_PKEY_CTX *ctx = CreateKeygenContext(curve);
+  if (ctx == NULL) {
     return 0;
   }
 
   /* Generate the key pair */
   EVP_PKEY *pkey = NULL;
-  if (EVP_PKEY_keygen(ctx, &pkey) <= 0) {
-    fprintf(stderr, "Generating EC key pair failed.\n");
+  if (EccPemKeygen(ctx, &pkey) <= 0) {
+    EccPemReportError(ECCPEM_ERROR_KEYGEN_FAILED, "Generating EC key pair failed.");
     EVP_PKEY_CTX_free(ctx);
     return 0;
   }
 
   /* Write private and public keys' (binary data) in PEM format. */
   if (!WriteKeysToPEMFiles(pkey, pubkey_file, privkey_file)) {
-    fprintf(stderr, "Writing private and public keys in PEM format files failed.\n");
+    EccPemReportError(ECCPEM_ERROR_WRITE_FAILED,
+                      "Writing private and public keys in PEM format files failed.");
     EVP_PKEY_free(pkey);
     EVP_PKEY_CTX_free(ctx);
     return 0;
@@ -101,6 +127,303 @@ int CreateECCKeysPemFiles(const char* ec_type,
 
 
 
+/*
+ * Function generates a batch of Elliptic Curve Cryptography (ECC) key pairs on
+ * the same curve and writes each pair to its own public and private PEM files.
+ * The key generation context and the curve are set up only once for the whole
+ * batch, and all keys are encoded into the same reusable arenas, so per key only
+ * the key generation, one encoding pass and one write call per file are paid.
+ *
+ * Arguments:
+ * - ec_type: The type of elliptic curve to use for key generation. Must be a valid
+ *            curve name as listed by the command: openssl ecparam -list_curves
+ * - num_keys: Number of key pairs to generate.
+ * - pubkey_files: Array of num_keys paths (.pem extension) where the public keys
+ *                 will be written.
+ * - privkey_files: Array of num_keys paths (.pem extension) where the private
+ *                  keys will be written.
+ * - results: Optional array of num_keys entries (may be NULL). Entry i is set to
+ *            1 if the i-th key pair was generated and written, and to 0 otherwise.
+ *
+ * Returns:
+ * - Number of key pairs that were generated and written successfully. 0 is also
+ *   returned if the arguments are invalid or the curve cannot be set up, in
+ *   which case every entry of results is set to 0.
+ */
+size_t CreateECCKeysPemFilesBatch(const char* ec_type,
+                                  const size_t num_keys,
+                                  const char* const pubkey_files[],
+                                  const char* const privkey_files[],
+                                  int results[]) {
+  if (results != NULL) {
+    memset(results, 0, num_keys * sizeof(results[0]));
+  }
+
+  /* Sanity checking of arguments. */
+  if (ec_type == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Elliptic Curve type cannot be NULL. "
+                      "Run 'openssl ecparam -list_curves' command to list EC types.");
+    return 0;
+  }
+
+  if (pubkey_files == NULL || privkey_files == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Public and private key file arrays cannot be NULL.");
+    return 0;
+  }
+
+  /* Resolve the curve and set up the context once for the whole batch */
+  const EccPemCurve* curve = EccPemGetCurve(ec_type);
+  if (curve == NULL) {
+    return 0;
+  }
+
+  EVP_PKEY_CTX *ctx = CreateKeygenContext(curve);
+  if (ctx == NULL) {
+    return 0;
+  }
+
+  /* Every key pair is encoded into the same two arenas */
+  EccPemArena pubkey_arena;
+  EccPemArena privkey_arena;
+  EccPemArenaInit(&pubkey_arena);
+  EccPemArenaInit(&privkey_arena);
+
+  size_t num_created = 0;
+  for (size_t i = 0; i < num_keys; ++i) {
+    if (!VerifyPemFileFormat(pubkey_files[i]) ||
+        !VerifyPemFileFormat(privkey_files[i])) {
+      continue;
+    }
+
+    EVP_PKEY *pkey = NULL;
+    if (EccPemKeygen(ctx, &pkey) <= 0) {
+      EccPemReportError(ECCPEM_ERROR_KEYGEN_FAILED, "Generating EC key pair failed.");
+      continue;
+    }
+
+    if (!WriteKeyPairWithArenas(curve, pkey, pubkey_files[i], privkey_files[i],
+                                &pubkey_arena, &privkey_arena)) {
+      EccPemReportError(ECCPEM_ERROR_WRITE_FAILED,
+                        "Writing private and public keys in PEM format files failed.");
+      EVP_PKEY_free(pkey);
+      continue;
+    }
+    EVP_PKEY_free(pkey);
+
+    if (results != NULL) {
+      results[i] = 1;
+    }
+    ++num_created;
+  }
+
+  EccPemArenaFree(&pubkey_arena);
+  EccPemArenaFree(&privkey_arena);
+  EVP_PKEY_CTX_free(ctx);
+  return num_created;
+}
+
+
+
+/*
+ * Function encodes DER data as a PEM block into a caller provided buffer and
+ * null-terminates it.
+ *
+ * Arguments:
+ * - label: Label of the PEM block.
+ * - der: DER encoded key.
+ * - der_len: Length of the DER data.
+ * - pem: Output buffer where the PEM data will be stored.
+ * - pem_size: Size of output buffer. It must hold the PEM data and the
+ *             terminating null character.
+ * - pem_len: Where the length of the PEM data (without the terminating null
+ *            character) will be stored. It is set even if the buffer is too
+ *            small, so the caller can retry with a larger buffer.
+ *
+ * Returns:
+ * - 1 if the PEM data was stored in the buffer.
+ * - 0 if the buffer is too small.
+ */
+static int EncodePemToBuffer(const char* label, const uint8_t der[], const size_t der_len,
+                             char pem[], const size_t pem_size, size_t* pem_len) {
+  if (!EccPemEncodeBlock(label, der, der_len, pem, pem_size > 0 ? pem_size - 1 : 0,
+                         pem_len)) {
+    EccPemReportErrorf(ECCPEM_ERROR_BUFFER_TOO_SMALL,
+                       "PEM buffer is too small, %zu bytes are required.", *pem_len + 1);
+    return 0;
+  }
+  pem[*pem_len] = '\0';
+  return 1;
+}
+
+
+
+/*
+ * Function encodes the public and private keys of an EVP_PKEY structure in PEM
+ * format into caller provided buffers, the same way PEM_write_PUBKEY and
+ * PEM_write_PrivateKey do. Both buffers are null-terminated. Keys of a cached
+ * curve are DER encoded from the curve's templates, other keys with the OpenSSL
+ * encoders.
+ *
+ * Returns:
+ * - 1 if both keys were stored in the buffers.
+ * - 0 if encoding failed or a buffer is too small. In the latter case the
+ *   required lengths are still stored.
+ */
+static int EncodeKeyPairPem(const EccPemCurve* curve, EVP_PKEY* pkey,
+                            char pubkey_pem[], const size_t pubkey_pem_size,
+                            size_t* pubkey_pem_len,
+                            char privkey_pem[], const size_t privkey_pem_size,
+                            size_t* privkey_pem_len) {
+  /* Keys of a cached curve are encoded from its templates into stack buffers */
+  uint8_t template_pubkey_der[ECCPEM_MAX_KEY_DER_SIZE];
+  uint8_t template_privkey_der[ECCPEM_MAX_KEY_DER_SIZE];
+  size_t template_pubkey_der_len = 0;
+  size_t template_privkey_der_len = 0;
+  if (curve != NULL &&
+      EccPemCurveEncodeKeyDer(curve, pkey, template_pubkey_der, &template_pubkey_der_len,
+                              template_privkey_der, &template_privkey_der_len)) {
+    const int pub_encoded = EncodePemToBuffer(PEM_STRING_PUBLIC, template_pubkey_der,
+                                              template_pubkey_der_len, pubkey_pem,
+                                              pubkey_pem_size, pubkey_pem_len);
+    const int priv_encoded = EncodePemToBuffer(PEM_STRING_PKCS8INF, template_privkey_der,
+                                               template_privkey_der_len, privkey_pem,
+                                               privkey_pem_size, privkey_pem_len);
+    OPENSSL_cleanse(template_privkey_der, template_privkey_der_len);
+    return pub_encoded && priv_encoded;
+  }
+
+  /* Otherwise encode both keys as DER, the private key as unencrypted PKCS#8
+   * like PEM_write_bio_PrivateKey does */
+  uint8_t* pubkey_der = NULL;
+  uint8_t* privkey_der = NULL;
+  const int pubkey_der_len = i2d_PUBKEY(pkey, &pubkey_der);
+  PKCS8_PRIV_KEY_INFO* p8info = EVP_PKEY2PKCS8(pkey);
+  const int privkey_der_len = p8info != NULL ? i2d_PKCS8_PRIV_KEY_INFO(p8info, &privkey_der)
+                                             : -1;
+  PKCS8_PRIV_KEY_INFO_free(p8info);
+
+  int ret_value = 1;
+  if (privkey_der_len <= 0) {
+    EccPemReportError(ECCPEM_ERROR_ENCODE_FAILED, "Error writing private key data in PEM format.");
+    ret_value = 0;
+  } else if (pubkey_der_len <= 0) {
+    EccPemReportError(ECCPEM_ERROR_ENCODE_FAILED, "Error writing public key data in PEM format.");
+    ret_value = 0;
+  } else {
+    /* Encode both so the caller learns both required lengths on failure */
+    const int pub_encoded = EncodePemToBuffer(PEM_STRING_PUBLIC, pubkey_der,
+                                              (size_t)pubkey_der_len, pubkey_pem,
+                                              pubkey_pem_size, pubkey_pem_len);
+    const int priv_encoded = EncodePemToBuffer(PEM_STRING_PKCS8INF, privkey_der,
+                                               (size_t)privkey_der_len, privkey_pem,
+                                               privkey_pem_size, privkey_pem_len);
+    ret_value = pub_encoded && priv_encoded;
+  }
+
+  /* The private key DER is secret material, wipe it before freeing */
+  OPENSSL_free(pubkey_der);
+  if (privkey_der_len > 0) {
+    OPENSSL_clear_free(privkey_der, (size_t)privkey_der_len);
+  }
+  return ret_value;
+}
+
+
+
+int EncodeKeysToPemBuffers(const EccPemCurve* curve, EVP_PKEY* pkey,
+                           char pubkey_pem[], const size_t pubkey_pem_size,
+                           size_t* pubkey_pem_len,
+                           char privkey_pem[], const size_t privkey_pem_size,
+                           size_t* privkey_pem_len) {
+  ECCPEM_STAGE_BEGIN(encode_timer);
+  const int ret_value = EncodeKeyPairPem(curve, pkey, pubkey_pem, pubkey_pem_size,
+                                         pubkey_pem_len, privkey_pem, privkey_pem_size,
+                                         privkey_pem_len);
+  ECCPEM_STAGE_END(ECCPEM_STAGE_PEM_ENCODE, encode_timer);
+  return ret_value;
+}
+
+
+
+/*
+ * Function generates an Elliptic Curve Cryptography (ECC) key pair and writes the
+ * public and private keys in PEM format to caller provided memory buffers instead
+ * of files. The buffers are null-terminated.
+ *
+ * Arguments:
+ * - ec_type: The type of elliptic curve to use for key generation. Must be a valid
+ *            curve name as listed by the command: openssl ecparam -list_curves
+ * - pubkey_pem: Buffer where the PEM formatted public key will be written
+ * - pubkey_pem_size: Size of pubkey_pem buffer
+ * - pubkey_pem_len: Where the length of the public key PEM data (without the
+ *                   terminating null character) will be stored
+ * - privkey_pem: Buffer where the PEM formatted private key will be written
+ * - privkey_pem_size: Size of privkey_pem buffer
+ * - privkey_pem_len: Where the length of the private key PEM data (without the
+ *                    terminating null character) will be stored
+ *
+ * Returns:
+ * - 1 on success: Key pair was generated and written to buffers successfully
+ * - 0 on failure: Returns 0 if any of the following operations fail:
+ *     - Invalid arguments
+ *     - Creating or configuring the key generation context
+ *     - Generating the EC key pair
+ *     - Encoding the keys in PEM format
+ *     - Either buffer is too small (the required lengths are still stored)
+ */
+int CreateECCKeysPemBuffers(const char* ec_type,
+                            char pubkey_pem[],
+                            const size_t pubkey_pem_size,
+                            size_t* pubkey_pem_len,
+                            char privkey_pem[],
+                            const size_t privkey_pem_size,
+                            size_t* privkey_pem_len) {
+  /* Sanity checking of arguments. */
+  if (ec_type == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "Elliptic Curve type cannot be NULL. "
+                      "Run 'openssl ecparam -list_curves' command to list EC types.");
+    return 0;
+  }
+
+  if (pubkey_pem == NULL || pubkey_pem_len == NULL ||
+      privkey_pem == NULL || privkey_pem_len == NULL) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_ARGUMENT,
+                      "PEM output buffers and lengths cannot be NULL.");
+    return 0;
+  }
+
+  const EccPemCurve* curve = EccPemGetCurve(ec_type);
+  if (curve == NULL) {
+    return 0;
+  }
+
+  /* Create a new EVP_PKEY context for key generation from the curve's template */
+  EVP_PKEY_CTX *ctx = CreateKeygenContext(curve);
+  if (ctx == NULL) {
+    return 0;
+  }
+
+  /* Generate the key pair */
+  EVP_PKEY *pkey = NULL;
+  if (EccPemKeygen(ctx, &pkey) <= 0) {
+    EccPemReportError(ECCPEM_ERROR_KEYGEN_FAILED, "Generating EC key pair failed.");
+    EVP_PKEY_CTX_free(ctx);
+    return 0;
+  }
+  EVP_PKEY_CTX_free(ctx);
+
+  const int ret_value = EncodeKeysToPemBuffers(curve, pkey, pubkey_pem, pubkey_pem_size,
+                                               pubkey_pem_len, privkey_pem,
+                                               privkey_pem_size, privkey_pem_len);
+  EVP_PKEY_free(pkey);
+  return ret_value;
+}
+
+
+
 /*
  * Function writes private and public keys to PEM formatted files. The keys are
  * represented by an EVP_PKEY structure. If the target files already exist, they
@@ -115,18 +438,18 @@ int CreateECCKeysPemFiles(const char* ec_type,
  * - 1 if both PEM files were written successfully
  * - 0 if creating or writing to either PEM file failed, or if any other error occurred
  */
-static int WriteKeysToPEMFiles(EVP_PKEY* pkey,
-                               const char* pubkey_file,
-                               const char* privkey_file) {
+static int WriteKeysToPemFilesStdio(EVP_PKEY* pkey,
+                                    const char* pubkey_file,
+                                    const char* privkey_file) {
   /* Write private key to file */
   FILE* privkey_fp = fopen(privkey_file, "w");
   if (privkey_fp == NULL) {
-    fprintf(stderr, "Unable to open private key file for writing.\n");
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Unable to open private key file for writing.");
     return 0;
   }
 
   if (!PEM_write_PrivateKey(privkey_fp, pkey, NULL, NULL, 0, NULL, NULL)) {
-    fprintf(stderr, "Error writing private key data in PEM format.\n");
+    EccPemReportError(ECCPEM_ERROR_WRITE_FAILED, "Error writing private key data in PEM format.");
     fclose(privkey_fp);
     return 0;
   }
@@ -135,12 +458,12 @@ static int WriteKeysToPEMFiles(EVP_PKEY* pkey,
   /* Write public key to file */
   FILE* pubkey_fp = fopen(pubkey_file, "w");
   if (pubkey_fp == NULL) {
-    fprintf(stderr, "Unable to open public key file for writing.\n");
+    EccPemReportError(ECCPEM_ERROR_OPEN_FAILED, "Unable to open public key file for writing.");
     return 0;
   }
 
   if (!PEM_write_PUBKEY(pubkey_fp, pkey)) {
-    fprintf(stderr, "Error writing public key data in PEM format.\n");
+    EccPemReportError(ECCPEM_ERROR_WRITE_FAILED, "Error writing public key data in PEM format.");
     fclose(pubkey_fp);
     return 0;
   }
@@ -148,3 +471,54 @@ static int WriteKeysToPEMFiles(EVP_PKEY* pkey,
   return 1;
 }
 
+
+
+int WriteKeysToPEMFiles(EVP_PKEY* pkey,
+                        const char* pubkey_file,
+                        const char* privkey_file) {
+  /* PEM_write_* encode while writing, so all of it counts as the write stage */
+  ECCPEM_STAGE_BEGIN(write_timer);
+  const int ret_value = WriteKeysToPemFilesStdio(pkey, pubkey_file, privkey_file);
+  ECCPEM_STAGE_END(ECCPEM_STAGE_WRITE, write_timer);
+  return ret_value;
+}
+
+
+
+
+/*
+ * Function writes a key pair to PEM formatted files through two arenas. The
+ * private key file is written first, like WriteKeysToPEMFiles does.
+ *
+ * Arguments:
+ * - curve: Handle of the curve the key pair was generated on.
+ * - pkey: EVP_PKEY structure containing both the private and public keys
+ * - pubkey_file: Path where the public key will be written in PEM format
+ * - privkey_file: Path where the private key will be written in PEM format
+ * - pubkey_arena, privkey_arena: Arenas the keys are encoded into. They
+ *                                are cleared before and after use.
+ *
+ * Returns:
+ * - 1 if both PEM files were written successfully
+ * - 0 if encoding or writing either PEM file failed
+ */
+int WriteKeyPairWithArenas(const EccPemCurve* curve, EVP_PKEY* pkey,
+                           const char* pubkey_file, const char* privkey_file,
+                           EccPemArena* pubkey_arena, EccPemArena* privkey_arena) {
+  EccPemArenaClear(pubkey_arena);
+  EccPemArenaClear(privkey_arena);
+  if (!EccPemArenaAppendKeyPair(pubkey_arena, privkey_arena, curve, pkey)) {
+    return 0;
+  }
+
+  int ret_value = 1;
+  if (!EccPemWriteFile(privkey_file, privkey_arena->data, privkey_arena->len)) {
+    EccPemReportError(ECCPEM_ERROR_WRITE_FAILED, "Unable to write private key file.");
+    ret_value = 0;
+  } else if (!EccPemWriteFile(pubkey_file, pubkey_arena->data, pubkey_arena->len)) {
+    EccPemReportError(ECCPEM_ERROR_WRITE_FAILED, "Unable to write public key file.");
+    ret_value = 0;
+  }
+  EccPemArenaClear(privkey_arena);
+  return ret_value;
+}
@@ -0,0 +1,212 @@
+/*
+ * ===--- pem_scan.c --------------------------------------------------------===
+ *
+ * This file is distributed under the MIT License. See LICENSE for details.
+ *
+ * AUTHOR: Artiom Baloian <artiom.baloian@nyu.edu>
+ *
+ * DESCRIPTION:
+ * File provides a scanner that locates PEM blocks directly in a memory region
+ * (a buffer or a memory mapped file) without copying them, and a structural
+ * pre-scan that tells whether a region can hold a key before it is decoded.
+ */
+
+/* memmem is a GNU extension */
+#define _GNU_SOURCE
+
+#include "eccpem_internal.h"
+
+#include <string.h>
+#include <openssl/pem.h>
+
+#define PEM_BEGIN_MARKER "-----BEGIN "
+#define PEM_END_MARKER "-----END "
+#define PEM_DASHES "-----"
+
+/* DER lengths of plausible EC keys. The smallest named curve keys are larger than
+ * the minimum, and keys with explicit parameters and encrypted keys stay well
+ * below the maximum. */
+#define PEM_SCAN_MIN_DER_SIZE 16
+#define PEM_SCAN_MAX_DER_SIZE 16384
+
+/*
+ * Function returns the end of the line starting at line, which is either the
+ * position of its '\n' or the end of the region.
+ */
+static const char* FindLineEnd(const char* line, const char* end) {
+  const char* newline = memchr(line, '\n', (size_t)(end - line));
+  return newline != NULL ? newline : end;
+}
+
+
+
+/*
+ * Function finds the first marker that starts a line of the region, like
+ * PEM_read_bio, which only looks for markers at the start of a line. Line starts
+ * are the start of the data and every position after a '\n'.
+ *
+ * Returns:
+ * - Start of the line holding the marker.
+ * - NULL if no line of the region starts with it.
+ */
+static const char* FindMarkerLine(const char* data, const char* cursor, const char* end,
+                                  const char* marker, const size_t marker_len) {
+  while (cursor < end) {
+    const char* match = memmem(cursor, (size_t)(end - cursor), marker, marker_len);
+    if (match == NULL) {
+      return NULL;
+    }
+    if (match == data || match[-1] == '\n') {
+      return match;
+    }
+    /* Markers in the middle of a line do not count, go on with the next line */
+    const char* line_end = FindLineEnd(match, end);
+    cursor = line_end < end ? line_end + 1 : end;
+  }
+  return NULL;
+}
+
+
+
+/*
+ * Function parses the label of a "-----BEGIN <label>-----" or
+ * "-----END <label>-----" line. Trailing whitespace ('\r', spaces and tabs) is
+ * allowed, as PEM_read_bio strips it as well.
+ *
+ * Returns:
+ * - 1 if the line is well formed, label and label_len are then set.
+ * - 0 otherwise.
+ */
+static int ParseMarkerLabel(const char* line, const char* line_end, const size_t marker_len,
+                            const char** label, size_t* label_len) {
+  while (line_end > line &&
+         (line_end[-1] == '\r' || line_end[-1] == ' ' || line_end[-1] == '\t')) {
+    --line_end;
+  }
+  const size_t dashes_len = sizeof(PEM_DASHES) - 1;
+  if ((size_t)(line_end - line) < marker_len + dashes_len ||
+      memcmp(line_end - dashes_len, PEM_DASHES, dashes_len) != 0) {
+    return 0;
+  }
+  *label = line + marker_len;
+  *label_len = (size_t)(line_end - dashes_len - *label);
+  return 1;
+}
+
+
+
+int EccPemFindBlock(const char* data, const size_t data_len, const size_t offset,
+                    EccPemBlock* block) {
+  const char* end = data + data_len;
+  const char* cursor = data + offset;
+  const size_t begin_len = sizeof(PEM_BEGIN_MARKER) - 1;
+  const size_t end_len = sizeof(PEM_END_MARKER) - 1;
+
+  while (cursor < end) {
+    const char* begin_line = FindMarkerLine(data, cursor, end, PEM_BEGIN_MARKER, begin_len);
+    if (begin_line == NULL) {
+      return 0;
+    }
+
+    const char* begin_line_end = FindLineEnd(begin_line, end);
+    if (!ParseMarkerLabel(begin_line, begin_line_end, begin_len,
+                          &block->label, &block->label_len)) {
+      /* Not a BEGIN line after all, go on with the next line */
+      cursor = begin_line_end;
+      continue;
+    }
+
+    block->body = begin_line_end < end ? begin_line_end + 1 : end;
+    block->complete = 0;
+
+    const char* end_line = FindMarkerLine(data, block->body, end, PEM_END_MARKER, end_len);
+    if (end_line == NULL) {
+      /* Truncated block, it runs until the end of the region */
+      block->body_len = (size_t)(end - block->body);
+      block->next = data_len;
+      return 1;
+    }
+
+    const char* end_line_end = FindLineEnd(end_line, end);
+    const char* end_label = NULL;
+    size_t end_label_len = 0;
+    block->body_len = (size_t)(end_line - block->body);
+    block->next = (size_t)((end_line_end < end ? end_line_end + 1 : end) - data);
+    block->complete = ParseMarkerLabel(end_line, end_line_end, end_len, &end_label, &end_label_len) &&
+                      end_label_len == block->label_len &&
+                      memcmp(end_label, block->label, end_label_len) == 0;
+    return 1;
+  }
+  return 0;
+}
+
+
+
+int EccPemBlockHasLabel(const EccPemBlock* block, const char* label) {
+  const size_t label_len = strlen(label);
+  return block->label_len == label_len && memcmp(block->label, label, label_len) == 0;
+}
+
+
+
+/*
+ * Function returns the start of the base64 data of a block body. RFC 1421
+ * headers ("Proc-Type: ..." lines up to an empty line) are skipped.
+ *
+ * Returns:
+ * - Start of the base64 data.
+ * - NULL if headers are not terminated by an empty line.
+ */
+static const char* SkipBodyHeaders(const char* body, const char* end) {
+  const char* first_line_end = FindLineEnd(body, end);
+  if (memchr(body, ':', (size_t)(first_line_end - body)) == NULL) {
+    return body;
+  }
+  const char* line = body;
+  while (line < end) {
+    const char* line_end = FindLineEnd(line, end);
+    const char* next_line = line_end < end ? line_end + 1 : end;
+    if (line_end == line || (line_end == line + 1 && line[0] == '\r')) {
+      return next_line;
+    }
+    line = next_line;
+  }
+  return NULL;
+}
+
+
+
+/*
+ * Function reports whether a block has one of the labels of a private or public
+ * key.
+ */
+static int HasKeyLabel(const EccPemBlock* block, const int private_key) {
+  if (!private_key) {
+    return EccPemBlockHasLabel(block, PEM_STRING_PUBLIC);
+  }
+  return EccPemBlockHasLabel(block, PEM_STRING_PKCS8INF) ||
+         EccPemBlockHasLabel(block, PEM_STRING_PKCS8) ||
+         EccPemBlockHasLabel(block, PEM_STRING_ECPRIVATEKEY);
+}
+
+
+
+int EccPemFindKeyBlock(const char* data, const size_t data_len, const int private_key,
+                       EccPemBlock* block) {
+  size_t offset = 0;
+  /* Keys may follow other blocks, e.g. "EC PARAMETERS" */
+  while (offset < data_len && EccPemFindBlock(data, data_len, offset, block)) {
+    offset = block->next;
+    if (!block->complete || !HasKeyLabel(block, private_key)) {
+      continue;
+    }
+    const char* end = block->body + block->body_len;
+    const char* base64 = SkipBodyHeaders(block->body, end);
+    size_t der_len = 0;
+    if (base64 != NULL && EccPemBase64CheckBody(base64, (size_t)(end - base64), &der_len) &&
+        der_len >= PEM_SCAN_MIN_DER_SIZE && der_len <= PEM_SCAN_MAX_DER_SIZE) {
+      return 1;
+    }
+  }
+  return 0;
+}
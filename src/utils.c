@@ -10,11 +10,30 @@
  */
 
 #include "utils.h"
+#include "eccpem_internal.h"
 
 #include <stdio.h>
 #include <string.h>
 
 
+/*
+ * Function checks that a file name has a .pem extension, the check that
+ * VerifyPemFileFormat performs, without reporting an error.
+ *
+ * Returns:
+ * - 1 if the file name ends with .pem.
+ * - 0 otherwise, or if pem_file is NULL.
+ */
+int HasPemFileExtension(const char* pem_file) {
+  if (pem_file == NULL) {
+    return 0;
+  }
+  const char* pem_file_last_dot = strrchr(pem_file, '.');
+  return pem_file_last_dot != NULL && strcmp(pem_file_last_dot, ".pem") == 0;
+}
+
+
+
 /*
  * Function verifies that the input file has a .pem extension and is properly
  * formatted as a PEM file.
@@ -29,24 +48,26 @@
  *     PEM-formatted.
  */
 int VerifyPemFileFormat(const char* pem_file) {
-  if (pem_file == NULL) {
-    fprintf(stderr, "Provided public/private key file must be PEM "
-                    "format (extension is .pem).\n");
-    return 0;
-  }
   /* Key files must be in PEM format with .pem extension. */
-  const char* pem_file_last_dot = strrchr(pem_file, '.');
-  if (pem_file_last_dot == NULL) {
-    fprintf(stderr, "Provided public/private key file must be PEM "
-                    "format (extension is .pem).\n");
+  if (!HasPemFileExtension(pem_file)) {
+    EccPemReportError(ECCPEM_ERROR_INVALID_FILE_NAME,
+                      "Provided public/private key file must be PEM format (extension is .pem).");
     return 0;
-  } else {
-    if (strcmp(pem_file_last_dot, ".pem") != 0) {
-      fprintf(stderr, "Provided public/private key file must be PEM "
-                      "format (extension is .pem).\n");
-      return 0;
-    }
   }
   return 1;
 }
 
+
+
+/*
+ * Function checks that PEM data holds a complete key block of the wanted type
+ * with a well formed base64 body, without decoding it or reporting an error.
+ *
+ * Returns:
+ * - 1 if the data holds a block that can be such a key.
+ * - 0 otherwise, or if pem is NULL.
+ */
+int HasPemKeyBlock(const char* pem, const size_t pem_len, const int private_key) {
+  EccPemBlock block;
+  return pem != NULL && EccPemFindKeyBlock(pem, pem_len, private_key, &block);
+}
@@ -0,0 +1,91 @@
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "eccpem_async.h"
+#include "eccpem_curve.h"
+#include "eccpem_read.h"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+typedef struct {
+  atomic_int num_completed;
+  atomic_int num_succeeded;
+} AsyncTestCompletions;
+
+static void AsyncTestCallback(int result, void* user_data) {
+  AsyncTestCompletions* completions = (AsyncTestCompletions*)user_data;
+  if (result == 1) {
+    atomic_fetch_add(&completions->num_succeeded, 1);
+  }
+  atomic_fetch_add(&completions->num_completed, 1);
+}
+
+void RUN_ASYNC_KEYGEN_TESTS() {
+  printf("\nTesting EccPemGenerateAsync...\n");
+
+  const EccPemCurve* curve = EccPemGetCurve("prime256v1");
+  TEST_ASSERT_EQUAL_INT(curve != NULL, 1);
+
+  // Test requests are completed and written before shutdown returns
+  enum { kNumKeys = 40 };
+  char pub_names[kNumKeys][32];
+  char priv_names[kNumKeys][32];
+  AsyncTestCompletions completions;
+  atomic_init(&completions.num_completed, 0);
+  atomic_init(&completions.num_succeeded, 0);
+  TEST_ASSERT_EQUAL_INT(EccPemAsyncInit(2), 1);
+  for (int i = 0; i < kNumKeys; ++i) {
+    snprintf(pub_names[i], sizeof(pub_names[i]), "test_async_pub_%d.pem", i);
+    snprintf(priv_names[i], sizeof(priv_names[i]), "test_async_priv_%d.pem", i);
+    TEST_ASSERT_EQUAL_INT(EccPemGenerateAsync(curve, pub_names[i], priv_names[i],
+                                              AsyncTestCallback, &completions), 1);
+  }
+  EccPemAsyncShutdown();
+  TEST_ASSERT_EQUAL_INT(atomic_load(&completions.num_completed), kNumKeys);
+  TEST_ASSERT_EQUAL_INT(atomic_load(&completions.num_succeeded), kNumKeys);
+
+  uint8_t private_key[32];
+  uint8_t public_key[33];
+  for (int i = 0; i < kNumKeys; ++i) {
+    TEST_ASSERT_EQUAL_INT(ReadPrivateKeyPemFile(priv_names[i], private_key, 32), 1);
+    TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile(pub_names[i], public_key, 33), 1);
+    remove(pub_names[i]);
+    remove(priv_names[i]);
+  }
+  printf("✓ %d key pairs generated asynchronously\n", kNumKeys);
+
+  // Test the pool starts on first use and a failed write is reported
+  atomic_init(&completions.num_completed, 0);
+  atomic_init(&completions.num_succeeded, 0);
+  printf("\nExpected error message:\n"
+         "Unable to write private key file.\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(EccPemGenerateAsync(curve, "test_async_pub.pem",
+                                            "no_such_dir/test_async_priv.pem",
+                                            AsyncTestCallback, &completions), 1);
+  EccPemAsyncShutdown();
+  TEST_ASSERT_EQUAL_INT(atomic_load(&completions.num_completed), 1);
+  TEST_ASSERT_EQUAL_INT(atomic_load(&completions.num_succeeded), 0);
+  printf("✓ Failed write reported to the callback\n");
+
+  // Test invalid requests are rejected without invoking the callback
+  printf("\nExpected error message:\n"
+         "Curve handle cannot be NULL.\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(EccPemGenerateAsync(NULL, "test_async_pub.pem",
+                                            "test_async_priv.pem",
+                                            AsyncTestCallback, &completions), 0);
+  printf("\nExpected error message:\n"
+         "Provided public/private key file must be PEM format (extension is .pem).\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(EccPemGenerateAsync(curve, "test_async_pub.txt",
+                                            "test_async_priv.pem",
+                                            AsyncTestCallback, &completions), 0);
+  EccPemAsyncShutdown();
+  TEST_ASSERT_EQUAL_INT(atomic_load(&completions.num_completed), 1);
+  printf("✓ Invalid requests rejected\n");
+
+  printf("\nTesting EccPemGenerateAsync --------------------------------------- [ " GREEN "PASSED" RESET " ]\n");
+}
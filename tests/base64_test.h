@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <string.h>
+#include <openssl/bio.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+
+#include "eccpem_internal.h"
+#include "eccpem_read.h"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+/*
+ * Encodes and decodes random data of every length up to 300 bytes with the
+ * selected kernel and compares the body against the one PEM_write_bio produces.
+ */
+void CHECK_BASE64_ROUND_TRIPS() {
+  uint8_t data[300];
+  char body[512];
+  uint8_t decoded[300 + 32];
+  RAND_bytes(data, sizeof(data));
+
+  for (size_t len = 1; len <= sizeof(data); ++len) {
+    size_t body_len = 0;
+    TEST_ASSERT_EQUAL_INT(EccPemBase64EncodeBody(data, len, body, sizeof(body), &body_len), 1);
+    TEST_ASSERT_EQUAL_INT((int)body_len, (int)EccPemBase64EncodedBodyLength(len));
+
+    BIO* bio = BIO_new(BIO_s_mem());
+    PEM_write_bio(bio, "TEST", "", data, (long)len);
+    char* pem = NULL;
+    BIO_get_mem_data(bio, &pem);
+    TEST_ASSERT_EQUAL_INT(memcmp(pem + strlen("-----BEGIN TEST-----\n"), body, body_len), 0);
+    BIO_free(bio);
+
+    size_t decoded_len = 0;
+    TEST_ASSERT_EQUAL_INT(EccPemBase64DecodeBody(body, body_len, decoded, sizeof(decoded),
+                                                 &decoded_len), 1);
+    TEST_ASSERT_EQUAL_INT((int)decoded_len, (int)len);
+    TEST_ASSERT_EQUAL_INT(memcmp(decoded, data, len), 0);
+
+    decoded_len = 0;
+    TEST_ASSERT_EQUAL_INT(EccPemBase64CheckBody(body, body_len, &decoded_len), 1);
+    TEST_ASSERT_EQUAL_INT((int)decoded_len, (int)len);
+  }
+
+  // Lines broken at odd positions and CRLF line endings
+  const char* body_crlf = "SGVsbG8s\r\nIHd\r\nvcmxkIQ\r\n==\r\n";
+  size_t decoded_len = 0;
+  TEST_ASSERT_EQUAL_INT(EccPemBase64DecodeBody(body_crlf, strlen(body_crlf), decoded,
+                                               sizeof(decoded), &decoded_len), 1);
+  TEST_ASSERT_EQUAL_INT((int)decoded_len, 13);
+  TEST_ASSERT_EQUAL_INT(memcmp(decoded, "Hello, world!", 13), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemBase64CheckBody(body_crlf, strlen(body_crlf), &decoded_len), 1);
+  TEST_ASSERT_EQUAL_INT((int)decoded_len, 13);
+
+  // Blanks the OpenSSL decoder skips pass the check, not the decoder
+  const char* body_blanks = "SGVs bG8s\n\tIHdv\n";
+  TEST_ASSERT_EQUAL_INT(EccPemBase64CheckBody(body_blanks, strlen(body_blanks), &decoded_len), 1);
+  TEST_ASSERT_EQUAL_INT((int)decoded_len, 9);
+
+  // Invalid characters, data after padding, truncated quads are rejected
+  const char* invalid[] = {"SGVs!G8s\n", "SGVsbG8=\nSGVs\n", "SGVsbG8\n",
+                           "Proc-Type: 4,ENCRYPTED\n\nSGVsbG8s\n",
+                           "QUJDREVGR0hJSktMTU5PUFFSU1RVVldYWVphYmNkZWZnaGlqa2xt*m9wcXJzdHV2\n"};
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+    TEST_ASSERT_EQUAL_INT(EccPemBase64DecodeBody(invalid[i], strlen(invalid[i]), decoded,
+                                                 sizeof(decoded), &decoded_len), 0);
+    TEST_ASSERT_EQUAL_INT(EccPemBase64CheckBody(invalid[i], strlen(invalid[i]), &decoded_len), 0);
+  }
+
+  // Output buffer too small
+  const char* body_short = "SGVsbG8s\n";
+  TEST_ASSERT_EQUAL_INT(EccPemBase64DecodeBody(body_short, strlen(body_short), decoded, 5,
+                                               &decoded_len), 0);
+}
+
+void RUN_BASE64_TESTS() {
+  printf("\nTesting base64 codec...\n");
+
+  const EccPemBase64Kernel default_kernel = EccPemBase64GetKernel();
+
+  TEST_ASSERT_EQUAL_INT(EccPemBase64SetKernel(kEccPemBase64Scalar), 1);
+  CHECK_BASE64_ROUND_TRIPS();
+  printf("✓ Scalar kernel matches the OpenSSL encoding\n");
+
+  if (EccPemBase64SetKernel(kEccPemBase64Avx2)) {
+    CHECK_BASE64_ROUND_TRIPS();
+    printf("✓ AVX2 kernel matches the OpenSSL encoding\n");
+  } else {
+    printf("✓ AVX2 kernel not supported, skipped\n");
+  }
+  EccPemBase64SetKernel(default_kernel);
+
+  // Test the fast path and the OpenSSL path read the same key
+  char pem[512];
+  size_t pem_len = 0;
+  EccPemEncodeBlock("PUBLIC KEY",
+                    (const uint8_t*)"\x30\x39\x30\x13\x06\x07\x2a\x86\x48\xce\x3d\x02\x01"
+                    "\x06\x08\x2a\x86\x48\xce\x3d\x03\x01\x07\x03\x22\x00\x03"
+                    "\x6b\x17\xd1\xf2\xe1\x2c\x42\x47\xf8\xbc\xe6\xe5\x63\xa4\x40\xf2"
+                    "\x77\x03\x7d\x81\x2d\xeb\x33\xa0\xf4\xa1\x39\x45\xd8\x98\xc2\x96",
+                    59, pem, sizeof(pem), &pem_len);
+  uint8_t fast_key[33];
+  uint8_t bio_key[33];
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemBuffer(pem, pem_len, fast_key, 33), 1);
+
+  BIO* bio = BIO_new_mem_buf(pem, (int)pem_len);
+  EVP_PKEY* pkey = PEM_read_bio_PUBKEY(bio, NULL, NULL, NULL);
+  BIO_free(bio);
+  TEST_ASSERT_EQUAL_INT(pkey != NULL, 1);
+  TEST_ASSERT_EQUAL_INT(ExtractCompressedPublicKey(pkey, bio_key, sizeof(bio_key)), 1);
+  EVP_PKEY_free(pkey);
+  TEST_ASSERT_EQUAL_INT(memcmp(fast_key, bio_key, sizeof(fast_key)), 0);
+  printf("✓ Fast path reads the same key as the OpenSSL path\n");
+
+  printf("\nTesting base64 codec ---------------------------------------------- [ " GREEN "PASSED" RESET " ]\n");
+}
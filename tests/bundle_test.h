@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "eccpem_bundle.h"
+#include "eccpem_curve.h"
+#include "eccpem_read.h"
+#include "eccpem_write.h"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+/*
+ * Writes a PEM bundle of num_keys prime256v1 public keys to bundle_file and
+ * stores their compressed form in expected_keys. A private key block and a
+ * corrupted public key block are mixed in after the first key.
+ */
+void WRITE_TEST_BUNDLE(const char* bundle_file, const int num_keys, uint8_t expected_keys[]) {
+  FILE* fp = fopen(bundle_file, "w");
+  for (int i = 0; i < num_keys; ++i) {
+    char pub_pem[512];
+    char priv_pem[512];
+    size_t pub_len = 0;
+    size_t priv_len = 0;
+    CreateECCKeysPemBuffers("prime256v1", pub_pem, sizeof(pub_pem), &pub_len,
+                            priv_pem, sizeof(priv_pem), &priv_len);
+    ReadPublicKeyPemBuffer(pub_pem, pub_len, expected_keys + 33 * i, 33);
+    fwrite(pub_pem, 1, pub_len, fp);
+    if (i == 0) {
+      fwrite(priv_pem, 1, priv_len, fp);
+      fputs("-----BEGIN PUBLIC KEY-----\n!!!!\n-----END PUBLIC KEY-----\n", fp);
+    }
+  }
+  fclose(fp);
+}
+
+void RUN_BUNDLE_TESTS() {
+  printf("\nTesting EccPemBundle...\n");
+
+  enum { kNumKeys = 5 };
+  const char* bundle_file = "test_bundle.pem";
+  uint8_t expected_keys[kNumKeys * 33];
+  WRITE_TEST_BUNDLE(bundle_file, kNumKeys, expected_keys);
+
+  // Test all keys are streamed in order, in chunks smaller than the bundle
+  EccPemBundle* bundle = EccPemBundleOpen(bundle_file);
+  TEST_ASSERT_EQUAL_INT(bundle != NULL, 1);
+  uint8_t public_keys[kNumKeys * 33];
+  size_t num_read = 0;
+  size_t num_keys = 0;
+  while ((num_keys = EccPemBundleNext(bundle, public_keys + 33 * num_read, 33, 2)) > 0) {
+    num_read += num_keys;
+  }
+  TEST_ASSERT_EQUAL_INT((int)num_read, kNumKeys);
+  TEST_ASSERT_EQUAL_INT(memcmp(expected_keys, public_keys, sizeof(public_keys)), 0);
+  printf("✓ All public keys of the bundle read in order\n");
+
+  // Test corrupted block was skipped and counted, private key block ignored
+  EccPemBundleStats stats;
+  EccPemBundleGetStats(bundle, &stats);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_keys, kNumKeys);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_skipped, 1);
+  TEST_ASSERT_EQUAL_INT((int)EccPemBundleNext(bundle, public_keys, 33, 2), 0);
+  EccPemBundleClose(bundle);
+  printf("✓ Corrupted block skipped\n");
+
+  // Test memory mapped bundle yields the same keys and statistics
+  bundle = EccPemBundleOpenMapped(bundle_file, 1);
+  TEST_ASSERT_EQUAL_INT(bundle != NULL, 1);
+  memset(public_keys, 0, sizeof(public_keys));
+  num_read = 0;
+  while ((num_keys = EccPemBundleNext(bundle, public_keys + 33 * num_read, 33, 2)) > 0) {
+    num_read += num_keys;
+  }
+  TEST_ASSERT_EQUAL_INT((int)num_read, kNumKeys);
+  TEST_ASSERT_EQUAL_INT(memcmp(expected_keys, public_keys, sizeof(public_keys)), 0);
+  EccPemBundleGetStats(bundle, &stats);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_skipped, 1);
+  EccPemBundleClose(bundle);
+  printf("✓ Memory mapped bundle read in order\n");
+
+  // Test bundle held in memory yields the same keys, a block whose END marker
+  // runs into the next BEGIN marker is skipped, and an empty buffer yields none
+  FILE* fp = fopen(bundle_file, "rb");
+  static char bundle_pem[64 * 1024];
+  const size_t bundle_pem_len = fread(bundle_pem, 1, sizeof(bundle_pem), fp);
+  fclose(fp);
+  bundle = EccPemBundleOpenBuffer(bundle_pem, bundle_pem_len);
+  TEST_ASSERT_EQUAL_INT(bundle != NULL, 1);
+  memset(public_keys, 0, sizeof(public_keys));
+  TEST_ASSERT_EQUAL_INT((int)EccPemBundleNext(bundle, public_keys, 33, kNumKeys + 1), kNumKeys);
+  TEST_ASSERT_EQUAL_INT(memcmp(expected_keys, public_keys, sizeof(public_keys)), 0);
+  EccPemBundleClose(bundle);
+  const char glued[] = "-----BEGIN PUBLIC KEY-----\nMFkwEwYHKoZIzj0CAQYIKoZIzj0DAQcDQgAE\n"
+                       "-----END PUBLIC KEY----------BEGIN PUBLIC KEY-----\n";
+  bundle = EccPemBundleOpenBuffer(glued, sizeof(glued) - 1);
+  TEST_ASSERT_EQUAL_INT((int)EccPemBundleNext(bundle, public_keys, 33, 2), 0);
+  EccPemBundleGetStats(bundle, &stats);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_skipped, 1);
+  EccPemBundleClose(bundle);
+  bundle = EccPemBundleOpenBuffer(bundle_pem, 0);
+  TEST_ASSERT_EQUAL_INT((int)EccPemBundleNext(bundle, public_keys, 33, 2), 0);
+  EccPemBundleClose(bundle);
+  printf("✓ Bundle in memory read in place\n");
+
+  // Test truncated last block of a memory mapped bundle is skipped
+  fp = fopen(bundle_file, "a");
+  fputs("-----BEGIN PUBLIC KEY-----\nMFkwEwYHKoZIzj0CAQYIKoZIzj0DAQcDQgAE\n", fp);
+  fclose(fp);
+  bundle = EccPemBundleOpenMapped(bundle_file, 0);
+  TEST_ASSERT_EQUAL_INT((int)EccPemBundleNext(bundle, public_keys, 33, kNumKeys + 1), kNumKeys);
+  EccPemBundleGetStats(bundle, &stats);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_skipped, 2);
+  EccPemBundleClose(bundle);
+  printf("✓ Truncated block skipped\n");
+
+  // Test empty memory mapped bundle
+  const char* empty_file = "test_empty_bundle.pem";
+  fclose(fopen(empty_file, "w"));
+  bundle = EccPemBundleOpenMapped(empty_file, 1);
+  TEST_ASSERT_EQUAL_INT(bundle != NULL, 1);
+  TEST_ASSERT_EQUAL_INT((int)EccPemBundleNext(bundle, public_keys, 33, 2), 0);
+  EccPemBundleClose(bundle);
+  remove(empty_file);
+  printf("✓ Empty bundle has no keys\n");
+
+  // Test non-existent bundle
+  printf("\nExpected error message:\nFailed to open PEM bundle file\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(EccPemBundleOpen("nonexistent.pem") == NULL, 1);
+  printf("✓ Non-existent bundle rejected\n");
+
+  // Test key pairs written to bundles with vectored writes, across chunks
+  enum { kNumBundleKeys = 100 };
+  const char* pub_bundle = "test_bundle_pubkeys.pem";
+  const char* priv_bundle = "test_bundle_privkeys.pem";
+  const EccPemCurve* curve = EccPemGetCurve("prime256v1");
+  TEST_ASSERT_EQUAL_INT((int)CreateECCKeysPemBundles(curve, kNumBundleKeys, pub_bundle,
+                                                     priv_bundle), kNumBundleKeys);
+  static uint8_t bundle_keys[kNumBundleKeys * 33];
+  bundle = EccPemBundleOpen(pub_bundle);
+  TEST_ASSERT_EQUAL_INT((int)EccPemBundleNext(bundle, bundle_keys, 33, kNumBundleKeys + 1),
+                        kNumBundleKeys);
+  EccPemBundleClose(bundle);
+  // The first private key block belongs to the first public key
+  const char* priv_files[] = {priv_bundle};
+  uint8_t derived_key[33];
+  TEST_ASSERT_EQUAL_INT((int)DerivePublicKeysFromPemFiles(priv_files, 1, derived_key, 33, NULL), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(derived_key, bundle_keys, 33), 0);
+  remove(pub_bundle);
+  remove(priv_bundle);
+  printf("✓ Key pairs written to PEM bundles\n");
+
+  // Test bundle that cannot be created
+  printf("\nExpected error message:\nUnable to open PEM bundle file for writing.\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT((int)CreateECCKeysPemBundles(curve, 1, "no_such_dir/pub.pem",
+                                                     priv_bundle), 0);
+  remove(priv_bundle);
+  printf("✓ Unwritable bundle rejected\n");
+
+  remove(bundle_file);
+
+  printf("\nTesting EccPemBundle ---------------------------------------------- [ " GREEN "PASSED" RESET " ]\n");
+}
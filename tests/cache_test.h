@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "eccpem_cache.h"
+#include "eccpem_read.h"
+#include "eccpem_write.h"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+void RUN_KEY_CACHE_TESTS() {
+  printf("\nTesting EccPemKeyCache...\n");
+
+  const char* pub_file = "test_cache_pubkey.pem";
+  const char* priv_file = "test_cache_privkey.pem";
+  CreateECCKeysPemFiles("prime256v1", pub_file, priv_file);
+
+  EccPemKeyCache* cache = EccPemKeyCacheCreate(1);
+  EccPemKeyCacheStats stats;
+
+  // Test first read is a miss and the second one a hit with the same key
+  uint8_t expected_key[33];
+  uint8_t public_key[33];
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile(pub_file, expected_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyCacheReadPublicKey(cache, pub_file, public_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyCacheReadPublicKey(cache, pub_file, public_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(expected_key, public_key, 33), 0);
+  EccPemKeyCacheGetStats(cache, &stats);
+  TEST_ASSERT_EQUAL_INT((int)stats.misses, 1);
+  TEST_ASSERT_EQUAL_INT((int)stats.hits, 1);
+  printf("✓ Repeated read served from cache\n");
+
+  // Test a rewritten file invalidates the entry
+  sleep(1);
+  CreateECCKeysPemFiles("prime256v1", pub_file, priv_file);
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile(pub_file, expected_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyCacheReadPublicKey(cache, pub_file, public_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(expected_key, public_key, 33), 0);
+  EccPemKeyCacheGetStats(cache, &stats);
+  TEST_ASSERT_EQUAL_INT((int)stats.invalidations, 1);
+  TEST_ASSERT_EQUAL_INT((int)stats.misses, 2);
+  printf("✓ Changed file invalidated the cached key\n");
+
+  // Test least recently used entry is evicted when the cache is full
+  uint8_t private_key[32];
+  TEST_ASSERT_EQUAL_INT(EccPemKeyCacheReadPrivateKey(cache, priv_file, private_key, 32), 1);
+  EccPemKeyCacheGetStats(cache, &stats);
+  TEST_ASSERT_EQUAL_INT((int)stats.evictions, 1);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_entries, 1);
+  printf("✓ Least recently used key evicted\n");
+
+  // Test failed reads are not cached
+  printf("\nExpected error message:\nFailed to open public key PEM file\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(EccPemKeyCacheReadPublicKey(cache, "nonexistent.pem", public_key, 33), 0);
+  EccPemKeyCacheGetStats(cache, &stats);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_entries, 1);
+  printf("✓ Non-existent file rejected\n");
+
+  EccPemKeyCacheFree(cache);
+  remove(pub_file);
+  remove(priv_file);
+
+  printf("\nTesting EccPemKeyCache -------------------------------------------- [ " GREEN "PASSED" RESET " ]\n");
+}
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+
+#include "eccpem.hpp"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+// Key sizes are part of the types
+static_assert(std::tuple_size<eccpem::CompressedPublicKey<eccpem::Curve::kPrime256v1>>::value == 33);
+static_assert(std::tuple_size<eccpem::PrivateKeyBytes<eccpem::Curve::kSecp521r1>>::value == 66);
+static_assert(!std::is_copy_constructible<eccpem::Reader<eccpem::Curve::kSecp256k1>>::value);
+static_assert(std::is_nothrow_move_constructible<eccpem::Reader<eccpem::Curve::kSecp256k1>>::value);
+static_assert(!std::is_copy_constructible<eccpem::PrivateKey<eccpem::Curve::kSecp384r1>>::value);
+static_assert(std::is_nothrow_move_assignable<eccpem::PublicKey<eccpem::Curve::kSecp384r1>>::value);
+static_assert(eccpem::PublicKeySpan<eccpem::Curve::kSecp521r1>::size() == 67);
+
+/*
+ * Checks that the compile-time traits of curve C match the curve handle, and
+ * that keys read through the wrapper equal keys read with the C API.
+ */
+template <eccpem::Curve C>
+void TEST_CURVE_WRAPPER() {
+  using Traits = eccpem::CurveTraits<C>;
+  const EccPemCurve* curve = eccpem::CurveHandle<C>();
+  TEST_ASSERT_EQUAL_INT(curve != nullptr, 1);
+  TEST_ASSERT_EQUAL_INT(curve == EccPemGetCurve(Traits::kName), 1);
+  TEST_ASSERT_EQUAL_INT(EccPemCurveGetNid(curve), Traits::kNid);
+  TEST_ASSERT_EQUAL_INT((int)EccPemCurveGetPrivateKeySize(curve), (int)Traits::kPrivateKeySize);
+  TEST_ASSERT_EQUAL_INT((int)EccPemCurveGetCompressedKeySize(curve),
+                        (int)Traits::kCompressedKeySize);
+
+  TEST_ASSERT_EQUAL_INT(eccpem::CreateKeyPemFiles<C>("test_cpp_pub.pem", "test_cpp_priv.pem"), 1);
+  uint8_t expected_public_key[Traits::kCompressedKeySize];
+  uint8_t expected_private_key[Traits::kPrivateKeySize];
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile("test_cpp_pub.pem", expected_public_key,
+                                             sizeof(expected_public_key)), 1);
+  TEST_ASSERT_EQUAL_INT(ReadPrivateKeyPemFile("test_cpp_priv.pem", expected_private_key,
+                                              sizeof(expected_private_key)), 1);
+
+  const auto public_key = eccpem::ReadPublicKey<C>("test_cpp_pub.pem");
+  const auto private_key = eccpem::ReadPrivateKey<C>("test_cpp_priv.pem");
+  TEST_ASSERT_EQUAL_INT(public_key.has_value() && private_key.has_value(), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(public_key->data(), expected_public_key, public_key->size()), 0);
+  TEST_ASSERT_EQUAL_INT(memcmp(private_key->data(), expected_private_key, private_key->size()),
+                        0);
+
+  auto reader = eccpem::Reader<C>::Create();
+  TEST_ASSERT_EQUAL_INT(reader.has_value(), 1);
+  TEST_ASSERT_EQUAL_INT(reader->ReadPublicKey("test_cpp_pub.pem") == public_key, 1);
+  TEST_ASSERT_EQUAL_INT(reader->ReadPrivateKey("test_cpp_priv.pem") == private_key, 1);
+
+  // Keys loaded into handles expose the same bytes without copying them
+  const auto private_handle = eccpem::PrivateKey<C>::FromFile("test_cpp_priv.pem");
+  const auto public_handle = eccpem::PublicKey<C>::FromFile("test_cpp_pub.pem");
+  TEST_ASSERT_EQUAL_INT(private_handle.has_value() && public_handle.has_value(), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(private_handle->Scalar().data(), expected_private_key,
+                               sizeof(expected_private_key)), 0);
+  TEST_ASSERT_EQUAL_INT(memcmp(private_handle->PublicPoint().data(), expected_public_key,
+                               sizeof(expected_public_key)), 0);
+  TEST_ASSERT_EQUAL_INT(memcmp(public_handle->PublicPoint().data(), expected_public_key,
+                               sizeof(expected_public_key)), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyGetCurve(public_handle->get()) == curve, 1);
+  remove("test_cpp_pub.pem");
+  remove("test_cpp_priv.pem");
+}
+
+void RUN_CPP_WRAPPER_TESTS() {
+  printf("\nTesting eccpem.hpp...\n");
+
+  TEST_CURVE_WRAPPER<eccpem::Curve::kPrime256v1>();
+  TEST_CURVE_WRAPPER<eccpem::Curve::kSecp256k1>();
+  TEST_CURVE_WRAPPER<eccpem::Curve::kSecp384r1>();
+  TEST_CURVE_WRAPPER<eccpem::Curve::kSecp521r1>();
+  printf("✓ Curve traits match the curve handles and keys read back\n");
+
+  // Test PEM buffers read through the wrapper and a moved reader
+  char pub_pem[512];
+  char priv_pem[512];
+  size_t pub_len = 0;
+  size_t priv_len = 0;
+  TEST_ASSERT_EQUAL_INT(CreateECCKeysPemBuffers("prime256v1", pub_pem, sizeof(pub_pem), &pub_len,
+                                                priv_pem, sizeof(priv_pem), &priv_len), 1);
+  const std::string_view pub(pub_pem, pub_len);
+  const std::string_view priv(priv_pem, priv_len);
+  const auto public_key = eccpem::ReadPublicKeyFromPem<eccpem::Curve::kPrime256v1>(pub);
+  const auto private_key = eccpem::ReadPrivateKeyFromPem<eccpem::Curve::kPrime256v1>(priv);
+  TEST_ASSERT_EQUAL_INT(public_key.has_value() && private_key.has_value(), 1);
+
+  auto reader = eccpem::Reader<eccpem::Curve::kPrime256v1>::Create();
+  eccpem::Reader<eccpem::Curve::kPrime256v1> moved_reader = std::move(*reader);
+  TEST_ASSERT_EQUAL_INT(moved_reader.ReadPublicKeyFromPem(pub) == public_key, 1);
+  TEST_ASSERT_EQUAL_INT(moved_reader.ReadPrivateKeyFromPem(priv) == private_key, 1);
+  printf("✓ PEM buffers read through the wrapper\n");
+
+  // Test generated keys, key handles parsed from PEM buffers and moved key handles
+  auto generated = eccpem::PrivateKey<eccpem::Curve::kPrime256v1>::Generate();
+  TEST_ASSERT_EQUAL_INT(generated.has_value(), 1);
+  TEST_ASSERT_EQUAL_INT(generated->WritePemFiles("test_cpp_pub.pem", "test_cpp_priv.pem"), 1);
+  const auto generated_public_key = eccpem::ReadPublicKey<eccpem::Curve::kPrime256v1>(
+      "test_cpp_pub.pem");
+  TEST_ASSERT_EQUAL_INT(generated_public_key.has_value(), 1);
+  TEST_ASSERT_EQUAL_INT(std::equal(generated->PublicPoint().begin(),
+                                   generated->PublicPoint().end(),
+                                   generated_public_key->begin()), 1);
+  remove("test_cpp_pub.pem");
+  remove("test_cpp_priv.pem");
+
+  auto private_handle = eccpem::PrivateKey<eccpem::Curve::kPrime256v1>::FromPem(priv);
+  auto public_handle = eccpem::PublicKey<eccpem::Curve::kPrime256v1>::FromPem(pub);
+  TEST_ASSERT_EQUAL_INT(private_handle.has_value() && public_handle.has_value(), 1);
+  const uint8_t* scalar = private_handle->Scalar().data();
+  eccpem::PrivateKey<eccpem::Curve::kPrime256v1> moved_key = std::move(*private_handle);
+  TEST_ASSERT_EQUAL_INT(moved_key.Scalar().data() == scalar, 1);
+  TEST_ASSERT_EQUAL_INT(private_handle->get() == nullptr, 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(scalar, private_key->data(), private_key->size()), 0);
+  TEST_ASSERT_EQUAL_INT(moved_key.PublicPoint()[0] == (*public_key)[0], 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(public_handle->PublicPoint().data(), public_key->data(),
+                               public_key->size()), 0);
+  *private_handle = std::move(*generated);
+  TEST_ASSERT_EQUAL_INT(private_handle->get() != nullptr && generated->get() == nullptr, 1);
+  printf("✓ Key handles generated, parsed and moved\n");
+
+  // Test keys of another curve are rejected
+  EccPemSetErrorLogging(0);
+  TEST_ASSERT_EQUAL_INT(eccpem::ReadPublicKeyFromPem<eccpem::Curve::kSecp384r1>(pub).has_value(),
+                        0);
+  TEST_ASSERT_EQUAL_INT(eccpem::PublicKey<eccpem::Curve::kSecp256k1>::FromPem(pub).has_value(),
+                        0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_NOT_EC_KEY);
+  // secp256k1 keys have the sizes of prime256v1 keys, only the curve tells them apart
+  TEST_ASSERT_EQUAL_INT(eccpem::CreateKeyPemFiles<eccpem::Curve::kSecp256k1>(
+                            "test_cpp_k1_pub.pem", "test_cpp_k1_priv.pem"), 1);
+  TEST_ASSERT_EQUAL_INT(eccpem::ReadPublicKey<eccpem::Curve::kSecp256k1>(
+                            "test_cpp_k1_pub.pem").has_value(), 1);
+  TEST_ASSERT_EQUAL_INT(eccpem::ReadPrivateKey<eccpem::Curve::kSecp256k1>(
+                            "test_cpp_k1_priv.pem").has_value(), 1);
+  TEST_ASSERT_EQUAL_INT(eccpem::ReadPublicKey<eccpem::Curve::kPrime256v1>(
+                            "test_cpp_k1_pub.pem").has_value(), 0);
+  TEST_ASSERT_EQUAL_INT(eccpem::ReadPrivateKey<eccpem::Curve::kPrime256v1>(
+                            "test_cpp_k1_priv.pem").has_value(), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_NOT_EC_KEY);
+  TEST_ASSERT_EQUAL_INT(eccpem::ReadPublicKeyFromPem<eccpem::Curve::kSecp256k1>(pub).has_value(),
+                        0);
+  TEST_ASSERT_EQUAL_INT(
+      eccpem::ReadPrivateKeyFromPem<eccpem::Curve::kSecp256k1>(priv).has_value(), 0);
+  remove("test_cpp_k1_pub.pem");
+  remove("test_cpp_k1_priv.pem");
+  TEST_ASSERT_EQUAL_INT(moved_reader.ReadPublicKey("nonexistent.pem").has_value(), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_OPEN_FAILED);
+  EccPemSetErrorLogging(1);
+  printf("✓ Keys of another curve and missing files rejected\n");
+
+  printf("\nTesting eccpem.hpp ------------------------------------------------ [ " GREEN "PASSED" RESET " ]\n");
+}
@@ -47,3 +47,47 @@ void RUN_CREATE_KEYS_TESTS() {
 
   printf("\nTesting CreateECCKeysPemFiles ------------------------------------- [ " GREEN "PASSED" RESET " ]\n");
 }
+
+void RUN_CREATE_KEYS_BATCH_TESTS() {
+  printf("\nTesting CreateECCKeysPemFilesBatch...\n");
+
+  // Test valid batch creation
+  const char* pub_files[] = {"test_pubkey_0.pem", "test_pubkey_1.pem", "test_pubkey_2.pem"};
+  const char* priv_files[] = {"test_privkey_0.pem", "test_privkey_1.pem", "test_privkey_2.pem"};
+  int results[3] = {0, 0, 0};
+  size_t num_created = CreateECCKeysPemFilesBatch("secp256k1", 3, pub_files, priv_files, results);
+  TEST_ASSERT_EQUAL_INT((int)num_created, 3);
+  for (int i = 0; i < 3; ++i) {
+    TEST_ASSERT_EQUAL_INT(results[i], 1);
+    TEST_ASSERT_EQUAL_INT(access(pub_files[i], F_OK), 0);
+    TEST_ASSERT_EQUAL_INT(access(priv_files[i], F_OK), 0);
+    remove(pub_files[i]);
+    remove(priv_files[i]);
+  }
+  printf("✓ Batch of key files created successfully\n");
+
+  // Test per-key failure does not stop the batch
+  const char* mixed_pub[] = {"test_pubkey_0.pem", "test_pubkey_1.txt"};
+  const char* mixed_priv[] = {"test_privkey_0.pem", "test_privkey_1.pem"};
+  printf("\nExpected error message:\n"
+         "Provided public/private key file must be PEM format (extension is .pem).\n");
+  printf("Actual output:\n");
+  num_created = CreateECCKeysPemFilesBatch("prime256v1", 2, mixed_pub, mixed_priv, results);
+  TEST_ASSERT_EQUAL_INT((int)num_created, 1);
+  TEST_ASSERT_EQUAL_INT(results[0], 1);
+  TEST_ASSERT_EQUAL_INT(results[1], 0);
+  remove(mixed_pub[0]);
+  remove(mixed_priv[0]);
+  printf("✓ Invalid entry rejected, remaining keys created\n");
+
+  // Test invalid curve name
+  printf("\nExpected error message:\n"
+         "Unknown Elliptic Curve type. Run 'openssl ecparam -list_curves' command to list EC types.\n");
+  printf("Actual output:\n");
+  num_created = CreateECCKeysPemFilesBatch("invalid_curve", 3, pub_files, priv_files, results);
+  TEST_ASSERT_EQUAL_INT((int)num_created, 0);
+  TEST_ASSERT_EQUAL_INT(results[0], 0);
+  printf("✓ Invalid curve name rejected\n");
+
+  printf("\nTesting CreateECCKeysPemFilesBatch -------------------------------- [ " GREEN "PASSED" RESET " ]\n");
+}
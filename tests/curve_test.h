@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <string.h>
+#include <openssl/obj_mac.h>
+#include <openssl/objects.h>
+#include <openssl/provider.h>
+
+#include "eccpem_curve.h"
+#include "eccpem_internal.h"
+#include "eccpem_error.h"
+#include "eccpem_read.h"
+#include "eccpem_reader.h"
+#include "eccpem_sign.h"
+#include "eccpem_write.h"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+void RUN_CURVE_TESTS() {
+  printf("\nTesting EccPemCurve...\n");
+
+  // Test curves are resolved once and looked up by name, long name and NID
+  const char* curve_names[] = {"prime256v1", "secp384r1"};
+  TEST_ASSERT_EQUAL_INT(EccPemInitCurves(curve_names, 2), 1);
+  const EccPemCurve* p256 = EccPemGetCurve("prime256v1");
+  TEST_ASSERT_EQUAL_INT(p256 != NULL, 1);
+  TEST_ASSERT_EQUAL_INT(p256 == EccPemGetCurve("prime256v1"), 1);
+  TEST_ASSERT_EQUAL_INT(p256 == EccPemGetCurveByNid(NID_X9_62_prime256v1), 1);
+  TEST_ASSERT_EQUAL_INT(p256 == EccPemGetCurve(OBJ_nid2ln(NID_X9_62_prime256v1)), 1);
+  TEST_ASSERT_EQUAL_INT(p256 != EccPemGetCurve("secp384r1"), 1);
+  printf("✓ Curve handles are cached\n");
+
+  // Test curve properties
+  TEST_ASSERT_EQUAL_INT(EccPemCurveGetNid(p256), NID_X9_62_prime256v1);
+  TEST_ASSERT_EQUAL_STRING("prime256v1", EccPemCurveGetName(p256));
+  TEST_ASSERT_EQUAL_INT((int)EccPemCurveGetPrivateKeySize(p256), 32);
+  TEST_ASSERT_EQUAL_INT((int)EccPemCurveGetCompressedKeySize(p256), 33);
+  const EccPemCurve* p521 = EccPemGetCurve("secp521r1");
+  TEST_ASSERT_EQUAL_INT((int)EccPemCurveGetPrivateKeySize(p521), 66);
+  TEST_ASSERT_EQUAL_INT((int)EccPemCurveGetCompressedKeySize(p521), 67);
+  printf("✓ Curve properties\n");
+
+  // Test key generation with a curve handle
+  const char* pub_file = "test_curve_pub.pem";
+  const char* priv_file = "test_curve_priv.pem";
+  TEST_ASSERT_EQUAL_INT(CreateECCKeysPemFilesWithCurve(p521, pub_file, priv_file), 1);
+  uint8_t private_key[66];
+  uint8_t public_key[67];
+  TEST_ASSERT_EQUAL_INT(ReadPrivateKeyPemFile(priv_file, private_key, 66), 1);
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile(pub_file, public_key, 67), 1);
+  remove(pub_file);
+  remove(priv_file);
+  printf("✓ Keys generated with curve handle\n");
+
+  // Test curve handles bound to a library context generate, read and sign with its
+  // provider. The context lives as long as the process, like the handles.
+  OSSL_LIB_CTX* libctx = OSSL_LIB_CTX_new();
+  TEST_ASSERT_EQUAL_INT(OSSL_PROVIDER_load(libctx, "default") != NULL, 1);
+  const EccPemCurve* provider_p256 = EccPemGetCurveFromProvider("prime256v1", libctx,
+                                                                "provider=default");
+  TEST_ASSERT_EQUAL_INT(provider_p256 != NULL && provider_p256 != p256, 1);
+  TEST_ASSERT_EQUAL_INT(provider_p256 == EccPemGetCurveFromProvider("prime256v1", libctx,
+                                                                    "provider=default"), 1);
+  TEST_ASSERT_EQUAL_INT(provider_p256 != EccPemGetCurveFromProvider("prime256v1", libctx, NULL),
+                        1);
+  TEST_ASSERT_EQUAL_INT(EccPemGetCurveFromProvider("prime256v1", NULL, NULL) == p256, 1);
+  TEST_ASSERT_EQUAL_INT(EccPemCurveGetLibraryContext(provider_p256) == libctx, 1);
+  TEST_ASSERT_EQUAL_STRING("provider=default", EccPemCurveGetPropertyQuery(provider_p256));
+  TEST_ASSERT_EQUAL_INT(EccPemCurveGetLibraryContext(p256) == NULL, 1);
+  TEST_ASSERT_EQUAL_INT(EccPemCurveGetPropertyQuery(p256) == NULL, 1);
+  TEST_ASSERT_EQUAL_INT(EccPemCurveGetNid(provider_p256), NID_X9_62_prime256v1);
+
+  TEST_ASSERT_EQUAL_INT(CreateECCKeysPemFilesWithCurve(provider_p256, pub_file, priv_file), 1);
+  EccPemReader* reader = EccPemReaderCreate(provider_p256);
+  uint8_t reader_key[33];
+  TEST_ASSERT_EQUAL_INT(EccPemReaderReadPublicKeyFile(reader, pub_file, reader_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile(pub_file, public_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(reader_key, public_key, 33), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemReaderReadPrivateKeyFile(reader, priv_file, reader_key, 32), 1);
+  TEST_ASSERT_EQUAL_INT(ReadPrivateKeyPemFile(priv_file, private_key, 32), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(reader_key, private_key, 32), 0);
+  EccPemReaderFree(reader);
+  remove(pub_file);
+  remove(priv_file);
+
+  EccPemKey* provider_key = EccPemKeyGenerate(provider_p256);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyGetCurve(provider_key) == provider_p256, 1);
+  uint8_t digest[32] = {1, 2, 3};
+  uint8_t signature[80];
+  size_t signature_len = 0;
+  TEST_ASSERT_EQUAL_INT((int)EccPemSignBatch(provider_key, digest, 32, 1, signature,
+                                             sizeof(signature), &signature_len, 1), 1);
+  TEST_ASSERT_EQUAL_INT((int)EccPemVerifyBatch(provider_key, digest, 32, 1, signature,
+                                               sizeof(signature), &signature_len, NULL, 1), 1);
+  EccPemKeyFree(provider_key);
+
+  EccPemSetErrorLogging(0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetCurveFromProvider("prime256v1", libctx,
+                                                   "provider=nonexistent") == NULL, 1);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_KEYGEN_FAILED);
+  EccPemSetErrorLogging(1);
+  printf("✓ Keys generated, read and signed with a library context\n");
+
+  // Test unknown curve
+  printf("\nExpected error message:\nUnknown Elliptic Curve type. Run 'openssl ecparam "
+         "-list_curves' command to list EC types.\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(EccPemGetCurve("invalid_curve") == NULL, 1);
+  printf("✓ Unknown curve rejected\n");
+
+  // Test a known object that is not a curve
+  printf("\nExpected error message:\nUnknown Elliptic Curve type. Run 'openssl ecparam "
+         "-list_curves' command to list EC types.\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(EccPemGetCurve("SHA256") == NULL, 1);
+  printf("✓ Non-curve object rejected\n");
+
+  // Test NULL curve handle
+  printf("\nExpected error message:\nCurve handle cannot be NULL.\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(CreateECCKeysPemFilesWithCurve(NULL, pub_file, priv_file), 0);
+  printf("✓ NULL curve handle rejected\n");
+
+  // Test keys encoded from the DER templates match the OpenSSL encoders
+  const char* template_curves[] = {"prime256v1", "secp256k1", "secp384r1", "secp521r1",
+                                   "sect571k1"};
+  for (size_t c = 0; c < sizeof(template_curves) / sizeof(template_curves[0]); ++c) {
+    const EccPemCurve* curve = EccPemGetCurve(template_curves[c]);
+    TEST_ASSERT_EQUAL_INT(EccPemCurveGetDerTemplate(curve) != NULL, 1);
+    EVP_PKEY_CTX* ctx = CreateKeygenContext(curve);
+    for (int i = 0; i < 8; ++i) {
+      EVP_PKEY* pkey = NULL;
+      TEST_ASSERT_EQUAL_INT(EVP_PKEY_keygen(ctx, &pkey), 1);
+      char template_pem[2][ECCPEM_MAX_KEY_PEM_SIZE];
+      char openssl_pem[2][ECCPEM_MAX_KEY_PEM_SIZE];
+      size_t template_len[2] = {0, 0};
+      size_t openssl_len[2] = {0, 0};
+      TEST_ASSERT_EQUAL_INT(EncodeKeysToPemBuffers(curve, pkey, template_pem[0],
+                                                   ECCPEM_MAX_KEY_PEM_SIZE, &template_len[0],
+                                                   template_pem[1], ECCPEM_MAX_KEY_PEM_SIZE,
+                                                   &template_len[1]), 1);
+      TEST_ASSERT_EQUAL_INT(EncodeKeysToPemBuffers(NULL, pkey, openssl_pem[0],
+                                                   ECCPEM_MAX_KEY_PEM_SIZE, &openssl_len[0],
+                                                   openssl_pem[1], ECCPEM_MAX_KEY_PEM_SIZE,
+                                                   &openssl_len[1]), 1);
+      TEST_ASSERT_EQUAL_STRING(openssl_pem[0], template_pem[0]);
+      TEST_ASSERT_EQUAL_STRING(openssl_pem[1], template_pem[1]);
+      EVP_PKEY_free(pkey);
+    }
+    EVP_PKEY_CTX_free(ctx);
+  }
+  printf("✓ DER templates match the OpenSSL encoders\n");
+
+  printf("\nTesting EccPemCurve ----------------------------------------------- [ " GREEN "PASSED" RESET " ]\n");
+}
@@ -0,0 +1,83 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "eccpem_error.h"
+#include "eccpem_read.h"
+#include "eccpem_write.h"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+static void* GET_THREAD_LAST_ERROR(void* arg) {
+  *(EccPemError*)arg = EccPemGetLastError();
+  return NULL;
+}
+
+void RUN_ERROR_TESTS() {
+  printf("\nTesting EccPemGetLastError...\n");
+
+  // Errors are recorded without being logged
+  EccPemSetErrorLogging(0);
+  EccPemClearError();
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_OK);
+  TEST_ASSERT_EQUAL_INT(strcmp(EccPemGetLastErrorDetail(), ""), 0);
+
+  uint8_t public_key[33];
+  uint8_t private_key[32];
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile("test_error_key.txt", public_key, 33), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_INVALID_FILE_NAME);
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile("nonexistent.pem", public_key, 33), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_OPEN_FAILED);
+  TEST_ASSERT_EQUAL_INT(strcmp(EccPemGetLastErrorDetail(), "Failed to open public key PEM file"), 0);
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile("test_error_key.pem", NULL, 33), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_INVALID_ARGUMENT);
+  TEST_ASSERT_EQUAL_INT(CreateECCKeysPemFiles("unknown_curve", "test_error_pub.pem",
+                                              "test_error_priv.pem"), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_UNKNOWN_CURVE);
+  printf("✓ Error codes recorded\n");
+
+  FILE* fp = fopen("test_error_key.pem", "w");
+  fputs("-----BEGIN PUBLIC KEY-----\nnot a key\n-----END PUBLIC KEY-----\n", fp);
+  fclose(fp);
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile("test_error_key.pem", public_key, 33), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_DECODE_FAILED);
+  remove("test_error_key.pem");
+
+  TEST_ASSERT_EQUAL_INT(CreateECCKeysPemFiles("prime256v1", "test_error_pub.pem",
+                                              "test_error_priv.pem"), 1);
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile("test_error_pub.pem", public_key, 65), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_KEY_SIZE_MISMATCH);
+  TEST_ASSERT_EQUAL_INT(strcmp(EccPemGetLastErrorDetail(), "Invalid compressed key size. "
+                               "The curve of the key needs 33 bytes"), 0);
+
+  // Successful calls leave the last error alone
+  TEST_ASSERT_EQUAL_INT(ReadPrivateKeyPemFile("test_error_priv.pem", private_key, 32), 1);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_KEY_SIZE_MISMATCH);
+  remove("test_error_pub.pem");
+  remove("test_error_priv.pem");
+  printf("✓ Decode and key size errors recorded\n");
+
+  // The error state is per thread
+  EccPemError thread_error = ECCPEM_ERROR_INVALID_STATE;
+  pthread_t thread;
+  TEST_ASSERT_EQUAL_INT(pthread_create(&thread, NULL, GET_THREAD_LAST_ERROR, &thread_error), 0);
+  pthread_join(thread, NULL);
+  TEST_ASSERT_EQUAL_INT(thread_error, ECCPEM_OK);
+  printf("✓ Error state is per thread\n");
+
+  EccPemClearError();
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_OK);
+  TEST_ASSERT_EQUAL_INT(strcmp(EccPemGetLastErrorDetail(), ""), 0);
+  TEST_ASSERT_EQUAL_INT(strcmp(EccPemErrorString(ECCPEM_ERROR_OPEN_FAILED),
+                               "file cannot be opened"), 0);
+  TEST_ASSERT_EQUAL_INT(strcmp(EccPemErrorString(ECCPEM_NUM_ERRORS), "unknown error"), 0);
+  for (int i = 0; i < ECCPEM_NUM_ERRORS; ++i) {
+    TEST_ASSERT_EQUAL_INT(EccPemErrorString((EccPemError)i) != NULL, 1);
+  }
+  printf("✓ Error cleared and described\n");
+  EccPemSetErrorLogging(1);
+
+  printf("\nTesting EccPemGetLastError ---------------------------------------- [ " GREEN "PASSED" RESET " ]\n");
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "eccpem_instrument.h"
+#include "eccpem_parallel.h"
+#include "eccpem_read.h"
+#include "eccpem_write.h"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+void RUN_INSTRUMENTATION_TESTS() {
+  printf("\nTesting EccPemGetCounters...\n");
+
+  TEST_ASSERT_EQUAL_INT(strcmp(EccPemStageName(ECCPEM_STAGE_PEM_DECODE), "pem_decode"), 0);
+  TEST_ASSERT_EQUAL_INT(strcmp(EccPemStageName(ECCPEM_NUM_STAGES), "unknown"), 0);
+  printf("✓ Stage names\n");
+
+  EccPemResetCounters();
+  TEST_ASSERT_EQUAL_INT(CreateECCKeysPemFiles("prime256v1", "test_instr_pub.pem",
+                                              "test_instr_priv.pem"), 1);
+  uint8_t public_key[33];
+  uint8_t private_key[32];
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile("test_instr_pub.pem", public_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(ReadPrivateKeyPemFile("test_instr_priv.pem", private_key, 32), 1);
+  remove("test_instr_pub.pem");
+  remove("test_instr_priv.pem");
+
+  // Key pairs generated on worker threads are counted once the threads exit
+  enum { kNumKeys = 40 };
+  char pub_names[kNumKeys][32];
+  char priv_names[kNumKeys][32];
+  const char* pub_files[kNumKeys];
+  const char* priv_files[kNumKeys];
+  for (int i = 0; i < kNumKeys; ++i) {
+    snprintf(pub_names[i], sizeof(pub_names[i]), "test_instr_pub_%d.pem", i);
+    snprintf(priv_names[i], sizeof(priv_names[i]), "test_instr_priv_%d.pem", i);
+    pub_files[i] = pub_names[i];
+    priv_files[i] = priv_names[i];
+  }
+  TEST_ASSERT_EQUAL_INT((int)CreateECCKeysPemFilesParallel("prime256v1", kNumKeys, pub_files,
+                                                           priv_files, NULL, 2, NULL), kNumKeys);
+  for (int i = 0; i < kNumKeys; ++i) {
+    remove(pub_files[i]);
+    remove(priv_files[i]);
+  }
+
+  EccPemCounters counters;
+  const int enabled = EccPemGetCounters(&counters);
+#ifdef ECCPEM_INSTRUMENTATION
+  TEST_ASSERT_EQUAL_INT(enabled, 1);
+  TEST_ASSERT_EQUAL_INT((int)counters.stages[ECCPEM_STAGE_KEYGEN].count, kNumKeys + 1);
+  TEST_ASSERT_EQUAL_INT((int)counters.stages[ECCPEM_STAGE_PEM_ENCODE].count, kNumKeys);
+  TEST_ASSERT_EQUAL_INT((int)counters.stages[ECCPEM_STAGE_WRITE].count, 2 * kNumKeys + 1);
+  TEST_ASSERT_EQUAL_INT(counters.stages[ECCPEM_STAGE_OPEN].count >= 2, 1);
+  TEST_ASSERT_EQUAL_INT(counters.stages[ECCPEM_STAGE_PEM_DECODE].count >= 2, 1);
+  TEST_ASSERT_EQUAL_INT((int)counters.stages[ECCPEM_STAGE_EC_CONVERSION].count, 1);
+  TEST_ASSERT_EQUAL_INT((int)counters.stages[ECCPEM_STAGE_POINT_ENCODE].count, 1);
+  TEST_ASSERT_EQUAL_INT(counters.stages[ECCPEM_STAGE_KEYGEN].nanoseconds > 0, 1);
+  printf("✓ Stages counted on all threads\n");
+
+  EccPemResetCounters();
+  EccPemGetCounters(&counters);
+  TEST_ASSERT_EQUAL_INT((int)counters.stages[ECCPEM_STAGE_KEYGEN].count, 0);
+  TEST_ASSERT_EQUAL_INT(counters.stages[ECCPEM_STAGE_KEYGEN].nanoseconds == 0, 1);
+  printf("✓ Counters reset\n");
+#else
+  TEST_ASSERT_EQUAL_INT(enabled, 0);
+  for (int i = 0; i < ECCPEM_NUM_STAGES; ++i) {
+    TEST_ASSERT_EQUAL_INT(counters.stages[i].count == 0, 1);
+  }
+  printf("✓ Counters are zero without instrumentation\n");
+#endif
+
+  printf("\nTesting EccPemGetCounters ----------------------------------------- [ " GREEN "PASSED" RESET " ]\n");
+}
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "eccpem_loader.h"
+#include "eccpem_read.h"
+#include "eccpem_write.h"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+void RUN_KEY_DIRECTORY_TESTS() {
+  printf("\nTesting EccPemKeyDirectory...\n");
+
+  // Test a scan finds only the regular .pem files, sorted by name
+  enum { kNumKeys = 70 };
+  mkdir("test_keydir", 0755);
+  mkdir("test_keydir/subdir.pem", 0755);
+  char pub_names[kNumKeys][48];
+  char priv_names[kNumKeys][48];
+  const char* pub_files[kNumKeys];
+  const char* priv_files[kNumKeys];
+  for (int i = 0; i < kNumKeys; ++i) {
+    snprintf(pub_names[i], sizeof(pub_names[i]), "test_keydir/key_%03d.pem", i);
+    snprintf(priv_names[i], sizeof(priv_names[i]), "test_keydir_priv_%03d.pem", i);
+    pub_files[i] = pub_names[i];
+    priv_files[i] = priv_names[i];
+  }
+  TEST_ASSERT_EQUAL_INT((int)CreateECCKeysPemFilesBatch("prime256v1", kNumKeys, pub_files,
+                                                        priv_files, NULL), kNumKeys);
+  FILE* fp = fopen("test_keydir/notes.txt", "w");
+  fputs("not a key\n", fp);
+  fclose(fp);
+  fp = fopen("test_keydir/zz_corrupt.pem", "w");
+  fputs("-----BEGIN PUBLIC KEY-----\n!!!!\n-----END PUBLIC KEY-----\n", fp);
+  fclose(fp);
+
+  EccPemKeyDirectory* key_dir = EccPemKeyDirectoryScan("test_keydir");
+  TEST_ASSERT_EQUAL_INT(key_dir != NULL, 1);
+  TEST_ASSERT_EQUAL_INT((int)EccPemKeyDirectoryNumFiles(key_dir), kNumKeys + 1);
+  for (int i = 0; i < kNumKeys; ++i) {
+    TEST_ASSERT_EQUAL_INT(strcmp(EccPemKeyDirectoryGetFile(key_dir, i), pub_files[i]), 0);
+  }
+  TEST_ASSERT_EQUAL_INT(strcmp(EccPemKeyDirectoryGetFile(key_dir, kNumKeys),
+                               "test_keydir/zz_corrupt.pem"), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyDirectoryGetFile(key_dir, kNumKeys + 1) == NULL, 1);
+  printf("✓ Directory scanned for .pem files\n");
+
+  // Test every key is loaded into its slot, with a failed status for the
+  // corrupted file
+  static uint8_t public_keys[(kNumKeys + 1) * 33];
+  int results[kNumKeys + 1];
+  EccPemLoadStats stats;
+  printf("\nExpected error message:\n"
+         "Failed to read public key from PEM file\n");
+  printf("Actual output:\n");
+  size_t num_loaded = EccPemKeyDirectoryLoadPublicKeys(key_dir, public_keys, 33, results,
+                                                       2, &stats);
+  TEST_ASSERT_EQUAL_INT((int)num_loaded, kNumKeys);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_files, kNumKeys + 1);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_loaded, kNumKeys);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_threads, 2);
+  uint8_t public_key[33];
+  for (int i = 0; i < kNumKeys; ++i) {
+    TEST_ASSERT_EQUAL_INT(results[i], 1);
+    TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile(pub_files[i], public_key, 33), 1);
+    TEST_ASSERT_EQUAL_INT(memcmp(public_keys + 33 * i, public_key, 33), 0);
+  }
+  TEST_ASSERT_EQUAL_INT(results[kNumKeys], 0);
+  printf("✓ %d public keys loaded on %u threads (%.0f files/sec)\n", kNumKeys,
+         stats.num_threads, stats.files_per_second);
+  EccPemKeyDirectoryClose(key_dir);
+
+  for (int i = 0; i < kNumKeys; ++i) {
+    remove(pub_files[i]);
+    remove(priv_files[i]);
+  }
+  remove("test_keydir/notes.txt");
+  remove("test_keydir/zz_corrupt.pem");
+  rmdir("test_keydir/subdir.pem");
+  rmdir("test_keydir");
+
+  // Test missing directory
+  printf("\nExpected error message:\n"
+         "Unable to open key directory.\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(EccPemKeyDirectoryScan("test_keydir") == NULL, 1);
+  printf("✓ Missing directory rejected\n");
+
+  printf("\nTesting EccPemKeyDirectory ---------------------------------------- [ " GREEN "PASSED" RESET " ]\n");
+}
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include "eccpem_parallel.h"
+#include "eccpem_read.h"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+void RUN_PARALLEL_KEYGEN_TESTS() {
+  printf("\nTesting CreateECCKeysPemFilesParallel...\n");
+
+  // Test valid parallel creation with more keys than one chunk
+  enum { kNumKeys = 40 };
+  char pub_names[kNumKeys][32];
+  char priv_names[kNumKeys][32];
+  const char* pub_files[kNumKeys];
+  const char* priv_files[kNumKeys];
+  for (int i = 0; i < kNumKeys; ++i) {
+    snprintf(pub_names[i], sizeof(pub_names[i]), "test_par_pub_%d.pem", i);
+    snprintf(priv_names[i], sizeof(priv_names[i]), "test_par_priv_%d.pem", i);
+    pub_files[i] = pub_names[i];
+    priv_files[i] = priv_names[i];
+  }
+
+  int results[kNumKeys];
+  EccPemParallelStats stats;
+  size_t num_created = CreateECCKeysPemFilesParallel("prime256v1", kNumKeys, pub_files,
+                                                     priv_files, results, 3, &stats);
+  TEST_ASSERT_EQUAL_INT((int)num_created, kNumKeys);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_created, kNumKeys);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_threads, 3);
+  uint8_t public_key[33];
+  for (int i = 0; i < kNumKeys; ++i) {
+    TEST_ASSERT_EQUAL_INT(results[i], 1);
+    TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile(pub_files[i], public_key, 33), 1);
+    remove(pub_files[i]);
+    remove(priv_files[i]);
+  }
+  printf("✓ %d key pairs created on %u threads (%.0f keys/sec)\n", kNumKeys,
+         stats.num_threads, stats.keys_per_second);
+
+  // Test thread count is capped by the amount of work
+  num_created = CreateECCKeysPemFilesParallel("prime256v1", 1, pub_files, priv_files,
+                                              results, 8, &stats);
+  TEST_ASSERT_EQUAL_INT((int)num_created, 1);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_threads, 1);
+  remove(pub_files[0]);
+  remove(priv_files[0]);
+  printf("✓ Thread count capped by number of chunks\n");
+
+  // Test invalid curve name
+  printf("\nExpected error message:\n"
+         "Unknown Elliptic Curve type. Run 'openssl ecparam -list_curves' command to list EC types.\n");
+  printf("Actual output:\n");
+  num_created = CreateECCKeysPemFilesParallel("invalid_curve", kNumKeys, pub_files, priv_files,
+                                              results, 2, NULL);
+  TEST_ASSERT_EQUAL_INT((int)num_created, 0);
+  printf("✓ Invalid curve name rejected\n");
+
+  printf("\nTesting CreateECCKeysPemFilesParallel ----------------------------- [ " GREEN "PASSED" RESET " ]\n");
+}
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include "eccpem_curve.h"
+#include "eccpem_pool.h"
+#include "eccpem_read.h"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+void RUN_KEY_POOL_TESTS() {
+  printf("\nTesting EccPemKeyPool...\n");
+
+  const EccPemCurve* curve = EccPemGetCurve("prime256v1");
+  TEST_ASSERT_EQUAL_INT(curve != NULL, 1);
+
+  // Test the pool is full once created, with the capacity rounded up
+  EccPemKeyPool* pool = EccPemKeyPoolCreate(curve, 6, 2);
+  TEST_ASSERT_EQUAL_INT(pool != NULL, 1);
+  EccPemKeyPoolStats stats;
+  EccPemKeyPoolGetStats(pool, &stats);
+  TEST_ASSERT_EQUAL_INT((int)stats.capacity, 8);
+  TEST_ASSERT_EQUAL_INT((int)stats.depth, 8);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_generated, 8);
+  EccPemKeyPoolGetStats(NULL, &stats);
+  EccPemKeyPoolGetStats(pool, NULL);
+  TEST_ASSERT_EQUAL_INT((int)stats.depth, 8);
+  printf("✓ Key pool filled on creation\n");
+
+  // Test every key handed out is a valid and distinct key pair
+  enum { kNumKeys = 20 };
+  uint8_t private_keys[kNumKeys][32];
+  uint8_t public_key[33];
+  for (int i = 0; i < kNumKeys; ++i) {
+    TEST_ASSERT_EQUAL_INT(EccPemKeyPoolTakePemFiles(pool, "test_pool_pub.pem",
+                                                    "test_pool_priv.pem"), 1);
+    TEST_ASSERT_EQUAL_INT(ReadPrivateKeyPemFile("test_pool_priv.pem", private_keys[i], 32), 1);
+    TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile("test_pool_pub.pem", public_key, 33), 1);
+    for (int j = 0; j < i; ++j) {
+      TEST_ASSERT_EQUAL_INT(memcmp(private_keys[i], private_keys[j], 32) != 0, 1);
+    }
+  }
+  remove("test_pool_pub.pem");
+  remove("test_pool_priv.pem");
+
+  char pubkey_pem[512];
+  char privkey_pem[512];
+  size_t pubkey_pem_len = 0;
+  size_t privkey_pem_len = 0;
+  TEST_ASSERT_EQUAL_INT(EccPemKeyPoolTakePemBuffers(pool, pubkey_pem, sizeof(pubkey_pem),
+                                                    &pubkey_pem_len, privkey_pem,
+                                                    sizeof(privkey_pem), &privkey_pem_len), 1);
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemBuffer(pubkey_pem, pubkey_pem_len, public_key, 33), 1);
+  printf("✓ Key pairs handed out once each\n");
+
+  // Test the refill thread brings the pool back to its capacity once a take
+  // leaves it at the low watermark
+  int num_taken = kNumKeys + 1;
+  for (EccPemKeyPoolGetStats(pool, &stats); stats.depth > stats.low_watermark;
+       EccPemKeyPoolGetStats(pool, &stats)) {
+    TEST_ASSERT_EQUAL_INT(EccPemKeyPoolTakePemBuffers(pool, pubkey_pem, sizeof(pubkey_pem),
+                                                      &pubkey_pem_len, privkey_pem,
+                                                      sizeof(privkey_pem), &privkey_pem_len), 1);
+    ++num_taken;
+  }
+  for (int i = 0; i < 500; ++i) {
+    EccPemKeyPoolGetStats(pool, &stats);
+    if (stats.depth == stats.capacity) {
+      break;
+    }
+    usleep(10000);
+  }
+  TEST_ASSERT_EQUAL_INT((int)stats.depth, 8);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_taken, num_taken);
+  TEST_ASSERT_EQUAL_INT(stats.num_stalls <= stats.num_taken, 1);
+  TEST_ASSERT_EQUAL_INT((int)(stats.num_generated + stats.num_stalls),
+                        num_taken + 8);
+  TEST_ASSERT_EQUAL_INT(stats.min_depth <= 2, 1);
+  printf("✓ Pool refilled in the background (%llu stalls)\n",
+         (unsigned long long)stats.num_stalls);
+  EccPemKeyPoolFree(pool);
+
+  // Test invalid watermark
+  printf("\nExpected error message:\n"
+         "Key pool low watermark must be less than its capacity.\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(EccPemKeyPoolCreate(curve, 4, 4) == NULL, 1);
+  printf("✓ Invalid low watermark rejected\n");
+
+  printf("\nTesting EccPemKeyPool --------------------------------------------- [ " GREEN "PASSED" RESET " ]\n");
+}
@@ -1,9 +1,12 @@
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include <openssl/obj_mac.h>
 
 #include "eccpem_read.h"
 #include "eccpem_write.h"
 #include "unit_tests_api.h"
+#include "utils.h"
 
 #define GREEN "\x1B[1;32m"
 #define RESET "\x1B[0m"
@@ -80,6 +83,57 @@ void RUN_READ_PUBLIC_KEY_TESTS() {
   TEST_ASSERT_EQUAL_INT(ret_value, 1);
   printf("✓ Valid public key read successfully\n");
 
+  // Test trailing whitespace behind the BEGIN line and the padded last body
+  // line is accepted, like PEM_read_bio does
+  char pem[512];
+  FILE* fp = fopen(pub_file, "r");
+  const size_t pem_len = fread(pem, 1, sizeof(pem) - 1, fp);
+  fclose(fp);
+  pem[pem_len] = '\0';
+  char* begin_line_end = strchr(pem, '\n');
+  char* padding = strstr(pem, "==\n-----END ");
+  TEST_ASSERT_EQUAL_INT(padding != NULL, 1);
+  char* padding_line_end = padding + 2;
+  const char* spaced_file = "test_pubkey_spaces.pem";
+  fp = fopen(spaced_file, "w");
+  fprintf(fp, "%.*s  \t%.*s  %s", (int)(begin_line_end - pem), pem,
+          (int)(padding_line_end - begin_line_end), begin_line_end, padding_line_end);
+  fclose(fp);
+  uint8_t spaced_key[33];
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile(spaced_file, spaced_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(spaced_key, public_key, 33), 0);
+  fp = fopen(spaced_file, "r");
+  const size_t spaced_len = fread(pem, 1, sizeof(pem), fp);
+  fclose(fp);
+  memset(spaced_key, 0, sizeof(spaced_key));
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemBuffer(pem, spaced_len, spaced_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(spaced_key, public_key, 33), 0);
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(pem, spaced_len, 0), 1);
+  remove(spaced_file);
+  printf("✓ Trailing whitespace behind marker and padding accepted\n");
+
+  // Test a marker in the middle of a line in front of the key is ignored, like
+  // PEM_read_bio does, and the key behind it is read
+  fp = fopen(pub_file, "r");
+  const size_t key_pem_len = fread(pem, 1, sizeof(pem), fp);
+  fclose(fp);
+  const char* junk_file = "test_pubkey_junk.pem";
+  fp = fopen(junk_file, "w");
+  fprintf(fp, "junk -----BEGIN PUBLIC KEY-----\n%.*s", (int)key_pem_len, pem);
+  fclose(fp);
+  uint8_t junk_key[33];
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile(junk_file, junk_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(junk_key, public_key, 33), 0);
+  fp = fopen(junk_file, "r");
+  const size_t junk_len = fread(pem, 1, sizeof(pem), fp);
+  fclose(fp);
+  memset(junk_key, 0, sizeof(junk_key));
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemBuffer(pem, junk_len, junk_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(junk_key, public_key, 33), 0);
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(pem, junk_len, 0), 1);
+  remove(junk_file);
+  printf("✓ Marker in the middle of a line ignored\n");
+
   // Test NULL public key array
   printf(
       "\nExpected error message:\nPublic key output buffer cannot be NULL\n");
@@ -90,8 +144,8 @@ void RUN_READ_PUBLIC_KEY_TESTS() {
 
   // Test zero key size
   printf(
-      "\nExpected error message:\nInvalid compressed key size. Expected 33 "
-      "bytes for ECDSA compressed public key\n");
+      "\nExpected error message:\nInvalid compressed key size. It must match "
+      "the curve of the key\n");
   printf("Actual output:\n");
   ret_value = ReadPublicKeyPemFile(pub_file, public_key, 0);
   TEST_ASSERT_EQUAL_INT(ret_value, 0);
@@ -122,3 +176,204 @@ void RUN_READ_PUBLIC_KEY_TESTS() {
       "\nTesting ReadPublicKeyPemFile -------------------------------------- "
       "[ " GREEN "PASSED" RESET " ]\n");
 }
+
+void RUN_READ_PUBLIC_KEY_EX_TESTS() {
+  printf("\nTesting ReadPublicKeyPemFileEx...\n");
+
+  const char* pub_file = "test_pubkey.pem";
+  const char* priv_file = "test_privkey.pem";
+  CreateECCKeysPemFiles("secp384r1", pub_file, priv_file);
+
+  // Test compressed keys of other curves are read with their own size
+  uint8_t public_key[ECCPEM_MAX_PUBLIC_KEY_SIZE];
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile(pub_file, public_key, 49), 1);
+  printf("✓ secp384r1 compressed public key read\n");
+
+  printf("\nExpected error message:\nInvalid compressed key size. The curve of the key "
+         "needs 49 bytes\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile(pub_file, public_key, 33), 0);
+  printf("✓ Size not matching the curve rejected\n");
+
+  // Test size query
+  size_t public_key_len = 0;
+  int curve_nid = NID_undef;
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFileEx(pub_file, POINT_CONVERSION_UNCOMPRESSED, NULL, 0,
+                                               &public_key_len, &curve_nid), 1);
+  TEST_ASSERT_EQUAL_INT((int)public_key_len, 97);
+  TEST_ASSERT_EQUAL_INT(curve_nid, NID_secp384r1);
+  printf("✓ Size query reports length and curve\n");
+
+  // Test compressed and uncompressed forms hold the same X coordinate
+  uint8_t uncompressed[ECCPEM_MAX_PUBLIC_KEY_SIZE];
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFileEx(pub_file, POINT_CONVERSION_UNCOMPRESSED,
+                                               uncompressed, sizeof(uncompressed),
+                                               &public_key_len, NULL), 1);
+  TEST_ASSERT_EQUAL_INT((int)public_key_len, 97);
+  TEST_ASSERT_EQUAL_INT(uncompressed[0], 0x04);
+  uint8_t compressed[ECCPEM_MAX_PUBLIC_KEY_SIZE];
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFileEx(pub_file, POINT_CONVERSION_COMPRESSED,
+                                               compressed, sizeof(compressed),
+                                               &public_key_len, NULL), 1);
+  TEST_ASSERT_EQUAL_INT((int)public_key_len, 49);
+  TEST_ASSERT_EQUAL_INT(compressed[0], 0x02 | (uncompressed[96] & 1));
+  TEST_ASSERT_EQUAL_INT(memcmp(compressed + 1, uncompressed + 1, 48), 0);
+  TEST_ASSERT_EQUAL_INT(memcmp(compressed, public_key, 49), 0);
+  printf("✓ Compressed and uncompressed forms match\n");
+
+  // Test buffer variant
+  char pub_pem[512];
+  FILE* fp = fopen(pub_file, "r");
+  const size_t pub_pem_len = fread(pub_pem, 1, sizeof(pub_pem), fp);
+  fclose(fp);
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemBufferEx(pub_pem, pub_pem_len, POINT_CONVERSION_COMPRESSED,
+                                                 public_key, sizeof(public_key),
+                                                 &public_key_len, &curve_nid), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(compressed, public_key, 49), 0);
+  printf("✓ Buffer variant matches file variant\n");
+
+  // Test too small buffer
+  printf("\nExpected error message:\nPublic key output buffer is too small, 97 bytes are "
+         "required\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFileEx(pub_file, POINT_CONVERSION_UNCOMPRESSED,
+                                               uncompressed, 96, &public_key_len, NULL), 0);
+  TEST_ASSERT_EQUAL_INT((int)public_key_len, 97);
+  printf("✓ Too small buffer rejected\n");
+
+  remove(pub_file);
+  remove(priv_file);
+
+  printf(
+      "\nTesting ReadPublicKeyPemFileEx ------------------------------------ "
+      "[ " GREEN "PASSED" RESET " ]\n");
+}
+
+void RUN_PEM_BUFFER_TESTS() {
+  printf("\nTesting CreateECCKeysPemBuffers and Read*PemBuffer...\n");
+
+  // Test valid generation into buffers
+  char pub_pem[512];
+  char priv_pem[512];
+  size_t pub_len = 0;
+  size_t priv_len = 0;
+  int ret_value = CreateECCKeysPemBuffers("prime256v1", pub_pem, sizeof(pub_pem), &pub_len,
+                                          priv_pem, sizeof(priv_pem), &priv_len);
+  TEST_ASSERT_EQUAL_INT(ret_value, 1);
+  TEST_ASSERT_EQUAL_INT((int)strlen(pub_pem), (int)pub_len);
+  TEST_ASSERT_EQUAL_INT((int)strlen(priv_pem), (int)priv_len);
+  printf("✓ Key pair written to buffers successfully\n");
+
+  // Test reading keys back from buffers matches reading them from files
+  uint8_t private_key[32];
+  uint8_t public_key[33];
+  ret_value = ReadPrivateKeyPemBuffer(priv_pem, priv_len, private_key, 32);
+  TEST_ASSERT_EQUAL_INT(ret_value, 1);
+  ret_value = ReadPublicKeyPemBuffer(pub_pem, pub_len, public_key, 33);
+  TEST_ASSERT_EQUAL_INT(ret_value, 1);
+
+  const char* pub_file = "test_pubkey.pem";
+  const char* priv_file = "test_privkey.pem";
+  FILE* fp = fopen(pub_file, "w");
+  fwrite(pub_pem, 1, pub_len, fp);
+  fclose(fp);
+  fp = fopen(priv_file, "w");
+  fwrite(priv_pem, 1, priv_len, fp);
+  fclose(fp);
+
+  uint8_t file_private_key[32];
+  uint8_t file_public_key[33];
+  TEST_ASSERT_EQUAL_INT(ReadPrivateKeyPemFile(priv_file, file_private_key, 32), 1);
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile(pub_file, file_public_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(private_key, file_private_key, 32), 0);
+  TEST_ASSERT_EQUAL_INT(memcmp(public_key, file_public_key, 33), 0);
+  remove(pub_file);
+  remove(priv_file);
+  printf("✓ Buffer reads match file reads\n");
+
+  // Test too small output buffer reports the required length
+  char small_pem[16];
+  size_t small_len = 0;
+  printf("\nExpected error message:\nPEM buffer is too small, N bytes are required.\n");
+  printf("Actual output:\n");
+  ret_value = CreateECCKeysPemBuffers("prime256v1", small_pem, sizeof(small_pem), &small_len,
+                                      priv_pem, sizeof(priv_pem), &priv_len);
+  TEST_ASSERT_EQUAL_INT(ret_value, 0);
+  TEST_ASSERT_EQUAL_INT(small_len > sizeof(small_pem), 1);
+  printf("✓ Too small buffer rejected\n");
+
+  // Test garbage input
+  const char garbage[] = "-----BEGIN PUBLIC KEY-----\nnot base64\n-----END PUBLIC KEY-----\n";
+  printf("\nExpected error message:\nFailed to read public key from PEM buffer\n");
+  printf("Actual output:\n");
+  ret_value = ReadPublicKeyPemBuffer(garbage, sizeof(garbage) - 1, public_key, 33);
+  TEST_ASSERT_EQUAL_INT(ret_value, 0);
+  printf("✓ Garbage PEM buffer rejected\n");
+
+  // Test NULL buffer
+  printf("\nExpected error message:\nPrivate key's PEM buffer cannot be null or empty.\n");
+  printf("Actual output:\n");
+  ret_value = ReadPrivateKeyPemBuffer(NULL, 10, private_key, 32);
+  TEST_ASSERT_EQUAL_INT(ret_value, 0);
+  printf("✓ NULL PEM buffer rejected\n");
+
+  printf(
+      "\nTesting Read*PemBuffer -------------------------------------------- "
+      "[ " GREEN "PASSED" RESET " ]\n");
+}
+
+void RUN_DERIVE_PUBLIC_KEYS_TESTS() {
+  printf("\nTesting DerivePublicKeysFromPemFiles...\n");
+
+  enum { kNumKeys = 4 };
+  const char* pub_files[kNumKeys] = {"test_derive_pub_0.pem", "test_derive_pub_1.pem",
+                                     "test_derive_pub_2.pem", "test_derive_pub_3.pem"};
+  const char* priv_files[kNumKeys] = {"test_derive_priv_0.pem", "test_derive_priv_1.pem",
+                                      "test_derive_priv_2.pem", "test_derive_priv_3.pem"};
+  TEST_ASSERT_EQUAL_INT((int)CreateECCKeysPemFilesBatch("prime256v1", kNumKeys - 1, pub_files,
+                                                        priv_files, NULL), kNumKeys - 1);
+  TEST_ASSERT_EQUAL_INT(CreateECCKeysPemFiles("secp384r1", pub_files[kNumKeys - 1],
+                                              priv_files[kNumKeys - 1]), 1);
+
+  // Test derived keys match the public key files
+  printf("\nExpected error message:\nInvalid compressed key size for the key's curve.\n");
+  printf("Actual output:\n");
+  uint8_t public_keys[kNumKeys * 33];
+  int results[kNumKeys];
+  const size_t num_derived = DerivePublicKeysFromPemFiles(priv_files, kNumKeys, public_keys,
+                                                          33, results);
+  TEST_ASSERT_EQUAL_INT((int)num_derived, kNumKeys - 1);
+  for (int i = 0; i < kNumKeys - 1; ++i) {
+    uint8_t expected_key[33];
+    TEST_ASSERT_EQUAL_INT(results[i], 1);
+    TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile(pub_files[i], expected_key, 33), 1);
+    TEST_ASSERT_EQUAL_INT(memcmp(public_keys + 33 * i, expected_key, 33), 0);
+  }
+  TEST_ASSERT_EQUAL_INT(results[kNumKeys - 1], 0);
+  printf("✓ Derived public keys match the public key files\n");
+
+  // Test a key of another curve is derived with its own size
+  uint8_t p384_key[49];
+  TEST_ASSERT_EQUAL_INT((int)DerivePublicKeysFromPemFiles(priv_files + kNumKeys - 1, 1,
+                                                          p384_key, 49, NULL), 1);
+  printf("✓ secp384r1 public key derived\n");
+
+  // Test missing file is skipped
+  const char* missing_files[2] = {"nonexistent.pem", priv_files[0]};
+  printf("\nExpected error message:\nUnable to open private key's pem file or it does not exist.\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT((int)DerivePublicKeysFromPemFiles(missing_files, 2, public_keys, 33,
+                                                          results), 1);
+  TEST_ASSERT_EQUAL_INT(results[0], 0);
+  TEST_ASSERT_EQUAL_INT(results[1], 1);
+  printf("✓ Missing private key file skipped\n");
+
+  for (int i = 0; i < kNumKeys; ++i) {
+    remove(pub_files[i]);
+    remove(priv_files[i]);
+  }
+
+  printf(
+      "\nTesting DerivePublicKeysFromPemFiles ------------------------------ "
+      "[ " GREEN "PASSED" RESET " ]\n");
+}
@@ -0,0 +1,9 @@
+#include "cpp_wrapper_test.h"
+int main() {
+  // Print error messages, so they can be compared with the expected ones
+  EccPemSetErrorLogging(1);
+
+  RUN_CPP_WRAPPER_TESTS();
+
+  return 0;
+}
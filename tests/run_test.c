@@ -1,12 +1,49 @@
 #include "test_utils.h"
+#include "curve_test.h"
 #include "create_keys_test.h"
 #include "read_pem_test.h"
+#include "reader_test.h"
+#include "sign_test.h"
+#include "parallel_test.h"
+#include "async_test.h"
+#include "pool_test.h"
+#include "cache_test.h"
+#include "bundle_test.h"
+#include "loader_test.h"
+#include "watch_test.h"
+#include "store_test.h"
+#include "instrument_test.h"
+#include "error_test.h"
+#include "base64_test.h"
+#include "secure_test.h"
 int main() {
+  // Print error messages, so they can be compared with the expected ones
+  EccPemSetErrorLogging(1);
 
   RUN_UTILS_TESTS();
+  RUN_PEM_KEY_BLOCK_TESTS();
+  RUN_CURVE_TESTS();
   RUN_CREATE_KEYS_TESTS();
+  RUN_CREATE_KEYS_BATCH_TESTS();
   RUN_READ_PRIVATE_KEY_TESTS();
   RUN_READ_PUBLIC_KEY_TESTS();
+  RUN_READ_PUBLIC_KEY_EX_TESTS();
+  RUN_PEM_BUFFER_TESTS();
+  RUN_READER_TESTS();
+  RUN_SIGN_TESTS();
+  RUN_DERIVE_PUBLIC_KEYS_TESTS();
+  RUN_PARALLEL_KEYGEN_TESTS();
+  RUN_ASYNC_KEYGEN_TESTS();
+  RUN_KEY_POOL_TESTS();
+  RUN_KEY_CACHE_TESTS();
+  RUN_BUNDLE_TESTS();
+  RUN_KEY_DIRECTORY_TESTS();
+  RUN_KEY_WATCHER_TESTS();
+  RUN_KEY_STORE_TESTS();
+  RUN_INSTRUMENTATION_TESTS();
+  RUN_ERROR_TESTS();
+  RUN_BASE64_TESTS();
+  RUN_SECURE_ARENA_TESTS();
 
   return 0;
 }
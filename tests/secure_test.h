@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <string.h>
+#include <openssl/crypto.h>
+
+#include "eccpem_error.h"
+#include "eccpem_read.h"
+#include "eccpem_secure.h"
+#include "eccpem_write.h"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+void RUN_SECURE_ARENA_TESTS() {
+  printf("\nTesting EccPemSecureArena...\n");
+
+  // Test the secure heap holds the big numbers of generated keys
+  TEST_ASSERT_EQUAL_INT(EccPemSecureHeapInit(1 << 16), 1);
+  TEST_ASSERT_EQUAL_INT(CRYPTO_secure_malloc_initialized(), 1);
+
+  EccPemSecureArena* arena = EccPemSecureArenaCreate(100);
+  TEST_ASSERT_EQUAL_INT(arena != NULL, 1);
+  TEST_ASSERT_EQUAL_INT(EccPemSecureArenaGetCapacity(arena) >= 100, 1);
+  TEST_ASSERT_EQUAL_INT((int)EccPemSecureArenaGetUsed(arena), 0);
+  printf("✓ Arena created, memory %s\n",
+         EccPemSecureArenaIsLocked(arena) ? "locked" : "not lockable here");
+
+  // Test generated keys are packed back to back and match their public keys
+  const EccPemCurve* curve = EccPemGetCurve("prime256v1");
+  enum { kNumKeys = 3 };
+  uint8_t* private_keys = NULL;
+  uint8_t public_keys[kNumKeys * 33];
+  TEST_ASSERT_EQUAL_INT((int)EccPemSecureArenaGenerateKeys(arena, curve, kNumKeys, &private_keys,
+                                                           public_keys), kNumKeys);
+  TEST_ASSERT_EQUAL_INT((int)EccPemSecureArenaGetUsed(arena), kNumKeys * 32);
+  TEST_ASSERT_EQUAL_INT(memcmp(private_keys, private_keys + 32, 32) != 0, 1);
+  TEST_ASSERT_EQUAL_INT(public_keys[33] == 0x02 || public_keys[33] == 0x03, 1);
+  printf("✓ Generated private keys stored in the arena\n");
+
+  // Test keys read from files equal the keys read one by one
+  const char* privkey_files[kNumKeys] = {"test_secure_priv_0.pem", "test_secure_priv_1.pem",
+                                         "nonexistent.pem"};
+  uint8_t expected_keys[2][32];
+  for (int i = 0; i < 2; ++i) {
+    TEST_ASSERT_EQUAL_INT(CreateECCKeysPemFiles("prime256v1", "test_secure_pub.pem",
+                                                privkey_files[i]), 1);
+    TEST_ASSERT_EQUAL_INT(ReadPrivateKeyPemFile(privkey_files[i], expected_keys[i], 32), 1);
+  }
+  int results[kNumKeys];
+  uint8_t* read_keys = NULL;
+  EccPemSetErrorLogging(0);
+  TEST_ASSERT_EQUAL_INT((int)EccPemSecureArenaReadPrivateKeyFiles(arena, curve, privkey_files,
+                                                                  kNumKeys, &read_keys,
+                                                                  results), 2);
+  EccPemSetErrorLogging(1);
+  TEST_ASSERT_EQUAL_INT(read_keys == private_keys + kNumKeys * 32, 1);
+  TEST_ASSERT_EQUAL_INT(results[0] == 1 && results[1] == 1 && results[2] == 0, 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(read_keys, expected_keys[0], 32), 0);
+  TEST_ASSERT_EQUAL_INT(memcmp(read_keys + 32, expected_keys[1], 32), 0);
+  uint8_t zeros[32] = {0};
+  TEST_ASSERT_EQUAL_INT(memcmp(read_keys + 64, zeros, 32), 0);
+  remove("test_secure_pub.pem");
+  remove(privkey_files[0]);
+  remove(privkey_files[1]);
+  printf("✓ Private key files read into the arena\n");
+
+  // Test a full arena rejects more keys and clearing wipes it
+  const size_t capacity = EccPemSecureArenaGetCapacity(arena);
+  printf("\nExpected error message:\nSecure arena is too small. It has %zu bytes left\n",
+         capacity - EccPemSecureArenaGetUsed(arena));
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT((int)EccPemSecureArenaGenerateKeys(arena, curve, capacity, &private_keys,
+                                                           NULL), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_BUFFER_TOO_SMALL);
+  TEST_ASSERT_EQUAL_INT(EccPemSecureArenaAlloc(arena, capacity) == NULL, 1);
+  uint8_t* first_key = read_keys - kNumKeys * 32;
+  EccPemSecureArenaClear(arena);
+  TEST_ASSERT_EQUAL_INT((int)EccPemSecureArenaGetUsed(arena), 0);
+  TEST_ASSERT_EQUAL_INT(memcmp(first_key, zeros, 32), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemSecureArenaAlloc(arena, capacity) == first_key, 1);
+  EccPemSecureArenaFree(arena);
+  printf("✓ Full arena rejected and cleared\n");
+
+  printf("\nExpected error message:\nCapacity of the arena cannot be 0.\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(EccPemSecureArenaCreate(0) == NULL, 1);
+  printf("✓ Empty arena rejected\n");
+
+  TEST_ASSERT_EQUAL_INT(EccPemSecureHeapDone(), 1);
+  printf("\nTesting EccPemSecureArena ----------------------------------------- [ " GREEN "PASSED" RESET " ]\n");
+}
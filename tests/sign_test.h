@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include "eccpem_error.h"
+#include "eccpem_read.h"
+#include "eccpem_sign.h"
+#include "eccpem_write.h"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+void RUN_SIGN_TESTS() {
+  printf("\nTesting EccPemSignBatch...\n");
+
+  enum { kNumDigests = 100, kSignatureSize = 160 };
+  static uint8_t digests[kNumDigests * 32];
+  static uint8_t signatures[kNumDigests * kSignatureSize];
+  size_t signature_lens[kNumDigests];
+  int results[kNumDigests];
+  TEST_ASSERT_EQUAL_INT(RAND_bytes(digests, sizeof(digests)), 1);
+
+  // Test signatures of every curve verify with the public key, on one and many threads
+  const char* curves[] = {"prime256v1", "secp256k1", "secp384r1", "secp521r1"};
+  for (size_t c = 0; c < sizeof(curves) / sizeof(curves[0]); ++c) {
+    TEST_ASSERT_EQUAL_INT(CreateECCKeysPemFiles(curves[c], "test_sign_pub.pem",
+                                                "test_sign_priv.pem"), 1);
+    EccPemKey* private_key = EccPemKeyLoadPrivateKeyFile("test_sign_priv.pem");
+    EccPemKey* public_key = EccPemKeyLoadPublicKeyFile("test_sign_pub.pem");
+    TEST_ASSERT_EQUAL_INT(private_key != NULL && public_key != NULL, 1);
+    TEST_ASSERT_EQUAL_INT(EccPemKeyIsPrivate(private_key), 1);
+    TEST_ASSERT_EQUAL_INT(EccPemKeyIsPrivate(public_key), 0);
+    TEST_ASSERT_EQUAL_INT(EccPemKeyGetCurve(public_key) == EccPemGetCurve(curves[c]), 1);
+    TEST_ASSERT_EQUAL_INT(EccPemKeyGetMaxSignatureSize(public_key) <= kSignatureSize, 1);
+
+    const unsigned int num_threads = c % 2 == 0 ? 1 : 4;
+    TEST_ASSERT_EQUAL_INT((int)EccPemSignBatch(private_key, digests, 32, kNumDigests, signatures,
+                                               kSignatureSize, signature_lens, num_threads),
+                          kNumDigests);
+    TEST_ASSERT_EQUAL_INT((int)EccPemVerifyBatch(public_key, digests, 32, kNumDigests,
+                                                 signatures, kSignatureSize, signature_lens,
+                                                 results, num_threads), kNumDigests);
+    TEST_ASSERT_EQUAL_INT((int)EccPemVerifyBatch(private_key, digests, 32, kNumDigests,
+                                                 signatures, kSignatureSize, signature_lens,
+                                                 NULL, 2), kNumDigests);
+    TEST_ASSERT_EQUAL_INT(results[0] == 1 && results[kNumDigests - 1] == 1, 1);
+    EccPemKeyFree(private_key);
+    EccPemKeyFree(public_key);
+  }
+  printf("✓ Signatures of all curves verified\n");
+
+  // Test generated keys and keys loaded from PEM buffers expose their bytes
+  const EccPemCurve* curve = EccPemGetCurve("prime256v1");
+  EccPemKey* generated_key = EccPemKeyGenerate(curve);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyWritePemFiles(generated_key, "test_sign_gen_pub.pem",
+                                               "test_sign_gen_priv.pem"), 1);
+  uint8_t expected_private_key[32];
+  uint8_t expected_public_key[33];
+  TEST_ASSERT_EQUAL_INT(ReadPrivateKeyPemFile("test_sign_gen_priv.pem", expected_private_key, 32), 1);
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile("test_sign_gen_pub.pem", expected_public_key, 33), 1);
+  size_t len = 0;
+  TEST_ASSERT_EQUAL_INT(memcmp(EccPemKeyGetPrivateKey(generated_key, &len), expected_private_key,
+                               32), 0);
+  TEST_ASSERT_EQUAL_INT((int)len, 32);
+  TEST_ASSERT_EQUAL_INT(memcmp(EccPemKeyGetPublicKey(generated_key, &len), expected_public_key,
+                               33), 0);
+  TEST_ASSERT_EQUAL_INT((int)len, 33);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyGetEvpPkey(generated_key) != NULL, 1);
+
+  char pub_pem[512];
+  char priv_pem[512];
+  size_t pub_len = 0;
+  size_t priv_len = 0;
+  TEST_ASSERT_EQUAL_INT(CreateECCKeysPemBuffers("secp384r1", pub_pem, sizeof(pub_pem), &pub_len,
+                                                priv_pem, sizeof(priv_pem), &priv_len), 1);
+  EccPemKey* buffer_key = EccPemKeyLoadPublicKeyBuffer(pub_pem, pub_len);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyCheckCurve(buffer_key, EccPemGetCurve("secp384r1")), 1);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyGetPrivateKey(buffer_key, &len) == NULL && len == 0, 1);
+  EccPemKeyGetPublicKey(buffer_key, &len);
+  TEST_ASSERT_EQUAL_INT((int)len, 49);
+  EccPemKeyFree(buffer_key);
+  buffer_key = EccPemKeyLoadPrivateKeyBuffer(priv_pem, priv_len);
+  EccPemKeyGetPrivateKey(buffer_key, &len);
+  TEST_ASSERT_EQUAL_INT((int)len, 48);
+  EccPemKeyFree(buffer_key);
+  EccPemKeyFree(generated_key);
+  remove("test_sign_gen_pub.pem");
+  remove("test_sign_gen_priv.pem");
+  printf("✓ Key bytes of generated and buffered keys\n");
+
+  // Test signatures of other digests and tampered signatures are rejected
+  digests[3 * 32] ^= 1;
+  signatures[7 * kSignatureSize + signature_lens[7] - 1] ^= 1;
+  signature_lens[9] = 0;
+  EccPemKey* public_key = EccPemKeyLoadPublicKeyFile("test_sign_pub.pem");
+  TEST_ASSERT_EQUAL_INT((int)EccPemVerifyBatch(public_key, digests, 32, kNumDigests, signatures,
+                                               kSignatureSize, signature_lens, results, 0),
+                        kNumDigests - 3);
+  TEST_ASSERT_EQUAL_INT(results[3], 0);
+  TEST_ASSERT_EQUAL_INT(results[7], 0);
+  TEST_ASSERT_EQUAL_INT(results[9], 0);
+  TEST_ASSERT_EQUAL_INT(results[8], 1);
+  printf("✓ Invalid signatures rejected\n");
+
+  // Test a public key cannot sign and signature slots must fit the key
+  EccPemSetErrorLogging(0);
+  TEST_ASSERT_EQUAL_INT((int)EccPemSignBatch(public_key, digests, 32, kNumDigests, signatures,
+                                             kSignatureSize, signature_lens, 1), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_INVALID_ARGUMENT);
+  TEST_ASSERT_EQUAL_INT(signature_lens[0], 0);
+  EccPemKey* private_key = EccPemKeyLoadPrivateKeyFile("test_sign_priv.pem");
+  TEST_ASSERT_EQUAL_INT((int)EccPemSignBatch(private_key, digests, 32, kNumDigests, signatures,
+                                             32, signature_lens, 1), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_BUFFER_TOO_SMALL);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyLoadPublicKeyFile("nonexistent.pem") == NULL, 1);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_OPEN_FAILED);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyCheckCurve(public_key, EccPemGetCurve("secp384r1")), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_NOT_EC_KEY);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyWritePemFiles(public_key, "test_sign_pub.pem",
+                                               "test_sign_priv.pem"), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_INVALID_ARGUMENT);
+  EccPemSetErrorLogging(1);
+  EccPemKeyFree(private_key);
+  EccPemKeyFree(public_key);
+  remove("test_sign_pub.pem");
+  remove("test_sign_priv.pem");
+  printf("✓ Invalid arguments rejected\n");
+
+  printf("\nTesting EccPemSignBatch ------------------------------------------- [ " GREEN "PASSED" RESET " ]\n");
+}
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <openssl/obj_mac.h>
+
+#include "eccpem_read.h"
+#include "eccpem_store.h"
+#include "eccpem_write.h"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+void RUN_KEY_STORE_TESTS() {
+  printf("\nTesting EccPemStore...\n");
+
+  const char* pub_files[] = {"test_store_pub_0.pem", "test_store_pub_1.pem", "test_store_pub_2.pem"};
+  const char* priv_files[] = {"test_store_priv_0.pem", "test_store_priv_1.pem", NULL};
+  const char* store_file = "test_keys.store";
+  CreateECCKeysPemFiles("prime256v1", pub_files[0], priv_files[0]);
+  CreateECCKeysPemFiles("secp384r1", pub_files[1], priv_files[1]);
+  CreateECCKeysPemFiles("prime256v1", pub_files[2], "test_store_priv_2.pem");
+
+  // Test building a store from PEM files, one key without private key
+  TEST_ASSERT_EQUAL_INT(EccPemStoreBuild(store_file, pub_files, priv_files, 3), 1);
+  EccPemStore* store = EccPemStoreOpen(store_file);
+  TEST_ASSERT_EQUAL_INT(store != NULL, 1);
+  TEST_ASSERT_EQUAL_INT((int)EccPemStoreNumRecords(store), 3);
+  // The store holds private scalars, so only the owner may read it
+  struct stat store_stat;
+  TEST_ASSERT_EQUAL_INT(stat(store_file, &store_stat), 0);
+  TEST_ASSERT_EQUAL_INT((int)(store_stat.st_mode & 0777), 0600);
+  printf("✓ Key store built from PEM files\n");
+
+  // Test lookup by fingerprint returns the key read from PEM
+  uint8_t public_key[33];
+  uint8_t private_key[32];
+  uint8_t fingerprint[ECCPEM_FINGERPRINT_SIZE];
+  ReadPublicKeyPemFile(pub_files[0], public_key, 33);
+  ReadPrivateKeyPemFile(priv_files[0], private_key, 32);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyFingerprint(public_key, 33, fingerprint), 1);
+  const EccPemStoreRecord* record = EccPemStoreLookup(store, fingerprint);
+  TEST_ASSERT_EQUAL_INT(record != NULL, 1);
+  TEST_ASSERT_EQUAL_INT(record->curve_nid, NID_X9_62_prime256v1);
+  TEST_ASSERT_EQUAL_INT(record->public_key_len, 33);
+  TEST_ASSERT_EQUAL_INT(record->private_key_len, 32);
+  TEST_ASSERT_EQUAL_INT(memcmp(record->public_key, public_key, 33), 0);
+  TEST_ASSERT_EQUAL_INT(memcmp(record->private_key, private_key, 32), 0);
+  printf("✓ Key found by fingerprint\n");
+
+  // Test every record can be found and converted back to PEM
+  for (size_t i = 0; i < EccPemStoreNumRecords(store); ++i) {
+    const EccPemStoreRecord* stored = EccPemStoreGetRecord(store, i);
+    TEST_ASSERT_EQUAL_INT(EccPemStoreLookup(store, stored->fingerprint) == stored, 1);
+    if (stored->curve_nid == NID_secp384r1) {
+      TEST_ASSERT_EQUAL_INT(stored->public_key_len, 49);
+      TEST_ASSERT_EQUAL_INT(stored->private_key_len, 48);
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(EccPemStoreRecordToPemFiles(record, "test_store_out_pub.pem",
+                                                    "test_store_out_priv.pem"), 1);
+  uint8_t exported_key[33];
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile("test_store_out_pub.pem", exported_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(exported_key, public_key, 33), 0);
+  TEST_ASSERT_EQUAL_INT(ReadPrivateKeyPemFile("test_store_out_priv.pem", exported_key, 32), 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(exported_key, private_key, 32), 0);
+  remove("test_store_out_pub.pem");
+  remove("test_store_out_priv.pem");
+  printf("✓ Record converted back to PEM files\n");
+
+  // Test unknown fingerprint
+  memset(fingerprint, 0xAB, sizeof(fingerprint));
+  TEST_ASSERT_EQUAL_INT(EccPemStoreLookup(store, fingerprint) == NULL, 1);
+  EccPemStoreClose(store);
+  printf("✓ Unknown fingerprint not found\n");
+
+  // Test mismatching public and private key files are rejected
+  const char* mismatched_priv[] = {priv_files[1], NULL, NULL};
+  printf("\nExpected error message:\nPublic and private key files do not belong to the same key.\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(EccPemStoreBuild(store_file, pub_files, mismatched_priv, 3), 0);
+  printf("✓ Mismatching key files rejected\n");
+
+  // Test a file that is not a store is rejected
+  printf("\nExpected error message:\nInvalid key store file.\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(EccPemStoreOpen(pub_files[0]) == NULL, 1);
+  printf("✓ Invalid key store rejected\n");
+
+  for (int i = 0; i < 3; ++i) {
+    remove(pub_files[i]);
+  }
+  remove(priv_files[0]);
+  remove(priv_files[1]);
+  remove("test_store_priv_2.pem");
+  remove(store_file);
+
+  printf("\nTesting EccPemStore ----------------------------------------------- [ " GREEN "PASSED" RESET " ]\n");
+}
@@ -1,6 +1,8 @@
+#include "eccpem_write.h"
 #include "unit_tests_api.h"
 #include "utils.h"
 #include <stdio.h>
+#include <string.h>
 
 #define GREEN "\x1B[1;32m"
 #define RESET "\x1B[0m"
@@ -48,3 +50,60 @@ void RUN_UTILS_TESTS() {
   printf("\nTesting VerifyPemFileFormat ----------------------------------------- [ "
          GREEN "PASSED" RESET " ]\n");
 }
+
+void RUN_PEM_KEY_BLOCK_TESTS() {
+  printf("\nTesting HasPemKeyBlock...\n");
+
+  // Test generated keys pass, each only as its own key type
+  char pub_pem[512];
+  char priv_pem[512];
+  size_t pub_len = 0;
+  size_t priv_len = 0;
+  TEST_ASSERT_EQUAL_INT(CreateECCKeysPemBuffers("secp521r1", pub_pem, sizeof(pub_pem), &pub_len,
+                                                priv_pem, sizeof(priv_pem), &priv_len), 1);
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(pub_pem, pub_len, 0), 1);
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(priv_pem, priv_len, 1), 1);
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(pub_pem, pub_len, 1), 0);
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(priv_pem, priv_len, 0), 0);
+  printf("✓ Key blocks of the wanted type accepted\n");
+
+  // Test keys behind other blocks and RFC 1421 headers pass
+  char pem[1024];
+  int len = snprintf(pem, sizeof(pem), "-----BEGIN EC PARAMETERS-----\nBgUrgQQAIw==\n"
+                     "-----END EC PARAMETERS-----\n%.*s", (int)priv_len, priv_pem);
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(pem, (size_t)len, 1), 1);
+  const char* public_key_body = pub_pem + strlen("-----BEGIN PUBLIC KEY-----\n");
+  len = snprintf(pem, sizeof(pem), "-----BEGIN PUBLIC KEY-----\nComment: test\n\n%s",
+                 public_key_body);
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(pem, (size_t)len, 0), 1);
+  len = snprintf(pem, sizeof(pem), "-----BEGIN -----BEGIN -----BEGIN x\n%.*s", (int)pub_len,
+                 pub_pem);
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(pem, (size_t)len, 0), 1);
+  printf("✓ Keys behind other blocks and headers accepted\n");
+
+  // Test garbage, mismatched labels, bad base64 and bad lengths are rejected
+  const char* garbage = "This is not a PEM file at all\n";
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(garbage, strlen(garbage), 0), 0);
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(pub_pem, 0, 0), 0);
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(NULL, 10, 0), 0);
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(pub_pem, pub_len / 2, 0), 0);
+
+  len = snprintf(pem, sizeof(pem), "%.*s", (int)pub_len, pub_pem);
+  memcpy(strstr(pem, "-----END ") + strlen("-----END "), "PUBLIC KEX", 10);
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(pem, (size_t)len, 0), 0);
+
+  len = snprintf(pem, sizeof(pem), "%.*s", (int)pub_len, pub_pem);
+  pem[40] = '*';
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(pem, (size_t)len, 0), 0);
+
+  len = snprintf(pem, sizeof(pem), "%.*s", (int)pub_len, pub_pem);
+  memmove(pem + 40, pem + 41, (size_t)len - 41);
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(pem, (size_t)len - 1, 0), 0);
+
+  const char* tiny = "-----BEGIN PUBLIC KEY-----\nMAA=\n-----END PUBLIC KEY-----\n";
+  TEST_ASSERT_EQUAL_INT(HasPemKeyBlock(tiny, strlen(tiny), 0), 0);
+  printf("✓ Garbage, mismatched labels and malformed bodies rejected\n");
+
+  printf("\nTesting HasPemKeyBlock ---------------------------------------------- [ "
+         GREEN "PASSED" RESET " ]\n");
+}
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "eccpem_error.h"
+#include "eccpem_read.h"
+#include "eccpem_watch.h"
+#include "eccpem_write.h"
+#include "unit_tests_api.h"
+
+#define GREEN "\x1B[1;32m"
+#define RESET "\x1B[0m"
+
+void RUN_KEY_WATCHER_TESTS() {
+  printf("\nTesting EccPemKeyWatcher...\n");
+
+  // Test the initial load holds every key of the directory, split over chunks
+  enum { kNumKeys = 600 };
+  mkdir("test_watchdir", 0755);
+  mkdir("test_watchdir_priv", 0755);
+  char pub_names[kNumKeys][48];
+  char priv_names[kNumKeys][48];
+  const char* pub_files[kNumKeys];
+  const char* priv_files[kNumKeys];
+  for (int i = 0; i < kNumKeys; ++i) {
+    snprintf(pub_names[i], sizeof(pub_names[i]), "test_watchdir/key_%03d.pem", i);
+    snprintf(priv_names[i], sizeof(priv_names[i]), "test_watchdir_priv/key_%03d.pem", i);
+    pub_files[i] = pub_names[i];
+    priv_files[i] = priv_names[i];
+  }
+  TEST_ASSERT_EQUAL_INT((int)CreateECCKeysPemFilesBatch("prime256v1", kNumKeys, pub_files,
+                                                        priv_files, NULL), kNumKeys);
+
+  EccPemKeyWatcher* watcher = EccPemKeyWatcherCreate("test_watchdir", 33, 2);
+  TEST_ASSERT_EQUAL_INT(watcher != NULL, 1);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyWatcherGetFd(watcher) >= 0, 1);
+  EccPemKeySnapshot* old_snapshot = EccPemKeyWatcherAcquireSnapshot(watcher);
+  TEST_ASSERT_EQUAL_INT((int)EccPemKeySnapshotNumKeys(old_snapshot), kNumKeys);
+  TEST_ASSERT_EQUAL_INT((int)EccPemKeySnapshotGetGeneration(old_snapshot), 1);
+  uint8_t public_key[33];
+  const char* file_name = NULL;
+  for (int i = 0; i < kNumKeys; ++i) {
+    TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile(pub_files[i], public_key, 33), 1);
+    const uint8_t* key = EccPemKeySnapshotGetKey(old_snapshot, i, &file_name);
+    TEST_ASSERT_EQUAL_INT(strcmp(file_name, pub_files[i] + strlen("test_watchdir/")), 0);
+    TEST_ASSERT_EQUAL_INT(memcmp(key, public_key, 33), 0);
+    TEST_ASSERT_EQUAL_INT(EccPemKeySnapshotFind(old_snapshot, file_name) == key, 1);
+  }
+  TEST_ASSERT_EQUAL_INT(EccPemKeySnapshotGetKey(old_snapshot, kNumKeys, NULL) == NULL, 1);
+  TEST_ASSERT_EQUAL_INT(EccPemKeySnapshotFind(old_snapshot, "key_600.pem") == NULL, 1);
+  TEST_ASSERT_EQUAL_INT(EccPemKeySnapshotFind(old_snapshot, "a.pem") == NULL, 1);
+  printf("✓ %d keys loaded into the first snapshot\n", kNumKeys);
+
+  // Test a poll without changes keeps the snapshot
+  EccPemWatchStats stats;
+  TEST_ASSERT_EQUAL_INT(EccPemKeyWatcherPoll(watcher, 0, &stats), 1);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_events, 0);
+  TEST_ASSERT_EQUAL_INT((int)stats.generation, 1);
+
+  // Test a replaced, a new, a deleted and a corrupted file are applied in one
+  // update, while the previous snapshot stays unchanged
+  uint8_t old_key[33];
+  memcpy(old_key, EccPemKeySnapshotFind(old_snapshot, "key_010.pem"), 33);
+  TEST_ASSERT_EQUAL_INT(CreateECCKeysPemFiles("prime256v1", "test_watch_new.pem",
+                                              "test_watch_priv.pem"), 1);
+  uint8_t new_key[33];
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile("test_watch_new.pem", new_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(rename("test_watch_new.pem", "test_watchdir/key_010.pem"), 0);
+  TEST_ASSERT_EQUAL_INT(CreateECCKeysPemFiles("prime256v1", "test_watchdir/key_700.pem",
+                                              "test_watch_priv.pem"), 1);
+  remove(pub_files[kNumKeys - 1]);
+  FILE* fp = fopen("test_watchdir/key_300.pem", "w");
+  fputs("-----BEGIN PUBLIC KEY-----\n!!!!\n-----END PUBLIC KEY-----\n", fp);
+  fclose(fp);
+  fp = fopen("test_watchdir/notes.txt", "w");
+  fputs("not a key\n", fp);
+  fclose(fp);
+
+  printf("\nExpected error message:\n"
+         "Failed to read public key from PEM file\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(EccPemKeyWatcherPoll(watcher, 1000, &stats), 1);
+  TEST_ASSERT_EQUAL_INT(stats.num_events >= 5, 1);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_updated, 2);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_removed, 1);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_failed, 1);
+  TEST_ASSERT_EQUAL_INT(stats.full_reload, 0);
+  TEST_ASSERT_EQUAL_INT((int)stats.generation, 2);
+
+  EccPemKeySnapshot* snapshot = EccPemKeyWatcherAcquireSnapshot(watcher);
+  TEST_ASSERT_EQUAL_INT((int)EccPemKeySnapshotGetGeneration(snapshot), 2);
+  TEST_ASSERT_EQUAL_INT((int)EccPemKeySnapshotNumKeys(snapshot), kNumKeys - 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(EccPemKeySnapshotFind(snapshot, "key_010.pem"), new_key, 33), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemKeySnapshotFind(snapshot, "key_599.pem") == NULL, 1);
+  TEST_ASSERT_EQUAL_INT(EccPemKeySnapshotFind(snapshot, "key_300.pem") == NULL, 1);
+  TEST_ASSERT_EQUAL_INT(EccPemKeySnapshotFind(snapshot, "key_700.pem") != NULL, 1);
+  EccPemKeySnapshotGetKey(snapshot, kNumKeys - 2, &file_name);
+  TEST_ASSERT_EQUAL_INT(strcmp(file_name, "key_700.pem"), 0);
+  EccPemKeySnapshotGetKey(snapshot, 300, &file_name);
+  TEST_ASSERT_EQUAL_INT(strcmp(file_name, "key_301.pem"), 0);
+  TEST_ASSERT_EQUAL_INT(memcmp(EccPemKeySnapshotFind(old_snapshot, "key_010.pem"), old_key, 33),
+                        0);
+  TEST_ASSERT_EQUAL_INT(EccPemKeySnapshotFind(old_snapshot, "key_599.pem") != NULL, 1);
+  TEST_ASSERT_EQUAL_INT((int)EccPemKeySnapshotNumKeys(old_snapshot), kNumKeys);
+  printf("✓ %d events applied in %.6f sec\n", (int)stats.num_events, stats.elapsed_seconds);
+
+  // Test symbolic and hard links created after startup are picked up
+  TEST_ASSERT_EQUAL_INT(CreateECCKeysPemFiles("prime256v1", "test_watch_link.pem",
+                                              "test_watch_priv.pem"), 1);
+  uint8_t link_key[33];
+  TEST_ASSERT_EQUAL_INT(ReadPublicKeyPemFile("test_watch_link.pem", link_key, 33), 1);
+  TEST_ASSERT_EQUAL_INT(symlink("../test_watch_link.pem", "test_watchdir/key_710.pem"), 0);
+  TEST_ASSERT_EQUAL_INT(link("test_watch_link.pem", "test_watchdir/key_720.pem"), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemKeyWatcherPoll(watcher, 1000, &stats), 1);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_updated, 2);
+  TEST_ASSERT_EQUAL_INT((int)stats.num_failed, 0);
+  EccPemKeySnapshot* link_snapshot = EccPemKeyWatcherAcquireSnapshot(watcher);
+  TEST_ASSERT_EQUAL_INT((int)EccPemKeySnapshotNumKeys(link_snapshot), kNumKeys + 1);
+  TEST_ASSERT_EQUAL_INT(memcmp(EccPemKeySnapshotFind(link_snapshot, "key_710.pem"), link_key, 33),
+                        0);
+  TEST_ASSERT_EQUAL_INT(memcmp(EccPemKeySnapshotFind(link_snapshot, "key_720.pem"), link_key, 33),
+                        0);
+  EccPemKeySnapshotRelease(link_snapshot);
+  printf("✓ Links created after startup picked up\n");
+
+  // Test a snapshot outlives its watcher
+  EccPemKeySnapshotRelease(old_snapshot);
+  EccPemKeyWatcherFree(watcher);
+  TEST_ASSERT_EQUAL_INT(memcmp(EccPemKeySnapshotFind(snapshot, "key_010.pem"), new_key, 33), 0);
+  EccPemKeySnapshotRelease(snapshot);
+  printf("✓ Snapshot outlived its watcher\n");
+
+  // Test a deleted directory stops the watcher
+  EccPemSetErrorLogging(0);
+  watcher = EccPemKeyWatcherCreate("test_watchdir", 33, 0);
+  TEST_ASSERT_EQUAL_INT(watcher != NULL, 1);
+  for (int i = 0; i < kNumKeys; ++i) {
+    remove(pub_files[i]);
+    remove(priv_files[i]);
+  }
+  remove("test_watchdir/key_700.pem");
+  remove("test_watchdir/key_710.pem");
+  remove("test_watchdir/key_720.pem");
+  remove("test_watch_link.pem");
+  remove("test_watchdir/notes.txt");
+  remove("test_watch_priv.pem");
+  rmdir("test_watchdir_priv");
+  rmdir("test_watchdir");
+  TEST_ASSERT_EQUAL_INT(EccPemKeyWatcherPoll(watcher, 1000, &stats), 0);
+  TEST_ASSERT_EQUAL_INT(EccPemGetLastError(), ECCPEM_ERROR_OPEN_FAILED);
+  EccPemSetErrorLogging(1);
+  EccPemKeyWatcherFree(watcher);
+  printf("✓ Deleted directory reported\n");
+
+  // Test missing directory
+  printf("\nExpected error message:\n"
+         "Unable to watch key directory.\n");
+  printf("Actual output:\n");
+  TEST_ASSERT_EQUAL_INT(EccPemKeyWatcherCreate("test_watchdir", 33, 0) == NULL, 1);
+  printf("✓ Missing directory rejected\n");
+
+  printf("\nTesting EccPemKeyWatcher ------------------------------------------ [ " GREEN "PASSED" RESET " ]\n");
+}